@@ -693,6 +693,35 @@ function TEST_ec_recovery_unfound() {
     delete_erasure_coded_pool $poolname
 }
 
+# A parity delta write that cannot read one of the shards it modifies
+# reads the whole stripes instead
+function TEST_ec_parity_delta_write_eio() {
+    local dir=$1
+    local objname=myobject
+
+    setup_osds 7 || return 1
+    ceph config set osd osd_ec_parity_delta_writes true || return 1
+
+    local poolname=pool-jerasure
+    create_erasure_coded_pool $poolname 3 2 || return 1
+    ceph osd pool set $poolname allow_ec_overwrites true || return 1
+
+    rados_put $dir $poolname $objname || return 1
+    # shard 0 holds the chunk the overwrite modifies
+    inject_eio ec data $poolname $objname $dir 0 || return 1
+
+    printf "%*s" 512 EEEE > $dir/UPDATE
+    rados --pool $poolname put $objname $dir/UPDATE --offset 1024 || return 1
+    dd if=$dir/UPDATE of=$dir/ORIGINAL bs=1024 seek=1 conv=notrunc || return 1
+
+    rados_get $dir $poolname $objname || return 1
+    # no OSD went down
+    test $(ceph osd dump | grep -c '^osd\.[0-9]* up') = 7 || return 1
+
+    rm -f $dir/UPDATE
+    delete_erasure_coded_pool $poolname
+}
+
 main test-erasure-eio "$@"
 
 # Local Variables:
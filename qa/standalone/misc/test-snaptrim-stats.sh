@@ -180,6 +180,68 @@ function TEST_snaptrim_stats_multiple_snaps() {
 
     teardown $dir || return 1
 }
+function TEST_snaptrim_batched_ec() {
+    local dir=$1
+    local poolname=test
+    local OSDS=3
+    local objects=20
+    local WAIT_FOR_UPDATE=10
+
+    setup $dir || return 1
+    run_mon $dir a || return 1
+    run_mgr $dir x || return 1
+    # trim the clones of several heads in each transaction
+    for osd in $(seq 0 $(expr $OSDS - 1))
+    do
+      run_osd $dir $osd --osd_pool_default_pg_autoscale_mode=off \
+          --osd_snap_trim_batch_size=8 || return 1
+    done
+
+    # disable scrubs
+    ceph osd set noscrub || return 1
+    ceph osd set nodeep-scrub || return 1
+
+    # a single PG, so that the clones of all the objects end up in batches
+    create_ec_pool $poolname false k=2 m=1 || return 1
+    poolid=$(ceph osd dump | grep "^pool.*[']${poolname}[']" | awk '{ print $2 }')
+
+    # write a few objects
+    TESTDATA="testdata.1"
+    dd if=/dev/urandom of=$TESTDATA bs=4096 count=1
+    for i in `seq 1 $objects`
+    do
+        rados -p $poolname put obj${i} $TESTDATA
+    done
+    rm -f $TESTDATA
+
+    # create a snapshot, clones
+    rados -p $poolname mksnap snap1
+    TESTDATA="testdata.2"
+    dd if=/dev/urandom of=$TESTDATA  bs=4096 count=1
+    for i in `seq 1 $objects`
+    do
+        rados -p $poolname put obj${i} $TESTDATA
+    done
+    rm -f $TESTDATA
+
+    # remove the snapshot, the batches must not bring down the primary
+    rados -p $poolname rmsnap snap1
+    wait_for_clean || return 1
+    sleep $WAIT_FOR_UPDATE
+    test $(ceph osd dump | grep -c '^osd\.[0-9]* up') -eq $OSDS || return 1
+    local objects_trimmed=$(ceph pg ${poolid}.0 query | \
+        jq '.info.stats.objects_trimmed')
+    test $objects_trimmed -eq $objects || return 1
+
+    # the heads are intact
+    for i in `seq 1 $objects`
+    do
+        rados -p $poolname stat obj${i} || return 1
+    done
+
+    teardown $dir || return 1
+}
+
 main test-snaptrim-stats "$@"
 
 # Local Variables:
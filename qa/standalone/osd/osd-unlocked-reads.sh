@@ -0,0 +1,77 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7155" # git grep '\<7155\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+    CEPH_ARGS+="--osd_unlocked_reads=true "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+# reads in flight without the pg lock, and the ops parked behind them,
+# must survive interval changes in op order; ceph_test_rados checks every
+# reply against its model of the objects
+function TEST_unlocked_reads_interval_change() {
+    local dir=$1
+    local poolname=test
+    local OSDS=3
+
+    run_mon $dir a --osd_pool_default_size=$OSDS || return 1
+    run_mgr $dir x || return 1
+    for osd in $(seq 0 $(expr $OSDS - 1))
+    do
+      run_osd $dir $osd || return 1
+    done
+    create_pool $poolname 4 4 || return 1
+    wait_for_clean || return 1
+
+    ceph_test_rados --pool $poolname --max-ops 20000 --objects 20 \
+        --max-in-flight 32 --size 65536 --no-omap \
+        --op read 100 --op write 30 --op delete 5 > $dir/test_rados.log 2>&1 &
+    local pid=$!
+
+    # new intervals while the reads run
+    for i in $(seq 1 10)
+    do
+        kill -0 $pid 2>/dev/null || break
+        ceph osd down $(expr $i % $OSDS) || return 1
+        sleep 2
+    done
+
+    wait $pid || { cat $dir/test_rados.log ; return 1 ; }
+    wait_for_clean || return 1
+    for osd in $(seq 0 $(expr $OSDS - 1))
+    do
+      ceph tell osd.$osd version || return 1
+    done
+}
+
+main osd-unlocked-reads "$@"
+
+# Local Variables:
+# compile-command: "cd build ; make -j4 && \
+#   ../qa/run-standalone.sh osd-unlocked-reads.sh"
+# End:
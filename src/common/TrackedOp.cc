@@ -12,6 +12,8 @@
 
 #include "TrackedOp.h"
 
+#include <algorithm>
+
 #define dout_context cct
 #define dout_subsys ceph_subsys_optracker
 #undef dout_prefix
@@ -24,6 +26,7 @@ using std::pair;
 using std::set;
 using std::string;
 using std::stringstream;
+using std::vector;
 
 using ceph::Formatter;
 
@@ -68,6 +71,23 @@ void* OpHistoryServiceThread::entry() {
   return nullptr;
 }
 
+OpHistory::OpHistory(CephContext *c)
+  : cct(c), opsvc(this),
+    id([] {
+      static std::atomic<uint64_t> next_id = {1};
+      return next_id++;
+    }())
+{
+  PerfCountersBuilder b(cct, "osd-slow-ops",
+			l_osd_slow_op_first, l_osd_slow_op_last);
+  b.add_u64_counter(l_osd_slow_op_count, "slow_ops_count",
+		    "Number of operations taking over ten second");
+
+  logger.reset(b.create_perf_counters());
+  cct->get_perfcounters_collection()->add(logger.get());
+
+  opsvc.create("OpHistorySvc");
+}
 
 void OpHistory::on_shutdown()
 {
@@ -95,6 +115,61 @@ void OpHistory::_insert_delayed(const utime_t& now, TrackedOpRef op)
   cleanup(now);
 }
 
+OpHistory::HistoryRing& OpHistory::get_ring()
+{
+  // the ring of the OpHistory this thread used last
+  static thread_local uint64_t cached_id = 0;
+  static thread_local HistoryRing* cached_ring = nullptr;
+  if (cached_id != id) {
+    std::lock_guard l(rings_lock);
+    auto& ring = rings[std::this_thread::get_id()];
+    if (!ring) {
+      ring = std::make_unique<HistoryRing>();
+    }
+    cached_id = id;
+    cached_ring = ring.get();
+  }
+  return *cached_ring;
+}
+
+void OpHistory::insert_unsampled(uint64_t seq, const utime_t& initiated,
+				 const utime_t& done)
+{
+  if (shutdown)
+    return;
+
+  auto& ring = get_ring();
+  auto& r = ring.records[ring.head++ % OPTRACKER_HISTORY_RING_SIZE];
+  r.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  r.initiated.store(initiated.to_nsec(), std::memory_order_relaxed);
+  r.done.store(done.to_nsec(), std::memory_order_relaxed);
+  r.seq.store(seq, std::memory_order_release);
+}
+
+vector<OpHistory::UnsampledOp> OpHistory::get_unsampled_ops()
+{
+  vector<UnsampledOp> ops;
+  std::lock_guard l(rings_lock);
+  for (auto& [tid, ring] : rings) {
+    for (auto& r : ring->records) {
+      uint64_t seq = r.seq.load(std::memory_order_acquire);
+      if (seq == 0)
+	continue;
+      uint64_t initiated = r.initiated.load(std::memory_order_relaxed);
+      uint64_t done = r.done.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (r.seq.load(std::memory_order_relaxed) != seq)
+	continue;
+      ops.push_back(UnsampledOp{
+	seq,
+	utime_t(std::chrono::nanoseconds(initiated)),
+	utime_t(std::chrono::nanoseconds(done))});
+    }
+  }
+  return ops;
+}
+
 void OpHistory::cleanup(utime_t now)
 {
   while (arrived.size() &&
@@ -146,6 +221,44 @@ void OpHistory::dump_ops(utime_t now, Formatter *f, set<string> filters, bool by
     }
     f->close_section();
   }
+  // they do not know where they came from, so no filter matches them
+  if (filters.empty() || (filters.size() == 1 && filters.begin()->empty())) {
+    dump_unsampled_ops(now, f, by_duration);
+  }
+  f->close_section();
+}
+
+void OpHistory::dump_unsampled_ops(utime_t now, Formatter *f, bool by_duration)
+{
+  auto ops = get_unsampled_ops();
+  ops.erase(std::remove_if(ops.begin(), ops.end(), [&](const UnsampledOp& op) {
+    return now - op.initiated > (double)history_duration.load();
+  }), ops.end());
+  auto op_duration = [](const UnsampledOp& op) {
+    return op.done - op.initiated;
+  };
+  // the same order as the sampled ops, keeping at most as many of them
+  size_t keep = std::min(ops.size(), history_size.load());
+  if (by_duration) {
+    std::sort(ops.begin(), ops.end(), [&](const auto& a, const auto& b) {
+      return op_duration(a) > op_duration(b);
+    });
+    ops.resize(keep);
+  } else {
+    std::sort(ops.begin(), ops.end(), [](const auto& a, const auto& b) {
+      return a.initiated < b.initiated;
+    });
+    ops.erase(ops.begin(), ops.end() - keep);
+  }
+  f->open_array_section("unsampled_ops");
+  for (auto& op : ops) {
+    f->open_object_section("op");
+    f->dump_unsigned("seq", op.seq);
+    f->dump_stream("initiated_at") << op.initiated;
+    f->dump_float("age", now - op.initiated);
+    f->dump_float("duration", op_duration(op));
+    f->close_section();
+  }
   f->close_section();
 }
 
@@ -288,6 +401,7 @@ bool OpTracker::register_inflight_op(TrackedOp *i)
 
   std::shared_lock l{lock};
   uint64_t current_seq = ++seq;
+  bool sampled = is_sampled(current_seq);
   uint32_t shard_index = current_seq % num_optracker_shards;
   ShardedTrackingData* sdata = sharded_in_flight_list[shard_index];
   ceph_assert(NULL != sdata);
@@ -295,10 +409,22 @@ bool OpTracker::register_inflight_op(TrackedOp *i)
     std::lock_guard locker(sdata->ops_in_flight_lock_sharded);
     sdata->ops_in_flight_sharded.push_back(*i);
     i->seq = current_seq;
+    i->sampled = sampled;
   }
   return true;
 }
 
+bool OpTracker::is_sampled(uint64_t seq) const
+{
+  double rate = sample_rate;
+  if (rate >= 1.0)
+    return true;
+  if (rate <= 0.0)
+    return false;
+  // every op that takes the running count of sampled ops to the next integer
+  return (uint64_t)(seq * rate) != (uint64_t)((seq - 1) * rate);
+}
+
 void OpTracker::unregister_inflight_op(TrackedOp* const i)
 {
   // caller checks;
@@ -320,6 +446,17 @@ void OpTracker::record_history_op(TrackedOpRef&& i)
   history.insert(ceph_clock_now(), std::move(i));
 }
 
+bool OpTracker::record_unsampled_op(TrackedOp *i)
+{
+  i->done_at = ceph_clock_now();
+  if (i->get_duration() >= history.get_slow_op_threshold()) {
+    // so that dump_historic_slow_ops() still has all the slow ones
+    return false;
+  }
+  history.insert_unsampled(i->seq, i->get_initiated(), i->done_at);
+  return true;
+}
+
 bool OpTracker::visit_ops_in_flight(utime_t* oldest_secs,
 				    std::function<bool(TrackedOp&)>&& visit)
 {
@@ -484,7 +621,7 @@ void TrackedOp::mark_event(std::string_view event, utime_t stamp)
   if (!state)
     return;
 
-  {
+  if (sampled) {
     std::lock_guard l(lock);
     events.emplace_back(stamp, event);
   }
@@ -505,6 +642,9 @@ void TrackedOp::dump(utime_t now, Formatter *f, OpTracker::dumper lambda) const
   f->dump_stream("initiated_at") << get_initiated();
   f->dump_float("age", now - get_initiated());
   f->dump_float("duration", get_duration());
+  if (!sampled) {
+    f->dump_bool("sampled", false);
+  }
   {
     f->open_object_section("type_data");
     lambda(*this, f);
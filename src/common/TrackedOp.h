@@ -14,7 +14,11 @@
 #ifndef TRACKEDREQUEST_H_
 #define TRACKEDREQUEST_H_
 
+#include <array>
 #include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
 #include "common/StackStringStream.h"
 #include "common/ceph_mutex.h"
 #include "common/histogram.h"
@@ -24,6 +28,7 @@
 #include "msg/Message.h"
 
 #define OPTRACKER_PREALLOC_EVENTS 20
+#define OPTRACKER_HISTORY_RING_SIZE 128
 
 class TrackedOp;
 class OpHistory;
@@ -59,6 +64,31 @@ enum {
 };
 
 class OpHistory {
+public:
+  /// what is left of an op that was not sampled
+  struct UnsampledOp {
+    uint64_t seq;
+    utime_t initiated;
+    utime_t done;
+  };
+
+private:
+  /**
+   * The completed ops that were not sampled, one ring per thread that
+   * completes ops.  Only the owning thread writes to its ring, so
+   * recording an op takes no lock; a reader checks the seq of a record
+   * before and after copying it and skips the ones overwritten meanwhile.
+   */
+  struct HistoryRing {
+    struct Record {
+      std::atomic<uint64_t> seq = {0};  ///< 0 while empty or being written
+      std::atomic<uint64_t> initiated = {0};
+      std::atomic<uint64_t> done = {0};
+    };
+    std::array<Record, OPTRACKER_HISTORY_RING_SIZE> records;
+    uint64_t head = 0;  ///< only used by the owning thread
+  };
+
   CephContext* cct = nullptr;
   std::set<std::pair<utime_t, TrackedOpRef> > arrived;
   std::set<std::pair<double, TrackedOpRef> > duration;
@@ -73,19 +103,15 @@ class OpHistory {
   OpHistoryServiceThread opsvc;
   friend class OpHistoryServiceThread;
   std::unique_ptr<PerfCounters> logger;
+  const uint64_t id;  ///< tells this OpHistory's rings apart in get_ring()
+  ceph::mutex rings_lock = ceph::make_mutex("OpHistory::rings_lock");
+  std::map<std::thread::id, std::unique_ptr<HistoryRing>> rings;
 
-public:
-  OpHistory(CephContext *c) : cct(c), opsvc(this) {
-    PerfCountersBuilder b(cct, "osd-slow-ops",
-                         l_osd_slow_op_first, l_osd_slow_op_last);
-    b.add_u64_counter(l_osd_slow_op_count, "slow_ops_count",
-                      "Number of operations taking over ten second");
-
-    logger.reset(b.create_perf_counters());
-    cct->get_perfcounters_collection()->add(logger.get());
+  HistoryRing& get_ring();
+  void dump_unsampled_ops(utime_t now, ceph::Formatter *f, bool by_duration);
 
-    opsvc.create("OpHistorySvc");
-  }
+public:
+  OpHistory(CephContext *c);
   ~OpHistory() {
     ceph_assert(arrived.empty());
     ceph_assert(duration.empty());
@@ -103,6 +129,11 @@ public:
     opsvc.insert_op(now, op);
   }
 
+  /// record an op that was not sampled, lock free
+  void insert_unsampled(uint64_t seq, const utime_t& initiated,
+			const utime_t& done);
+  std::vector<UnsampledOp> get_unsampled_ops();
+
   void _insert_delayed(const utime_t& now, TrackedOpRef op);
   void dump_ops(utime_t now, ceph::Formatter *f, std::set<std::string> filters = {""}, bool by_duration=false);
   void dump_slow_ops(utime_t now, ceph::Formatter *f, std::set<std::string> filters = {""});
@@ -115,6 +146,9 @@ public:
     history_slow_op_size = new_size;
     history_slow_op_threshold = new_threshold;
   }
+  uint32_t get_slow_op_threshold() const {
+    return history_slow_op_threshold;
+  }
 };
 
 struct ShardedTrackingData;
@@ -127,6 +161,7 @@ class OpTracker {
   float complaint_time;
   int log_threshold;
   std::atomic<bool> tracking_enabled;
+  std::atomic<double> sample_rate = {1.0};
   ceph::shared_mutex lock = ceph::make_shared_mutex("OpTracker::lock");
 
 public:
@@ -151,6 +186,21 @@ public:
   void set_tracking(bool enable) {
     tracking_enabled = enable;
   }
+  /**
+   * track only this fraction of the ops with all their events
+   *
+   * The others are still in flight, so they count as slow ops, but they
+   * do not keep their events and are recorded in the history rings with
+   * only their timestamps, unless they were slow.
+   */
+  void set_sample_rate(double rate) {
+    sample_rate = rate;
+  }
+  double get_sample_rate() const {
+    return sample_rate;
+  }
+  /// whether the op with this seq is sampled at the current rate
+  bool is_sampled(uint64_t seq) const;
   static void default_dumper(const TrackedOp& op, Formatter* f);
   bool dump_ops_in_flight(ceph::Formatter *f, bool print_only_blocked = false, std::set<std::string> filters = {""}, bool count_only = false, dumper lambda = default_dumper);
   bool dump_historic_ops(ceph::Formatter *f, bool by_duration = false, std::set<std::string> filters = {""});
@@ -158,6 +208,15 @@ public:
   bool register_inflight_op(TrackedOp *i);
   void unregister_inflight_op(TrackedOp *i);
   void record_history_op(TrackedOpRef&& i);
+  /**
+   * record an op that was not sampled in the history rings
+   *
+   * @return false if it was slow and should go to the history whole
+   */
+  bool record_unsampled_op(TrackedOp *i);
+  std::vector<OpHistory::UnsampledOp> get_unsampled_history() {
+    return history.get_unsampled_ops();
+  }
 
   void get_age_ms_histogram(pow2_hist_t *h);
 
@@ -248,6 +307,7 @@ protected:
   std::atomic_int nref = {0};  ///< ref count
 
   utime_t initiated_at;
+  utime_t done_at;  ///< only set for ops that are not sampled
 
   struct Event {
     utime_t stamp;
@@ -272,6 +332,7 @@ protected:
   std::vector<Event> events;    ///< std::list of events and their times
   mutable ceph::mutex lock = ceph::make_mutex("TrackedOp::lock"); ///< to protect the events list
   uint64_t seq = 0;        ///< a unique value std::set by the OpTracker
+  bool sampled = true;     ///< whether the events are kept, std::set by the OpTracker
 
   uint32_t warn_interval_multiplier = 1; //< limits output of a given op warning
 
@@ -285,9 +346,7 @@ protected:
   TrackedOp(OpTracker *_tracker, const utime_t& initiated) :
     tracker(_tracker),
     initiated_at(initiated)
-  {
-    events.reserve(OPTRACKER_PREALLOC_EVENTS);
-  }
+  {}
 
   /// output any type-specific data you want to get when dump() is called
   virtual void _dump(ceph::Formatter *f) const {}
@@ -327,6 +386,8 @@ public:
 	_unregistered();
 	if (!tracker->is_tracking()) {
 	  delete this;
+	} else if (!sampled && tracker->record_unsampled_op(this)) {
+	  delete this;
 	} else {
 	  state = TrackedOp::STATE_HISTORY;
 	  tracker->record_history_op(
@@ -386,6 +447,9 @@ public:
   }
 
   double get_duration() const {
+    if (!sampled) {
+      return (done_at.is_zero() ? ceph_clock_now() : done_at) - get_initiated();
+    }
     std::lock_guard l(lock);
     if (!events.empty() && events.rbegin()->compare("done") == 0)
       return events.rbegin()->stamp - get_initiated();
@@ -408,7 +472,10 @@ public:
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
-      events.emplace_back(initiated_at, "initiated");
+      if (sampled) {
+	events.reserve(OPTRACKER_PREALLOC_EVENTS);
+	events.emplace_back(initiated_at, "initiated");
+      }
       state = STATE_LIVE;
     }
   }
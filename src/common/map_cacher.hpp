@@ -35,6 +35,12 @@ public:
     const std::set<K> &to_remove ///< [in] keys to remove
     ) = 0;
 
+  /// Remove all keys in [first, last)
+  virtual void remove_range(
+    const K &first, ///< [in] first key to remove
+    const K &last   ///< [in] first key past the range
+    ) = 0;
+
   /// Add context to fire when data is readable
   virtual void add_callback(
     Context *c ///< [in] Context to fire on readable
@@ -157,6 +163,30 @@ public:
     t->add_callback(new TransHolder(vptrs));
   }
 
+  /**
+   * Adds operation removing the keys in [first, last) to Transaction
+   *
+   * keys must be all of the keys in the range, as get_next() sees them,
+   * so that the removal of each of them is cached until it is readable.
+   */
+  void remove_range(
+    const std::set<K> &keys, ///< [in] keys in the range
+    const K &first,          ///< [in] first key of the range
+    const K &last,           ///< [in] first key past the range
+    Transaction<K, V> *t     ///< [out] transaction to use
+    ) {
+    std::set<VPtr> vptrs;
+    for (auto i = keys.begin(); i != keys.end(); ++i) {
+      ceph_assert(!(*i < first) && *i < last);
+      boost::optional<V> empty;
+      VPtr ip = in_progress.lookup_or_create(*i, empty);
+      *ip = empty;
+      vptrs.insert(ip);
+    }
+    t->remove_range(first, last);
+    t->add_callback(new TransHolder(vptrs));
+  }
+
   /// Gets keys, uses cached values for unstable keys
   int get_keys(
     const std::set<K> &keys_to_get, ///< [in] std::set of keys to fetch
@@ -96,6 +96,36 @@ public:
   // alignment with decode methods
   virtual int decompress(ceph::bufferlist::const_iterator &p, size_t compressed_len, ceph::bufferlist &out, std::optional<int32_t> compressor_message) = 0;
 
+  /**
+   * Compression state kept across buffers, e.g. the frames of a connection,
+   * so that small buffers can refer to data seen in earlier ones.  The
+   * output of each compress() call must be passed, in the same order, to a
+   * StreamDecompressor created with the same dictionary.
+   */
+  class StreamCompressor {
+  public:
+    virtual ~StreamCompressor() {}
+    virtual int compress(const ceph::bufferlist &in, ceph::bufferlist &out) = 0;
+  };
+  class StreamDecompressor {
+  public:
+    virtual ~StreamDecompressor() {}
+    virtual int decompress(const ceph::bufferlist &in, ceph::bufferlist &out) = 0;
+  };
+
+  virtual bool supports_stream() const {
+    return false;
+  }
+  /// @param dict dictionary to prime the stream with, may be empty
+  virtual std::unique_ptr<StreamCompressor> create_stream_compressor(
+    const ceph::bufferlist &dict) {
+    return nullptr;
+  }
+  virtual std::unique_ptr<StreamDecompressor> create_stream_decompressor(
+    const ceph::bufferlist &dict) {
+    return nullptr;
+  }
+
   static CompressorRef create(CephContext *cct, const std::string &type);
   static CompressorRef create(CephContext *cct, int alg);
 
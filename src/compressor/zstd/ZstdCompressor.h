@@ -22,6 +22,144 @@
 #include "include/encoding.h"
 #include "compressor/Compressor.h"
 
+/*
+ * One zstd frame spanning many buffers: each compress() call flushes a
+ * block so the peer can decode it right away, and the frame is only ended
+ * once in a while so the next one starts with the dictionary in its window
+ * again.  Both contexts are reused for the lifetime of the stream.
+ */
+class ZstdStreamCompressor : public Compressor::StreamCompressor {
+  static constexpr uint64_t MAX_FRAME_BYTES = 1 << 20;
+
+  ZSTD_CCtx *cctx;
+  uint64_t frame_bytes = 0;
+
+ public:
+  ZstdStreamCompressor(int level, const ceph::buffer::list &dict)
+    : cctx(ZSTD_createCCtx()) {
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+    if (dict.length()) {
+      ceph::buffer::list d(dict);
+      // the dictionary is copied and sticks to all the following frames
+      ZSTD_CCtx_loadDictionary(cctx, d.c_str(), d.length());
+    }
+  }
+  ~ZstdStreamCompressor() override {
+    ZSTD_freeCCtx(cctx);
+  }
+
+  int compress(const ceph::buffer::list &src, ceph::buffer::list &dst) override {
+    ceph::buffer::ptr outptr = ceph::buffer::create_small_page_aligned(
+      ZSTD_compressBound(src.length()));
+    ZSTD_outBuffer_s outbuf;
+    outbuf.dst = outptr.c_str();
+    outbuf.size = outptr.length();
+    outbuf.pos = 0;
+
+    ceph::buffer::list out;
+    // prefix with decompressed length
+    ceph::encode((uint32_t)src.length(), out);
+    auto grow = [&] {
+      out.append(outptr, 0, outbuf.pos);
+      outptr = ceph::buffer::create_small_page_aligned(ZSTD_CStreamOutSize());
+      outbuf.dst = outptr.c_str();
+      outbuf.size = outptr.length();
+      outbuf.pos = 0;
+    };
+
+    for (const auto &bp : src.buffers()) {
+      ZSTD_inBuffer_s inbuf;
+      inbuf.src = bp.c_str();
+      inbuf.size = bp.length();
+      inbuf.pos = 0;
+      while (inbuf.pos < inbuf.size) {
+	if (outbuf.pos == outbuf.size) {
+	  grow();
+	}
+	size_t r = ZSTD_compressStream2(cctx, &outbuf, &inbuf, ZSTD_e_continue);
+	if (ZSTD_isError(r)) {
+	  return -EINVAL;
+	}
+      }
+    }
+
+    frame_bytes += src.length();
+    ZSTD_EndDirective const zed =
+      frame_bytes >= MAX_FRAME_BYTES ? ZSTD_e_end : ZSTD_e_flush;
+    if (zed == ZSTD_e_end) {
+      frame_bytes = 0;
+    }
+    size_t remaining;
+    do {
+      if (outbuf.pos == outbuf.size) {
+	grow();
+      }
+      ZSTD_inBuffer_s inbuf = {nullptr, 0, 0};
+      remaining = ZSTD_compressStream2(cctx, &outbuf, &inbuf, zed);
+      if (ZSTD_isError(remaining)) {
+	return -EINVAL;
+      }
+    } while (remaining);
+
+    out.append(outptr, 0, outbuf.pos);
+    dst.claim_append(out);
+    return 0;
+  }
+};
+
+class ZstdStreamDecompressor : public Compressor::StreamDecompressor {
+  ZSTD_DCtx *dctx;
+
+ public:
+  explicit ZstdStreamDecompressor(const ceph::buffer::list &dict)
+    : dctx(ZSTD_createDCtx()) {
+    if (dict.length()) {
+      ceph::buffer::list d(dict);
+      ZSTD_DCtx_loadDictionary(dctx, d.c_str(), d.length());
+    }
+  }
+  ~ZstdStreamDecompressor() override {
+    ZSTD_freeDCtx(dctx);
+  }
+
+  int decompress(const ceph::buffer::list &src, ceph::buffer::list &dst) override {
+    if (src.length() < 4) {
+      return -EINVAL;
+    }
+    auto p = src.cbegin();
+    uint32_t dst_len;
+    ceph::decode(dst_len, p);
+
+    ceph::buffer::ptr dstptr(dst_len);
+    ZSTD_outBuffer_s outbuf;
+    outbuf.dst = dstptr.c_str();
+    outbuf.size = dstptr.length();
+    outbuf.pos = 0;
+    size_t left = src.length() - 4;
+    while (left) {
+      ZSTD_inBuffer_s inbuf;
+      inbuf.pos = 0;
+      inbuf.size = p.get_ptr_and_advance(left, (const char**)&inbuf.src);
+      left -= inbuf.size;
+      while (inbuf.pos < inbuf.size) {
+	auto in_pos = inbuf.pos;
+	auto out_pos = outbuf.pos;
+	size_t r = ZSTD_decompressStream(dctx, &outbuf, &inbuf);
+	if (ZSTD_isError(r) ||
+	    (inbuf.pos == in_pos && outbuf.pos == out_pos)) {
+	  return -EINVAL;
+	}
+      }
+    }
+    // the sender flushed everything it got, so must we
+    if (outbuf.pos != dst_len) {
+      return -EINVAL;
+    }
+    dst.append(dstptr, 0, outbuf.pos);
+    return 0;
+  }
+};
+
 class ZstdCompressor : public Compressor {
  public:
   ZstdCompressor(CephContext *cct) : Compressor(COMP_ALG_ZSTD, "zstd"), cct(cct) {}
@@ -100,6 +238,20 @@ class ZstdCompressor : public Compressor {
     dst.append(dstptr, 0, outbuf.pos);
     return 0;
   }
+
+  bool supports_stream() const override {
+    return true;
+  }
+  std::unique_ptr<StreamCompressor> create_stream_compressor(
+    const ceph::buffer::list &dict) override {
+    return std::make_unique<ZstdStreamCompressor>(
+      cct->_conf->compressor_zstd_level, dict);
+  }
+  std::unique_ptr<StreamDecompressor> create_stream_decompressor(
+    const ceph::buffer::list &dict) override {
+    return std::make_unique<ZstdStreamDecompressor>(dict);
+  }
+
  private:
   CephContext *const cct;
 };
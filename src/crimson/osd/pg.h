@@ -307,6 +307,12 @@ public:
   void queue_check_readable(epoch_t last_peering_reset,
 			    ceph::timespan delay) final;
   void recheck_readable() final;
+  void flush_batched_ops() final {
+    // Not needed yet
+  }
+  void hedge_reads() final {
+    // Not needed yet
+  }
 
   unsigned get_target_pg_log_entries() const final;
 
@@ -309,10 +309,9 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
  * for reference, see the exponential distribution example at:  
  * https://en.wikipedia.org/wiki/Inverse_transform_sampling#Examples
  */
-static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
+static inline __s64 generate_exponential_distribution(unsigned int u,
                                                       int weight)
 {
-	unsigned int u = crush_hash32_3(type, x, y, z);
 	u &= 0xffff;
 
 	/*
@@ -336,25 +335,42 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+/*
+ * the items of a straw2 bucket are hashed this many at a time, before
+ * their draws are compared, so that the hashes of a block are computed
+ * side by side (see crush_hash32_3_block())
+ */
+#define CRUSH_STRAW2_BLOCK 16
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
 {
-	unsigned int i, high = 0;
+	unsigned int i, j, n, high = 0;
 	__s64 draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
-	for (i = 0; i < bucket->h.size; i++) {
-                dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
-		if (weights[i]) {
-			draw = generate_exponential_distribution(bucket->h.hash, x, ids[i], r, weights[i]);
-		} else {
-			draw = S64_MIN;
-		}
+	__u32 u[CRUSH_STRAW2_BLOCK];
+
+	for (i = 0; i < bucket->h.size; i += n) {
+		n = bucket->h.size - i;
+		if (n > CRUSH_STRAW2_BLOCK)
+			n = CRUSH_STRAW2_BLOCK;
+		crush_hash32_3_block(bucket->h.hash, x, ids + i, r, u, n);
+		for (j = 0; j < n; j++) {
+			dprintk("weight 0x%x item %d\n", weights[i + j],
+				ids[i + j]);
+			if (weights[i + j]) {
+				draw = generate_exponential_distribution(
+					u[j], weights[i + j]);
+			} else {
+				draw = S64_MIN;
+			}
 
-		if (i == 0 || draw > high_draw) {
-			high = i;
-			high_draw = draw;
+			if (i + j == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
 		}
 	}
 
@@ -1081,3 +1097,19 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+int crush_do_rule_batch(const struct crush_map *map,
+			int ruleno, const int *x, int count,
+			int *result, int result_max, int *result_len,
+			const __u32 *weight, int weight_max,
+			void *cwin, const struct crush_choose_arg *choose_args)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		result_len[i] = crush_do_rule(map, ruleno, x[i],
+					      result + i * result_max,
+					      result_max, weight, weight_max,
+					      cwin, choose_args);
+	return count;
+}
@@ -77,6 +77,28 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/**
+ * crush_do_rule() for each of the __count__ inputs of __x__, sharing
+ * the workspace __cwin__, so that mapping many inputs with the same
+ * rule, e.g. all the PGs of a pool, initializes it only once.
+ *
+ * @param x an array of __count__ values to map
+ * @param result an array of __count__ * __result_max__ items, the
+ *        mapping of x[i] starts at result + i * __result_max__
+ * @param result_len an array of __count__, the return value of
+ *        crush_do_rule() for x[i]
+ *
+ * The other arguments are those of crush_do_rule().
+ *
+ * @return __count__
+ */
+extern int crush_do_rule_batch(const struct crush_map *map,
+			       int ruleno, const int *x, int count,
+			       int *result, int result_max, int *result_len,
+			       const __u32 *weights, int weight_max,
+			       void *cwin,
+			       const struct crush_choose_arg *choose_args);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
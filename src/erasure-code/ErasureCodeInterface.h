@@ -459,6 +459,25 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    enum {
+      /* The code is linear: encoding the XOR of two stripes yields the
+       * XOR of their coding chunks.  A partial overwrite can then
+       * update the coding chunks from the old and new content of the
+       * data chunks it modifies, without reading the other data
+       * chunks of the stripe. */
+      FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION = 1 << 0,
+    };
+
+    /**
+     * Return the FLAG_EC_PLUGIN_* optimizations the caller may rely
+     * on for the current profile.
+     *
+     * @return a bit mask of FLAG_EC_PLUGIN_*
+     */
+    virtual uint64_t get_supported_optimizations() const {
+      return 0;
+    }
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
@@ -21,6 +21,7 @@
 #include "MOSDFastDispatchOp.h"
 #include "include/ceph_features.h"
 #include "common/hobject.h"
+#include "msg/MessagePool.h"
 
 /*
  * OSD op
@@ -520,7 +521,7 @@ struct ceph_osd_request_head {
 
       hobj.pool = pgid.pgid.pool();
       hobj.set_key(oloc.key);
-      hobj.nspace = oloc.nspace;
+      hobj.nspace = std::move(oloc.nspace);
       hobj.set_hash(pgid.pgid.ps());
 
       OSDOp::split_osd_op_vector_in_data(ops, data);
@@ -565,7 +566,7 @@ struct ceph_osd_request_head {
 
     hobj.pool = pgid.pgid.pool();
     hobj.set_key(oloc.key);
-    hobj.nspace = oloc.nspace;
+    hobj.nspace = std::move(oloc.nspace);
 
     OSDOp::split_osd_op_vector_in_data(ops, data);
 
@@ -600,6 +601,8 @@ struct ceph_osd_request_head {
     out << ")";
   }
 
+  MESSAGE_POOL_HELPERS(MOSDOp);
+
 private:
   template<class T, typename... Args>
   friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
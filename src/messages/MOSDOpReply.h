@@ -20,6 +20,7 @@
 
 #include "MOSDOp.h"
 #include "common/errno.h"
+#include "msg/MessagePool.h"
 
 /*
  * OSD op reply
@@ -344,6 +345,8 @@ public:
     out << ")";
   }
 
+  MESSAGE_POOL_HELPERS(MOSDOpReply);
+
 private:
   template<class T, typename... Args>
   friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
@@ -26,11 +26,15 @@ public:
   enum {
     OP_SCAN_GET_DIGEST = 1,      // just objects and versions
     OP_SCAN_DIGEST = 2,          // result
+    OP_SCAN_GET_RANGE_DIGEST = 3, // compare against digests of ranges
+    OP_SCAN_RANGE_DIGEST = 4,    // result: objects of differing ranges
   };
   const char *get_op_name(int o) const {
     switch (o) {
     case OP_SCAN_GET_DIGEST: return "get_digest";
     case OP_SCAN_DIGEST: return "digest";
+    case OP_SCAN_GET_RANGE_DIGEST: return "get_range_digest";
+    case OP_SCAN_RANGE_DIGEST: return "range_digest";
     default: return "???";
     }
   }
@@ -17,6 +17,7 @@
 #define CEPH_MOSDREPOP_H
 
 #include "MOSDFastDispatchOp.h"
+#include "msg/MessagePool.h"
 
 /*
  * OSD sub op - for internal ops on pobjects between primary and replicas(/stripes/whatever)
@@ -188,6 +189,9 @@ public:
     }
     out << ")";
   }
+
+  MESSAGE_POOL_HELPERS(MOSDRepOp);
+
 private:
   template<class T, typename... Args>
   friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
@@ -0,0 +1,138 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+
+#ifndef CEPH_MOSDREPOPBATCH_H
+#define CEPH_MOSDREPOPBATCH_H
+
+#include "MOSDFastDispatchOp.h"
+#include "MOSDRepOp.h"
+
+/*
+ * Several MOSDRepOps of one PG to the same replica, in the order the
+ * primary issued them.  The replica queues their transactions together
+ * and still replies to each of them with a MOSDRepOpReply.
+ */
+
+class MOSDRepOpBatch final : public MOSDFastDispatchOp {
+private:
+  static constexpr int HEAD_VERSION = 1;
+  static constexpr int COMPAT_VERSION = 1;
+
+public:
+  epoch_t map_epoch = 0, min_epoch = 0;
+  spg_t pgid;
+  std::vector<ceph::ref_t<MOSDRepOp>> ops;
+
+  epoch_t get_map_epoch() const override {
+    return map_epoch;
+  }
+  epoch_t get_min_epoch() const override {
+    return min_epoch;
+  }
+  spg_t get_spg() const override {
+    return pgid;
+  }
+
+  int get_cost() const override {
+    return data.length();
+  }
+
+  void decode_payload() override {
+    using ceph::decode;
+    auto p = payload.cbegin();
+    decode(map_epoch, p);
+    decode(min_epoch, p);
+    decode(pgid, p);
+    uint32_t n;
+    decode(n, p);
+    ops.clear();
+    ops.reserve(n);
+    unsigned data_off = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      ceph_tid_t tid;
+      __u16 version;
+      uint32_t data_len;
+      ceph::buffer::list op_payload, op_data;
+      decode(tid, p);
+      decode(version, p);
+      decode(op_payload, p);
+      decode(data_len, p);
+      op_data.substr_of(data, data_off, data_len);
+      data_off += data_len;
+
+      auto op = ceph::make_message<MOSDRepOp>();
+      ceph_msg_header h = header;
+      h.type = MSG_OSD_REPOP;
+      h.version = version;
+      h.tid = tid;
+      h.data_len = data_len;
+      op->set_header(h);
+      op->set_recv_stamp(get_recv_stamp());
+      op->set_payload(op_payload);
+      op->set_data(op_data);
+      op->decode_payload();
+      ops.push_back(std::move(op));
+    }
+  }
+
+  void encode_payload(uint64_t features) override {
+    using ceph::encode;
+    encode(map_epoch, payload);
+    encode(min_epoch, payload);
+    encode(pgid, payload);
+    encode(static_cast<uint32_t>(ops.size()), payload);
+    data.clear();
+    for (auto& op : ops) {
+      // we are encoded again if the connection's features changed
+      op->clear_payload();
+      op->encode_payload(features);
+      encode(op->get_tid(), payload);
+      encode(op->get_header().version, payload);
+      encode(op->get_payload(), payload);
+      encode(static_cast<uint32_t>(op->get_data().length()), payload);
+      data.append(op->get_data());
+    }
+  }
+
+  MOSDRepOpBatch()
+    : MOSDFastDispatchOp{MSG_OSD_REPOP_BATCH, HEAD_VERSION, COMPAT_VERSION} {}
+  MOSDRepOpBatch(spg_t pgid, epoch_t map_epoch, epoch_t min_epoch,
+		 std::vector<ceph::ref_t<MOSDRepOp>>&& ops)
+    : MOSDFastDispatchOp{MSG_OSD_REPOP_BATCH, HEAD_VERSION, COMPAT_VERSION},
+      map_epoch(map_epoch),
+      min_epoch(min_epoch),
+      pgid(pgid),
+      ops(std::move(ops)) {}
+private:
+  ~MOSDRepOpBatch() final {}
+
+public:
+  std::string_view get_type_name() const override { return "osd_repop_batch"; }
+  void print(std::ostream& out) const override {
+    out << "osd_repop_batch(" << pgid << " e" << map_epoch << "/" << min_epoch
+	<< " " << ops.size() << " ops";
+    if (!ops.empty()) {
+      out << " " << ops.front()->reqid;
+      if (ops.size() > 1) {
+	out << ".." << ops.back()->reqid;
+      }
+    }
+    out << ")";
+  }
+
+private:
+  template<class T, typename... Args>
+  friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
+};
+
+#endif
@@ -24,7 +24,7 @@
 
 class MOSDRepScrub final : public MOSDFastDispatchOp {
 public:
-  static constexpr int HEAD_VERSION = 9;
+  static constexpr int HEAD_VERSION = 10;
   static constexpr int COMPAT_VERSION = 6;
 
   spg_t pgid;             // PG to scrub
@@ -38,6 +38,10 @@ public:
   bool allow_preemption = false;
   int32_t priority = 0;
   bool high_priority = false;
+  /// for an incremental deep scrub, only sample the data of the objects
+  /// not modified after this version
+  eversion_t incremental_since;
+  uint32_t sample_seed = 0;
 
   epoch_t get_map_epoch() const override {
     return map_epoch;
@@ -87,8 +91,11 @@ public:
         << ",version:" << header.version
 	<< ",allow_preemption:" << (int)allow_preemption
 	<< ",priority=" << priority
-	<< (high_priority ? " (high)":"")
-	<< ")";
+	<< (high_priority ? " (high)":"");
+    if (incremental_since != eversion_t()) {
+      out << ",incremental_since:" << incremental_since;
+    }
+    out << ")";
   }
 
   void encode_payload(uint64_t features) override {
@@ -107,6 +114,8 @@ public:
     encode(allow_preemption, payload);
     encode(priority, payload);
     encode(high_priority, payload);
+    encode(incremental_since, payload);
+    encode(sample_seed, payload);
   }
   void decode_payload() override {
     using ceph::decode;
@@ -136,6 +145,10 @@ public:
       decode(priority, p);
       decode(high_priority, p);
     }
+    if (header.version >= 10) {
+      decode(incremental_since, p);
+      decode(sample_seed, p);
+    }
   }
 };
 
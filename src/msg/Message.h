@@ -146,6 +146,7 @@
 
 #define MSG_OSD_PG_LEASE        133
 #define MSG_OSD_PG_LEASE_ACK    134
+#define MSG_OSD_REPOP_BATCH     136
 
 // *** MDS ***
 
@@ -0,0 +1,203 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_MESSAGEPOOL_H
+#define CEPH_MSG_MESSAGEPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "include/ceph_assert.h"
+#include "include/spinlock.h"
+
+/*
+ * Storage recycling for hot Message types.
+ *
+ * Messages on the IO path are allocated by a messenger worker when they
+ * are decoded and released by whichever thread drops the last reference,
+ * typically an OSD shard.  A plain per-thread free list would therefore
+ * only ever fill up on the releasing side, so each thread keeps a small
+ * cache and exchanges fixed-size batches of blocks with a shared depot,
+ * much like the front end of tcmalloc.  The lock is only taken once per
+ * batch.
+ *
+ * Usage:
+ *
+ *   class MFoo final : public Message {
+ *     ...
+ *     MESSAGE_POOL_HELPERS(MFoo);
+ *   };
+ *
+ * The class must be final: the pool hands out blocks of exactly
+ * sizeof(MFoo).
+ *
+ * Only the message itself is recycled.  Decoding an MOSDOp still
+ * allocates its ops vector, and object names, keys and namespaces too long
+ * for std::string's inline buffer; unittest_message_pool bounds what a
+ * small op costs.
+ */
+
+namespace ceph::msg {
+
+struct message_pool_stats_t {
+  uint64_t heap_allocs = 0;   ///< blocks obtained from operator new
+  uint64_t recycled = 0;      ///< allocations served from a cache
+  uint64_t heap_frees = 0;    ///< blocks given back to operator delete
+};
+
+template <typename T>
+class message_pool {
+  struct free_node {
+    free_node *next;
+  };
+
+  static constexpr unsigned THREAD_CACHE_MAX = 64;
+  static constexpr unsigned BATCH = THREAD_CACHE_MAX / 2;
+  static constexpr unsigned DEPOT_MAX_BATCHES = 64;
+
+  struct thread_cache {
+    free_node *head = nullptr;
+    unsigned count = 0;
+    ~thread_cache() {
+      message_pool::instance().drain(*this);
+    }
+  };
+
+  ceph::spinlock depot_lock;
+  std::vector<free_node*> depot;  ///< chains of exactly BATCH blocks
+
+  std::atomic<uint64_t> heap_allocs{0};
+  std::atomic<uint64_t> recycled{0};
+  std::atomic<uint64_t> heap_frees{0};
+
+  static thread_cache& get_cache() {
+    static thread_local thread_cache cache;
+    return cache;
+  }
+
+  static void *pop(thread_cache& c) {
+    free_node *n = c.head;
+    c.head = n->next;
+    --c.count;
+    return n;
+  }
+
+  static void free_chain(free_node *n) {
+    while (n) {
+      free_node *next = n->next;
+      ::operator delete(n);
+      n = next;
+    }
+  }
+
+  void drain(thread_cache& c) {
+    while (c.count >= BATCH)
+      release_batch(c);
+    heap_frees += c.count;
+    free_chain(c.head);
+    c.head = nullptr;
+    c.count = 0;
+  }
+
+  void release_batch(thread_cache& c) {
+    free_node *chain = c.head;
+    free_node *tail = chain;
+    for (unsigned i = 1; i < BATCH; ++i)
+      tail = tail->next;
+    c.head = tail->next;
+    c.count -= BATCH;
+    tail->next = nullptr;
+    {
+      std::lock_guard l(depot_lock);
+      if (depot.size() < DEPOT_MAX_BATCHES) {
+	depot.push_back(chain);
+	return;
+      }
+    }
+    heap_frees += BATCH;
+    free_chain(chain);
+  }
+
+  message_pool() {
+    depot.reserve(DEPOT_MAX_BATCHES);
+  }
+
+ public:
+  static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  static_assert(sizeof(T) >= sizeof(free_node));
+
+  message_pool(const message_pool&) = delete;
+  message_pool& operator=(const message_pool&) = delete;
+
+  static message_pool& instance() {
+    static message_pool pool;
+    return pool;
+  }
+
+  void *allocate(std::size_t size) {
+    ceph_assert(size == sizeof(T));
+    auto& c = get_cache();
+    if (!c.head) {
+      std::lock_guard l(depot_lock);
+      if (!depot.empty()) {
+	c.head = depot.back();
+	c.count = BATCH;
+	depot.pop_back();
+      }
+    }
+    if (c.head) {
+      ++recycled;
+      return pop(c);
+    }
+    ++heap_allocs;
+    return ::operator new(sizeof(T));
+  }
+
+  void deallocate(void *p) {
+    if (!p)
+      return;
+    auto& c = get_cache();
+    auto n = static_cast<free_node*>(p);
+    n->next = c.head;
+    c.head = n;
+    if (++c.count > THREAD_CACHE_MAX)
+      release_batch(c);
+  }
+
+  message_pool_stats_t get_stats() const {
+    message_pool_stats_t s;
+    s.heap_allocs = heap_allocs;
+    s.recycled = recycled;
+    s.heap_frees = heap_frees;
+    return s;
+  }
+};
+
+} // namespace ceph::msg
+
+#ifdef WITH_SEASTAR
+// seastar's allocator already keeps per-shard free lists
+#define MESSAGE_POOL_HELPERS(type)
+#else
+#define MESSAGE_POOL_HELPERS(type)					\
+  static void *operator new(std::size_t size) {				\
+    return ceph::msg::message_pool<type>::instance().allocate(size);	\
+  }									\
+  static void operator delete(void *p) {				\
+    ceph::msg::message_pool<type>::instance().deallocate(p);		\
+  }
+#endif
+
+#endif
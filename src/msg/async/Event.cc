@@ -413,7 +413,29 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
 
   ldout(cct, 30) << __func__ << " wait second " << tv.tv_sec << " usec " << tv.tv_usec << dendl;
   std::vector<FiredFileEvent> fired_events;
-  numevents = driver->event_wait(fired_events, &tv);
+  numevents = 0;
+  if (blocking && busy_poll_us && timeout_microseconds) {
+    auto poll_start = ceph::mono_clock::now();
+    auto until = std::min(
+      last_active + std::chrono::microseconds(busy_poll_us),
+      poll_start + std::chrono::microseconds(timeout_microseconds));
+    numevents = busy_poll(fired_events, poll_start, until);
+    if (numevents == 0) {
+      // don't let the polling delay the time events
+      auto polled = std::chrono::duration_cast<std::chrono::microseconds>(
+        ceph::mono_clock::now() - poll_start).count();
+      timeout_microseconds = polled < timeout_microseconds ?
+        timeout_microseconds - polled : 0;
+      // an external event may have been queued while we were polling, in
+      // which case nobody woke us up
+      if (external_num_events.load())
+        timeout_microseconds = 0;
+      tv.tv_sec = timeout_microseconds / 1000000;
+      tv.tv_usec = timeout_microseconds % 1000000;
+    }
+  }
+  if (numevents == 0)
+    numevents = driver->event_wait(fired_events, &tv);
   auto working_start = ceph::mono_clock::now();
   for (int event_id = 0; event_id < numevents; event_id++) {
     int rfired = 0;
@@ -464,11 +486,47 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
       numevents += pollers[i]->poll();
   }
 
+  if (numevents > 0 && busy_poll_us)
+    last_active = working_start;
+
   if (working_dur)
     *working_dur = ceph::mono_clock::now() - working_start;
   return numevents;
 }
 
+int EventCenter::busy_poll(std::vector<FiredFileEvent> &fired_events,
+                           ceph::mono_clock::time_point start,
+                           ceph::mono_clock::time_point until)
+{
+  // idle for longer than the polling window: go to sleep right away
+  if (until <= start)
+    return 0;
+
+  struct timeval zero = {0, 0};
+  int numevents = 0;
+  auto now = start;
+  busy_polling = true;
+  do {
+    numevents = driver->event_wait(fired_events, &zero);
+    if (numevents != 0 || external_num_events.load())
+      break;
+    now = ceph::mono_clock::now();
+  } while (now < until);
+  // pairs with the check in dispatch_event_external()
+  busy_polling = false;
+
+  if (numevents != 0 || external_num_events.load()) {
+    ++busy_poll_stats.hits;
+    now = ceph::mono_clock::now();
+  } else {
+    ++busy_poll_stats.misses;
+  }
+  busy_poll_stats.time += now - start;
+  ldout(cct, 30) << __func__ << " polled " << (now - start)
+                 << " got " << numevents << " events" << dendl;
+  return numevents;
+}
+
 void EventCenter::dispatch_event_external(EventCallbackRef e)
 {
   uint64_t num = 0;
@@ -480,7 +538,9 @@ void EventCenter::dispatch_event_external(EventCallbackRef e)
     external_events.push_back(e);
     num = ++external_num_events;
   }
-  if (num == 1 && !in_thread())
+  // no need to wake up the owner while it is busy polling, it checks
+  // external_num_events before going to sleep
+  if (num == 1 && !in_thread() && !busy_polling.load())
     wakeup();
 
   ldout(cct, 30) << __func__ << " " << e << " pending " << num << dendl;
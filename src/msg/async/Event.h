@@ -44,6 +44,7 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <utility>
 
 #include "common/ceph_time.h"
 #include "common/dout.h"
@@ -180,7 +181,27 @@ class EventCenter {
   unsigned center_id;
   AssociatedCenters *global_centers = nullptr;
 
+ public:
+  struct busy_poll_stats_t {
+    ceph::timespan time = ceph::timespan::zero(); ///< spent polling
+    uint64_t hits = 0;    ///< polls that found work, saving a wakeup
+    uint64_t misses = 0;  ///< polls that gave up and went to sleep
+  };
+
+ private:
+  // adaptive busy polling: keep polling without blocking for up to
+  // busy_poll_us after the last time we had work, then sleep as usual
+  unsigned busy_poll_us = 0;
+  ceph::mono_clock::time_point last_active;
+  // tells external threads that we will notice their events without a
+  // wakeup
+  std::atomic<bool> busy_polling = false;
+  busy_poll_stats_t busy_poll_stats;
+
   int process_time_events();
+  int busy_poll(std::vector<FiredFileEvent> &fired_events,
+                ceph::mono_clock::time_point start,
+                ceph::mono_clock::time_point until);
   FileEvent *_get_file_event(int fd) {
     ceph_assert(fd < nevent);
     return &file_events[fd];
@@ -210,6 +231,13 @@ class EventCenter {
   void delete_time_event(uint64_t id);
   int process_events(unsigned timeout_microseconds, ceph::timespan *working_dur = nullptr);
   void wakeup();
+  void set_busy_poll(unsigned microseconds) {
+    busy_poll_us = microseconds;
+  }
+  /// return the busy poll stats accumulated since the last call
+  busy_poll_stats_t take_busy_poll_stats() {
+    return std::exchange(busy_poll_stats, {});
+  }
 
   // Used by external thread
   void dispatch_event_external(EventCallbackRef e);
@@ -25,8 +25,9 @@
 #include "Stack.h"
 
 class PosixWorker : public Worker {
-  ceph::NetHandler net;
   void initialize() override;
+ protected:
+  ceph::NetHandler net;
  public:
   PosixWorker(CephContext *c, unsigned i)
       : Worker(c, i), net(c) {}
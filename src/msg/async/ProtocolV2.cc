@@ -2146,9 +2146,16 @@ CtPtr ProtocolV2::send_compression_request() {
     static_cast<Compressor::CompressionMode>(
       messenger->comp_registry.get_mode(peer_type, auth_meta->is_mode_secure()));
   const auto preferred_methods = messenger->comp_registry.get_methods(peer_type);
-  auto comp_req_frame = CompressionRequestFrame::Encode(comp_meta.is_compress(), preferred_methods);
 
   INTERCEPT(19);
+  if (HAVE_MSGR2_FEATURE(peer_supported_features, COMPRESSION_STREAM)) {
+    auto comp_req_frame = CompressionStreamRequestFrame::Encode(
+      comp_meta.is_compress(), preferred_methods,
+      messenger->comp_registry.get_stream(peer_type),
+      messenger->comp_registry.get_dictionary_ids(peer_type));
+    return WRITE(comp_req_frame, "compression request", read_frame);
+  }
+  auto comp_req_frame = CompressionRequestFrame::Encode(comp_meta.is_compress(), preferred_methods);
   return WRITE(comp_req_frame, "compression request", read_frame);
 }
 
@@ -2158,16 +2165,36 @@ CtPtr ProtocolV2::handle_compression_done(ceph::bufferlist &payload) {
     return _fault();
   }
 
-  auto response = CompressionDoneFrame::Decode(payload);
-  ldout(cct, 10) << __func__ << " CompressionDoneFrame(is_compress=" << response.is_compress()
-		 << ", method=" << response.method() << ")" << dendl;
+  bool is_compress;
+  if (HAVE_MSGR2_FEATURE(peer_supported_features, COMPRESSION_STREAM)) {
+    auto response = CompressionStreamDoneFrame::Decode(payload);
+    ldout(cct, 10) << __func__ << " CompressionStreamDoneFrame(is_compress=" << response.is_compress()
+		   << ", method=" << response.method()
+		   << ", is_stream=" << response.is_stream()
+		   << ", dictionary_id=" << response.dictionary_id() << ")" << dendl;
+    is_compress = response.is_compress();
+    comp_meta.con_method = static_cast<Compressor::CompressionAlgorithm>(response.method());
+    comp_meta.con_stream = response.is_stream();
+    comp_meta.con_dictionary_id = response.dictionary_id();
+  } else {
+    auto response = CompressionDoneFrame::Decode(payload);
+    ldout(cct, 10) << __func__ << " CompressionDoneFrame(is_compress=" << response.is_compress()
+		   << ", method=" << response.method() << ")" << dendl;
+    is_compress = response.is_compress();
+    comp_meta.con_method = static_cast<Compressor::CompressionAlgorithm>(response.method());
+  }
 
-  comp_meta.con_method = static_cast<Compressor::CompressionAlgorithm>(response.method());
-  if (comp_meta.is_compress() != response.is_compress()) {
+  if (comp_meta.is_compress() != is_compress) {
     comp_meta.con_mode = Compressor::COMP_NONE;
   }
   session_compression_handlers = ceph::compression::onwire::rxtx_t::create_handler_pair(
-    cct, comp_meta, messenger->comp_registry.get_min_compression_size(connection->get_peer_type()));
+    cct, comp_meta, messenger->comp_registry.get_min_compression_size(connection->get_peer_type()),
+    messenger->comp_registry.get_dictionary(comp_meta.con_dictionary_id));
+  if (comp_meta.is_compress() && !session_compression_handlers.rx) {
+    lderr(cct) << __func__ << " unable to set up the compression picked by"
+	       << " the peer" << dendl;
+    return _fault();
+  }
 
   return start_session_connect();
 }
@@ -2997,15 +3024,34 @@ CtPtr ProtocolV2::handle_compression_request(ceph::bufferlist &payload) {
     return _fault();
   }
 
-  auto request = CompressionRequestFrame::Decode(payload);
-  ldout(cct, 10) << __func__ << " CompressionRequestFrame(is_compress=" << request.is_compress()
-		 << ", preferred_methods=" << request.preferred_methods() << ")" << dendl;
+  const bool has_stream = HAVE_MSGR2_FEATURE(peer_supported_features, COMPRESSION_STREAM);
+  bool is_compress;
+  std::vector<uint32_t> preferred_methods;
+  bool is_stream = false;
+  std::vector<uint32_t> dictionary_ids;
+  if (has_stream) {
+    auto request = CompressionStreamRequestFrame::Decode(payload);
+    ldout(cct, 10) << __func__ << " CompressionStreamRequestFrame(is_compress=" << request.is_compress()
+		   << ", preferred_methods=" << request.preferred_methods()
+		   << ", is_stream=" << request.is_stream()
+		   << ", dictionary_ids=" << request.dictionary_ids() << ")" << dendl;
+    is_compress = request.is_compress();
+    preferred_methods = std::move(request.preferred_methods());
+    is_stream = request.is_stream();
+    dictionary_ids = std::move(request.dictionary_ids());
+  } else {
+    auto request = CompressionRequestFrame::Decode(payload);
+    ldout(cct, 10) << __func__ << " CompressionRequestFrame(is_compress=" << request.is_compress()
+		   << ", preferred_methods=" << request.preferred_methods() << ")" << dendl;
+    is_compress = request.is_compress();
+    preferred_methods = std::move(request.preferred_methods());
+  }
 
   const int peer_type = connection->get_peer_type();
   if (Compressor::CompressionMode mode = messenger->comp_registry.get_mode(
         peer_type, auth_meta->is_mode_secure());
-      mode != Compressor::COMP_NONE && request.is_compress()) {
-    comp_meta.con_method = messenger->comp_registry.pick_method(peer_type, request.preferred_methods());
+      mode != Compressor::COMP_NONE && is_compress) {
+    comp_meta.con_method = messenger->comp_registry.pick_method(peer_type, preferred_methods);
     ldout(cct, 10) << __func__ << " Compressor(pick_method=" 
                    << Compressor::get_comp_alg_name(comp_meta.get_method())
                    << ")" << dendl;
@@ -3015,10 +3061,25 @@ CtPtr ProtocolV2::handle_compression_request(ceph::bufferlist &payload) {
   } else {
     comp_meta.con_method = Compressor::COMP_ALG_NONE;
   }
-  
-  auto response = CompressionDoneFrame::Encode(comp_meta.is_compress(), comp_meta.get_method());
+
+  if (comp_meta.is_compress() && is_stream &&
+      messenger->comp_registry.get_stream(peer_type)) {
+    CompressorRef compressor = Compressor::create(cct, comp_meta.get_method());
+    if (compressor && compressor->supports_stream()) {
+      comp_meta.con_stream = true;
+      comp_meta.con_dictionary_id =
+        messenger->comp_registry.pick_dictionary(peer_type, dictionary_ids);
+    }
+  }
 
   INTERCEPT(20);
+  if (has_stream) {
+    auto response = CompressionStreamDoneFrame::Encode(
+      comp_meta.is_compress(), comp_meta.get_method(),
+      comp_meta.con_stream, comp_meta.con_dictionary_id);
+    return WRITE(response, "compression done", finish_compression);
+  }
+  auto response = CompressionDoneFrame::Encode(comp_meta.is_compress(), comp_meta.get_method());
   return WRITE(response, "compression done", finish_compression);
 }
 
@@ -3027,7 +3088,13 @@ CtPtr ProtocolV2::finish_compression() {
   // allow reusing finish_compression().
   
   session_compression_handlers = ceph::compression::onwire::rxtx_t::create_handler_pair(
-    cct, comp_meta, messenger->comp_registry.get_min_compression_size(connection->get_peer_type()));
+    cct, comp_meta, messenger->comp_registry.get_min_compression_size(connection->get_peer_type()),
+    messenger->comp_registry.get_dictionary(comp_meta.con_dictionary_id));
+  if (comp_meta.is_compress() && !session_compression_handlers.rx) {
+    lderr(cct) << __func__ << " unable to set up the negotiated compression"
+	       << dendl;
+    return _fault();
+  }
 
   state = SESSION_ACCEPTING;
   return CONTINUE(read_frame);
@@ -20,6 +20,9 @@
 #include "common/Cond.h"
 #include "common/errno.h"
 #include "PosixStack.h"
+#ifdef __linux__
+#include "shm/ShmStack.h"
+#endif
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
 #endif
@@ -40,6 +43,8 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
       rename_thread(w->id);
       const unsigned EventMaxWaitUs = 30000000;
       w->center.set_owner();
+      w->center.set_busy_poll(
+        cct->_conf.get_val<uint64_t>("ms_async_busy_poll_us"));
       ldout(cct, 10) << __func__ << " starting" << dendl;
       w->initialize();
       w->init_done();
@@ -54,6 +59,11 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+        if (auto bp = w->center.take_busy_poll_stats(); bp.hits || bp.misses) {
+          w->perf_logger->tinc(l_msgr_busy_poll_time, bp.time);
+          w->perf_logger->inc(l_msgr_busy_poll_hits, bp.hits);
+          w->perf_logger->inc(l_msgr_busy_poll_misses, bp.misses);
+        }
       }
       w->reset();
       w->destroy();
@@ -67,6 +77,10 @@ std::shared_ptr<NetworkStack> NetworkStack::create(CephContext *c,
 
   if (t == "posix")
     stack.reset(new PosixNetworkStack(c));
+#ifdef __linux__
+  else if (t == "shm")
+    stack.reset(new ShmNetworkStack(c));
+#endif
 #ifdef HAVE_RDMA
   else if (t == "rdma")
     stack.reset(new RDMAStack(c));
@@ -213,6 +213,10 @@ enum {
   l_msgr_recv_encrypted_bytes,
   l_msgr_send_encrypted_bytes,
 
+  l_msgr_busy_poll_time,
+  l_msgr_busy_poll_hits,
+  l_msgr_busy_poll_misses,
+
   l_msgr_last,
 };
 
@@ -271,6 +275,10 @@ class Worker {
     plb.add_u64_counter(l_msgr_recv_encrypted_bytes, "msgr_recv_encrypted_bytes", "Network received encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_msgr_send_encrypted_bytes, "msgr_send_encrypted_bytes", "Network sent encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
 
+    plb.add_time(l_msgr_busy_poll_time, "msgr_busy_poll_time", "The total time spent busy polling for events");
+    plb.add_u64_counter(l_msgr_busy_poll_hits, "msgr_busy_poll_hits", "Busy polls that found events without sleeping");
+    plb.add_u64_counter(l_msgr_busy_poll_misses, "msgr_busy_poll_misses", "Busy polls that timed out and went to sleep");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
 
@@ -8,6 +8,12 @@ struct CompConnectionMeta {
     TOPNSPC::Compressor::COMP_NONE;  // negotiated mode
   TOPNSPC::Compressor::CompressionAlgorithm con_method =
     TOPNSPC::Compressor::COMP_ALG_NONE; // negotiated method
+  bool con_stream = false;              // keep the context across frames
+  uint32_t con_dictionary_id = 0;       // dictionary priming the stream
+
+  bool is_stream() const {
+    return is_compress() && con_stream;
+  }
 
   bool is_compress() const {
     return con_mode != TOPNSPC::Compressor::COMP_NONE;
@@ -12,11 +12,36 @@ namespace ceph::compression::onwire {
 rxtx_t rxtx_t::create_handler_pair(
     CephContext* ctx,
     const CompConnectionMeta& comp_meta,
-    std::uint64_t compress_min_size)
+    std::uint64_t compress_min_size,
+    const ceph::bufferlist& dictionary)
 {
   if (comp_meta.is_compress()) {
      CompressorRef compressor = Compressor::create(ctx, comp_meta.get_method());
-    if (compressor) {
+    if (compressor && comp_meta.is_stream()) {
+      if (comp_meta.con_dictionary_id != 0 && dictionary.length() == 0) {
+	lderr(ctx) << __func__ << " unknown dictionary "
+		   << comp_meta.con_dictionary_id << dendl;
+	return {};
+      }
+      auto rx_stream = compressor->create_stream_decompressor(dictionary);
+      auto tx_stream = compressor->create_stream_compressor(dictionary);
+      if (!rx_stream || !tx_stream) {
+	// the peer asked for a stream, or a dictionary, we cannot set up
+	lderr(ctx) << __func__ << " unable to create "
+		   << Compressor::get_comp_alg_name(comp_meta.get_method())
+		   << " streams with dictionary " << comp_meta.con_dictionary_id
+		   << " (" << dictionary.length() << " bytes)" << dendl;
+	return {};
+      }
+      ldout(ctx, 10) << __func__ << " streaming with dictionary "
+		     << comp_meta.con_dictionary_id
+		     << " (" << dictionary.length() << " bytes)" << dendl;
+      return {std::make_unique<RxHandler>(ctx, compressor, std::move(rx_stream)),
+	      std::make_unique<TxHandler>(ctx, compressor,
+					  comp_meta.get_mode(),
+					  compress_min_size,
+					  std::move(tx_stream))};
+    } else if (compressor) {
       return {std::make_unique<RxHandler>(ctx, compressor),
 	      std::make_unique<TxHandler>(ctx, compressor,
 					  comp_meta.get_mode(),
@@ -28,6 +53,9 @@ rxtx_t rxtx_t::create_handler_pair(
 
 std::optional<ceph::bufferlist> TxHandler::compress(const ceph::bufferlist &input)
 {
+  if (m_stream_broken) {
+    return {};
+  }
   if (m_init_onwire_size < m_min_size) {
     ldout(m_cct, 20) << __func__ 
 		     << " discovered frame that is smaller than threshold, aborting compression"
@@ -46,6 +74,19 @@ std::optional<ceph::bufferlist> TxHandler::compress(const ceph::bufferlist &inpu
     return out;
   }
 
+  if (m_stream) {
+    if (int r = m_stream->compress(input, out); r < 0) {
+      ldout(m_cct, 1) << __func__ << " stream compression failed: " << r
+		      << ", not compressing anymore" << dendl;
+      m_stream_broken = true;
+      return {};
+    }
+    ldout(m_cct, 20) << __func__ << " uncompressed.length()=" << input.length()
+		     << " compressed.length()=" << out.length() << " (stream)" << dendl;
+    m_onwire_size += out.length();
+    return out;
+  }
+
   std::optional<int32_t> compressor_message;
   if (m_compressor->compress(input, out, compressor_message)) {
     return {};
@@ -68,6 +109,15 @@ std::optional<ceph::bufferlist> RxHandler::decompress(const ceph::bufferlist &in
     return out;
   }
 
+  if (m_stream) {
+    if (m_stream->decompress(input, out) < 0) {
+      return {};
+    }
+    ldout(m_cct, 20) << __func__ << " compressed.length()=" << input.length()
+		     << " uncompressed.length()=" << out.length() << " (stream)" << dendl;
+    return out;
+  }
+
   std::optional<int32_t> compressor_message;
   if (m_compressor->decompress(input, out, compressor_message)) {
     return {};
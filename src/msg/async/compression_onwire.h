@@ -5,6 +5,7 @@
 #define CEPH_COMPRESSION_ONWIRE_H
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 
 #include "compressor/Compressor.h"
@@ -28,8 +29,9 @@ namespace ceph::compression::onwire {
 
   class RxHandler final : private Handler {
   public:
-    RxHandler(CephContext* const cct, CompressorRef compressor)
-      : Handler(cct, compressor) {}
+    RxHandler(CephContext* const cct, CompressorRef compressor,
+	      std::unique_ptr<Compressor::StreamDecompressor> stream = nullptr)
+      : Handler(cct, compressor), m_stream(std::move(stream)) {}
     ~RxHandler() {};
 
     /**
@@ -41,14 +43,19 @@ namespace ceph::compression::onwire {
      * @returns true on success, false on failure
      */
     std::optional<ceph::bufferlist> decompress(const ceph::bufferlist &input);
+
+  private:
+    std::unique_ptr<Compressor::StreamDecompressor> m_stream;
   };
 
   class TxHandler final : private Handler {
   public:
-    TxHandler(CephContext* const cct, CompressorRef compressor, int mode, std::uint64_t min_size)
+    TxHandler(CephContext* const cct, CompressorRef compressor, int mode, std::uint64_t min_size,
+	      std::unique_ptr<Compressor::StreamCompressor> stream = nullptr)
       : Handler(cct, compressor),
 	m_min_size(min_size),
-	m_mode(static_cast<Compressor::CompressionMode>(mode))
+	m_mode(static_cast<Compressor::CompressionMode>(mode)),
+	m_stream(std::move(stream))
     {}
     ~TxHandler() {}
 
@@ -89,16 +96,28 @@ namespace ceph::compression::onwire {
     uint64_t m_init_onwire_size;
     uint64_t m_onwire_size;
     uint64_t m_compress_potential;
+
+    std::unique_ptr<Compressor::StreamCompressor> m_stream;
+    // the peer's stream no longer matches ours after a failure part way
+    // through a frame, so from then on frames go out uncompressed
+    bool m_stream_broken = false;
   };
 
   struct rxtx_t {
     std::unique_ptr<RxHandler> rx;
     std::unique_ptr<TxHandler> tx;
 
+    /**
+     * @param dictionary primes the stream if comp_meta.is_stream(), the
+     *                   one identified by comp_meta.con_dictionary_id
+     * @return no handlers if comp_meta.is_compress() but the compression
+     *         it describes cannot be set up
+     */
     static rxtx_t create_handler_pair(
       CephContext* ctx,
       const CompConnectionMeta& comp_meta,
-      std::uint64_t compress_min_size);
+      std::uint64_t compress_min_size,
+      const ceph::bufferlist& dictionary = {});
   };
 }
 
@@ -895,6 +895,44 @@ protected:
   using ControlFrame::ControlFrame;
 };
 
+// Sent instead of the frames above when both peers support
+// CEPH_MSGR2_FEATURE_COMPRESSION_STREAM.  The leading fields are the same.
+struct CompressionStreamRequestFrame : public ControlFrame<CompressionStreamRequestFrame,
+                                              bool, // is compress
+                                              std::vector<uint32_t>, // preferred methods
+                                              bool, // is stream
+                                              std::vector<uint32_t>> { // dictionary ids
+  static const Tag tag = Tag::COMPRESSION_REQUEST;
+  using ControlFrame::Encode;
+  using ControlFrame::Decode;
+
+  inline bool &is_compress() { return get_val<0>(); }
+  inline std::vector<uint32_t> &preferred_methods() { return get_val<1>(); }
+  inline bool &is_stream() { return get_val<2>(); }
+  inline std::vector<uint32_t> &dictionary_ids() { return get_val<3>(); }
+
+protected:
+  using ControlFrame::ControlFrame;
+};
+
+struct CompressionStreamDoneFrame : public ControlFrame<CompressionStreamDoneFrame,
+                                           bool, // is compress
+                                           uint32_t, // method
+                                           bool, // is stream
+                                           uint32_t> { // dictionary id
+  static const Tag tag = Tag::COMPRESSION_DONE;
+  using ControlFrame::Encode;
+  using ControlFrame::Decode;
+
+  inline bool &is_compress() { return get_val<0>(); }
+  inline uint32_t &method() { return get_val<1>(); }
+  inline bool &is_stream() { return get_val<2>(); }
+  inline uint32_t &dictionary_id() { return get_val<3>(); }
+
+protected:
+  using ControlFrame::ControlFrame;
+};
+
 } // namespace ceph::msgr::v2
 
 #endif // _MSG_ASYNC_FRAMES_V2_
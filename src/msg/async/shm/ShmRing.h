@@ -0,0 +1,209 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_ASYNC_SHMRING_H
+#define CEPH_MSG_ASYNC_SHMRING_H
+
+#include <sys/types.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "include/ceph_assert.h"
+
+/**
+ * Single-producer/single-consumer byte ring living in a shared mapping.
+ *
+ * The header and the data area are laid out back to back in memory shared
+ * by the two ends of a connection, so everything that lives in the header
+ * must be lock-free and position independent.  head and tail only ever
+ * grow; the data offset is derived by masking with the (power of two)
+ * capacity.
+ *
+ * The peer may write anything into the shared mapping, so neither side
+ * trusts what it finds there: each keeps a private copy of the counter it
+ * moves (head for the writer, tail for the reader) and checks the peer's
+ * counter against it on every access.  The peer's counter must only move
+ * forward and never claim more than capacity bytes in flight; anything
+ * else is a protocol error, after which the connection has to be failed.
+ *
+ * The waiting flags implement the sleep/wakeup handshake: a side that finds
+ * the ring empty (reader) or full (writer) raises its flag, re-checks the
+ * ring and only then goes to sleep.  The other side clears the flag after
+ * publishing its progress and, if it was set, kicks the sleeper.  Both
+ * sides use sequentially consistent operations so that at least one of
+ * them observes the other's update.
+ */
+struct shm_ring_header_t {
+  static constexpr uint32_t MAGIC = 0x63736872;  // "cshr"
+
+  uint32_t magic;
+  uint32_t pad;
+  uint64_t capacity;
+  alignas(64) std::atomic<uint64_t> head;  ///< bytes ever written
+  alignas(64) std::atomic<uint64_t> tail;  ///< bytes ever read
+  alignas(64) std::atomic<uint32_t> reader_waiting;
+  std::atomic<uint32_t> writer_waiting;
+  std::atomic<uint32_t> closed;            ///< writer will not write again
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+	      "shm ring requires lock-free 64-bit atomics");
+
+class ShmRing {
+  shm_ring_header_t *hdr = nullptr;
+  char *data = nullptr;
+  uint64_t mask = 0;
+  /// our own progress, whatever the shared header says
+  uint64_t local_head = 0;  ///< writer side: bytes written
+  uint64_t local_tail = 0;  ///< reader side: bytes read
+  /// the peer's counter when we last looked, it may not move backwards
+  uint64_t peer_head = 0;   ///< reader side
+  uint64_t peer_tail = 0;   ///< writer side
+
+  /// the head published by the writer, or -EPROTO if it makes no sense
+  int load_head() {
+    uint64_t head = hdr->head.load(std::memory_order_acquire);
+    if (head < peer_head || head - local_tail > capacity())
+      return -EPROTO;
+    peer_head = head;
+    return 0;
+  }
+  /// the tail published by the reader, or -EPROTO if it makes no sense
+  int load_tail() {
+    uint64_t tail = hdr->tail.load(std::memory_order_acquire);
+    if (tail < peer_tail || tail > local_head)
+      return -EPROTO;
+    peer_tail = tail;
+    return 0;
+  }
+
+ public:
+  static constexpr uint64_t HEADER_SIZE = 4096;
+
+  /// bytes of shared memory needed for a ring of the given capacity
+  static uint64_t region_size(uint64_t capacity) {
+    return HEADER_SIZE + capacity;
+  }
+
+  ShmRing() {}
+  /// attach to (but do not initialize) the ring at the given address
+  ShmRing(void *base, uint64_t capacity) {
+    attach(base, capacity);
+  }
+
+  void attach(void *base, uint64_t capacity) {
+    static_assert(sizeof(shm_ring_header_t) <= HEADER_SIZE);
+    ceph_assert(capacity && (capacity & (capacity - 1)) == 0);
+    hdr = static_cast<shm_ring_header_t*>(base);
+    data = static_cast<char*>(base) + HEADER_SIZE;
+    mask = capacity - 1;
+    local_head = local_tail = peer_head = peer_tail = 0;
+  }
+  /// initialize an attached ring; only the creating side does this
+  void init() {
+    hdr->magic = shm_ring_header_t::MAGIC;
+    hdr->capacity = mask + 1;
+    hdr->head = 0;
+    hdr->tail = 0;
+    hdr->reader_waiting = 0;
+    hdr->writer_waiting = 0;
+    hdr->closed = 0;
+  }
+  /// whether the ring was initialized by a peer with the same geometry
+  bool is_valid() const {
+    return hdr->magic == shm_ring_header_t::MAGIC &&
+      hdr->capacity == mask + 1;
+  }
+
+  uint64_t capacity() const {
+    return mask + 1;
+  }
+  /// bytes to read; -EPROTO if the writer broke the protocol
+  int64_t readable() {
+    int r = load_head();
+    return r < 0 ? r : static_cast<int64_t>(peer_head - local_tail);
+  }
+  /// room to write; -EPROTO if the reader broke the protocol
+  int64_t writable() {
+    int r = load_tail();
+    return r < 0 ? r :
+      static_cast<int64_t>(capacity() - (local_head - peer_tail));
+  }
+
+  /// copy up to len bytes into the ring, returns the number of bytes
+  /// copied or -EPROTO
+  ssize_t write(const char *buf, size_t len) {
+    int64_t room = writable();
+    if (room < 0)
+      return room;
+    size_t n = std::min<uint64_t>(len, room);
+    if (n == 0)
+      return 0;
+    uint64_t off = local_head & mask;
+    size_t first = std::min<uint64_t>(n, capacity() - off);
+    memcpy(data + off, buf, first);
+    memcpy(data, buf + first, n - first);
+    local_head += n;
+    hdr->head.store(local_head);
+    return n;
+  }
+  /// copy up to len bytes out of the ring, returns the number of bytes
+  /// copied or -EPROTO
+  ssize_t read(char *buf, size_t len) {
+    int64_t avail = readable();
+    if (avail < 0)
+      return avail;
+    size_t n = std::min<uint64_t>(len, avail);
+    if (n == 0)
+      return 0;
+    uint64_t off = local_tail & mask;
+    size_t first = std::min<uint64_t>(n, capacity() - off);
+    memcpy(buf, data + off, first);
+    memcpy(buf + first, data, n - first);
+    local_tail += n;
+    hdr->tail.store(local_tail);
+    return n;
+  }
+
+  /// reader is about to sleep; returns false if data raced in meanwhile,
+  /// or if the writer broke the protocol, which the next read() reports
+  bool prepare_read_wait() {
+    hdr->reader_waiting.store(1);
+    return readable() == 0;
+  }
+  /// writer is about to sleep; returns false if space raced in meanwhile,
+  /// or if the reader broke the protocol, which the next write() reports
+  bool prepare_write_wait() {
+    hdr->writer_waiting.store(1);
+    return writable() == 0;
+  }
+  /// called by the writer after publishing data; true if reader must be woken
+  bool reader_needs_wakeup() {
+    return hdr->reader_waiting.exchange(0) != 0;
+  }
+  /// called by the reader after consuming data; true if writer must be woken
+  bool writer_needs_wakeup() {
+    return hdr->writer_waiting.exchange(0) != 0;
+  }
+
+  void mark_closed() {
+    hdr->closed.store(1);
+  }
+  bool is_closed() const {
+    return hdr->closed.load() != 0;
+  }
+};
+
+#endif //CEPH_MSG_ASYNC_SHMRING_H
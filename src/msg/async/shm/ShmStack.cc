@@ -0,0 +1,721 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <list>
+
+#include "ShmStack.h"
+#include "ShmRing.h"
+
+#include "common/errno.h"
+#include "common/dout.h"
+#include "include/compat.h"
+#include "include/sock_compat.h"
+
+#define dout_subsys ceph_subsys_ms
+#undef dout_prefix
+#define dout_prefix *_dout << "ShmStack "
+
+namespace {
+
+constexpr uint32_t SHM_HELLO_MAGIC = 0x6d736863;  // "chsm"
+constexpr uint32_t SHM_HELLO_VERSION = 3;
+constexpr uint64_t SHM_MAX_RING_SIZE = 1ull << 30;
+
+/// fds passed along with the hello
+enum {
+  SHM_FD_MEM,
+  SHM_FD_ACCEPTOR_DATA,    ///< data for the acceptor to read
+  SHM_FD_CONNECTOR_DATA,   ///< data for the connector to read
+  SHM_FD_ACCEPTOR_SPACE,   ///< room in the acceptor's tx ring
+  SHM_FD_CONNECTOR_SPACE,  ///< room in the connector's tx ring
+  SHM_NUM_FDS,
+};
+
+/// sent by the connecting side along with the SHM_NUM_FDS fds; both ends
+/// are on the same host, so a raw struct is fine as long as the version
+/// is bumped whenever it changes. Nothing in it is authenticated: the
+/// acceptor checks all of it, and does not take an address from it.
+struct shm_hello_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_size;
+};
+
+/// the memfd may neither shrink under the mapping nor be resealed
+constexpr int SHM_MEMFD_SEALS = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+std::string shm_socket_name(const entity_addr_t &addr)
+{
+  return std::string("ceph-msgr-shm:") + addr.ip_n_port_to_str();
+}
+
+/// abstract unix socket address; scoped to the network namespace, just
+/// like the ip address it is derived from
+socklen_t shm_socket_addr(const entity_addr_t &addr, sockaddr_un *sun)
+{
+  std::string name = shm_socket_name(addr);
+  memset(sun, 0, sizeof(*sun));
+  sun->sun_family = AF_UNIX;
+  size_t len = std::min(name.size(), sizeof(sun->sun_path) - 1);
+  memcpy(sun->sun_path + 1, name.data(), len);
+  return offsetof(sockaddr_un, sun_path) + 1 + len;
+}
+
+/// an ip is local iff we are allowed to bind to it
+bool is_local_addr(const entity_addr_t &addr)
+{
+  if (addr.is_blank_ip())
+    return false;
+  int sd = ::socket(addr.get_family(), SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sd < 0)
+    return false;
+  entity_addr_t probe = addr;
+  probe.set_port(0);
+  int r = ::bind(sd, probe.get_sockaddr(), probe.get_sockaddr_len());
+  ::close(sd);
+  return r == 0;
+}
+
+uint64_t shm_ring_size(CephContext *cct)
+{
+  uint64_t want = cct->_conf.get_val<Option::size_t>("ms_async_shm_ring_size");
+  uint64_t size = 4096;
+  while (size < want && size < SHM_MAX_RING_SIZE)
+    size <<= 1;
+  return size;
+}
+
+} // anonymous namespace
+
+class ShmConnectedSocketImpl final : public ConnectedSocketImpl {
+  CephContext *cct;
+  ShmWorker *worker;
+  int ctrl_fd;         ///< unix socket to the peer, only used to detect hangup
+  int notify_fd;       ///< data in rx, signaled by the peer, see fd()
+  int peer_notify_fd;  ///< data in the peer's rx, signaled by us
+  int space_fd;        ///< room in tx, signaled by the peer
+  int peer_space_fd;   ///< room in the peer's tx, signaled by us
+  void *region;
+  size_t region_len;
+  ShmRing tx, rx;
+  /// sent, but not in tx yet, waiting for room there
+  ceph::buffer::list pending_tx;
+  bool local_closed = false;
+  bool peer_closed = false;
+  /// the peer broke the ring protocol, the connection is unusable
+  int error = 0;
+  EventCallbackRef ctrl_handler = nullptr;
+  EventCallbackRef space_handler = nullptr;
+
+  class C_handle_ctrl : public EventCallback {
+    ShmConnectedSocketImpl *csi;
+   public:
+    explicit C_handle_ctrl(ShmConnectedSocketImpl *s) : csi(s) {}
+    void do_request(uint64_t fd) override {
+      csi->handle_ctrl();
+    }
+  };
+
+  class C_handle_space : public EventCallback {
+    ShmConnectedSocketImpl *csi;
+   public:
+    explicit C_handle_space(ShmConnectedSocketImpl *s) : csi(s) {}
+    void do_request(uint64_t fd) override {
+      eventfd_t v;
+      eventfd_read(fd, &v);
+      csi->flush_tx();
+    }
+  };
+
+  void notify_peer() {
+    eventfd_write(peer_notify_fd, 1);
+    worker->get_shm_perf_counter()->inc(l_msgr_shm_wakeups);
+  }
+  void notify_peer_space() {
+    eventfd_write(peer_space_fd, 1);
+    worker->get_shm_perf_counter()->inc(l_msgr_shm_wakeups);
+  }
+
+  void fail_protocol(const char *ring) {
+    ldout(cct, 1) << __func__ << " peer of fd " << notify_fd
+		  << " corrupted the " << ring << " ring" << dendl;
+    error = -EPROTO;
+    pending_tx.clear();
+    // wake up our own connection so it notices
+    eventfd_write(notify_fd, 1);
+  }
+
+  /// move pending_tx into tx; if it does not fit, the rest goes once the
+  /// peer signals space_fd
+  void flush_tx() {
+    if (peer_closed || error) {
+      pending_tx.clear();
+    }
+    while (pending_tx.length()) {
+      size_t sent = 0;
+      for (const auto& p : pending_tx.buffers()) {
+	ssize_t n = tx.write(p.c_str(), p.length());
+	if (n < 0) {
+	  fail_protocol("tx");
+	  break;
+	}
+	sent += n;
+	if (static_cast<size_t>(n) < p.length())
+	  break;
+      }
+      if (error)
+	break;
+      if (sent) {
+	pending_tx.splice(0, sent);
+	if (tx.reader_needs_wakeup())
+	  notify_peer();
+      }
+      if (pending_tx.length() && tx.prepare_write_wait()) {
+	// full, and the reader did not make room meanwhile
+	if (!space_handler) {
+	  space_handler = new C_handle_space(this);
+	  worker->center.create_file_event(space_fd, EVENT_READABLE,
+					   space_handler);
+	}
+	return;
+      }
+    }
+    if (space_handler) {
+      worker->center.delete_file_event(space_fd, EVENT_READABLE);
+      delete space_handler;
+      space_handler = nullptr;
+    }
+  }
+
+  // the ctrl socket is watched from the worker owning the connection,
+  // which for accepted sockets is only known once it starts using it
+  void maybe_watch_ctrl() {
+    if (ctrl_handler || ctrl_fd < 0 || !worker->center.in_thread())
+      return;
+    ctrl_handler = new C_handle_ctrl(this);
+    worker->center.create_file_event(ctrl_fd, EVENT_READABLE, ctrl_handler);
+  }
+
+  void handle_ctrl() {
+    char c;
+    ssize_t r = ::recv(ctrl_fd, &c, sizeof(c), MSG_DONTWAIT);
+    if (r < 0 && (errno == EAGAIN || errno == EINTR))
+      return;
+    ldout(cct, 10) << __func__ << " peer of fd " << notify_fd
+		   << " hung up" << dendl;
+    peer_closed = true;
+    // nobody will make room in tx any more
+    flush_tx();
+    // wake up our own connection so it notices
+    eventfd_write(notify_fd, 1);
+  }
+
+ public:
+  ShmConnectedSocketImpl(CephContext *c, ShmWorker *w, int ctrl, int notify,
+			 int peer_notify, int space, int peer_space,
+			 void *r, size_t len,
+			 void *tx_base, void *rx_base, uint64_t ring_size)
+    : cct(c), worker(w), ctrl_fd(ctrl), notify_fd(notify),
+      peer_notify_fd(peer_notify), space_fd(space), peer_space_fd(peer_space),
+      region(r), region_len(len),
+      tx(tx_base, ring_size), rx(rx_base, ring_size) {}
+  ~ShmConnectedSocketImpl() override {
+    close();
+  }
+
+  int is_connected() override {
+    return 1;
+  }
+
+  ssize_t read(char *buf, size_t len) override {
+    maybe_watch_ctrl();
+    if (local_closed)
+      return 0;
+    if (error)
+      return error;
+    size_t got = 0;
+    while (true) {
+      ssize_t r = rx.read(buf + got, len - got);
+      if (r < 0) {
+	// whatever was read before is of no use on a broken connection
+	fail_protocol("rx");
+	return error;
+      }
+      got += r;
+      if (got == len)
+	break;
+      // consume pending wakeups before re-checking so that a signal
+      // raised after this point keeps the fd readable
+      eventfd_t v;
+      eventfd_read(notify_fd, &v);
+      if (rx.prepare_read_wait()) {
+	if (got == 0 && (peer_closed || rx.is_closed()) && rx.readable() == 0)
+	  return 0;
+	break;
+      }
+    }
+    if (got == 0)
+      return -EAGAIN;
+    if (rx.writer_needs_wakeup())
+      notify_peer_space();
+    return got;
+  }
+
+  // like RDMAConnectedSocketImpl, take all of bl: fd() only tells about
+  // data to read, an eventfd is always writable, so the connection must
+  // never wait for EVENT_WRITABLE on it
+  ssize_t send(ceph::buffer::list &bl, bool more) override {
+    maybe_watch_ctrl();
+    if (error)
+      return error;
+    if (local_closed || peer_closed)
+      return -EPIPE;
+    ssize_t len = bl.length();
+    pending_tx.claim_append(bl);
+    flush_tx();
+    return error ? error : len;
+  }
+
+  void shutdown() override {
+    if (local_closed)
+      return;
+    local_closed = true;
+    tx.mark_closed();
+    notify_peer();
+    ::shutdown(ctrl_fd, SHUT_RDWR);
+  }
+
+  void close() override {
+    if (!region)
+      return;
+    if (ctrl_handler) {
+      worker->center.submit_to(worker->center.get_id(), [this]() {
+	worker->center.delete_file_event(ctrl_fd, EVENT_READABLE);
+      }, false);
+      delete ctrl_handler;
+      ctrl_handler = nullptr;
+    }
+    if (space_handler) {
+      worker->center.submit_to(worker->center.get_id(), [this]() {
+	worker->center.delete_file_event(space_fd, EVENT_READABLE);
+      }, false);
+      delete space_handler;
+      space_handler = nullptr;
+    }
+    pending_tx.clear();
+    shutdown();
+    ::munmap(region, region_len);
+    region = nullptr;
+    ::close(ctrl_fd);
+    ::close(notify_fd);
+    ::close(peer_notify_fd);
+    ::close(space_fd);
+    ::close(peer_space_fd);
+  }
+
+  void set_priority(int sd, int prio, int domain) override {
+    // nothing is queued anywhere but in our own rings
+  }
+  /// readable when there is data to read; see send() for writing
+  int fd() const override {
+    return notify_fd;
+  }
+};
+
+namespace {
+
+/// map the memfd backing both rings of a connection
+void *map_region(int memfd, size_t len)
+{
+  void *p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  return p == MAP_FAILED ? nullptr : p;
+}
+
+} // anonymous namespace
+
+class ShmServerSocketImpl : public ServerSocketImpl {
+  CephContext *cct;
+  ServerSocket tcp;   ///< fallback listener for remote peers
+  int unix_fd;
+  int ep_fd;          ///< level-triggered epoll over both listeners
+  /// what we listen on; a local peer is known by its ip, with no port
+  entity_addr_t local_addr;
+  /// accepted unix sockets whose hello has not arrived yet, also in ep_fd,
+  /// oldest first
+  std::list<int> pending;
+
+  void accept_pending();
+  void drop_pending(std::list<int>::iterator p);
+  int accept_shm(int sd, ConnectedSocket *sock, entity_addr_t *out,
+		 Worker *w);
+
+ public:
+  ShmServerSocketImpl(CephContext *c, ServerSocket &&t, int u, int ep,
+		      const entity_addr_t& listen_addr, unsigned slot)
+    : ServerSocketImpl(listen_addr.get_type(), slot),
+      cct(c), tcp(std::move(t)), unix_fd(u), ep_fd(ep),
+      local_addr(listen_addr) {
+    local_addr.set_port(0);
+    local_addr.set_nonce(0);
+  }
+  int accept(ConnectedSocket *sock, const SocketOptions &opts,
+	     entity_addr_t *out, Worker *w) override {
+    // the hello is sent right after connect(), it may well be behind the
+    // connection itself; never wait for it here
+    accept_pending();
+    for (auto p = pending.begin(); p != pending.end(); ) {
+      int r = accept_shm(*p, sock, out, w);
+      if (r == -EAGAIN) {
+	++p;
+	continue;
+      }
+      ::epoll_ctl(ep_fd, EPOLL_CTL_DEL, *p, nullptr);
+      pending.erase(p);
+      return r;
+    }
+    return tcp.accept(sock, opts, out, w);
+  }
+  void abort_accept() override {
+    if (tcp)
+      tcp.abort_accept();
+    while (!pending.empty())
+      drop_pending(pending.begin());
+    if (unix_fd >= 0)
+      ::close(unix_fd);
+    if (ep_fd >= 0)
+      ::close(ep_fd);
+    unix_fd = ep_fd = -1;
+  }
+  int fd() const override {
+    return ep_fd;
+  }
+};
+
+void ShmServerSocketImpl::accept_pending()
+{
+  while (true) {
+    int sd = accept_cloexec(unix_fd, nullptr, nullptr);
+    if (sd < 0)
+      return;
+    ceph::NetHandler net(cct);
+    net.set_nonblock(sd);
+    struct epoll_event ee;
+    memset(&ee, 0, sizeof(ee));
+    ee.events = EPOLLIN;
+    ee.data.fd = sd;
+    if (::epoll_ctl(ep_fd, EPOLL_CTL_ADD, sd, &ee) < 0) {
+      ldout(cct, 1) << __func__ << " unable to watch sd " << sd << ": "
+		    << cpp_strerror(errno) << dendl;
+      ::close(sd);
+      continue;
+    }
+    pending.push_back(sd);
+    // don't let local clients that never say hello pile up
+    while (pending.size() >
+	   static_cast<size_t>(cct->_conf->ms_tcp_listen_backlog)) {
+      ldout(cct, 1) << __func__ << " too many connections without hello,"
+		    << " dropping sd " << pending.front() << dendl;
+      drop_pending(pending.begin());
+    }
+  }
+}
+
+void ShmServerSocketImpl::drop_pending(std::list<int>::iterator p)
+{
+  ::epoll_ctl(ep_fd, EPOLL_CTL_DEL, *p, nullptr);
+  ::close(*p);
+  pending.erase(p);
+}
+
+/// -EAGAIN if the hello of sd is not there yet, sd is closed on failure
+int ShmServerSocketImpl::accept_shm(int sd, ConnectedSocket *sock,
+				    entity_addr_t *out, Worker *w)
+{
+  shm_hello_t hello;
+  struct iovec iov = {&hello, sizeof(hello)};
+  char control[CMSG_SPACE(SHM_NUM_FDS * sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  // the hello and its fds go in a single sendmsg(), so they are either
+  // all there or not at all
+  ssize_t r = ::recvmsg(sd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+  if (r < 0 && (errno == EAGAIN || errno == EINTR))
+    return -EAGAIN;
+
+  int fds[SHM_NUM_FDS];
+  std::fill(std::begin(fds), std::end(fds), -1);
+  struct cmsghdr *cmsg = r > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+  if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len == CMSG_LEN(sizeof(fds))) {
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  }
+  auto fail = [&](const char *why) {
+    ldout(cct, 1) << "accept_shm " << why << dendl;
+    for (int fd : fds) {
+      if (fd >= 0)
+	::close(fd);
+    }
+    ::close(sd);
+    return -ECONNABORTED;
+  };
+
+  if (r != static_cast<ssize_t>(sizeof(hello)) || fds[SHM_FD_MEM] < 0)
+    return fail("short or malformed hello");
+  if (hello.magic != SHM_HELLO_MAGIC || hello.version != SHM_HELLO_VERSION)
+    return fail("unsupported hello");
+  if (hello.ring_size < 4096 || hello.ring_size > SHM_MAX_RING_SIZE ||
+      (hello.ring_size & (hello.ring_size - 1)))
+    return fail("bad ring geometry");
+
+  size_t ring_region = ShmRing::region_size(hello.ring_size);
+  size_t len = 2 * ring_region;
+  struct stat st;
+  if (::fstat(fds[SHM_FD_MEM], &st) < 0 ||
+      static_cast<size_t>(st.st_size) != len)
+    return fail("memfd size mismatch");
+  // a peer truncating the memfd would fault us on access
+  int seals = ::fcntl(fds[SHM_FD_MEM], F_GET_SEALS);
+  if (seals < 0 || (seals & SHM_MEMFD_SEALS) != SHM_MEMFD_SEALS)
+    return fail("memfd not sealed");
+  void *region = map_region(fds[SHM_FD_MEM], len);
+  if (!region)
+    return fail("mmap failed");
+  ::close(fds[SHM_FD_MEM]);
+  fds[SHM_FD_MEM] = -1;
+
+  // ring 0 carries connector -> acceptor, ring 1 the other way round
+  char *base = static_cast<char*>(region);
+  ShmRing ring0(base, hello.ring_size), ring1(base + ring_region, hello.ring_size);
+  if (!ring0.is_valid() || !ring1.is_valid()) {
+    ::munmap(region, len);
+    return fail("rings not initialized");
+  }
+
+  // the unix socket only tells that the peer is on this host, and the
+  // hello is the peer's word; use our own ip, as the tcp stack would see
+  // for a local peer
+  *out = local_addr;
+  out->set_type(addr_type);
+
+  auto worker = static_cast<ShmWorker*>(w);
+  *sock = ConnectedSocket(std::make_unique<ShmConnectedSocketImpl>(
+    cct, worker, sd,
+    fds[SHM_FD_ACCEPTOR_DATA], fds[SHM_FD_CONNECTOR_DATA],
+    fds[SHM_FD_ACCEPTOR_SPACE], fds[SHM_FD_CONNECTOR_SPACE],
+    region, len, base + ring_region, base, hello.ring_size));
+  worker->get_shm_perf_counter()->inc(l_msgr_shm_accept);
+  ldout(cct, 10) << "accept_shm accepted " << *out << " ring_size "
+		 << hello.ring_size << dendl;
+  return 0;
+}
+
+ShmWorker::ShmWorker(CephContext *c, unsigned i)
+  : PosixWorker(c, i)
+{
+  char name[128];
+  sprintf(name, "AsyncMessenger::ShmWorker-%u", id);
+  PerfCountersBuilder plb(cct, name, l_msgr_shm_first, l_msgr_shm_last);
+
+  plb.add_u64_counter(l_msgr_shm_connect, "shm_connect", "Connections established over shared memory");
+  plb.add_u64_counter(l_msgr_shm_accept, "shm_accept", "Connections accepted over shared memory");
+  plb.add_u64_counter(l_msgr_shm_fallback, "shm_fallback", "Local connections that fell back to TCP");
+  plb.add_u64_counter(l_msgr_shm_wakeups, "shm_wakeups", "Eventfd wakeups sent to shared memory peers");
+
+  shm_logger = plb.create_perf_counters();
+  cct->get_perfcounters_collection()->add(shm_logger);
+}
+
+ShmWorker::~ShmWorker()
+{
+  if (shm_logger) {
+    cct->get_perfcounters_collection()->remove(shm_logger);
+    delete shm_logger;
+  }
+}
+
+int ShmWorker::listen(entity_addr_t &sa,
+		      unsigned addr_slot,
+		      const SocketOptions &opt,
+		      ServerSocket *sock)
+{
+  ServerSocket tcp;
+  int r = PosixWorker::listen(sa, addr_slot, opt, &tcp);
+  if (r < 0)
+    return r;
+  if (sa.get_port() == 0 || sa.is_blank_ip()) {
+    // peers could not derive our rendezvous name
+    *sock = std::move(tcp);
+    return 0;
+  }
+
+  int unix_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (unix_fd < 0) {
+    r = -errno;
+    lderr(cct) << __func__ << " unable to create unix socket: "
+	       << cpp_strerror(r) << dendl;
+    *sock = std::move(tcp);
+    return 0;
+  }
+  sockaddr_un sun;
+  socklen_t sun_len = shm_socket_addr(sa, &sun);
+  if (::bind(unix_fd, reinterpret_cast<sockaddr*>(&sun), sun_len) < 0 ||
+      ::listen(unix_fd, cct->_conf->ms_tcp_listen_backlog) < 0) {
+    r = -errno;
+    ldout(cct, 1) << __func__ << " unable to bind " << shm_socket_name(sa)
+		  << ": " << cpp_strerror(r) << ", serving tcp only" << dendl;
+    ::close(unix_fd);
+    *sock = std::move(tcp);
+    return 0;
+  }
+
+  int ep_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (ep_fd < 0) {
+    r = -errno;
+    ::close(unix_fd);
+    return r;
+  }
+  struct epoll_event ee;
+  memset(&ee, 0, sizeof(ee));
+  ee.events = EPOLLIN;
+  ee.data.fd = unix_fd;
+  r = epoll_ctl(ep_fd, EPOLL_CTL_ADD, unix_fd, &ee);
+  if (r == 0) {
+    ee.data.fd = tcp.fd();
+    r = epoll_ctl(ep_fd, EPOLL_CTL_ADD, tcp.fd(), &ee);
+  }
+  if (r < 0) {
+    r = -errno;
+    ::close(ep_fd);
+    ::close(unix_fd);
+    return r;
+  }
+
+  ldout(cct, 10) << __func__ << " listening on " << sa << " and "
+		 << shm_socket_name(sa) << dendl;
+  *sock = ServerSocket(std::make_unique<ShmServerSocketImpl>(
+    cct, std::move(tcp), unix_fd, ep_fd, sa, addr_slot));
+  return 0;
+}
+
+int ShmWorker::connect(const entity_addr_t &addr, const SocketOptions &opts,
+		       ConnectedSocket *socket)
+{
+  if (!is_local_addr(addr))
+    return PosixWorker::connect(addr, opts, socket);
+
+  int sd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sd < 0)
+    return PosixWorker::connect(addr, opts, socket);
+  sockaddr_un sun;
+  socklen_t sun_len = shm_socket_addr(addr, &sun);
+  if (::connect(sd, reinterpret_cast<sockaddr*>(&sun), sun_len) < 0) {
+    // not an async+shm peer, or it bound a wildcard address
+    ldout(cct, 20) << __func__ << " no shm listener for " << addr
+		   << ", using tcp" << dendl;
+    ::close(sd);
+    shm_logger->inc(l_msgr_shm_fallback);
+    return PosixWorker::connect(addr, opts, socket);
+  }
+
+  uint64_t ring_size = shm_ring_size(cct);
+  size_t ring_region = ShmRing::region_size(ring_size);
+  size_t len = 2 * ring_region;
+  int fds[SHM_NUM_FDS];
+  std::fill(std::begin(fds), std::end(fds), -1);
+  void *region = nullptr;
+  auto fail = [&](const char *why) {
+    int err = errno;
+    ldout(cct, 1) << __func__ << " " << why << ": " << cpp_strerror(err)
+		  << ", using tcp for " << addr << dendl;
+    if (region)
+      ::munmap(region, len);
+    for (int fd : fds) {
+      if (fd >= 0)
+	::close(fd);
+    }
+    ::close(sd);
+    shm_logger->inc(l_msgr_shm_fallback);
+    return PosixWorker::connect(addr, opts, socket);
+  };
+
+  fds[SHM_FD_MEM] = memfd_create("ceph-msgr-shm",
+				 MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fds[SHM_FD_MEM] < 0)
+    return fail("memfd_create failed");
+  if (::ftruncate(fds[SHM_FD_MEM], len) < 0)
+    return fail("ftruncate failed");
+  if (::fcntl(fds[SHM_FD_MEM], F_ADD_SEALS, SHM_MEMFD_SEALS) < 0)
+    return fail("sealing the memfd failed");
+  region = map_region(fds[SHM_FD_MEM], len);
+  if (!region)
+    return fail("mmap failed");
+  for (int i = SHM_FD_MEM + 1; i < SHM_NUM_FDS; ++i) {
+    fds[i] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fds[i] < 0)
+      return fail("eventfd failed");
+  }
+
+  char *base = static_cast<char*>(region);
+  ShmRing(base, ring_size).init();
+  ShmRing(base + ring_region, ring_size).init();
+
+  shm_hello_t hello;
+  memset(&hello, 0, sizeof(hello));
+  hello.magic = SHM_HELLO_MAGIC;
+  hello.version = SHM_HELLO_VERSION;
+  hello.ring_size = ring_size;
+
+  struct iovec iov = {&hello, sizeof(hello)};
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  if (::sendmsg(sd, &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(hello)))
+    return fail("sending hello failed");
+
+  // the acceptor holds its own references from now on
+  ::close(fds[SHM_FD_MEM]);
+  net.set_nonblock(sd);
+
+  *socket = ConnectedSocket(std::make_unique<ShmConnectedSocketImpl>(
+    cct, this, sd,
+    fds[SHM_FD_CONNECTOR_DATA], fds[SHM_FD_ACCEPTOR_DATA],
+    fds[SHM_FD_CONNECTOR_SPACE], fds[SHM_FD_ACCEPTOR_SPACE],
+    region, len, base, base + ring_region, ring_size));
+  shm_logger->inc(l_msgr_shm_connect);
+  ldout(cct, 10) << __func__ << " connected to " << addr
+		 << " over shared memory, ring_size " << ring_size << dendl;
+  return 0;
+}
@@ -0,0 +1,68 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_ASYNC_SHMSTACK_H
+#define CEPH_MSG_ASYNC_SHMSTACK_H
+
+#include "msg/async/PosixStack.h"
+
+/*
+ * Shared-memory transport for peers running on the same host.
+ *
+ * Every listener binds, next to its TCP socket, an abstract unix socket
+ * named after its ip:port.  A connecting worker that finds the target ip
+ * to be local tries that unix socket first and, on success, passes a
+ * memfd holding two ShmRings (one per direction) plus two eventfds per side
+ * over it.  From then on the payload goes through the rings; one eventfd
+ * of a side wakes it up when there is data to read, the other when there
+ * is room to write again.  The unix socket is only kept to notice a peer
+ * going away.  Anything else falls back to plain TCP, so an
+ * async+shm messenger interoperates with async+posix ones.
+ */
+
+enum {
+  l_msgr_shm_first = 95000,
+  l_msgr_shm_connect,
+  l_msgr_shm_accept,
+  l_msgr_shm_fallback,
+  l_msgr_shm_wakeups,
+  l_msgr_shm_last,
+};
+
+class ShmWorker : public PosixWorker {
+  PerfCounters *shm_logger = nullptr;
+
+ public:
+  ShmWorker(CephContext *c, unsigned i);
+  ~ShmWorker() override;
+
+  int listen(entity_addr_t &sa,
+	     unsigned addr_slot,
+	     const SocketOptions &opt,
+	     ServerSocket *socks) override;
+  int connect(const entity_addr_t &addr, const SocketOptions &opts,
+	      ConnectedSocket *socket) override;
+
+  PerfCounters *get_shm_perf_counter() { return shm_logger; }
+};
+
+class ShmNetworkStack : public PosixNetworkStack {
+  Worker* create_worker(CephContext *c, unsigned worker_id) override {
+    return new ShmWorker(c, worker_id);
+  }
+
+ public:
+  explicit ShmNetworkStack(CephContext *c)
+    : PosixNetworkStack(c) {}
+};
+
+#endif //CEPH_MSG_ASYNC_SHMSTACK_H
@@ -1,8 +1,13 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <filesystem>
+
 #include "compressor_registry.h"
 #include "common/dout.h"
+#include "common/errno.h"
+
+namespace fs = std::filesystem;
 
 #define dout_subsys ceph_subsys_ms
 #undef dout_prefix
@@ -26,6 +31,8 @@ const char** CompressorRegistry::get_tracked_conf_keys() const
     "ms_osd_compression_algorithm",
     "ms_osd_compress_min_size",
     "ms_compress_secure",
+    "ms_osd_compress_stream",
+    "ms_osd_compress_dictionary_dir",
     nullptr
   };
   return keys;
@@ -80,13 +87,102 @@ void CompressorRegistry::_refresh_config()
 
   ms_compress_secure = cct->_conf.get_val<bool>("ms_compress_secure");
 
+  ms_osd_compress_stream = cct->_conf.get_val<bool>("ms_osd_compress_stream");
+  if (auto dir = cct->_conf.get_val<std::string>("ms_osd_compress_dictionary_dir");
+      dir != ms_osd_compress_dictionary_dir) {
+    ms_osd_compress_dictionary_dir = dir;
+    _load_dictionaries(dir);
+  }
+
   ldout(cct,10) << __func__ << " ms_osd_compression_mode " << ms_osd_compress_mode
     << " ms_osd_compression_methods " << ms_osd_compression_methods
     << " ms_osd_compress_above_min_size " << ms_osd_compress_min_size
     << " ms_compress_secure " << ms_compress_secure
+    << " ms_osd_compress_stream " << ms_osd_compress_stream
+    << " dictionaries " << dictionaries.size()
     << dendl;
 }
 
+void CompressorRegistry::_load_dictionaries(const std::string& dir)
+{
+  // zstd dictionaries, as produced by "zstd --train", start with a magic
+  // number followed by the dictionary id both peers refer to them by
+  static constexpr uint32_t ZSTD_DICT_MAGIC = 0xEC30A437;
+
+  dictionaries.clear();
+  if (dir.empty()) {
+    return;
+  }
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(dir, ec)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    ceph::bufferlist bl;
+    std::string err;
+    if (int r = bl.read_file(entry.path().c_str(), &err); r < 0) {
+      ldout(cct, 1) << __func__ << " failed to read " << entry.path()
+		    << ": " << err << dendl;
+      continue;
+    }
+    uint32_t magic = 0, id = 0;
+    if (bl.length() > 8) {
+      auto p = bl.cbegin();
+      decode(magic, p);
+      decode(id, p);
+    }
+    if (magic != ZSTD_DICT_MAGIC || id == 0) {
+      ldout(cct, 1) << __func__ << " ignoring " << entry.path()
+		    << ": not a zstd dictionary with an id" << dendl;
+      continue;
+    }
+    ldout(cct, 10) << __func__ << " loaded dictionary " << id << " from "
+		   << entry.path() << " (" << bl.length() << " bytes)" << dendl;
+    dictionaries.emplace(id, std::move(bl));
+  }
+  if (ec) {
+    ldout(cct, 1) << __func__ << " failed to list " << dir << ": "
+		  << cpp_strerror(ec.value()) << dendl;
+  }
+}
+
+std::vector<uint32_t> CompressorRegistry::get_dictionary_ids(uint32_t peer_type) const
+{
+  std::scoped_lock l(lock);
+  std::vector<uint32_t> ids;
+  if (peer_type == CEPH_ENTITY_TYPE_OSD) {
+    for (const auto& [id, dict] : dictionaries) {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+uint32_t CompressorRegistry::pick_dictionary(
+  uint32_t peer_type,
+  const std::vector<uint32_t>& peer_ids) const
+{
+  std::scoped_lock l(lock);
+  if (peer_type != CEPH_ENTITY_TYPE_OSD) {
+    return 0;
+  }
+  for (auto id : peer_ids) {
+    if (dictionaries.count(id)) {
+      return id;
+    }
+  }
+  return 0;
+}
+
+ceph::bufferlist CompressorRegistry::get_dictionary(uint32_t id) const
+{
+  std::scoped_lock l(lock);
+  if (auto p = dictionaries.find(id); p != dictionaries.end()) {
+    return p->second;
+  }
+  return {};
+}
+
 Compressor::CompressionAlgorithm
 CompressorRegistry::pick_method(uint32_t peer_type,
                                 const std::vector<uint32_t>& preferred_methods)
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include "compressor/Compressor.h"
@@ -55,6 +56,24 @@ public:
     return ms_compress_secure; 
   }
 
+  bool get_stream(uint32_t peer_type) const {
+    std::scoped_lock l(lock);
+    switch (peer_type) {
+      case CEPH_ENTITY_TYPE_OSD:
+        return ms_osd_compress_stream;
+      default:
+        return false;
+    }
+  }
+
+  /// ids of the dictionaries we can prime a stream with
+  std::vector<uint32_t> get_dictionary_ids(uint32_t peer_type) const;
+  /// the first of the peer's dictionaries we also have, 0 if none
+  uint32_t pick_dictionary(uint32_t peer_type,
+			   const std::vector<uint32_t>& peer_ids) const;
+  /// empty if unknown
+  ceph::bufferlist get_dictionary(uint32_t id) const;
+
 private:
   CephContext *cct;
   mutable ceph::mutex lock = ceph::make_mutex("CompressorRegistry::lock");
@@ -63,7 +82,11 @@ private:
   bool ms_compress_secure;
   std::uint64_t ms_osd_compress_min_size;
   std::vector<uint32_t> ms_osd_compression_methods;
+  bool ms_osd_compress_stream;
+  std::string ms_osd_compress_dictionary_dir;
+  std::map<uint32_t, ceph::bufferlist> dictionaries;
 
   void _refresh_config();
   std::vector<uint32_t> _parse_method_list(const std::string& s);
+  void _load_dictionaries(const std::string& dir);
 };
@@ -0,0 +1,112 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_ADAPTIVERECOVERYLIMIT_H
+#define CEPH_OSD_ADAPTIVERECOVERYLIMIT_H
+
+#include <algorithm>
+
+#include "common/ceph_time.h"
+
+/**
+ * AdaptiveRecoveryLimit
+ *
+ * Picks how many recovery ops an OSD keeps in flight, between 1 and the
+ * configured osd_recovery_max_active, from the latency of the recovery ops
+ * that complete.  This is the delay based scheme of TCP Vegas: the
+ * smallest latency seen recently is what an op costs when it does not
+ * wait behind anything, and the share of a sample above that baseline is
+ * time spent queued in the device, the network or behind client io.
+ *
+ *  - while less than a third of the latency is queueing, and the limit
+ *    is actually in use, it grows by about one op per round of completions;
+ *  - once more than half of it is queueing the limit halves per round.
+ *
+ * The limit starts at 1, so the first samples show the latency of an op
+ * that does not queue.  Every epoch of samples the baseline is replaced by
+ * the minimum seen during that epoch, so it follows the device when the
+ * object sizes or the competing load change for good, and the limit is
+ * halved so that the next epoch again sees a few ops that did not queue
+ * behind others.
+ *
+ * Not thread safe; OSDService calls it under recovery_lock.
+ */
+class AdaptiveRecoveryLimit {
+public:
+  explicit AdaptiveRecoveryLimit(unsigned max_limit = 1,
+				 unsigned samples_per_epoch = 500)
+    : max_limit(std::max(1u, max_limit)),
+      samples_per_epoch(std::max(1u, samples_per_epoch)) {}
+
+  /// change the upper bound, e.g. after osd_recovery_max_active changed
+  void set_max(unsigned m) {
+    max_limit = std::max(1u, m);
+    limit = std::min(limit, double(max_limit));
+  }
+
+  unsigned get() const {
+    return std::clamp(unsigned(limit), 1u, max_limit);
+  }
+
+  unsigned get_max() const {
+    return max_limit;
+  }
+
+  /// @return the latency of an op that did not queue, zero if unknown
+  ceph::timespan get_base_latency() const {
+    return ceph::make_timespan(base);
+  }
+
+  /**
+   * account a completed recovery op
+   *
+   * @param latency   time from the start of the op to its completion
+   * @param in_flight recovery ops in flight, including this one
+   */
+  void add_sample(ceph::timespan latency, unsigned in_flight) {
+    double lat = std::chrono::duration<double>(latency).count();
+    if (lat <= 0) {
+      return;
+    }
+    if (epoch_min == 0 || lat < epoch_min) {
+      epoch_min = lat;
+    }
+    if (base == 0 || lat < base) {
+      base = lat;
+    }
+    if (++samples >= samples_per_epoch) {
+      base = epoch_min;
+      epoch_min = 0;
+      samples = 0;
+      limit = std::max(1.0, limit / 2);
+      return;
+    }
+
+    double queued = 1.0 - base / lat;
+    if (queued > 0.5) {
+      limit = std::max(1.0, limit - 0.5);
+    } else if (queued < 1.0 / 3 && in_flight * 2 >= get()) {
+      // an app limited sample says nothing about how far we could go
+      limit = std::min(double(max_limit), limit + 1.0 / limit);
+    }
+  }
+
+private:
+  unsigned max_limit;
+  double limit = 1;
+  const unsigned samples_per_epoch;
+  unsigned samples = 0;
+  double base = 0;       ///< seconds, min over this and the previous epoch
+  double epoch_min = 0;  ///< seconds, min over this epoch
+};
+
+#endif
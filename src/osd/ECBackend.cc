@@ -25,6 +25,7 @@
 #include "ECMsgTypes.h"
 
 #include "PrimaryLogPG.h"
+#include "osd_perf_counters.h"
 #include "osd_tracer.h"
 
 #define dout_context cct
@@ -141,7 +142,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::ReadOp &rhs)
 	     << ", priority=" << rhs.priority
 	     << ", obj_to_source=" << rhs.obj_to_source
 	     << ", source_to_obj=" << rhs.source_to_obj
-	     << ", in_progress=" << rhs.in_progress << ")";
+	     << ", in_progress=" << rhs.in_progress
+	     << (rhs.hedged ? ", hedged" : "") << ")";
 }
 
 void ECBackend::ReadOp::dump(Formatter *f) const
@@ -156,6 +158,7 @@ void ECBackend::ReadOp::dump(Formatter *f) const
   f->dump_stream("obj_to_source") << obj_to_source;
   f->dump_stream("source_to_obj") << source_to_obj;
   f->dump_stream("in_progress") << in_progress;
+  f->dump_bool("hedged", hedged);
 }
 
 ostream &operator<<(ostream &lhs, const ECBackend::RMWPipeline::Op &rhs)
@@ -179,6 +182,7 @@ ostream &operator<<(ostream &lhs, const ECBackend::RMWPipeline::Op &rhs)
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
       << " plan.will_write=" << rhs.plan.will_write
+      << " plan.parity_delta=" << rhs.plan.parity_delta
       << ")";
   return lhs;
 }
@@ -1266,9 +1270,10 @@ void ECBackend::handle_sub_read_reply(
   rop.in_progress.erase(from);
   unsigned is_complete = 0;
   bool need_resend = false;
-  // For redundant reads check for completion as each shard comes in,
-  // or in a non-recovery read check for completion once all the shards read.
-  if (rop.do_redundant_reads || rop.in_progress.empty()) {
+  // For redundant and hedged reads check for completion as each shard
+  // comes in, or in a non-recovery read check for completion once all the
+  // shards read.
+  if (rop.do_redundant_reads || rop.hedged || rop.in_progress.empty()) {
     for (map<hobject_t, read_result_t>::const_iterator iter =
         rop.complete.begin();
       iter != rop.complete.end();
@@ -1514,6 +1519,8 @@ void ECBackend::on_change()
   tid_to_read_map.clear();
   shard_to_read_map.clear();
   in_progress_client_reads.clear();
+  hedge_queue.clear();
+  hedge_scheduled = false;
   clear_recovery_state();
 }
 
@@ -1565,6 +1572,7 @@ struct ECClassicalOp : ECBackend::RMWPipeline::Op {
         pgid,
         sinfo,
         remote_read_result,
+        delta_read_result,
         log_entries,
         written,
         transactions,
@@ -1636,6 +1644,10 @@ void ECBackend::submit_transaction(
       return ref;
     },
     get_parent()->get_dpp());
+  if (cct->_conf.get_val<bool>("osd_ec_parity_delta_writes") &&
+      get_parent()->get_pool().allows_ecoverwrites()) {
+    ECTransaction::plan_parity_delta(sinfo, ec_impl, op->plan);
+  }
   dout(10) << __func__ << ": op " << *op << " starting" << dendl;
   rmw_pipeline.start_rmw(std::move(op));
 }
@@ -1801,7 +1813,7 @@ int ECBackend::get_remaining_shards(
   return 0;
 }
 
-void ECBackend::start_read_op(
+ceph_tid_t ECBackend::start_read_op(
   int priority,
   map<hobject_t, set<int>> &want_to_read,
   map<hobject_t, read_request_t> &to_read,
@@ -1827,13 +1839,11 @@ void ECBackend::start_read_op(
     op.trace.event("start ec read");
   }
   do_read_op(op);
+  return tid;
 }
 
 void ECBackend::do_read_op(ReadOp &op)
 {
-  int priority = op.priority;
-  ceph_tid_t tid = op.tid;
-
   dout(10) << __func__ << ": starting read " << op << dendl;
 
   map<pg_shard_t, ECSubRead> messages;
@@ -1872,6 +1882,16 @@ void ECBackend::do_read_op(ReadOp &op)
     }
   }
 
+  send_sub_reads(op, messages);
+  dout(10) << __func__ << ": started " << op << dendl;
+}
+
+void ECBackend::send_sub_reads(
+  ReadOp &op,
+  map<pg_shard_t, ECSubRead> &messages)
+{
+  int priority = op.priority;
+  ceph_tid_t tid = op.tid;
   std::vector<std::pair<int, Message*>> m;
   m.reserve(messages.size());
   for (map<pg_shard_t, ECSubRead>::iterator i = messages.begin();
@@ -1900,8 +1920,118 @@ void ECBackend::do_read_op(ReadOp &op)
   if (!m.empty()) {
     get_parent()->send_message_osd_cluster(m, get_osdmap_epoch());
   }
+}
 
-  dout(10) << __func__ << ": started " << op << dendl;
+void ECBackend::queue_hedge(ceph::timespan delay, ceph_tid_t tid)
+{
+  hedge_queue.emplace_back(ceph::mono_clock::now() + delay, tid);
+  // a single timer event at a time for the whole pg
+  if (!hedge_scheduled) {
+    hedge_scheduled = true;
+    get_parent()->schedule_read_hedge(delay);
+  }
+}
+
+void ECBackend::hedge_reads()
+{
+  hedge_scheduled = false;
+  auto now = ceph::mono_clock::now();
+  // the delay may have changed meanwhile, so the queue is only roughly in
+  // order; a read that is due behind a later one is hedged a bit late
+  while (!hedge_queue.empty() && hedge_queue.front().first <= now) {
+    hedge_read(hedge_queue.front().second);
+    hedge_queue.pop_front();
+  }
+  if (!hedge_queue.empty()) {
+    hedge_scheduled = true;
+    get_parent()->schedule_read_hedge(hedge_queue.front().first - now);
+  }
+}
+
+void ECBackend::hedge_read(ceph_tid_t tid)
+{
+  auto iter = tid_to_read_map.find(tid);
+  if (iter == tid_to_read_map.end()) {
+    // complete already
+    return;
+  }
+  ReadOp &op = iter->second;
+  if (!op.may_hedge()) {
+    return;
+  }
+  dout(10) << __func__ << ": still waiting for " << op.in_progress
+	   << " on " << op << dendl;
+
+  map<hobject_t, map<shard_id_t, pg_shard_t>> avail;
+  for (auto &&[hoid, req] : op.to_read) {
+    if (req.need.empty()) {
+      continue;
+    }
+    set<int> have;
+    set<pg_shard_t> error_shards;
+    for (auto &&[shard, err] : op.complete[hoid].errors) {
+      error_shards.insert(shard);
+    }
+    get_all_avail_shards(hoid, error_shards, have, avail[hoid], false);
+  }
+  auto messages = plan_hedge_reads(
+    sinfo, ec_impl->get_sub_chunk_count(), op, avail);
+  if (messages.empty()) {
+    dout(10) << __func__ << ": no other shard to read from" << dendl;
+    return;
+  }
+  dout(20) << __func__ << ": also reading from " << messages.size()
+	   << " shards" << dendl;
+  get_parent()->get_logger()->inc(l_osd_sop_ec_read_hedge);
+  op.trace.event("ec read hedged");
+  send_sub_reads(op, messages);
+}
+
+map<pg_shard_t, ECSubRead> ECBackend::plan_hedge_reads(
+  const ECUtil::stripe_info_t &sinfo,
+  int sub_chunk_count,
+  ReadOp &op,
+  const map<hobject_t, map<shard_id_t, pg_shard_t>> &avail)
+{
+  map<pg_shard_t, ECSubRead> messages;
+  if (!op.may_hedge()) {
+    return messages;
+  }
+  op.hedged = true;
+
+  // any k chunks decode the others, one extra shard stands in for one
+  // slow shard of each object
+  vector<pair<int, int>> subchunks;
+  subchunks.push_back(make_pair(0, sub_chunk_count));
+  for (auto &&[hoid, req] : op.to_read) {
+    auto shards = avail.find(hoid);
+    if (req.need.empty() || shards == avail.end()) {
+      continue;
+    }
+    auto &sources = op.obj_to_source[hoid];
+    for (auto &&[shard_id, shard] : shards->second) {
+      if (sources.count(shard) || op.in_progress.count(shard)) {
+	continue;
+      }
+      req.need[shard] = subchunks;
+      auto &msg = messages[shard];
+      msg.subchunks[hoid] = subchunks;
+      for (auto &&extent : req.to_read) {
+	pair<uint64_t, uint64_t> chunk_off_len =
+	  sinfo.aligned_offset_len_to_chunk(
+	    make_pair(extent.get<0>(), extent.get<1>()));
+	msg.to_read[hoid].push_back(
+	  boost::make_tuple(
+	    chunk_off_len.first,
+	    chunk_off_len.second,
+	    extent.get<2>()));
+      }
+      sources.insert(shard);
+      op.source_to_obj[shard].insert(hoid);
+      break;
+    }
+  }
+  return messages;
 }
 
 ECUtil::HashInfoRef ECBackend::get_hash_info(
@@ -1975,6 +2105,86 @@ void ECBackend::RMWPipeline::start_rmw(OpRef op)
   check_ops();
 }
 
+/*
+ * A parity delta write reads the shards it modifies straight from
+ * disk, so no write to the same object may be in progress: its data
+ * would only be in the cache, and its coding chunks nowhere.
+ */
+bool ECBackend::RMWPipeline::can_use_parity_delta(const Op &op)
+{
+  if (!pipeline_state.caching_enabled()) {
+    return false;
+  }
+  for (auto &&[hoid, shards] : op.plan.delta_shards) {
+    if (cache.has_extents(hoid) || !shards_readable(hoid, shards)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * The data chunks a parity delta write does not modify are read from
+ * disk by later writes to its stripes; keep them from reading its
+ * coding chunks before it is sent, should they need to reconstruct.
+ */
+bool ECBackend::RMWPipeline::waits_for_parity_delta(const Op &op) const
+{
+  for (auto &&i: waiting_reads) {
+    if (!i.plan.parity_delta) {
+      continue;
+    }
+    for (auto &&hpair: op.plan.to_read) {
+      if (i.plan.delta_shards.count(hpair.first)) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*
+ * The shards a parity delta write reads could not all be read: read
+ * and reconstruct the whole stripes, as a full stripe rmw would, and
+ * encode them again for the old content of these shards.
+ */
+void ECBackend::RMWPipeline::read_delta_shards_from_stripes(
+  Op *op,
+  map<hobject_t, ECTransaction::shard_extent_map> &&read,
+  const map<hobject_t, extent_set> &to_read)
+{
+  objects_read_async_no_cache(
+    to_read,
+    [op, this, read=std::move(read)](
+      map<hobject_t, pair<int, extent_map>> &&results) mutable {
+      for (auto &&[hoid, result] : results) {
+	if (result.first < 0) {
+	  derr << __func__ << ": unable to read the stripes of " << hoid
+	       << " for a parity delta write: "
+	       << cpp_strerror(result.first) << dendl;
+	  ceph_abort_msg("unable to read the stripes of a parity delta write");
+	}
+	const set<int> &want = op->plan.delta_shards.at(hoid);
+	auto &shards = read[hoid];
+	for (auto &&extent: result.second) {
+	  bufferlist bl = extent.get_val();
+	  map<int, bufferlist> encoded;
+	  int r = ECUtil::encode(sinfo, ec_impl, bl, want, &encoded);
+	  ceph_assert(r == 0);
+	  uint64_t chunk_off =
+	    sinfo.aligned_logical_offset_to_chunk_offset(extent.get_off());
+	  for (auto &&[shard, chunks] : encoded) {
+	    if (want.count(shard)) {
+	      shards[shard].insert(chunk_off, chunks.length(), chunks);
+	    }
+	  }
+	}
+      }
+      op->delta_read_result = std::move(read);
+      check_ops();
+    });
+}
+
 bool ECBackend::RMWPipeline::try_state_to_reads()
 {
   if (waiting_state.empty())
@@ -1990,6 +2200,26 @@ bool ECBackend::RMWPipeline::try_state_to_reads()
     return false;
   }
 
+  if (op->requires_rmw() && waits_for_parity_delta(*op)) {
+    dout(20) << __func__ << ": blocking " << *op
+	     << " because it reads an object a parity delta write"
+	     << " is still reading"
+	     << dendl;
+    return false;
+  }
+
+  if (op->plan.parity_delta && !can_use_parity_delta(*op)) {
+    dout(20) << __func__ << ": " << *op
+	     << " falls back to a full stripe rmw" << dendl;
+    op->plan.parity_delta = false;
+    op->plan.delta_shards.clear();
+  }
+  if (op->plan.parity_delta) {
+    for (auto &&hpair: op->plan.delta_shards) {
+      op->plan.will_write[hpair.first] = op->plan.delta_chunks[hpair.first];
+    }
+  }
+
   if (!pipeline_state.caching_enabled()) {
     op->using_cache = false;
   } else if (op->invalidates_cache()) {
@@ -2008,7 +2238,8 @@ bool ECBackend::RMWPipeline::try_state_to_reads()
     for (auto &&hpair: op->plan.will_write) {
       auto to_read_plan_iter = op->plan.to_read.find(hpair.first);
       const extent_set &to_read_plan =
-	to_read_plan_iter == op->plan.to_read.end() ?
+	to_read_plan_iter == op->plan.to_read.end() ||
+	op->plan.parity_delta ?
 	empty :
 	to_read_plan_iter->second;
 
@@ -2034,7 +2265,40 @@ bool ECBackend::RMWPipeline::try_state_to_reads()
 
   dout(10) << __func__ << ": " << *op << dendl;
 
-  if (!op->remote_read.empty()) {
+  if (op->plan.parity_delta) {
+    ceph_assert(op->using_cache);
+    ceph_assert(op->remote_read.empty());
+    ceph_assert(op->pending_read.empty());
+    map<hobject_t, pair<extent_set, set<int>>> to_read;
+    for (auto &&hpair: op->plan.delta_shards) {
+      to_read.emplace(
+	hpair.first,
+	make_pair(op->plan.to_read.at(hpair.first), hpair.second));
+    }
+    objects_read_shards(
+      to_read,
+      [op, this](map<hobject_t,
+		     pair<int, ECTransaction::shard_extent_map>> &&results) {
+	map<hobject_t, ECTransaction::shard_extent_map> read;
+	map<hobject_t, extent_set> failed;
+	for (auto &&i: results) {
+	  if (i.second.first < 0) {
+	    dout(0) << __func__ << ": parity delta read of " << i.first
+		    << " failed: " << cpp_strerror(i.second.first)
+		    << ", reading its whole stripes" << dendl;
+	    failed.emplace(i.first, op->plan.to_read.at(i.first));
+	  } else {
+	    read.emplace(i.first, std::move(i.second.second));
+	  }
+	}
+	if (!failed.empty()) {
+	  read_delta_shards_from_stripes(op, std::move(read), failed);
+	  return;
+	}
+	op->delta_read_result = std::move(read);
+	check_ops();
+      });
+  } else if (!op->remote_read.empty()) {
     ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
     objects_read_async_no_cache(
       op->remote_read,
@@ -2128,6 +2392,7 @@ bool ECBackend::RMWPipeline::try_reads_to_commit()
   }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->delta_read_result.clear();
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -2468,6 +2733,27 @@ void ECBackend::objects_read_and_reconstruct(
   set<int> want_to_read;
   get_want_to_read_shards(&want_to_read);
     
+  const uint64_t segment_size =
+    cct->_conf.get_val<Option::size_t>("osd_ec_read_segment_size");
+  const auto hedge_delay =
+    cct->_conf.get_val<std::chrono::milliseconds>("osd_ec_read_hedge_delay");
+  // an extra shard only stands in for a slow one when whole chunks decode
+  const bool hedge = !fast_read && hedge_delay.count() > 0 &&
+    ec_impl->get_coding_chunk_count() > 0 &&
+    ec_impl->get_sub_chunk_count() == 1;
+  auto start_client_read_op = [&](auto &want, auto &to_read) {
+    ceph_tid_t tid = start_read_op(
+      CEPH_MSG_PRIO_DEFAULT,
+      want,
+      to_read,
+      OpRequestRef(),
+      fast_read, false);
+    if (hedge) {
+      queue_hedge(hedge_delay, tid);
+    }
+  };
+
+  auto &status = in_progress_client_reads.back();
   map<hobject_t, read_request_t> for_read_op;
   for (auto &&to_read: reads) {
     map<pg_shard_t, vector<pair<int, int>>> shards;
@@ -2479,10 +2765,34 @@ void ECBackend::objects_read_and_reconstruct(
       &shards);
     ceph_assert(r == 0);
 
+    auto segments =
+      split_read_to_segments(sinfo, to_read.second, segment_size);
+    if (segments.size() > 1) {
+      // each segment is decoded as soon as its chunks arrive, while the
+      // shards still read the later ones
+      dout(20) << __func__ << ": reading " << to_read.first << " in "
+	       << segments.size() << " segments" << dendl;
+      status.segments_to_read[to_read.first] = segments.size();
+      for (auto &&segment : segments) {
+	map<hobject_t, set<int>> segment_want{{to_read.first, want_to_read}};
+	map<hobject_t, read_request_t> segment_read;
+	segment_read.insert(
+	  make_pair(
+	    to_read.first,
+	    read_request_t(
+	      segment,
+	      shards,
+	      false,
+	      new CallClientContexts(to_read.first, this, &status, segment))));
+	start_client_read_op(segment_want, segment_read);
+      }
+      continue;
+    }
+
     CallClientContexts *c = new CallClientContexts(
       to_read.first,
       this,
-      &(in_progress_client_reads.back()),
+      &status,
       to_read.second);
     for_read_op.insert(
       make_pair(
@@ -2495,16 +2805,157 @@ void ECBackend::objects_read_and_reconstruct(
     obj_want_to_read.insert(make_pair(to_read.first, want_to_read));
   }
 
+  if (!for_read_op.empty()) {
+    start_client_read_op(obj_want_to_read, for_read_op);
+  }
+  return;
+}
+
+list<list<boost::tuple<uint64_t, uint64_t, uint32_t>>>
+ECBackend::split_read_to_segments(
+  const ECUtil::stripe_info_t &sinfo,
+  const list<boost::tuple<uint64_t, uint64_t, uint32_t>> &extents,
+  uint64_t segment_size)
+{
+  list<list<boost::tuple<uint64_t, uint64_t, uint32_t>>> segments;
+  uint64_t total = 0;
+  bool aligned = true;
+  for (auto &&extent : extents) {
+    total += extent.get<1>();
+    aligned = aligned && extent.get<1>() > 0 &&
+      sinfo.logical_offset_is_stripe_aligned(extent.get<0>()) &&
+      sinfo.logical_offset_is_stripe_aligned(extent.get<1>());
+  }
+  if (segment_size == 0 || total <= segment_size || !aligned) {
+    segments.push_back(extents);
+    return segments;
+  }
+
+  const uint64_t segment_len = sinfo.logical_to_next_stripe_offset(segment_size);
+  uint64_t in_segment = segment_len;
+  for (auto &&extent : extents) {
+    uint64_t off = extent.get<0>();
+    uint64_t left = extent.get<1>();
+    while (left > 0) {
+      if (in_segment == segment_len) {
+	segments.emplace_back();
+	in_segment = 0;
+      }
+      uint64_t len = std::min(left, segment_len - in_segment);
+      segments.back().push_back(boost::make_tuple(off, len, extent.get<2>()));
+      off += len;
+      left -= len;
+      in_segment += len;
+    }
+  }
+  return segments;
+}
+
+struct CallShardReadContexts :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  using results_t =
+    map<hobject_t,pair<int, ECTransaction::shard_extent_map>>;
+  struct Status {
+    unsigned objects_to_read;
+    GenContextURef<results_t &&> func;
+    results_t results;
+  };
+  hobject_t hoid;
+  ECBackend *ec;
+  std::shared_ptr<Status> status;
+  set<int> want;
+  CallShardReadContexts(
+    hobject_t hoid,
+    ECBackend *ec,
+    std::shared_ptr<Status> status,
+    const set<int> &want)
+    : hoid(hoid), ec(ec), status(status), want(want) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ECBackend::read_result_t &res = in.second;
+    ECTransaction::shard_extent_map result;
+    if (res.r == 0) {
+      for (auto &&read: res.returned) {
+	uint64_t chunk_off = ec->sinfo.aligned_logical_offset_to_chunk_offset(
+	  read.get<0>());
+	map<int, bufferlist> have;
+	for (auto &&j: read.get<2>()) {
+	  have[j.first.shard] = std::move(j.second);
+	}
+	map<int, bufferlist> decoded;
+	map<int, bufferlist*> to_decode;
+	for (auto shard: want) {
+	  if (!have.count(shard)) {
+	    to_decode[shard] = &decoded[shard];
+	  }
+	}
+	if (!to_decode.empty()) {
+	  int r = ECUtil::decode(ec->sinfo, ec->ec_impl, have, to_decode);
+	  if (r < 0) {
+	    res.r = r;
+	    break;
+	  }
+	}
+	for (auto shard: want) {
+	  bufferlist &bl = have.count(shard) ? have[shard] : decoded[shard];
+	  result[shard].insert(chunk_off, bl.length(), bl);
+	}
+      }
+    }
+    status->results.emplace(hoid, make_pair(res.r, std::move(result)));
+    if (--status->objects_to_read == 0) {
+      status->func.release()->complete(std::move(status->results));
+    }
+  }
+};
+
+void ECBackend::objects_read_shards(
+  const map<hobject_t, pair<extent_set, set<int>>> &reads,
+  GenContextURef<map<hobject_t,pair<int, ECTransaction::shard_extent_map>> &&>
+    &&func)
+{
+  ceph_assert(!reads.empty());
+  auto status = std::make_shared<CallShardReadContexts::Status>();
+  status->objects_to_read = reads.size();
+  status->func = std::move(func);
+
+  map<hobject_t, set<int>> obj_want_to_read;
+  map<hobject_t, read_request_t> for_read_op;
+  for (auto &&[hoid, to_read] : reads) {
+    auto &[extents, want] = to_read;
+    map<pg_shard_t, vector<pair<int, int>>> shards;
+    int r = get_min_avail_to_read_shards(
+      hoid,
+      want,
+      false,
+      false,
+      &shards);
+    ceph_assert(r == 0);
+
+    list<boost::tuple<uint64_t, uint64_t, uint32_t>> offsets;
+    for (auto &&extent: extents) {
+      ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.first));
+      ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.second));
+      offsets.emplace_back(extent.first, extent.second, 0);
+    }
+    for_read_op.insert(
+      make_pair(
+	hoid,
+	read_request_t(
+	  offsets,
+	  shards,
+	  false,
+	  new CallShardReadContexts(hoid, this, status, want))));
+    obj_want_to_read.insert(make_pair(hoid, want));
+  }
+
   start_read_op(
     CEPH_MSG_PRIO_DEFAULT,
     obj_want_to_read,
     for_read_op,
     OpRequestRef(),
-    fast_read, false);
-  return;
+    false, false);
 }
 
-
 int ECBackend::send_all_remaining_reads(
   const hobject_t &hoid,
   ReadOp &rop)
@@ -2606,33 +3057,40 @@ int ECBackend::be_deep_scrub(
   if (stride % sinfo.get_chunk_size())
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
 
-  bufferlist bl;
-  r = store->read(
-    ch,
-    ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-    pos.data_pos,
-    stride, bl,
-    fadvise_flags);
-  if (r < 0) {
-    dout(20) << __func__ << "  " << poid << " got "
-	     << r << " on read, read_error" << dendl;
-    o.read_error = true;
-    return 0;
-  }
-  if (bl.length() % sinfo.get_chunk_size()) {
-    dout(20) << __func__ << "  " << poid << " got "
-	     << r << " on read, not chunk size " << sinfo.get_chunk_size() << " aligned"
-	     << dendl;
-    o.read_error = true;
-    return 0;
-  }
-  if (r > 0) {
-    pos.data_hash << bl;
-  }
-  pos.data_pos += r;
-  if (r == (int)stride) {
-    return -EINPROGRESS;
+  if (pos.sampling) {
+    r = be_sample_data(poid, pos, stride, fadvise_flags, o);
+    if (r == -EINPROGRESS || o.read_error) {
+      return r;
+    }
+  } else {
+    bufferlist bl;
+    r = store->read(
+      ch,
+      ghobject_t(
+	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+      pos.data_pos,
+      stride, bl,
+      fadvise_flags);
+    if (r < 0) {
+      dout(20) << __func__ << "  " << poid << " got "
+	       << r << " on read, read_error" << dendl;
+      o.read_error = true;
+      return 0;
+    }
+    if (bl.length() % sinfo.get_chunk_size()) {
+      dout(20) << __func__ << "  " << poid << " got "
+	       << r << " on read, not chunk size " << sinfo.get_chunk_size() << " aligned"
+	       << dendl;
+      o.read_error = true;
+      return 0;
+    }
+    if (r > 0) {
+      pos.data_hash << bl;
+    }
+    pos.data_pos += r;
+    if (r == (int)stride) {
+      return -EINPROGRESS;
+    }
   }
 
   ECUtil::HashInfoRef hinfo = get_hash_info(poid, false, &o.attrs);
@@ -2648,7 +3106,8 @@ int ECBackend::be_deep_scrub(
         o.ec_size_mismatch = true;
         return 0;
       }
-      if (hinfo->get_total_chunk_size() != (unsigned)pos.data_pos) {
+      if (hinfo->get_total_chunk_size() !=
+	  (pos.sampling ? o.size : (unsigned)pos.data_pos)) {
 	dout(0) << "_scan_list  " << poid << " got incorrect size on read 0x"
 		<< std::hex << pos
 		<< " expected 0x" << hinfo->get_total_chunk_size() << std::dec
@@ -2657,7 +3116,9 @@ int ECBackend::be_deep_scrub(
 	return 0;
       }
 
-      if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) !=
+      // a sampled shard is only checked by the object store checksums
+      if (!pos.sampling &&
+	  hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) !=
 	  pos.data_hash.digest()) {
 	dout(0) << "_scan_list  " << poid << " got incorrect hash on read 0x"
 		<< std::hex << pos.data_hash.digest() << " !=  expected 0x"
@@ -144,11 +144,36 @@ public:
     bool fast_read,
     GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func);
 
+  /// stripe aligned extents of more than segment_size bytes, split into
+  /// segments of about segment_size bytes; others in a single segment
+  static std::list<std::list<boost::tuple<uint64_t, uint64_t, uint32_t>>>
+  split_read_to_segments(
+    const ECUtil::stripe_info_t &sinfo,
+    const std::list<boost::tuple<uint64_t, uint64_t, uint32_t>> &extents,
+    uint64_t segment_size);
+
+  /**
+   * Read the given shards of stripe aligned extents as they are on
+   * disk, without reconstructing the logical content.  Shards which
+   * cannot be read are decoded from the others.
+   *
+   * Parity delta writes use this to read the old content of the data
+   * chunks they modify and of the coding chunks.
+   */
+  void objects_read_shards(
+    const std::map<hobject_t, std::pair<extent_set, std::set<int>>> &reads,
+    GenContextURef<
+      std::map<hobject_t,std::pair<int, ECTransaction::shard_extent_map>> &&
+    > &&func);
+
   friend struct CallClientContexts;
+  friend struct CallShardReadContexts;
   struct ClientAsyncReadStatus {
     unsigned objects_to_read;
     GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> func;
     std::map<hobject_t,std::pair<int, extent_map> > results;
+    /// objects read in several segments -> segments not complete yet
+    std::map<hobject_t, unsigned> segments_to_read;
     explicit ClientAsyncReadStatus(
       unsigned objects_to_read,
       GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func)
@@ -158,6 +183,22 @@ public:
       int err,
       extent_map &&buffers) {
       ceph_assert(objects_to_read);
+      if (auto p = segments_to_read.find(hoid); p != segments_to_read.end()) {
+	auto &[r, result] = results[hoid];
+	if (err < 0 && r == 0) {
+	  r = err;
+	}
+	result.insert(std::move(buffers));
+	if (--p->second > 0) {
+	  return;
+	}
+	segments_to_read.erase(p);
+	if (r < 0) {
+	  result.clear();
+	}
+	--objects_to_read;
+	return;
+      }
       --objects_to_read;
       ceph_assert(!results.count(hoid));
       results.emplace(hoid, std::make_pair(err, std::move(buffers)));
@@ -370,6 +411,14 @@ public:
 
     std::set<pg_shard_t> in_progress;
 
+    /// an extra shard was asked because some were slow, @see hedge_read
+    bool hedged = false;
+
+    bool may_hedge() const {
+      return !hedged && !do_redundant_reads && !for_recovery &&
+	!in_progress.empty();
+    }
+
     ReadOp(
       int priority,
       ceph_tid_t tid,
@@ -404,7 +453,7 @@ public:
   friend ostream &operator<<(ostream &lhs, const ReadOp &rhs);
   std::map<ceph_tid_t, ReadOp> tid_to_read_map;
   std::map<pg_shard_t, std::set<ceph_tid_t> > shard_to_read_map;
-  void start_read_op(
+  ceph_tid_t start_read_op(
     int priority,
     std::map<hobject_t, std::set<int>> &want_to_read,
     std::map<hobject_t, read_request_t> &to_read,
@@ -412,6 +461,26 @@ public:
     bool do_redundant_reads, bool for_recovery);
 
   void do_read_op(ReadOp &rop);
+  void send_sub_reads(ReadOp &rop, std::map<pg_shard_t, ECSubRead> &messages);
+  /// client reads to hedge unless complete by then, in the order they are due
+  std::deque<std::pair<ceph::mono_time, ceph_tid_t>> hedge_queue;
+  bool hedge_scheduled = false;
+  void queue_hedge(ceph::timespan delay, ceph_tid_t tid);
+  void hedge_reads() override;
+  void hedge_read(ceph_tid_t tid);
+  /**
+   * ask one more shard for each object op is still waiting for
+   *
+   * Marks op hedged, so this is done only once.
+   *
+   * @param avail the shards each object may be read from
+   * @return the sub reads to send, empty if op cannot be hedged
+   */
+  static std::map<pg_shard_t, ECSubRead> plan_hedge_reads(
+    const ECUtil::stripe_info_t &sinfo,
+    int sub_chunk_count,
+    ReadOp &op,
+    const std::map<hobject_t, std::map<shard_id_t, pg_shard_t>> &avail);
   int send_all_remaining_reads(
     const hobject_t &hoid,
     ReadOp &rop);
@@ -467,7 +536,12 @@ public:
       std::map<hobject_t,extent_set> pending_read; // subset already being read
       std::map<hobject_t,extent_set> remote_read;  // subset we must read
       std::map<hobject_t,extent_map> remote_read_result;
+      /// old shard content for plan.parity_delta, see objects_read_shards
+      std::map<hobject_t,ECTransaction::shard_extent_map> delta_read_result;
       bool read_in_progress() const {
+        if (plan.parity_delta) {
+          return delta_read_result.empty();
+        }
         return !remote_read.empty() && remote_read_result.empty();
       }
 
@@ -555,6 +629,12 @@ public:
     eversion_t completed_to;
     eversion_t committed_to;
     void start_rmw(OpRef op);
+    bool can_use_parity_delta(const Op &op);
+    bool waits_for_parity_delta(const Op &op) const;
+    void read_delta_shards_from_stripes(
+      Op *op,
+      std::map<hobject_t, ECTransaction::shard_extent_map> &&read,
+      const std::map<hobject_t, extent_set> &to_read);
     bool try_state_to_reads();
     bool try_reads_to_commit();
     bool try_finish_rmw();
@@ -589,6 +669,24 @@ public:
         std::map<hobject_t,std::pair<int, extent_map> > &&, Func>(
             std::forward<Func>(on_complete)));
     }
+    template <typename Func>
+    void objects_read_shards(
+      const std::map<hobject_t, std::pair<extent_set, std::set<int>>> &to_read,
+      Func &&on_complete
+    ) {
+      ec_backend.objects_read_shards(
+        to_read,
+        make_gen_lambda_context<
+        std::map<hobject_t,std::pair<int, ECTransaction::shard_extent_map> > &&,
+        Func>(
+            std::forward<Func>(on_complete)));
+    }
+    bool shards_readable(const hobject_t &hoid, const std::set<int> &want) {
+      std::set<int> have;
+      std::map<shard_id_t, pg_shard_t> shards;
+      ec_backend.get_all_avail_shards(hoid, {}, have, shards, false);
+      return std::includes(have.begin(), have.end(), want.begin(), want.end());
+    }
     void handle_sub_write(
       pg_shard_t from,
       OpRequestRef msg,
@@ -736,6 +834,11 @@ public:
     ScrubMapBuilder &pos,
     ScrubMap::object &o) override;
 
+  bool be_can_sample_data(const object_info_t &oi) const override {
+    // the hash info, or nothing with overwrites, stands for the shard
+    return store->has_builtin_csum();
+  }
+
   uint64_t be_get_ondisk_size(uint64_t logical_size) const final {
     return sinfo.logical_to_next_chunk_offset(logical_size);
   }
@@ -94,6 +94,145 @@ static void encode_and_write(
   }
 }
 
+static int get_chunk_shard(const ErasureCodeInterfaceRef &ecimpl, int chunk)
+{
+  const vector<int> &chunk_mapping = ecimpl->get_chunk_mapping();
+  return (int)chunk_mapping.size() > chunk ? chunk_mapping[chunk] : chunk;
+}
+
+static void write_parity_deltas(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const extent_set &delta_chunks,
+  const ECTransaction::shard_extent_map &old_shards,
+  const extent_map &updates,
+  uint32_t flags,
+  extent_map &written,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp)
+{
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  auto get_old = [&](int shard, uint64_t chunk_off) {
+    auto siter = old_shards.find(shard);
+    ceph_assert(siter != old_shards.end());
+    auto old = siter->second.intersect(chunk_off, chunk_size);
+    ceph_assert(old.ext_count() == 1);
+    ceph_assert(old.begin().get_off() == chunk_off);
+    ceph_assert(old.begin().get_len() == chunk_size);
+    return old.begin().get_val();
+  };
+
+  map<uint64_t, set<int>> stripes;
+  for (auto &&extent: delta_chunks) {
+    for (uint64_t off = extent.first;
+	 off < extent.first + extent.second;
+	 off += chunk_size) {
+      stripes[sinfo.logical_to_prev_stripe_offset(off)].insert(
+	(off % sinfo.get_stripe_width()) / chunk_size);
+    }
+  }
+
+  const int data_chunks = ecimpl->get_data_chunk_count();
+  for (auto &&[stripe_off, chunks] : stripes) {
+    uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(
+      stripe_off);
+    map<int, bufferlist> old_data, new_data, parity;
+    for (auto i : chunks) {
+      int shard = get_chunk_shard(ecimpl, i);
+      uint64_t off = stripe_off + i * chunk_size;
+      extent_map chunk;
+      chunk.insert(off, chunk_size, get_old(shard, chunk_off));
+      chunk.insert(updates.intersect(off, chunk_size));
+      bufferlist bl;
+      for (auto &&extent: chunk) {
+	bl.append(extent.get_val());
+      }
+      ceph_assert(bl.length() == chunk_size);
+      written.insert(off, chunk_size, bl);
+      old_data[shard] = get_old(shard, chunk_off);
+      new_data[shard] = std::move(bl);
+    }
+    for (int i = data_chunks; i < (int)ecimpl->get_chunk_count(); ++i) {
+      int shard = get_chunk_shard(ecimpl, i);
+      parity[shard] = get_old(shard, chunk_off);
+    }
+    int r = ECUtil::encode_parity_delta(
+      sinfo, ecimpl, old_data, new_data, &parity);
+    ceph_assert(r == 0);
+
+    ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		       << " stripe " << stripe_off
+		       << " writing chunks " << chunks
+		       << " and parity" << dendl;
+    for (auto *shards : {&new_data, &parity}) {
+      for (auto &&[shard, bl] : *shards) {
+	auto st = transactions->find(shard_id_t(shard));
+	if (st == transactions->end()) {
+	  continue;
+	}
+	st->second.write(
+	  coll_t(spg_t(pgid, st->first)),
+	  ghobject_t(oid, ghobject_t::NO_GEN, st->first),
+	  chunk_off,
+	  bl.length(),
+	  bl,
+	  flags);
+      }
+    }
+  }
+}
+
+bool ECTransaction::plan_parity_delta(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  WritePlan &plan)
+{
+  if (plan.to_read.empty() ||
+      plan.invalidates_cache ||
+      !(ecimpl->get_supported_optimizations() &
+	ceph::ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION)) {
+    return false;
+  }
+
+  const uint64_t data_chunks = ecimpl->get_data_chunk_count();
+  const uint64_t coding_chunks = ecimpl->get_coding_chunk_count();
+  // chunks read and written by either way of updating the stripes
+  uint64_t full_cost = 0, delta_cost = 0;
+  map<hobject_t, set<int>> delta_shards;
+  for (auto &&[oid, to_read] : plan.to_read) {
+    auto chunks = plan.delta_chunks.find(oid);
+    if (chunks == plan.delta_chunks.end()) {
+      return false;
+    }
+    auto &shards = delta_shards[oid];
+    for (uint64_t i = data_chunks; i < data_chunks + coding_chunks; ++i) {
+      shards.insert(get_chunk_shard(ecimpl, i));
+    }
+    uint64_t modified = 0;
+    for (auto &&extent: chunks->second) {
+      for (uint64_t off = extent.first;
+	   off < extent.first + extent.second;
+	   off += sinfo.get_chunk_size()) {
+	shards.insert(get_chunk_shard(
+	  ecimpl, (off % sinfo.get_stripe_width()) / sinfo.get_chunk_size()));
+	++modified;
+      }
+    }
+    uint64_t stripes = to_read.size() / sinfo.get_stripe_width();
+    full_cost += stripes * (2 * data_chunks + coding_chunks);
+    // every modified shard is read over all the stripes
+    delta_cost += stripes * shards.size() + modified + stripes * coding_chunks;
+  }
+  if (delta_cost >= full_cost) {
+    return false;
+  }
+  plan.parity_delta = true;
+  plan.delta_shards = std::move(delta_shards);
+  return true;
+}
+
 void ECTransaction::generate_transactions(
   PGTransaction* _t,
   WritePlan &plan,
@@ -101,6 +240,7 @@ void ECTransaction::generate_transactions(
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<hobject_t,shard_extent_map> &delta_extents,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -392,6 +532,95 @@ void ECTransaction::generate_transactions(
 	}
       }
 
+      auto deltaiter = delta_extents.find(oid);
+      if (plan.parity_delta && deltaiter != delta_extents.end()) {
+	ceph_assert(entry);
+	ceph_assert(!op.truncate);
+	const uint64_t size = hinfo->get_total_logical_size(sinfo);
+	uint32_t fadvise_flags = 0;
+	extent_map updates;
+	for (auto &&extent: op.buffer_updates) {
+	  using BufferUpdate = PGTransaction::ObjectOperation::BufferUpdate;
+	  bufferlist bl;
+	  match(
+	    extent.get_val(),
+	    [&](const BufferUpdate::Write &op) {
+	      bl = op.buffer;
+	      fadvise_flags |= op.fadvise_flags;
+	    },
+	    [&](const BufferUpdate::Zero &) {
+	      bl.append_zero(extent.get_len());
+	    },
+	    [&](const BufferUpdate::CloneRange &) {
+	      ceph_assert(
+		0 ==
+		"CloneRange is not allowed, do_op should have returned ENOTSUPP");
+	    });
+	  ceph_assert(extent.get_off() + extent.get_len() <= size);
+	  updates.insert(extent.get_off(), extent.get_len(), bl);
+	}
+
+	// the rollback covers the whole stripes, so that it is the same
+	// on every shard whether or not this write modifies it
+	vector<pair<uint64_t, uint64_t> > rollback_extents;
+	for (auto &&extent: plan.to_read.at(oid)) {
+	  uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
+	    extent.first);
+	  uint64_t restore_len = sinfo.aligned_logical_offset_to_chunk_offset(
+	    extent.second);
+	  if (rollback_extents.empty()) {
+	    for (auto &&st : *transactions) {
+	      st.second.touch(
+		coll_t(spg_t(pgid, st.first)),
+		ghobject_t(oid, entry->version.version, st.first));
+	    }
+	  }
+	  rollback_extents.emplace_back(make_pair(restore_from, restore_len));
+	  for (auto &&st : *transactions) {
+	    st.second.clone_range(
+	      coll_t(spg_t(pgid, st.first)),
+	      ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	      ghobject_t(oid, entry->version.version, st.first),
+	      restore_from,
+	      restore_len,
+	      restore_from);
+	  }
+	}
+	ldpp_dout(dpp, 20) << "generate_transactions: " << oid
+			   << " parity delta write of "
+			   << plan.delta_chunks.at(oid)
+			   << " marking rollback extents "
+			   << rollback_extents
+			   << dendl;
+	write_parity_deltas(
+	  pgid,
+	  oid,
+	  sinfo,
+	  ecimpl,
+	  plan.delta_chunks.at(oid),
+	  deltaiter->second,
+	  updates,
+	  fadvise_flags,
+	  written,
+	  transactions,
+	  dpp);
+	entry->mod_desc.rollback_extents(
+	  entry->version.version, rollback_extents);
+	hinfo->set_total_chunk_size_clear_hash(
+	  sinfo.aligned_logical_offset_to_chunk_offset(size));
+
+	bufferlist hbuf;
+	encode(*hinfo, hbuf);
+	for (auto &&i : *transactions) {
+	  i.second.setattr(
+	    coll_t(spg_t(pgid, i.first)),
+	    ghobject_t(oid, ghobject_t::NO_GEN, i.first),
+	    ECUtil::get_hinfo_key(),
+	    hbuf);
+	}
+	return;
+      }
+
       extent_map to_write;
       auto pextiter = partial_extents.find(oid);
       if (pextiter != partial_extents.end()) {
@@ -29,8 +29,22 @@ namespace ECTransaction {
     std::map<hobject_t,extent_set> will_write; // superset of to_read
 
     std::map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /* Objects only overwritten in partial stripes within their size,
+     * with the data chunks modified, as chunk aligned logical extents.
+     * See plan_parity_delta(). */
+    std::map<hobject_t,extent_set> delta_chunks;
+
+    /* Set by plan_parity_delta(): the shards of to_read to read for
+     * each object, the modified data shards and the coding shards. */
+    bool parity_delta = false;
+    std::map<hobject_t,std::set<int>> delta_shards;
   };
 
+  /// old content of the shards read for a parity delta write, by shard
+  /// and chunk offset
+  using shard_extent_map = std::map<int, extent_map>;
+
   template <typename F>
   WritePlan get_write_plan(
     const ECUtil::stripe_info_t &sinfo,
@@ -166,6 +180,27 @@ namespace ECTransaction {
 	  sinfo,
 	  projected_size);
 
+	if (!i.first.is_temp() &&
+	    !i.second.deletes_first() &&
+	    !i.second.is_fresh_object() &&
+	    !i.second.truncate &&
+	    !raw_write_set.empty() &&
+	    raw_write_set.range_end() <= orig_size &&
+	    plan.to_read.count(i.first) &&
+	    plan.to_read.at(i.first) == will_write) {
+	  auto &delta_chunks = plan.delta_chunks[i.first];
+	  for (auto &&extent: raw_write_set) {
+	    uint64_t start = extent.first -
+	      extent.first % sinfo.get_chunk_size();
+	    uint64_t end = round_up_to(extent.first + extent.second,
+				       sinfo.get_chunk_size());
+	    delta_chunks.union_insert(start, end - start);
+	  }
+	  ldpp_dout(dpp, 20) << __func__ << ": " << i.first
+			     << " may use parity deltas for chunks "
+			     << delta_chunks << dendl;
+	}
+
 	/* validate post conditions:
 	 * to_read should have an entry for i.first iff it isn't empty
 	 * and if we are reading from i.first, we can't be renaming or
@@ -177,6 +212,24 @@ namespace ECTransaction {
     return plan;
   }
 
+  /**
+   * Decide whether to write the partial stripes of plan by reading and
+   * writing only the modified data chunks and the coding chunks, which
+   * are updated with the parity delta of the modification, instead of
+   * reading the full stripes and rewriting all the chunks.
+   *
+   * Requires every object read by the plan to have delta_chunks, a
+   * plugin with FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION, and fewer
+   * chunks read and written than the full stripe write.
+   *
+   * @return true, with plan.parity_delta and plan.delta_shards set, if
+   *         parity deltas should be used
+   */
+  bool plan_parity_delta(
+    const ECUtil::stripe_info_t &sinfo,
+    ceph::ErasureCodeInterfaceRef &ecimpl,
+    WritePlan &plan);
+
   void generate_transactions(
     PGTransaction* _t,
     WritePlan &plan,
@@ -184,6 +237,7 @@ namespace ECTransaction {
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
     const std::map<hobject_t,extent_map> &partial_extents,
+    const std::map<hobject_t,shard_extent_map> &delta_extents,
     std::vector<pg_log_entry_t> &entries,
     std::map<hobject_t,extent_map> *written,
     std::map<shard_id_t, ObjectStore::Transaction> *transactions,
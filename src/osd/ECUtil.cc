@@ -161,6 +161,86 @@ int ECUtil::encode(
   return 0;
 }
 
+static void xor_into(char *dst, const bufferlist &src)
+{
+  for (auto &p : src.buffers()) {
+    const char *s = p.c_str();
+    for (unsigned i = 0; i < p.length(); ++i) {
+      dst[i] ^= s[i];
+    }
+    dst += p.length();
+  }
+}
+
+int ECUtil::encode_parity_delta(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const map<int, bufferlist> &old_data,
+  const map<int, bufferlist> &new_data,
+  map<int, bufferlist> *parity) {
+
+  ceph_assert(ec_impl->get_supported_optimizations() &
+	      ceph::ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION);
+  ceph_assert(parity);
+  ceph_assert(!old_data.empty());
+  ceph_assert(old_data.size() == new_data.size());
+
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t len = old_data.begin()->second.length();
+  ceph_assert(len % chunk_size == 0);
+  for (auto &&i : old_data) {
+    ceph_assert(i.second.length() == len);
+    ceph_assert(new_data.count(i.first));
+    ceph_assert(new_data.at(i.first).length() == len);
+  }
+  set<int> want;
+  for (auto &&i : *parity) {
+    ceph_assert(i.second.length() == len);
+    want.insert(i.first);
+  }
+
+  // the code is linear, so the coding chunks of a stripe holding
+  // old ^ new in the modified data chunks and zeros elsewhere are
+  // what the coding chunks change by
+  const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+  map<int, bufferlist> out;
+  for (uint64_t off = 0; off < len; off += chunk_size) {
+    ceph::bufferptr delta =
+      ceph::buffer::create_page_aligned(sinfo.get_stripe_width());
+    delta.zero();
+    for (int i = 0; i < (int)ec_impl->get_data_chunk_count(); ++i) {
+      int chunk = (int)chunk_mapping.size() > i ? chunk_mapping[i] : i;
+      auto old_iter = old_data.find(chunk);
+      if (old_iter == old_data.end()) {
+	continue;
+      }
+      bufferlist o, n;
+      o.substr_of(old_iter->second, off, chunk_size);
+      n.substr_of(new_data.at(chunk), off, chunk_size);
+      xor_into(delta.c_str() + i * chunk_size, o);
+      xor_into(delta.c_str() + i * chunk_size, n);
+    }
+    bufferlist in;
+    in.push_back(std::move(delta));
+    map<int, bufferlist> encoded;
+    int r = ec_impl->encode(want, in, &encoded);
+    if (r < 0) {
+      return r;
+    }
+    for (auto &&i : *parity) {
+      ceph_assert(encoded[i.first].length() == chunk_size);
+      ceph::bufferptr chunk = ceph::buffer::create_page_aligned(chunk_size);
+      i.second.begin(off).copy(chunk_size, chunk.c_str());
+      xor_into(chunk.c_str(), encoded[i.first]);
+      out[i.first].push_back(std::move(chunk));
+    }
+  }
+  for (auto &&i : out) {
+    (*parity)[i.first].swap(i.second);
+  }
+  return 0;
+}
+
 void ECUtil::HashInfo::append(uint64_t old_size,
 			      map<int, bufferlist> &to_append) {
   ceph_assert(old_size == total_chunk_size);
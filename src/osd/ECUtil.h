@@ -98,6 +98,23 @@ int encode(
   const std::set<int> &want,
   std::map<int, ceph::buffer::list> *out);
 
+/**
+ * Update the coding chunks of a range of stripes after some of their
+ * data chunks changed, without the data chunks that did not change.
+ * Requires FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION.
+ *
+ * @param old_data [in] old content of the modified data shards
+ * @param new_data [in] new content of the same shards and range
+ * @param parity [in,out] old content of the coding shards over the same
+ *                        range, replaced by their new content
+ */
+int encode_parity_delta(
+  const stripe_info_t &sinfo,
+  ceph::ErasureCodeInterfaceRef &ec_impl,
+  const std::map<int, ceph::buffer::list> &old_data,
+  const std::map<int, ceph::buffer::list> &new_data,
+  std::map<int, ceph::buffer::list> *parity);
+
 class HashInfo {
   uint64_t total_chunk_size = 0;
   std::vector<uint32_t> cumulative_shard_hashes;
@@ -473,6 +473,12 @@ public:
     write_pin &pin,
     const extent_map &extents);
 
+  /// true if writes in progress pin extents of oid
+  bool has_extents(const hobject_t &oid) {
+    auto eset = get_if_exists(oid);
+    return eset && !eset->extent_set.empty();
+  }
+
   /**
    * Release all buffers pinned by pin
    */
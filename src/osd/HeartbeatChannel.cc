@@ -0,0 +1,309 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "osd/HeartbeatChannel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "common/Thread.h"
+#include "common/debug.h"
+#include "common/errno.h"
+#include "include/compat.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "hb_channel "
+
+using std::vector;
+
+namespace {
+/// tells our datagrams from whatever else ends up on the port
+constexpr uint32_t HB_CHANNEL_MAGIC = 0x43484231;  // "CHB1"
+}
+
+void HeartbeatChannel::Ping::encode(ceph::buffer::list& bl) const
+{
+  using ceph::encode;
+  encode(HB_CHANNEL_MAGIC, bl);
+  ENCODE_START(1, 1, bl);
+  encode(fsid, bl);
+  encode(from, bl);
+  encode(op, bl);
+  encode(map_epoch, bl);
+  encode(up_from, bl);
+  encode(ping_stamp, bl);
+  encode(mono_ping_stamp, bl);
+  encode(mono_send_stamp, bl);
+  encode(delta_ub, bl);
+  ENCODE_FINISH(bl);
+}
+
+void HeartbeatChannel::Ping::decode(ceph::buffer::list::const_iterator& p)
+{
+  using ceph::decode;
+  uint32_t magic;
+  decode(magic, p);
+  if (magic != HB_CHANNEL_MAGIC) {
+    throw ceph::buffer::malformed_input("bad heartbeat channel magic");
+  }
+  DECODE_START(1, p);
+  decode(fsid, p);
+  decode(from, p);
+  decode(op, p);
+  decode(map_epoch, p);
+  decode(up_from, p);
+  decode(ping_stamp, p);
+  decode(mono_ping_stamp, p);
+  decode(mono_send_stamp, p);
+  decode(delta_ub, p);
+  DECODE_FINISH(p);
+}
+
+HeartbeatChannel::HeartbeatChannel(CephContext *cct, handler_t handler)
+  : cct(cct),
+    handler(std::move(handler))
+{}
+
+HeartbeatChannel::~HeartbeatChannel()
+{
+  shutdown();
+  for (auto& fd : fds) {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+}
+
+int HeartbeatChannel::bind(iface_t iface, const entity_addr_t& addr)
+{
+  int fd = ::socket(addr.get_family(), SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return -errno;
+  }
+  if (::fcntl(fd, F_SETFD, FD_CLOEXEC) < 0 ||
+      ::fcntl(fd, F_SETFL, O_NONBLOCK) < 0 ||
+      ::bind(fd, addr.get_sockaddr(), addr.get_sockaddr_len()) < 0) {
+    int r = -errno;
+    ::close(fd);
+    return r;
+  }
+  sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
+  if (::getsockname(fd, reinterpret_cast<sockaddr*>(&ss), &len) < 0) {
+    int r = -errno;
+    ::close(fd);
+    return r;
+  }
+  if (fds[iface] >= 0) {
+    ::close(fds[iface]);
+  }
+  fds[iface] = fd;
+  addrs[iface] = addr;
+  addrs[iface].set_sockaddr(reinterpret_cast<sockaddr*>(&ss));
+  ldout(cct, 10) << __func__ << " " << (iface == BACK ? "back" : "front")
+		 << " " << addrs[iface] << dendl;
+  return 0;
+}
+
+int HeartbeatChannel::start()
+{
+  if (pipe_cloexec(wakeup_fds, O_NONBLOCK) < 0) {
+    return -errno;
+  }
+  rx_buf.resize(BATCH * MAX_DATAGRAM);
+  stopping = false;
+  receiver = make_named_thread("osd_hb_channel", &HeartbeatChannel::entry,
+			       this);
+  return 0;
+}
+
+void HeartbeatChannel::shutdown()
+{
+  if (!receiver.joinable()) {
+    return;
+  }
+  stopping = true;
+  char c = 0;
+  if (::write(wakeup_fds[1], &c, 1) < 0) {
+    ldout(cct, 0) << __func__ << " failed to wake up the receiver: "
+		  << cpp_strerror(errno) << dendl;
+  }
+  receiver.join();
+  ::close(wakeup_fds[0]);
+  ::close(wakeup_fds[1]);
+  wakeup_fds[0] = wakeup_fds[1] = -1;
+}
+
+void HeartbeatChannel::queue(iface_t iface, const entity_addr_t& to,
+			     const Ping& ping, uint32_t min_size)
+{
+  Outgoing o{iface, to, {}};
+  encode(ping, o.bl);
+  min_size = std::min<uint32_t>(min_size, MAX_DATAGRAM);
+  if (o.bl.length() < min_size) {
+    o.bl.append_zero(min_size - o.bl.length());
+  }
+  o.bl.rebuild();
+  std::lock_guard l(lock);
+  outgoing.push_back(std::move(o));
+}
+
+void HeartbeatChannel::flush()
+{
+  vector<Outgoing> out;
+  {
+    std::lock_guard l(lock);
+    out.swap(outgoing);
+  }
+  auto front = std::stable_partition(
+    out.begin(), out.end(),
+    [](const Outgoing& o) { return o.iface == BACK; });
+  size_t nback = front - out.begin();
+  send(BACK, out.data(), nback);
+  send(FRONT, out.data() + nback, out.size() - nback);
+}
+
+void HeartbeatChannel::send(iface_t iface, Outgoing *out, size_t count)
+{
+  if (count == 0) {
+    return;
+  }
+  if (fds[iface] < 0) {
+    ldout(cct, 5) << __func__ << " dropping " << count << " datagrams, "
+		  << (iface == BACK ? "back" : "front") << " is not bound"
+		  << dendl;
+    return;
+  }
+  mmsghdr msgs[BATCH];
+  iovec iovs[BATCH];
+  for (size_t start = 0; start < count; start += BATCH) {
+    unsigned n = std::min<size_t>(BATCH, count - start);
+    memset(msgs, 0, sizeof(msgs[0]) * n);
+    for (unsigned i = 0; i < n; ++i) {
+      auto& o = out[start + i];
+      iovs[i].iov_base = o.bl.c_str();
+      iovs[i].iov_len = o.bl.length();
+      msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(o.to.get_sockaddr());
+      msgs[i].msg_hdr.msg_namelen = o.to.get_sockaddr_len();
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    unsigned sent = 0;
+    while (sent < n) {
+      int r = ::sendmmsg(fds[iface], msgs + sent, n - sent, MSG_DONTWAIT);
+      if (r >= 0) {
+	sent += r;
+	continue;
+      }
+      int e = errno;
+      if (e == EINTR) {
+	continue;
+      }
+      if (e == EAGAIN || e == EWOULDBLOCK) {
+	// a heartbeat we do not send is a missed ping; the grace covers it
+	ldout(cct, 5) << __func__ << " socket full, dropping " << count - sent
+		      << " datagrams" << dendl;
+	return;
+      }
+      ldout(cct, 5) << __func__ << " failed to send to "
+		    << out[start + sent].to << ": " << cpp_strerror(e)
+		    << dendl;
+      ++sent;
+    }
+  }
+}
+
+unsigned HeartbeatChannel::receive(iface_t iface, vector<Received> *batch)
+{
+  mmsghdr msgs[BATCH];
+  iovec iovs[BATCH];
+  sockaddr_storage names[BATCH];
+  memset(msgs, 0, sizeof(msgs));
+  for (unsigned i = 0; i < BATCH; ++i) {
+    iovs[i].iov_base = rx_buf.data() + i * MAX_DATAGRAM;
+    iovs[i].iov_len = MAX_DATAGRAM;
+    msgs[i].msg_hdr.msg_name = &names[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(names[i]);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  int n = ::recvmmsg(fds[iface], msgs, BATCH, MSG_DONTWAIT, nullptr);
+  if (n < 0) {
+    int e = errno;
+    if (e != EAGAIN && e != EWOULDBLOCK && e != EINTR) {
+      ldout(cct, 5) << __func__ << " " << cpp_strerror(e) << dendl;
+    }
+    return 0;
+  }
+  for (int i = 0; i < n; ++i) {
+    Received r;
+    r.iface = iface;
+    r.from_addr.set_type(entity_addr_t::TYPE_ANY);
+    r.from_addr.set_sockaddr(reinterpret_cast<sockaddr*>(&names[i]));
+    r.length = msgs[i].msg_len;
+    ceph::buffer::list bl;
+    bl.append(static_cast<const char*>(iovs[i].iov_base),
+	      std::min<uint32_t>(r.length, MAX_DATAGRAM));
+    try {
+      auto p = bl.cbegin();
+      decode(r.ping, p);
+    } catch (const ceph::buffer::error& e) {
+      ldout(cct, 10) << __func__ << " dropping malformed datagram from "
+		     << r.from_addr << ": " << e.what() << dendl;
+      continue;
+    }
+    batch->push_back(std::move(r));
+  }
+  return n;
+}
+
+void HeartbeatChannel::entry()
+{
+  vector<Received> batch;
+  while (!stopping) {
+    pollfd pfds[NUM_IFACES + 1];
+    memset(pfds, 0, sizeof(pfds));
+    for (unsigned i = 0; i < NUM_IFACES; ++i) {
+      pfds[i].fd = fds[i];  // poll(2) ignores negative fds
+      pfds[i].events = POLLIN;
+    }
+    pfds[NUM_IFACES].fd = wakeup_fds[0];
+    pfds[NUM_IFACES].events = POLLIN;
+    if (::poll(pfds, NUM_IFACES + 1, -1) < 0) {
+      int e = errno;
+      if (e == EINTR) {
+	continue;
+      }
+      lderr(cct) << __func__ << " poll failed: " << cpp_strerror(e) << dendl;
+      return;
+    }
+    if (stopping) {
+      break;
+    }
+    for (unsigned i = 0; i < NUM_IFACES; ++i) {
+      if (pfds[i].revents & POLLIN) {
+	while (receive(iface_t(i), &batch) == BATCH) ;
+      }
+    }
+    if (!batch.empty()) {
+      handler(batch);
+      batch.clear();
+    }
+  }
+}
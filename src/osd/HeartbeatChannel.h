@@ -0,0 +1,130 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_HEARTBEATCHANNEL_H
+#define CEPH_OSD_HEARTBEATCHANNEL_H
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "include/buffer.h"
+#include "include/types.h"
+#include "include/utime.h"
+#include "include/uuid.h"
+#include "msg/msg_types.h"
+
+class CephContext;
+
+/**
+ * HeartbeatChannel
+ *
+ * Carries the OSD heartbeats as UDP datagrams, one socket for the back
+ * and one for the front network, instead of a messenger connection per
+ * peer and network.  The sockets are bound to the addresses of the
+ * heartbeat messengers; UDP ports do not clash with the TCP ports those
+ * listen on, so the peers find us at the addresses the OSDMap already has.
+ *
+ * The pings are queued and sent with a single sendmmsg(2) per flush(), and
+ * a thread receives whatever arrived with recvmmsg(2) and hands it to the
+ * handler in one batch.  A datagram holds one Ping; it carries the same
+ * stamps as MOSDPing, so the latency tracking is unchanged.  The datagrams
+ * are not authenticated: the OSD only accepts those coming from the
+ * heartbeat address the OSDMap has for the sender.
+ */
+class HeartbeatChannel {
+public:
+  enum iface_t : uint8_t {
+    BACK = 0,
+    FRONT = 1,
+    NUM_IFACES = 2,
+  };
+
+  struct Ping {
+    uuid_d fsid;
+    int32_t from = -1;
+    uint8_t op = 0;        ///< MOSDPing::PING, PING_REPLY or YOU_DIED
+    epoch_t map_epoch = 0;
+    epoch_t up_from = 0;
+    utime_t ping_stamp;
+    ceph::signedspan mono_ping_stamp = ceph::signedspan::zero();
+    ceph::signedspan mono_send_stamp = ceph::signedspan::zero();
+    std::optional<ceph::signedspan> delta_ub;
+
+    void encode(ceph::buffer::list& bl) const;
+    void decode(ceph::buffer::list::const_iterator& p);
+  };
+
+  struct Received {
+    iface_t iface;
+    entity_addr_t from_addr;
+    uint32_t length = 0;   ///< of the datagram, including the padding
+    Ping ping;
+  };
+
+  using handler_t = std::function<void(std::vector<Received>&)>;
+
+  /// the most datagrams sent or received per system call
+  static constexpr unsigned BATCH = 64;
+  /// the largest datagram we pad to; longer ones are truncated on receive
+  static constexpr unsigned MAX_DATAGRAM = 9000;
+
+  HeartbeatChannel(CephContext *cct, handler_t handler);
+  ~HeartbeatChannel();
+
+  /// bind iface to addr; a zero port picks a free one, see get_addr()
+  int bind(iface_t iface, const entity_addr_t& addr);
+  entity_addr_t get_addr(iface_t iface) const {
+    return addrs[iface];
+  }
+
+  /// start the receiving thread, the handler runs in it
+  int start();
+  void shutdown();
+
+  /// queue a datagram to 'to', padded to min_size bytes
+  void queue(iface_t iface, const entity_addr_t& to, const Ping& ping,
+	     uint32_t min_size);
+  /// send what was queued
+  void flush();
+
+private:
+  struct Outgoing {
+    iface_t iface;
+    entity_addr_t to;
+    ceph::buffer::list bl;
+  };
+
+  CephContext *cct;
+  handler_t handler;
+  int fds[NUM_IFACES] = {-1, -1};
+  entity_addr_t addrs[NUM_IFACES];
+  int wakeup_fds[2] = {-1, -1};
+  std::atomic<bool> stopping = false;
+  std::thread receiver;
+  std::vector<char> rx_buf;  ///< BATCH datagrams, only used by receiver
+
+  ceph::mutex lock = ceph::make_mutex("HeartbeatChannel::lock");
+  std::vector<Outgoing> outgoing;
+
+  void entry();
+  /// receive what is pending on iface, @return the number of datagrams
+  unsigned receive(iface_t iface, std::vector<Received> *batch);
+  void send(iface_t iface, Outgoing *out, size_t count);
+};
+WRITE_CLASS_ENCODER(HeartbeatChannel::Ping)
+
+#endif
@@ -92,6 +92,7 @@
 #include "messages/MOSDPGLog.h"
 #include "messages/MOSDPGRemove.h"
 #include "messages/MOSDPGInfo.h"
+#include "messages/MOSDPGInfo2.h"
 #include "messages/MOSDPGCreate2.h"
 #include "messages/MOSDForceRecovery.h"
 #include "messages/MOSDPGCreated.h"
@@ -244,6 +245,7 @@ OSDService::OSDService(OSD *osd, ceph::async::io_context_pool& poolctx) :
   monc(osd->monc),
   osd_max_object_size(cct->_conf, "osd_max_object_size"),
   osd_skip_data_digest(cct->_conf, "osd_skip_data_digest"),
+  osd_unlocked_reads(cct->_conf, "osd_unlocked_reads"),
   publish_lock{ceph::make_mutex("OSDService::publish_lock")},
   pre_publish_lock{ceph::make_mutex("OSDService::pre_publish_lock")},
   m_osd_scrub{cct, *this, cct->_conf},
@@ -279,6 +281,10 @@ OSDService::OSDService(OSD *osd, ceph::async::io_context_pool& poolctx) :
   map_cache(cct, cct->_conf->osd_map_cache_size),
   map_bl_cache(cct->_conf->osd_map_cache_size),
   map_bl_inc_cache(cct->_conf->osd_map_cache_size),
+  obc_cache(cct->_conf.get_val<uint64_t>("osd_object_context_cache_count")),
+  read_cache(cct->_conf.get_val<Option::size_t>("osd_read_cache_size"),
+	     cct->_conf.get_val<Option::size_t>(
+	       "osd_read_cache_max_object_size")),
   cur_state(NONE),
   cur_ratio(0), physical_ratio(0),
   boot_epoch(0), up_epoch(0), bind_epoch(0)
@@ -471,6 +477,26 @@ void OSDService::queue_renew_lease(epoch_t epoch, spg_t spgid)
 	RenewLease())));
 }
 
+void OSDService::queue_flush_batched_ops(epoch_t epoch, spg_t spgid)
+{
+  osd->enqueue_peering_evt(
+    spgid,
+    PGPeeringEventRef(
+      std::make_shared<PGPeeringEvent>(
+	epoch, epoch,
+	FlushBatchedOps())));
+}
+
+void OSDService::queue_hedge_reads(epoch_t epoch, spg_t spgid)
+{
+  osd->enqueue_peering_evt(
+    spgid,
+    PGPeeringEventRef(
+      std::make_shared<PGPeeringEvent>(
+	epoch, epoch,
+	HedgeReads())));
+}
+
 void OSDService::start_shutdown()
 {
   {
@@ -1130,6 +1156,11 @@ void OSDService::send_message_osd_cluster(std::vector<std::pair<int, Message*>>&
   }
   release_map(next_map);
 }
+void OSDService::flush_peering_batch(int peer, const ConnectionRef& con)
+{
+  osd->flush_peering_batch(peer, con);
+}
+
 ConnectionRef OSDService::get_con_osd_cluster(int peer, epoch_t from_epoch)
 {
   dout(20) << __func__ << " to osd." << peer
@@ -1563,6 +1594,27 @@ OSDMapRef OSDService::_add_map(OSDMap *o)
   return l;
 }
 
+bool OSDService::same_pg_mapping_inputs(const OSDMapRef& last,
+					const OSDMapRef& next)
+{
+  auto key = std::make_pair(last->get_epoch(), next->get_epoch());
+  {
+    std::lock_guard l(mapping_inputs_lock);
+    if (auto p = mapping_inputs_cache.find(key);
+	p != mapping_inputs_cache.end()) {
+      return p->second;
+    }
+  }
+  bool same = next->same_pg_mapping_inputs(*last);
+  std::lock_guard l(mapping_inputs_lock);
+  mapping_inputs_cache[key] = same;
+  // the PGs advance over the last few epochs at about the same time
+  while (mapping_inputs_cache.size() > 64) {
+    mapping_inputs_cache.erase(mapping_inputs_cache.begin());
+  }
+  return same;
+}
+
 OSDMapRef OSDService::try_get_map(epoch_t epoch)
 {
   std::lock_guard l(map_cache_lock);
@@ -1722,11 +1774,15 @@ void OSDService::queue_recovery_context(
 void OSDService::queue_for_snap_trim(PG *pg)
 {
   dout(10) << "queueing " << *pg << " for snaptrim" << dendl;
+  // a snap trim work item trims a batch of clones per transaction, charge
+  // the scheduler's background class for all of them
+  const uint64_t batch_size = std::max<uint64_t>(
+    1, cct->_conf.get_val<uint64_t>("osd_snap_trim_batch_size"));
   enqueue_back(
     OpSchedulerItem(
       unique_ptr<OpSchedulerItem::OpQueueable>(
 	new PGSnapTrim(pg->get_pgid(), pg->get_osdmap_epoch())),
-      cct->_conf->osd_snap_trim_cost,
+      cct->_conf->osd_snap_trim_cost * batch_size,
       cct->_conf->osd_snap_trim_priority,
       ceph_clock_now(),
       0,
@@ -2383,6 +2439,7 @@ OSD::OSD(CephContext *cct_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  op_tracker.set_sample_rate(cct->_conf.get_val<double>("osd_op_tracker_sample_rate"));
   ObjectCleanRegions::set_max_num_intervals(cct->_conf->osd_object_clean_region_max_num_intervals);
 #ifdef WITH_BLKIN
   std::stringstream ss;
@@ -2399,6 +2456,8 @@ OSD::OSD(CephContext *cct_,
       this);
     shards.push_back(one_shard);
   }
+  service.obc_cache.set_num_shards(num_shards);
+  service.read_cache.set_num_shards(num_shards);
 }
 
 OSD::~OSD()
@@ -3105,6 +3164,8 @@ will start to track new ops received afterwards.";
     for (auto& pg: pgs) {
       pg->clear_cache();
     }
+    service.read_cache.clear();
+    logger->set(l_osd_read_cache_bytes, 0);
   }
 
   else if (prefix == "cache status") {
@@ -3117,6 +3178,12 @@ will start to track new ops received afterwards.";
     }
     f->open_object_section("cache_status");
     f->dump_int("object_ctx", obj_ctx_count);
+    f->open_object_section("object_ctx_cache");
+    service.obc_cache.dump(f);
+    f->close_section();
+    f->open_object_section("object_read_cache");
+    service.read_cache.dump(f);
+    f->close_section();
     store->dump_cache_stats(f);
     f->close_section();
   }
@@ -3557,6 +3624,8 @@ int OSD::get_num_op_threads()
 
 float OSD::get_osd_recovery_sleep()
 {
+  if (cct->_conf.get_val<bool>("osd_recovery_adaptive_max_active"))
+    return 0;
   if (cct->_conf->osd_recovery_sleep)
     return cct->_conf->osd_recovery_sleep;
   if (!store_is_rotational && !journal_is_rotational)
@@ -3931,6 +4000,25 @@ int OSD::init()
 
   osd_op_tp.start();
 
+  if (cct->_conf.get_val<bool>("osd_heartbeat_channel")) {
+    hb_channel = std::make_unique<HeartbeatChannel>(
+      cct, [this](auto& batch) { handle_hb_channel(batch); });
+    int r = hb_channel->bind(HeartbeatChannel::BACK,
+			     hb_back_server_messenger->get_myaddrs().front());
+    if (r == 0) {
+      r = hb_channel->bind(HeartbeatChannel::FRONT,
+			   hb_front_server_messenger->get_myaddrs().front());
+    }
+    if (r == 0) {
+      r = hb_channel->start();
+    }
+    if (r < 0) {
+      derr << "failed to set up the heartbeat channel: " << cpp_strerror(r)
+	   << ", heartbeats go over the messenger only" << dendl;
+      hb_channel.reset();
+    }
+  }
+
   // start the heartbeat
   heartbeat_thread.create("osd_srv_heartbt");
 
@@ -4563,6 +4651,9 @@ int OSD::shutdown()
     heartbeat_peers.clear();
   }
   heartbeat_thread.join();
+  if (hb_channel) {
+    hb_channel->shutdown();
+  }
 
   hb_back_server_messenger->mark_down_all();
   hb_front_server_messenger->mark_down_all();
@@ -5639,6 +5730,233 @@ void OSD::reset_heartbeat_peers(bool all)
   }
 }
 
+bool OSD::_debug_drop_ping(int from)
+{
+  if (cct->_conf->osd_debug_drop_ping_probability > 0) {
+    auto heartbeat_drop = debug_heartbeat_drops_remaining.find(from);
+    if (heartbeat_drop != debug_heartbeat_drops_remaining.end()) {
+      if (heartbeat_drop->second == 0) {
+	debug_heartbeat_drops_remaining.erase(heartbeat_drop);
+      } else {
+	--heartbeat_drop->second;
+	dout(5) << "Dropping heartbeat from " << from
+		<< ", " << heartbeat_drop->second
+		<< " remaining to drop" << dendl;
+	return true;
+      }
+    } else if (cct->_conf->osd_debug_drop_ping_probability >
+	       ((((double)(rand()%100))/100.0))) {
+      heartbeat_drop =
+	debug_heartbeat_drops_remaining.insert(std::make_pair(from,
+			 cct->_conf->osd_debug_drop_ping_duration)).first;
+      dout(5) << "Dropping heartbeat from " << from
+	      << ", " << heartbeat_drop->second
+	      << " remaining to drop" << dendl;
+      return true;
+    }
+  }
+  return false;
+}
+
+void OSD::_got_ping_reply(HeartbeatInfo& hi, utime_t ping_stamp,
+			  bool back, bool front, utime_t now,
+			  const OSDMapRef& curmap)
+{
+  auto acked = hi.ping_history.find(ping_stamp);
+  if (acked != hi.ping_history.end()) {
+    int &unacknowledged = acked->second.second;
+    if (back) {
+      dout(25) << "handle_osd_ping got reply from osd." << hi.peer
+	       << " first_tx " << hi.first_tx
+	       << " last_tx " << hi.last_tx
+	       << " last_rx_back " << hi.last_rx_back
+	       << " -> " << now
+	       << " last_rx_front " << hi.last_rx_front
+	       << dendl;
+      hi.last_rx_back = now;
+      ceph_assert(unacknowledged > 0);
+      --unacknowledged;
+      // if there is no front con, set both stamps.
+      if (hi.con_front == NULL) {
+	hi.last_rx_front = now;
+	ceph_assert(unacknowledged > 0);
+	--unacknowledged;
+      }
+    } else if (front) {
+      dout(25) << "handle_osd_ping got reply from osd." << hi.peer
+	       << " first_tx " << hi.first_tx
+	       << " last_tx " << hi.last_tx
+	       << " last_rx_back " << hi.last_rx_back
+	       << " last_rx_front " << hi.last_rx_front
+	       << " -> " << now
+	       << dendl;
+      hi.last_rx_front = now;
+      ceph_assert(unacknowledged > 0);
+      --unacknowledged;
+    }
+
+    if (unacknowledged == 0) {
+      // succeeded in getting all replies
+      dout(25) << "handle_osd_ping got all replies from osd." << hi.peer
+	       << " , erase pending ping(sent at " << ping_stamp << ")"
+	       << " and older pending ping(s)"
+	       << dendl;
+
+#define ROUND_S_TO_USEC(sec) (uint32_t)((sec) * 1000 * 1000 + 0.5)
+      ++hi.hb_average_count;
+      uint32_t back_pingtime = ROUND_S_TO_USEC(hi.last_rx_back - ping_stamp);
+      hi.hb_total_back += back_pingtime;
+      if (back_pingtime < hi.hb_min_back)
+	hi.hb_min_back = back_pingtime;
+      if (back_pingtime > hi.hb_max_back)
+	hi.hb_max_back = back_pingtime;
+      uint32_t front_pingtime = ROUND_S_TO_USEC(hi.last_rx_front - ping_stamp);
+      hi.hb_total_front += front_pingtime;
+      if (front_pingtime < hi.hb_min_front)
+	hi.hb_min_front = front_pingtime;
+      if (front_pingtime > hi.hb_max_front)
+	hi.hb_max_front = front_pingtime;
+
+      ceph_assert(hi.hb_interval_start != utime_t());
+      if (hi.hb_interval_start == utime_t())
+	hi.hb_interval_start = now;
+      int64_t hb_avg_time_period = 60;
+      if (cct->_conf.get_val<int64_t>("debug_heartbeat_testing_span")) {
+	hb_avg_time_period = cct->_conf.get_val<int64_t>("debug_heartbeat_testing_span");
+      }
+      if (now - hi.hb_interval_start >=  utime_t(hb_avg_time_period, 0)) {
+	uint32_t back_avg = hi.hb_total_back / hi.hb_average_count;
+	uint32_t back_min = hi.hb_min_back;
+	uint32_t back_max = hi.hb_max_back;
+	uint32_t front_avg = hi.hb_total_front / hi.hb_average_count;
+	uint32_t front_min = hi.hb_min_front;
+	uint32_t front_max = hi.hb_max_front;
+
+	// Reset for new interval
+	hi.hb_average_count = 0;
+	hi.hb_interval_start = now;
+	hi.hb_total_back = hi.hb_max_back = 0;
+	hi.hb_min_back =  UINT_MAX;
+	hi.hb_total_front = hi.hb_max_front = 0;
+	hi.hb_min_front = UINT_MAX;
+
+	// Record per osd interace ping times
+	// Based on osd_heartbeat_interval ignoring that it is randomly short than this interval
+	if (hi.hb_back_pingtime.size() == 0) {
+	  ceph_assert(hi.hb_front_pingtime.size() == 0);
+	  for (unsigned k = 0 ; k < hb_vector_size; ++k) {
+	    hi.hb_back_pingtime.push_back(back_avg);
+	    hi.hb_back_min.push_back(back_min);
+	    hi.hb_back_max.push_back(back_max);
+	    hi.hb_front_pingtime.push_back(front_avg);
+	    hi.hb_front_min.push_back(front_min);
+	    hi.hb_front_max.push_back(front_max);
+	    ++hi.hb_index;
+	  }
+	} else {
+	  int index = hi.hb_index & (hb_vector_size - 1);
+	  hi.hb_back_pingtime[index] = back_avg;
+	  hi.hb_back_min[index] = back_min;
+	  hi.hb_back_max[index] = back_max;
+	  hi.hb_front_pingtime[index] = front_avg;
+	  hi.hb_front_min[index] = front_min;
+	  hi.hb_front_max[index] = front_max;
+	  ++hi.hb_index;
+	}
+
+	{
+	  std::lock_guard l(service.stat_lock);
+	  service.osd_stat.hb_pingtime[hi.peer].last_update = now.sec();
+	  service.osd_stat.hb_pingtime[hi.peer].back_last =  back_pingtime;
+
+	  uint32_t total = 0;
+	  uint32_t min = UINT_MAX;
+	  uint32_t max = 0;
+	  uint32_t count = 0;
+	  uint32_t which = 0;
+	  uint32_t size = (uint32_t)hi.hb_back_pingtime.size();
+	  for (int32_t k = size - 1 ; k >= 0; --k) {
+	    ++count;
+	    int index = (hi.hb_index + k) % size;
+	    total += hi.hb_back_pingtime[index];
+	    if (hi.hb_back_min[index] < min)
+	      min = hi.hb_back_min[index];
+	    if (hi.hb_back_max[index] > max)
+	      max = hi.hb_back_max[index];
+	    if (count == 1 || count == 5 || count == 15) {
+	      service.osd_stat.hb_pingtime[hi.peer].back_pingtime[which] = total / count;
+	      service.osd_stat.hb_pingtime[hi.peer].back_min[which] = min;
+	      service.osd_stat.hb_pingtime[hi.peer].back_max[which] = max;
+	      which++;
+	      if (count == 15)
+		break;
+	    }
+	  }
+
+	  if (hi.con_front != NULL) {
+	    service.osd_stat.hb_pingtime[hi.peer].front_last = front_pingtime;
+
+	    total = 0;
+	    min = UINT_MAX;
+	    max = 0;
+	    count = 0;
+	    which = 0;
+	    for (int32_t k = size - 1 ; k >= 0; --k) {
+	      ++count;
+	      int index = (hi.hb_index + k) % size;
+	      total += hi.hb_front_pingtime[index];
+	      if (hi.hb_front_min[index] < min)
+		min = hi.hb_front_min[index];
+	      if (hi.hb_front_max[index] > max)
+		max = hi.hb_front_max[index];
+	      if (count == 1 || count == 5 || count == 15) {
+		service.osd_stat.hb_pingtime[hi.peer].front_pingtime[which] = total / count;
+		service.osd_stat.hb_pingtime[hi.peer].front_min[which] = min;
+		service.osd_stat.hb_pingtime[hi.peer].front_max[which] = max;
+		which++;
+		if (count == 15)
+		  break;
+	      }
+	    }
+	  }
+	}
+      } else {
+	  std::lock_guard l(service.stat_lock);
+	  service.osd_stat.hb_pingtime[hi.peer].back_last =  back_pingtime;
+	  if (hi.con_front != NULL)
+	    service.osd_stat.hb_pingtime[hi.peer].front_last = front_pingtime;
+      }
+      hi.ping_history.erase(hi.ping_history.begin(), ++acked);
+    }
+
+    if (hi.is_healthy(now)) {
+      // Cancel false reports
+      auto failure_queue_entry = failure_queue.find(hi.peer);
+      if (failure_queue_entry != failure_queue.end()) {
+	dout(10) << "handle_osd_ping canceling queued "
+		 << "failure report for osd." << hi.peer << dendl;
+	failure_queue.erase(failure_queue_entry);
+      }
+
+      auto failure_pending_entry = failure_pending.find(hi.peer);
+      if (failure_pending_entry != failure_pending.end()) {
+	dout(10) << "handle_osd_ping canceling in-flight "
+		 << "failure report for osd." << hi.peer << dendl;
+	send_still_alive(curmap->get_epoch(),
+			 hi.peer,
+			 failure_pending_entry->second.second);
+	failure_pending.erase(failure_pending_entry);
+      }
+    }
+  } else {
+    // old replies, deprecated by newly sent pings.
+    dout(10) << "handle_osd_ping no pending ping(sent at " << ping_stamp
+	     << ") is found, treat as covered by newly sent pings "
+	     << "and ignore"
+	     << dendl;
+  }
+}
+
 void OSD::handle_osd_ping(MOSDPing *m)
 {
   if (superblock.cluster_fsid != m->fsid) {
@@ -5684,28 +6002,8 @@ void OSD::handle_osd_ping(MOSDPing *m)
 
   case MOSDPing::PING:
     {
-      if (cct->_conf->osd_debug_drop_ping_probability > 0) {
-	auto heartbeat_drop = debug_heartbeat_drops_remaining.find(from);
-	if (heartbeat_drop != debug_heartbeat_drops_remaining.end()) {
-	  if (heartbeat_drop->second == 0) {
-	    debug_heartbeat_drops_remaining.erase(heartbeat_drop);
-	  } else {
-	    --heartbeat_drop->second;
-	    dout(5) << "Dropping heartbeat from " << from
-		    << ", " << heartbeat_drop->second
-		    << " remaining to drop" << dendl;
-	    break;
-	  }
-	} else if (cct->_conf->osd_debug_drop_ping_probability >
-	           ((((double)(rand()%100))/100.0))) {
-	  heartbeat_drop =
-	    debug_heartbeat_drops_remaining.insert(std::make_pair(from,
-	                     cct->_conf->osd_debug_drop_ping_duration)).first;
-	  dout(5) << "Dropping heartbeat from " << from
-		  << ", " << heartbeat_drop->second
-		  << " remaining to drop" << dendl;
-	  break;
-	}
+      if (_debug_drop_ping(from)) {
+	break;
       }
 
       ceph::signedspan sender_delta_ub{};
@@ -5762,199 +6060,9 @@ void OSD::handle_osd_ping(MOSDPing *m)
     {
       map<int,HeartbeatInfo>::iterator i = heartbeat_peers.find(from);
       if (i != heartbeat_peers.end()) {
-        auto acked = i->second.ping_history.find(m->ping_stamp);
-        if (acked != i->second.ping_history.end()) {
-          int &unacknowledged = acked->second.second;
-          if (con == i->second.con_back) {
-            dout(25) << "handle_osd_ping got reply from osd." << from
-                     << " first_tx " << i->second.first_tx
-                     << " last_tx " << i->second.last_tx
-                     << " last_rx_back " << i->second.last_rx_back
-		     << " -> " << now
-                     << " last_rx_front " << i->second.last_rx_front
-                     << dendl;
-            i->second.last_rx_back = now;
-            ceph_assert(unacknowledged > 0);
-            --unacknowledged;
-            // if there is no front con, set both stamps.
-            if (i->second.con_front == NULL) {
-              i->second.last_rx_front = now;
-              ceph_assert(unacknowledged > 0);
-              --unacknowledged;
-            }
-          } else if (con == i->second.con_front) {
-            dout(25) << "handle_osd_ping got reply from osd." << from
-                     << " first_tx " << i->second.first_tx
-                     << " last_tx " << i->second.last_tx
-                     << " last_rx_back " << i->second.last_rx_back
-                     << " last_rx_front " << i->second.last_rx_front
-		     << " -> " << now
-                     << dendl;
-            i->second.last_rx_front = now;
-            ceph_assert(unacknowledged > 0);
-            --unacknowledged;
-          }
-
-          if (unacknowledged == 0) {
-            // succeeded in getting all replies
-            dout(25) << "handle_osd_ping got all replies from osd." << from
-                     << " , erase pending ping(sent at " << m->ping_stamp << ")"
-                     << " and older pending ping(s)"
-                     << dendl;
-
-#define ROUND_S_TO_USEC(sec) (uint32_t)((sec) * 1000 * 1000 + 0.5)
-	    ++i->second.hb_average_count;
-	    uint32_t back_pingtime = ROUND_S_TO_USEC(i->second.last_rx_back - m->ping_stamp);
-	    i->second.hb_total_back += back_pingtime;
-	    if (back_pingtime < i->second.hb_min_back)
-	      i->second.hb_min_back = back_pingtime;
-	    if (back_pingtime > i->second.hb_max_back)
-	      i->second.hb_max_back = back_pingtime;
-	    uint32_t front_pingtime = ROUND_S_TO_USEC(i->second.last_rx_front - m->ping_stamp);
-	    i->second.hb_total_front += front_pingtime;
-	    if (front_pingtime < i->second.hb_min_front)
-	      i->second.hb_min_front = front_pingtime;
-	    if (front_pingtime > i->second.hb_max_front)
-	      i->second.hb_max_front = front_pingtime;
-
-	    ceph_assert(i->second.hb_interval_start != utime_t());
-	    if (i->second.hb_interval_start == utime_t())
-	      i->second.hb_interval_start = now;
-	    int64_t hb_avg_time_period = 60;
-	    if (cct->_conf.get_val<int64_t>("debug_heartbeat_testing_span")) {
-	      hb_avg_time_period = cct->_conf.get_val<int64_t>("debug_heartbeat_testing_span");
-	    }
-	    if (now - i->second.hb_interval_start >=  utime_t(hb_avg_time_period, 0)) {
-              uint32_t back_avg = i->second.hb_total_back / i->second.hb_average_count;
-              uint32_t back_min = i->second.hb_min_back;
-              uint32_t back_max = i->second.hb_max_back;
-              uint32_t front_avg = i->second.hb_total_front / i->second.hb_average_count;
-              uint32_t front_min = i->second.hb_min_front;
-              uint32_t front_max = i->second.hb_max_front;
-
-	      // Reset for new interval
-	      i->second.hb_average_count = 0;
-	      i->second.hb_interval_start = now;
-	      i->second.hb_total_back = i->second.hb_max_back = 0;
-	      i->second.hb_min_back =  UINT_MAX;
-	      i->second.hb_total_front = i->second.hb_max_front = 0;
-	      i->second.hb_min_front = UINT_MAX;
-
-	      // Record per osd interace ping times
-	      // Based on osd_heartbeat_interval ignoring that it is randomly short than this interval
-	      if (i->second.hb_back_pingtime.size() == 0) {
-		ceph_assert(i->second.hb_front_pingtime.size() == 0);
-		for (unsigned k = 0 ; k < hb_vector_size; ++k) {
-	          i->second.hb_back_pingtime.push_back(back_avg);
-	          i->second.hb_back_min.push_back(back_min);
-	          i->second.hb_back_max.push_back(back_max);
-	          i->second.hb_front_pingtime.push_back(front_avg);
-	          i->second.hb_front_min.push_back(front_min);
-	          i->second.hb_front_max.push_back(front_max);
-	          ++i->second.hb_index;
-		}
-	      } else {
-	        int index = i->second.hb_index & (hb_vector_size - 1);
-	        i->second.hb_back_pingtime[index] = back_avg;
-	        i->second.hb_back_min[index] = back_min;
-	        i->second.hb_back_max[index] = back_max;
-	        i->second.hb_front_pingtime[index] = front_avg;
-	        i->second.hb_front_min[index] = front_min;
-	        i->second.hb_front_max[index] = front_max;
-	        ++i->second.hb_index;
-	      }
-
-	      {
-		std::lock_guard l(service.stat_lock);
-		service.osd_stat.hb_pingtime[from].last_update = now.sec();
-		service.osd_stat.hb_pingtime[from].back_last =  back_pingtime;
-
-		uint32_t total = 0;
-		uint32_t min = UINT_MAX;
-		uint32_t max = 0;
-		uint32_t count = 0;
-		uint32_t which = 0;
-		uint32_t size = (uint32_t)i->second.hb_back_pingtime.size();
-		for (int32_t k = size - 1 ; k >= 0; --k) {
-		  ++count;
-		  int index = (i->second.hb_index + k) % size;
-		  total += i->second.hb_back_pingtime[index];
-		  if (i->second.hb_back_min[index] < min)
-		    min = i->second.hb_back_min[index];
-		  if (i->second.hb_back_max[index] > max)
-		    max = i->second.hb_back_max[index];
-		  if (count == 1 || count == 5 || count == 15) {
-		    service.osd_stat.hb_pingtime[from].back_pingtime[which] = total / count;
-		    service.osd_stat.hb_pingtime[from].back_min[which] = min;
-		    service.osd_stat.hb_pingtime[from].back_max[which] = max;
-		    which++;
-		    if (count == 15)
-		      break;
-		  }
-		}
-
-                if (i->second.con_front != NULL) {
-		  service.osd_stat.hb_pingtime[from].front_last = front_pingtime;
-
-		  total = 0;
-		  min = UINT_MAX;
-		  max = 0;
-		  count = 0;
-		  which = 0;
-		  for (int32_t k = size - 1 ; k >= 0; --k) {
-		    ++count;
-		    int index = (i->second.hb_index + k) % size;
-		    total += i->second.hb_front_pingtime[index];
-		    if (i->second.hb_front_min[index] < min)
-		      min = i->second.hb_front_min[index];
-		    if (i->second.hb_front_max[index] > max)
-		      max = i->second.hb_front_max[index];
-		    if (count == 1 || count == 5 || count == 15) {
-		      service.osd_stat.hb_pingtime[from].front_pingtime[which] = total / count;
-		      service.osd_stat.hb_pingtime[from].front_min[which] = min;
-		      service.osd_stat.hb_pingtime[from].front_max[which] = max;
-		      which++;
-		      if (count == 15)
-		        break;
-		    }
-		  }
-		}
-	      }
-	    } else {
-		std::lock_guard l(service.stat_lock);
-		service.osd_stat.hb_pingtime[from].back_last =  back_pingtime;
-                if (i->second.con_front != NULL)
-		  service.osd_stat.hb_pingtime[from].front_last = front_pingtime;
-	    }
-            i->second.ping_history.erase(i->second.ping_history.begin(), ++acked);
-          }
-
-          if (i->second.is_healthy(now)) {
-            // Cancel false reports
-            auto failure_queue_entry = failure_queue.find(from);
-            if (failure_queue_entry != failure_queue.end()) {
-              dout(10) << "handle_osd_ping canceling queued "
-                       << "failure report for osd." << from << dendl;
-              failure_queue.erase(failure_queue_entry);
-            }
-
-            auto failure_pending_entry = failure_pending.find(from);
-            if (failure_pending_entry != failure_pending.end()) {
-              dout(10) << "handle_osd_ping canceling in-flight "
-                       << "failure report for osd." << from << dendl;
-              send_still_alive(curmap->get_epoch(),
-                               from,
-                               failure_pending_entry->second.second);
-              failure_pending.erase(failure_pending_entry);
-            }
-          }
-        } else {
-          // old replies, deprecated by newly sent pings.
-          dout(10) << "handle_osd_ping no pending ping(sent at " << m->ping_stamp
-                   << ") is found, treat as covered by newly sent pings "
-                   << "and ignore"
-                   << dendl;
-        }
+        _got_ping_reply(i->second, m->ping_stamp,
+			con == i->second.con_back, con == i->second.con_front,
+			now, curmap);
       }
 
       if (m->map_epoch &&
@@ -5987,6 +6095,149 @@ void OSD::handle_osd_ping(MOSDPing *m)
   m->put();
 }
 
+bool OSD::is_hb_addr(const OSDMap& osdmap, int from,
+		     HeartbeatChannel::iface_t iface,
+		     const entity_addr_t& addr)
+{
+  if (!osdmap.exists(from)) {
+    return false;
+  }
+  const auto& addrs = iface == HeartbeatChannel::BACK ?
+    osdmap.get_hb_back_addrs(from) : osdmap.get_hb_front_addrs(from);
+  if (addrs.empty()) {
+    return false;
+  }
+  return addrs.front().is_same_host(addr) &&
+    addrs.front().get_port() == addr.get_port();
+}
+
+void OSD::handle_hb_channel(vector<HeartbeatChannel::Received>& batch)
+{
+  std::lock_guard l(heartbeat_lock);
+  if (is_stopping()) {
+    return;
+  }
+  OSDMapRef curmap = service.get_osdmap();
+  if (!curmap) {
+    return;
+  }
+  utime_t now = ceph_clock_now();
+  auto mnow = service.get_mnow();
+
+  for (auto& r : batch) {
+    auto& m = r.ping;
+    int from = m.from;
+    if (m.fsid != superblock.cluster_fsid ||
+	from == whoami ||
+	!is_hb_addr(*curmap, from, r.iface, r.from_addr)) {
+      dout(20) << __func__ << " ignoring op " << (int)m.op << " from "
+	       << r.from_addr << " claiming to be osd." << from << dendl;
+      continue;
+    }
+    auto stamps = service.get_hb_stamps(from);
+
+    switch (m.op) {
+    case MOSDPing::PING:
+      {
+	if (_debug_drop_ping(from)) {
+	  break;
+	}
+
+	ceph::signedspan sender_delta_ub{};
+	stamps->got_ping(m.up_from, mnow, m.mono_send_stamp, m.delta_ub,
+			 &sender_delta_ub);
+	dout(20) << __func__ << " new stamps " << *stamps << dendl;
+
+	if (!cct->get_heartbeat_map()->is_healthy()) {
+	  dout(10) << "internal heartbeat not healthy, dropping ping request"
+		   << dendl;
+	  break;
+	}
+
+	HeartbeatChannel::Ping reply;
+	reply.fsid = monc->get_fsid();
+	reply.from = whoami;
+	reply.op = MOSDPing::PING_REPLY;
+	reply.map_epoch = curmap->get_epoch();
+	reply.up_from = service.get_up_epoch();
+	reply.ping_stamp = m.ping_stamp;
+	reply.mono_ping_stamp = m.mono_ping_stamp;
+	reply.mono_send_stamp = mnow;
+	reply.delta_ub = sender_delta_ub;
+	// no larger than the ping, so a forged one cannot be amplified
+	hb_channel->queue(r.iface, r.from_addr, reply, r.length);
+
+	if (curmap->is_up(from)) {
+	  if (is_active()) {
+	    ConnectionRef cluster_con = service.get_con_osd_cluster(
+	      from, curmap->get_epoch());
+	    if (cluster_con) {
+	      service.maybe_share_map(cluster_con.get(), curmap, m.map_epoch);
+	    }
+	  }
+	} else if (curmap->get_down_at(from) > m.map_epoch) {
+	  // tell them they have died
+	  reply.op = MOSDPing::YOU_DIED;
+	  reply.delta_ub.reset();
+	  hb_channel->queue(r.iface, r.from_addr, reply, r.length);
+	}
+      }
+      break;
+
+    case MOSDPing::PING_REPLY:
+      {
+	auto i = heartbeat_peers.find(from);
+	if (i != heartbeat_peers.end()) {
+	  if (!i->second.udp) {
+	    if (!i->second.ping_history.count(m.ping_stamp)) {
+	      // datagrams are not authenticated, only an answer to a ping
+	      // of ours may take the peer off its connections
+	      dout(10) << __func__ << " osd." << from << " reply to unknown "
+		       << "ping " << m.ping_stamp << " from " << r.from_addr
+		       << dendl;
+	      break;
+	    }
+	    // the pings in flight went both ways; start over on the channel
+	    dout(10) << __func__ << " osd." << from << " answers on "
+		     << r.from_addr << ", closing its heartbeat connections"
+		     << dendl;
+	    i->second.udp = true;
+	    i->second.ping_history.clear();
+	    i->second.con_back->mark_down();
+	    if (i->second.con_front) {
+	      i->second.con_front->mark_down();
+	    }
+	  } else {
+	    _got_ping_reply(i->second, m.ping_stamp,
+			    r.iface == HeartbeatChannel::BACK,
+			    r.iface == HeartbeatChannel::FRONT,
+			    now, curmap);
+	  }
+	}
+
+	if (m.map_epoch && curmap->is_up(from) && is_active()) {
+	  ConnectionRef cluster_con = service.get_con_osd_cluster(
+	    from, curmap->get_epoch());
+	  if (cluster_con) {
+	    service.maybe_share_map(cluster_con.get(), curmap, m.map_epoch);
+	  }
+	}
+
+	stamps->got_ping_reply(mnow, m.mono_send_stamp, m.delta_ub);
+	dout(20) << __func__ << " new stamps " << *stamps << dendl;
+      }
+      break;
+
+    case MOSDPing::YOU_DIED:
+      dout(10) << __func__ << " osd." << from
+	       << " says i am down in " << m.map_epoch << dendl;
+      osdmap_subscribe(curmap->get_epoch()+1, false);
+      break;
+    }
+  }
+  hb_channel->flush();
+}
+
 void OSD::heartbeat_entry()
 {
   std::unique_lock l(heartbeat_lock);
@@ -6090,6 +6341,8 @@ void OSD::heartbeat()
   auto mnow = service.get_mnow();
   utime_t deadline = now;
   deadline += cct->_conf->osd_heartbeat_grace;
+  OSDMapRef curmap = service.get_osdmap();
+  unsigned udp_peers = 0;
 
   // send heartbeats
   for (map<int,HeartbeatInfo>::iterator i = heartbeat_peers.begin();
@@ -6097,7 +6350,7 @@ void OSD::heartbeat()
        ++i) {
     int peer = i->first;
     Session *s = static_cast<Session*>(i->second.con_back->get_priv().get());
-    if (!s) {
+    if (!s && !i->second.udp) {
       dout(30) << "heartbeat osd." << peer << " has no open con" << dendl;
       continue;
     }
@@ -6112,7 +6365,30 @@ void OSD::heartbeat()
       i->second.hb_interval_start = now;
 
     std::optional<ceph::signedspan> delta_ub;
-    s->stamps->sent_ping(&delta_ub);
+    service.get_hb_stamps(peer)->sent_ping(&delta_ub);
+
+    if (hb_channel && curmap->is_up(peer)) {
+      HeartbeatChannel::Ping ping;
+      ping.fsid = monc->get_fsid();
+      ping.from = whoami;
+      ping.op = MOSDPing::PING;
+      ping.map_epoch = service.get_osdmap_epoch();
+      ping.up_from = service.get_up_epoch();
+      ping.ping_stamp = now;
+      ping.mono_ping_stamp = mnow;
+      ping.mono_send_stamp = mnow;
+      ping.delta_ub = delta_ub;
+      hb_channel->queue(HeartbeatChannel::BACK,
+			curmap->get_hb_back_addrs(peer).front(),
+			ping, cct->_conf->osd_heartbeat_min_size);
+      hb_channel->queue(HeartbeatChannel::FRONT,
+			curmap->get_hb_front_addrs(peer).front(),
+			ping, cct->_conf->osd_heartbeat_min_size);
+    }
+    if (i->second.udp) {
+      ++udp_peers;
+      continue;
+    }
 
     i->second.con_back->send_message(
       new MOSDPing(monc->get_fsid(),
@@ -6138,7 +6414,12 @@ void OSD::heartbeat()
 		     delta_ub));
   }
 
+  if (hb_channel) {
+    hb_channel->flush();
+  }
+
   logger->set(l_osd_hb_to, heartbeat_peers.size());
+  logger->set(l_osd_hb_channel_peers, udp_peers);
 
   // hmm.. am i all alone?
   dout(30) << "heartbeat lonely?" << dendl;
@@ -6168,6 +6449,11 @@ bool OSD::heartbeat_reset(Connection *con)
     if (p != heartbeat_peers.end() &&
 	(p->second.con_back == con ||
 	 p->second.con_front == con)) {
+      if (p->second.udp) {
+	dout(10) << "heartbeat_reset hb con " << con << " for osd."
+		 << p->second.peer << ", pinging it on the hb channel" << dendl;
+	return true;
+      }
       dout(10) << "heartbeat_reset failed hb con " << con << " for osd." << p->second.peer
 	       << ", reopening" << dendl;
       p->second.clear_mark_down(con);
@@ -8573,14 +8859,15 @@ void OSD::check_osdmap_features()
 struct C_FinishSplits : public Context {
   OSD *osd;
   set<PGRef> pgs;
+  utime_t start = ceph_clock_now();
   C_FinishSplits(OSD *osd, const set<PGRef> &in)
     : osd(osd), pgs(in) {}
   void finish(int r) override {
-    osd->_finish_splits(pgs);
+    osd->_finish_splits(pgs, start);
   }
 };
 
-void OSD::_finish_splits(set<PGRef>& pgs)
+void OSD::_finish_splits(set<PGRef>& pgs, utime_t start)
 {
   dout(10) << __func__ << " " << pgs << dendl;
   if (is_stopping())
@@ -8602,6 +8889,7 @@ void OSD::_finish_splits(set<PGRef>& pgs)
     unsigned shard_index = pg->pg_id.hash_to_shard(num_shards);
     shards[shard_index]->register_and_wake_split_child(pg);
   }
+  logger->tinc(l_osd_pg_split_ready_lat, ceph_clock_now() - start);
 };
 
 bool OSD::add_merge_waiter(OSDMapRef nextmap, spg_t target, PGRef src,
@@ -8630,6 +8918,10 @@ bool OSD::advance_pg(
   set<PGRef> new_pgs;  // any split children
   bool ret = true;
   auto first_new_epoch = pg->get_osdmap_epoch() + 1;
+  // up and acting as of lastmap, once computed
+  vector<int> newup, newacting;
+  int up_primary = -1, acting_primary = -1;
+  bool have_mapping = false;
 
   unsigned old_pg_num = lastmap->have_pg_pool(pg->pg_id.pool()) ?
     lastmap->get_pg_num(pg->pg_id.pool()) : 0;
@@ -8761,12 +9053,21 @@ bool OSD::advance_pg(
       }
     }
 
-    vector<int> newup, newacting;
-    int up_primary, acting_primary;
-    nextmap->pg_to_up_acting_osds(
-      pg->pg_id.pgid,
-      &newup, &up_primary,
-      &newacting, &acting_primary);
+    // the mapping of the last epoch holds as long as neither the pool nor
+    // anything else it is computed from changed
+    const pg_pool_t *lastpool = lastmap->get_pg_pool(pg->pg_id.pool());
+    const pg_pool_t *nextpool = nextmap->get_pg_pool(pg->pg_id.pool());
+    if (have_mapping && lastpool && nextpool &&
+	lastpool->get_last_change() == nextpool->get_last_change() &&
+	service.same_pg_mapping_inputs(lastmap, nextmap)) {
+      logger->inc(l_osd_pg_map_reuse);
+    } else {
+      nextmap->pg_to_up_acting_osds(
+	pg->pg_id.pgid,
+	&newup, &up_primary,
+	&newacting, &acting_primary);
+      have_mapping = true;
+    }
     pg->handle_advance_map(
       nextmap, lastmap, newup, up_primary,
       newacting, acting_primary, rctx);
@@ -9000,6 +9301,7 @@ void OSD::split_pgs(
   OSDMapRef nextmap,
   PeeringCtx &rctx)
 {
+  utime_t start = ceph_clock_now();
   unsigned pg_num = nextmap->get_pg_num(parent->pg_id.pool());
   parent->update_snap_mapper_bits(parent->get_pgid().get_split_bits(pg_num));
 
@@ -9045,6 +9347,8 @@ void OSD::split_pgs(
   }
   ceph_assert(stat_iter != updated_stats.end());
   parent->finish_split_stats(*stat_iter, rctx.transaction);
+  logger->inc(l_osd_pg_split, childpgids.size());
+  logger->tinc(l_osd_pg_split_lat, ceph_clock_now() - start);
 }
 
 // ----------------------------------------
@@ -9071,8 +9375,33 @@ void OSD::dispatch_context(PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
 	continue;
       }
       service.maybe_share_map(con.get(), curmap);
-      for (auto m : ls) {
-	con->send_message2(m);
+      auto window = cct->_conf.get_val<std::chrono::milliseconds>(
+	"osd_peering_batch_window");
+      if (window == std::chrono::milliseconds::zero()) {
+	// the window may just have been turned off with a batch pending
+	flush_peering_batch(osd, con);
+	for (auto m : ls) {
+	  con->send_message2(m);
+	}
+      } else {
+	std::lock_guard l(peering_batch_lock);
+	auto& batch = peering_batches[osd];
+	batch.epoch = std::max(batch.epoch, curmap->get_epoch());
+	for (auto m : ls) {
+	  if (!batch_peering_message(m, batch)) {
+	    // whatever the pending messages are, they were sent before m
+	    send_peering_batch(con, batch);
+	    con->send_message2(m);
+	  }
+	}
+	if (!batch.empty() && !batch.flush_scheduled) {
+	  batch.flush_scheduled = true;
+	  service.mono_timer.add_event(
+	    window,
+	    [this, osd=osd] {
+	      flush_peering_batch(osd);
+	    });
+	}
       }
       ls.clear();
     }
@@ -9086,6 +9415,76 @@ void OSD::dispatch_context(PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
   }
 }
 
+bool OSD::batch_peering_message(const MessageRef& m, PeeringBatch& batch)
+{
+  switch (m->get_type()) {
+  case MSG_OSD_PG_NOTIFY2:
+    batch.notifies.push_back(static_cast<MOSDPGNotify2*>(m.get())->notify);
+    return true;
+  case MSG_OSD_PG_INFO2:
+    {
+      auto info = static_cast<MOSDPGInfo2*>(m.get());
+      if (info->lease || info->lease_ack) {
+	// MOSDPGInfo has no room for them
+	return false;
+      }
+      batch.infos.emplace_back(
+	info->spgid.shard, info->info.pgid.shard,
+	info->min_epoch, info->epoch_sent,
+	info->info, PastIntervals());
+      return true;
+    }
+  default:
+    return false;
+  }
+}
+
+void OSD::send_peering_batch(const ConnectionRef& con, PeeringBatch& batch)
+{
+  ceph_assert(ceph_mutex_is_locked(peering_batch_lock));
+  auto count = batch.notifies.size() + batch.infos.size();
+  if (!batch.notifies.empty()) {
+    con->send_message2(make_message<MOSDPGNotify>(
+      batch.epoch, std::move(batch.notifies)));
+    batch.notifies.clear();
+  }
+  if (!batch.infos.empty()) {
+    con->send_message2(make_message<MOSDPGInfo>(
+      batch.epoch, std::move(batch.infos)));
+    batch.infos.clear();
+  }
+  logger->inc(l_osd_peering_batched, count);
+}
+
+void OSD::flush_peering_batch(int osd)
+{
+  auto curmap = service.get_osdmap();
+  ConnectionRef con;
+  if (curmap->is_up(osd)) {
+    con = service.get_con_osd_cluster(osd, curmap->get_epoch());
+  }
+  std::lock_guard l(peering_batch_lock);
+  auto p = peering_batches.find(osd);
+  if (p == peering_batches.end()) {
+    return;
+  }
+  if (con && !is_stopping()) {
+    send_peering_batch(con, p->second);
+  } else {
+    dout(20) << __func__ << " dropping batch to osd." << osd << dendl;
+  }
+  peering_batches.erase(p);
+}
+
+void OSD::flush_peering_batch(int osd, const ConnectionRef& con)
+{
+  std::lock_guard l(peering_batch_lock);
+  if (auto p = peering_batches.find(osd); p != peering_batches.end()) {
+    send_peering_batch(con, p->second);
+    peering_batches.erase(p);
+  }
+}
+
 void OSD::handle_fast_pg_create(MOSDPGCreate2 *m)
 {
   dout(7) << __func__ << " " << *m << " from " << m->get_source() << dendl;
@@ -9163,9 +9562,12 @@ void OSD::handle_fast_pg_notify(MOSDPGNotify* m)
 	    p,
 	    m->get_connection()->get_features()),
 	  true,
+	  // the notifies batched from MOSDPGNotify2, see
+	  // osd_peering_batch_window, come through here, so create with
+	  // epoch_sent as MOSDPGNotify2 does
 	  new PGCreateInfo(
 	    pgid,
-	    p.query_epoch,
+	    p.epoch_sent,
 	    p.info.history,
 	    p.past_intervals,
 	    false)
@@ -9336,6 +9738,17 @@ void OSDService::_maybe_queue_recovery() {
   }
 }
 
+uint64_t OSDService::_get_recovery_max_active()
+{
+  ceph_assert(ceph_mutex_is_locked_by_me(recovery_lock));
+  uint64_t max = osd->get_recovery_max_active();
+  if (!cct->_conf.get_val<bool>("osd_recovery_adaptive_max_active")) {
+    return max;
+  }
+  recovery_limit.set_max(max);
+  return recovery_limit.get();
+}
+
 bool OSDService::_recover_now(uint64_t *available_pushes)
 {
   if (available_pushes)
@@ -9351,7 +9764,7 @@ bool OSDService::_recover_now(uint64_t *available_pushes)
     return false;
   }
 
-  uint64_t max = osd->get_recovery_max_active();
+  uint64_t max = _get_recovery_max_active();
   if (max <= recovery_ops_active + recovery_ops_reserved) {
     dout(15) << __func__ << " active " << recovery_ops_active
 	     << " + reserved " << recovery_ops_reserved
@@ -9467,9 +9880,15 @@ void OSDService::start_recovery_op(PG *pg, const hobject_t& soid)
   std::lock_guard l(recovery_lock);
   dout(10) << "start_recovery_op " << *pg << " " << soid
 	   << " (" << recovery_ops_active << "/"
-	   << osd->get_recovery_max_active() << " rops)"
+	   << _get_recovery_max_active() << " rops)"
 	   << dendl;
   recovery_ops_active++;
+  // backfill scans (soid max) wait for the peers, and may be canceled
+  // by on_backfill_canceled(): only time object recovery
+  if (cct->_conf.get_val<bool>("osd_recovery_adaptive_max_active") &&
+      !soid.is_max()) {
+    recovery_op_stamps[pg->pg_id].emplace(soid, ceph::mono_clock::now());
+  }
 
 #ifdef DEBUG_RECOVERY_OIDS
   dout(20) << "  active was " << recovery_oids[pg->pg_id] << dendl;
@@ -9484,9 +9903,26 @@ void OSDService::finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue)
   dout(10) << "finish_recovery_op " << *pg << " " << soid
 	   << " dequeue=" << dequeue
 	   << " (" << recovery_ops_active << "/"
-	   << osd->get_recovery_max_active() << " rops)"
+	   << _get_recovery_max_active() << " rops)"
 	   << dendl;
 
+  if (dequeue) {
+    // clear_recovery_state() cancels all the ops of the pg, which did
+    // not complete: no sample
+    recovery_op_stamps.erase(pg->pg_id);
+  } else if (auto stamps = recovery_op_stamps.find(pg->pg_id);
+	     stamps != recovery_op_stamps.end()) {
+    if (auto p = stamps->second.find(soid); p != stamps->second.end()) {
+      recovery_limit.add_sample(ceph::mono_clock::now() - p->second,
+				recovery_ops_active);
+      logger->set(l_osd_recovery_max_active, recovery_limit.get());
+      stamps->second.erase(p);
+      if (stamps->second.empty()) {
+	recovery_op_stamps.erase(stamps);
+      }
+    }
+  }
+
   // adjust count
   ceph_assert(recovery_ops_active > 0);
   recovery_ops_active--;
@@ -9700,7 +10136,11 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_op_history_slow_op_size",
     "osd_op_history_slow_op_threshold",
     "osd_enable_op_tracker",
+    "osd_op_tracker_sample_rate",
     "osd_map_cache_size",
+    "osd_object_context_cache_count",
+    "osd_read_cache_size",
+    "osd_read_cache_max_object_size",
     "osd_pg_epoch_max_lag_factor",
     "osd_pg_epoch_persisted_max_stale",
     "osd_recovery_sleep",
@@ -9779,6 +10219,19 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("osd_pg_delete_cost")) {
     maybe_override_cost_for_qos();
   }
+  if (changed.count("osd_object_context_cache_count")) {
+    service.obc_cache.set_target_size(
+      cct->_conf.get_val<uint64_t>("osd_object_context_cache_count"));
+  }
+  if (changed.count("osd_read_cache_size")) {
+    service.read_cache.set_max_bytes(
+      cct->_conf.get_val<Option::size_t>("osd_read_cache_size"));
+    logger->set(l_osd_read_cache_bytes, service.read_cache.get_bytes());
+  }
+  if (changed.count("osd_read_cache_max_object_size")) {
+    service.read_cache.set_max_object_size(
+      cct->_conf.get_val<Option::size_t>("osd_read_cache_max_object_size"));
+  }
   if (changed.count("osd_min_recovery_priority")) {
     service.local_reserver.set_min_priority(cct->_conf->osd_min_recovery_priority);
     service.remote_reserver.set_min_priority(cct->_conf->osd_min_recovery_priority);
@@ -9804,6 +10257,10 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
+  if (changed.count("osd_op_tracker_sample_rate")) {
+    op_tracker.set_sample_rate(
+      cct->_conf.get_val<double>("osd_op_tracker_sample_rate"));
+  }
   if (changed.count("osd_map_cache_size")) {
     service.map_cache.set_size(cct->_conf->osd_map_cache_size);
     service.map_bl_cache.set_size(cct->_conf->osd_map_cache_size);
@@ -35,6 +35,10 @@
 #include "include/CompatSet.h"
 #include "include/common_fwd.h"
 
+#include "AdaptiveRecoveryLimit.h"
+#include "HeartbeatChannel.h"
+#include "ObjectContextCache.h"
+#include "ObjectReadCache.h"
 #include "OpRequest.h"
 #include "Session.h"
 
@@ -115,6 +119,7 @@ public:
 
   md_config_cacher_t<Option::size_t> osd_max_object_size;
   md_config_cacher_t<bool> osd_skip_data_digest;
+  md_config_cacher_t<bool> osd_unlocked_reads;
 
   void enqueue_back(OpSchedulerItem&& qi);
   void enqueue_front(OpSchedulerItem&& qi);
@@ -216,6 +221,9 @@ public:
                                        OSDSuperblock& superblock);
 
   ConnectionRef get_con_osd_cluster(int peer, epoch_t from_epoch);
+  /// send the peering messages held back for peer, see
+  /// osd_peering_batch_window
+  void flush_peering_batch(int peer, const ConnectionRef& con);
   std::pair<ConnectionRef,ConnectionRef> get_con_osd_hb(int peer, epoch_t from_epoch);  // (back, front)
   void send_message_osd_cluster(int peer, Message *m, epoch_t from_epoch);
   void send_message_osd_cluster(std::vector<std::pair<int, Message*>>& messages, epoch_t from_epoch);
@@ -598,6 +606,10 @@ private:
 #ifdef DEBUG_RECOVERY_OIDS
   std::map<spg_t, std::set<hobject_t> > recovery_oids;
 #endif
+  /// start stamps of the active recovery ops, to time them
+  std::map<spg_t, std::multimap<hobject_t, ceph::mono_time>> recovery_op_stamps;
+  AdaptiveRecoveryLimit recovery_limit;
+  uint64_t _get_recovery_max_active();
   bool _recover_now(uint64_t *available_pushes);
   void _maybe_queue_recovery();
   void _queue_for_recovery(pg_awaiting_throttle_t p, uint64_t reserved_pushes);
@@ -675,6 +687,11 @@ public:
   SimpleLRU<epoch_t, ceph::buffer::list> map_bl_cache;
   SimpleLRU<epoch_t, ceph::buffer::list> map_bl_inc_cache;
 
+  // object contexts of all PGs, see osd_object_context_cache_count
+  ObjectContextCache obc_cache;
+  // content of hot small objects of all PGs, see osd_read_cache_size
+  ObjectReadCache read_cache;
+
   OSDMapRef try_get_map(epoch_t e);
   OSDMapRef get_map(epoch_t e) {
     OSDMapRef ret(try_get_map(e));
@@ -705,6 +722,13 @@ public:
     std::set<std::pair<spg_t,epoch_t>> *new_children,
     std::set<std::pair<spg_t,epoch_t>> *merge_pgs);
 
+  /// OSDMap::same_pg_mapping_inputs() of next and last, compared once for
+  /// all the PGs advancing from last to next
+  bool same_pg_mapping_inputs(const OSDMapRef& last, const OSDMapRef& next);
+  ceph::mutex mapping_inputs_lock =
+    ceph::make_mutex("OSDService::mapping_inputs_lock");
+  std::map<std::pair<epoch_t, epoch_t>, bool> mapping_inputs_cache;
+
   void need_heartbeat_peer_update();
 
   void init();
@@ -844,6 +868,8 @@ public:
   ceph::timer<ceph::mono_clock> mono_timer = ceph::timer<ceph::mono_clock>{ceph::construct_suspended};
 
   void queue_renew_lease(epoch_t epoch, spg_t spgid);
+  void queue_flush_batched_ops(epoch_t epoch, spg_t spgid);
+  void queue_hedge_reads(epoch_t epoch, spg_t spgid);
 
   // -- stopping --
   ceph::mutex is_stopping_lock = ceph::make_mutex("OSDService::is_stopping_lock");
@@ -1346,6 +1372,9 @@ private:
     utime_t last_rx_front;  ///< last time we got a ping reply on the front side
     utime_t last_rx_back;   ///< last time we got a ping reply on the back side
     epoch_t epoch;      ///< most recent epoch we wanted this peer
+    /// the peer answered on hb_channel, we no longer ping it over the
+    /// connections above, which are marked down
+    bool udp = false;
     /// number of connections we send and receive heartbeat pings/replies
     static constexpr int HEARTBEAT_MAX_CONN = 2;
     /// history of inflight pings, arranging by timestamp we sent
@@ -1423,6 +1452,7 @@ private:
   Messenger *hb_back_client_messenger;
   Messenger *hb_front_server_messenger;
   Messenger *hb_back_server_messenger;
+  std::unique_ptr<HeartbeatChannel> hb_channel;  ///< if osd_heartbeat_channel
   utime_t last_heartbeat_resample;   ///< last time we chose random peers in waiting-for-healthy state
   double daily_loadavg;
   ceph::mono_time startup_time;
@@ -1447,6 +1477,18 @@ private:
   }
   void heartbeat();
   void heartbeat_check();
+  /// @return true if the ping from osd.from is to be dropped, for testing
+  bool _debug_drop_ping(int from);
+  /// account the reply of hi.peer to the ping sent at ping_stamp, received
+  /// on the back and/or front interface
+  void _got_ping_reply(HeartbeatInfo& hi, utime_t ping_stamp,
+		       bool back, bool front, utime_t now,
+		       const OSDMapRef& curmap);
+  void handle_hb_channel(std::vector<HeartbeatChannel::Received>& batch);
+  /// whether 'addr' is the heartbeat address osdmap has for osd.from
+  static bool is_hb_addr(const OSDMap& osdmap, int from,
+			 HeartbeatChannel::iface_t iface,
+			 const entity_addr_t& addr);
   void heartbeat_entry();
   void need_heartbeat_peer_update();
 
@@ -1760,7 +1802,7 @@ protected:
     OSDMapRef curmap,
     OSDMapRef nextmap,
     PeeringCtx &rctx);
-  void _finish_splits(std::set<PGRef>& pgs);
+  void _finish_splits(std::set<PGRef>& pgs, utime_t start);
 
   // == monitor interaction ==
   ceph::mutex mon_report_lock = ceph::make_mutex("OSD::mon_report_lock");
@@ -1826,6 +1868,25 @@ protected:
   void dispatch_context(PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
                         ThreadPool::TPHandle *handle = NULL);
 
+  // -- batched peering messages, see osd_peering_batch_window --
+  struct PeeringBatch {
+    epoch_t epoch = 0;
+    std::vector<pg_notify_t> notifies;
+    std::vector<pg_notify_t> infos;
+    bool flush_scheduled = false;
+    bool empty() const {
+      return notifies.empty() && infos.empty();
+    }
+  };
+  ceph::mutex peering_batch_lock = ceph::make_mutex("OSD::peering_batch_lock");
+  std::map<int, PeeringBatch> peering_batches;  ///< peer osd -> pending
+
+  /// add m to batch if it can go in a MOSDPGNotify or MOSDPGInfo
+  bool batch_peering_message(const MessageRef& m, PeeringBatch& batch);
+  void send_peering_batch(const ConnectionRef& con, PeeringBatch& batch);
+  void flush_peering_batch(int osd);
+  void flush_peering_batch(int osd, const ConnectionRef& con);
+
   bool require_mon_peer(const Message *m);
   bool require_mon_or_mgr_peer(const Message *m);
   bool require_osd_peer(const Message *m);
@@ -1886,6 +1947,7 @@ private:
     case MSG_OSD_RECOVERY_RESERVE:
     case MSG_OSD_REPOP:
     case MSG_OSD_REPOPREPLY:
+    case MSG_OSD_REPOP_BATCH:
     case MSG_OSD_PG_PUSH:
     case MSG_OSD_PG_PULL:
     case MSG_OSD_PG_PUSH_REPLY:
@@ -1545,13 +1545,14 @@ void OSDMap::set_max_osd(int m)
   osd_weight.resize(max_osd, CEPH_OSD_OUT);
   osd_info.resize(max_osd);
   osd_xinfo.resize(max_osd);
-  osd_addrs->client_addrs.resize(max_osd);
-  osd_addrs->cluster_addrs.resize(max_osd);
-  osd_addrs->hb_back_addrs.resize(max_osd);
-  osd_addrs->hb_front_addrs.resize(max_osd);
-  osd_uuid->resize(max_osd);
+  auto& addrs = cow(osd_addrs);
+  addrs.client_addrs.resize(max_osd);
+  addrs.cluster_addrs.resize(max_osd);
+  addrs.hb_back_addrs.resize(max_osd);
+  addrs.hb_front_addrs.resize(max_osd);
+  cow(osd_uuid).resize(max_osd);
   if (osd_primary_affinity)
-    osd_primary_affinity->resize(max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
+    cow(osd_primary_affinity).resize(max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
 
   calc_num_osds();
 }
@@ -1765,7 +1766,7 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
   }
   mask |= CEPH_FEATURES_CRUSH;
 
-  if (!pg_upmap.empty() || !pg_upmap_items.empty() || !pg_upmap_primaries.empty())
+  if (!pg_upmap->empty() || !pg_upmap_items->empty() || !pg_upmap_primaries->empty())
     features |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
   mask |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
 
@@ -1911,62 +1912,109 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   if (o->epoch == n->epoch)
     return;
 
-  int diff = 0;
+  // members n still shares with the epoch it was built from are already
+  // deduped; only compare what n owns alone, i.e. what was decoded or
+  // changed by the last incremental.
+  auto private_to_n = [o](const auto& optr, const auto& nptr) {
+    return optr != nptr && nptr.use_count() == 1;
+  };
 
   // do addrs match?
-  if (o->max_osd != n->max_osd)
-    diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
-    if ( n->osd_addrs->client_addrs[i] &&  o->osd_addrs->client_addrs[i] &&
-	*n->osd_addrs->client_addrs[i] == *o->osd_addrs->client_addrs[i])
-      n->osd_addrs->client_addrs[i] = o->osd_addrs->client_addrs[i];
-    else
-      diff++;
-    if ( n->osd_addrs->cluster_addrs[i] &&  o->osd_addrs->cluster_addrs[i] &&
-	*n->osd_addrs->cluster_addrs[i] == *o->osd_addrs->cluster_addrs[i])
-      n->osd_addrs->cluster_addrs[i] = o->osd_addrs->cluster_addrs[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_back_addrs[i] &&  o->osd_addrs->hb_back_addrs[i] &&
-	*n->osd_addrs->hb_back_addrs[i] == *o->osd_addrs->hb_back_addrs[i])
-      n->osd_addrs->hb_back_addrs[i] = o->osd_addrs->hb_back_addrs[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_front_addrs[i] &&  o->osd_addrs->hb_front_addrs[i] &&
-	*n->osd_addrs->hb_front_addrs[i] == *o->osd_addrs->hb_front_addrs[i])
-      n->osd_addrs->hb_front_addrs[i] = o->osd_addrs->hb_front_addrs[i];
-    else
+  if (private_to_n(o->osd_addrs, n->osd_addrs)) {
+    int diff = 0;
+    if (o->max_osd != n->max_osd)
       diff++;
-  }
-  if (diff == 0) {
-    // zoinks, no differences at all!
-    n->osd_addrs = o->osd_addrs;
+    for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+      if ( n->osd_addrs->client_addrs[i] &&  o->osd_addrs->client_addrs[i] &&
+	  *n->osd_addrs->client_addrs[i] == *o->osd_addrs->client_addrs[i])
+	n->osd_addrs->client_addrs[i] = o->osd_addrs->client_addrs[i];
+      else
+	diff++;
+      if ( n->osd_addrs->cluster_addrs[i] &&  o->osd_addrs->cluster_addrs[i] &&
+	  *n->osd_addrs->cluster_addrs[i] == *o->osd_addrs->cluster_addrs[i])
+	n->osd_addrs->cluster_addrs[i] = o->osd_addrs->cluster_addrs[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_back_addrs[i] &&  o->osd_addrs->hb_back_addrs[i] &&
+	  *n->osd_addrs->hb_back_addrs[i] == *o->osd_addrs->hb_back_addrs[i])
+	n->osd_addrs->hb_back_addrs[i] = o->osd_addrs->hb_back_addrs[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_front_addrs[i] &&  o->osd_addrs->hb_front_addrs[i] &&
+	  *n->osd_addrs->hb_front_addrs[i] == *o->osd_addrs->hb_front_addrs[i])
+	n->osd_addrs->hb_front_addrs[i] = o->osd_addrs->hb_front_addrs[i];
+      else
+	diff++;
+    }
+    if (diff == 0) {
+      // zoinks, no differences at all!
+      n->osd_addrs = o->osd_addrs;
+    }
   }
 
   // does crush match?
-  ceph::buffer::list oc, nc;
-  encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  if (private_to_n(o->crush, n->crush)) {
+    ceph::buffer::list oc, nc;
+    encode(*o->crush, oc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    encode(*n->crush, nc, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    if (oc.contents_equal(nc)) {
+      n->crush = o->crush;
+    }
   }
 
   // does pg_temp match?
-  if (*o->pg_temp == *n->pg_temp)
+  if (private_to_n(o->pg_temp, n->pg_temp) &&
+      *o->pg_temp == *n->pg_temp)
     n->pg_temp = o->pg_temp;
 
   // does primary_temp match?
-  if (o->primary_temp->size() == n->primary_temp->size()) {
-    if (*o->primary_temp == *n->primary_temp)
-      n->primary_temp = o->primary_temp;
-  }
+  if (private_to_n(o->primary_temp, n->primary_temp) &&
+      o->primary_temp->size() == n->primary_temp->size() &&
+      *o->primary_temp == *n->primary_temp)
+    n->primary_temp = o->primary_temp;
+
+  // do upmaps match?
+  if (private_to_n(o->pg_upmap, n->pg_upmap) &&
+      *o->pg_upmap == *n->pg_upmap)
+    n->pg_upmap = o->pg_upmap;
+  if (private_to_n(o->pg_upmap_items, n->pg_upmap_items) &&
+      *o->pg_upmap_items == *n->pg_upmap_items)
+    n->pg_upmap_items = o->pg_upmap_items;
+  if (private_to_n(o->pg_upmap_primaries, n->pg_upmap_primaries) &&
+      *o->pg_upmap_primaries == *n->pg_upmap_primaries)
+    n->pg_upmap_primaries = o->pg_upmap_primaries;
 
   // do uuids match?
-  if (o->osd_uuid->size() == n->osd_uuid->size() &&
+  if (private_to_n(o->osd_uuid, n->osd_uuid) &&
+      o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
 }
 
+bool OSDMap::same_pg_mapping_inputs(const OSDMap& o) const
+{
+  auto same = [](const auto& a, const auto& b) {
+    return a == b || (a && b && *a == *b);
+  };
+  if (max_osd != o.max_osd ||
+      crush != o.crush ||
+      !same(pg_temp, o.pg_temp) ||
+      !same(primary_temp, o.primary_temp) ||
+      !same(osd_primary_affinity, o.osd_primary_affinity) ||
+      !same(pg_upmap, o.pg_upmap) ||
+      !same(pg_upmap_items, o.pg_upmap_items) ||
+      !same(pg_upmap_primaries, o.pg_upmap_primaries) ||
+      osd_weight != o.osd_weight) {
+    return false;
+  }
+  for (int i = 0; i < max_osd; ++i) {
+    if ((osd_state[i] ^ o.osd_state[i]) & (CEPH_OSD_EXISTS | CEPH_OSD_UP)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void OSDMap::clean_temps(CephContext *cct,
 			 const OSDMap& oldmap,
 			 const OSDMap& nextmap,
@@ -2056,10 +2104,10 @@ void OSDMap::clean_temps(CephContext *cct,
 
 void OSDMap::get_upmap_pgs(vector<pg_t> *upmap_pgs) const
 {
-  upmap_pgs->reserve(pg_upmap.size() + pg_upmap_items.size());
-  for (auto& p : pg_upmap)
+  upmap_pgs->reserve(pg_upmap->size() + pg_upmap_items->size());
+  for (auto& p : *pg_upmap)
     upmap_pgs->push_back(p.first);
-  for (auto& p : pg_upmap_items)
+  for (auto& p : *pg_upmap_items)
     upmap_pgs->push_back(p.first);
 }
 
@@ -2139,8 +2187,8 @@ bool OSDMap::check_pg_upmaps(
       continue;
     // okay, upmap is valid
     // continue to check if it is still necessary
-    auto i = pg_upmap.find(pg);
-    if (i != pg_upmap.end()) {
+    auto i = pg_upmap->find(pg);
+    if (i != pg_upmap->end()) {
       if (i->second == raw) {
         ldout(cct, 10) << __func__ << "removing redundant pg_upmap " << i->first << " "
                        << i->second << dendl;
@@ -2155,21 +2203,21 @@ bool OSDMap::check_pg_upmaps(
         continue;
       }
     }
-    auto j = pg_upmap_items.find(pg);
-    if (j != pg_upmap_items.end()) {
+    auto j = pg_upmap_items->find(pg);
+    if (j != pg_upmap_items->end()) {
       mempool::osdmap::vector<pair<int,int>> newmap;
       for (auto& p : j->second) {
 	auto osd_from = p.first;
 	auto osd_to = p.second;
         if (std::find(raw.begin(), raw.end(), osd_from) == raw.end()) {
           // cancel mapping if source osd does not exist anymore
-          ldout(cct, 20) << __func__ << " pg_upmap_items (source osd does not exist) " << pg_upmap_items << dendl;
+          ldout(cct, 20) << __func__ << " pg_upmap_items (source osd does not exist) " << *pg_upmap_items << dendl;
           continue;
         }
         if (osd_to != CRUSH_ITEM_NONE && osd_to < max_osd &&
             osd_to >= 0 && osd_weight[osd_to] == 0) {
           // cancel mapping if target osd is out
-          ldout(cct, 20) << __func__ << " pg_upmap_items (target osd is out) " << pg_upmap_items << dendl;
+          ldout(cct, 20) << __func__ << " pg_upmap_items (target osd is out) " << *pg_upmap_items << dendl;
           continue;
         }
         newmap.push_back(p);
@@ -2209,8 +2257,8 @@ void OSDMap::clean_pg_upmaps(
                      << dendl;
       pending_inc->new_pg_upmap.erase(i);
     }
-    auto j = pg_upmap.find(pg);
-    if (j != pg_upmap.end()) {
+    auto j = pg_upmap->find(pg);
+    if (j != pg_upmap->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid pg_upmap entry "
                      << j->first << "->" << j->second
                      << dendl;
@@ -2224,8 +2272,8 @@ void OSDMap::clean_pg_upmaps(
                      << dendl;
       pending_inc->new_pg_upmap_items.erase(p);
     }
-    auto q = pg_upmap_items.find(pg);
-    if (q != pg_upmap_items.end()) {
+    auto q = pg_upmap_items->find(pg);
+    if (q != pg_upmap_items->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid "
                      << "pg_upmap_items entry "
                      << q->first << "->" << q->second
@@ -2381,14 +2429,15 @@ int OSDMap::apply_incremental(const Incremental &inc)
     if ((osd_state[osd] & CEPH_OSD_EXISTS) &&
 	(s & CEPH_OSD_EXISTS)) {
       // osd is destroyed; clear out anything interesting.
-      (*osd_uuid)[osd] = uuid_d();
+      cow(osd_uuid)[osd] = uuid_d();
       osd_info[osd] = osd_info_t();
       osd_xinfo[osd] = osd_xinfo_t();
       set_primary_affinity(osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
-      osd_addrs->client_addrs[osd].reset(new entity_addrvec_t());
-      osd_addrs->cluster_addrs[osd].reset(new entity_addrvec_t());
-      osd_addrs->hb_front_addrs[osd].reset(new entity_addrvec_t());
-      osd_addrs->hb_back_addrs[osd].reset(new entity_addrvec_t());
+      auto& addrs = cow(osd_addrs);
+      addrs.client_addrs[osd].reset(new entity_addrvec_t());
+      addrs.cluster_addrs[osd].reset(new entity_addrvec_t());
+      addrs.hb_front_addrs[osd].reset(new entity_addrvec_t());
+      addrs.hb_back_addrs[osd].reset(new entity_addrvec_t());
       osd_state[osd] = 0;
     } else {
       osd_state[osd] ^= s;
@@ -2398,18 +2447,19 @@ int OSDMap::apply_incremental(const Incremental &inc)
   for (const auto &client : inc.new_up_client) {
     osd_state[client.first] |= CEPH_OSD_EXISTS | CEPH_OSD_UP;
     osd_state[client.first] &= ~CEPH_OSD_STOP; // if any
-    osd_addrs->client_addrs[client.first].reset(
+    auto& addrs = cow(osd_addrs);
+    addrs.client_addrs[client.first].reset(
       new entity_addrvec_t(client.second));
-    osd_addrs->hb_back_addrs[client.first].reset(
+    addrs.hb_back_addrs[client.first].reset(
       new entity_addrvec_t(inc.new_hb_back_up.find(client.first)->second));
-    osd_addrs->hb_front_addrs[client.first].reset(
+    addrs.hb_front_addrs[client.first].reset(
       new entity_addrvec_t(inc.new_hb_front_up.find(client.first)->second));
 
     osd_info[client.first].up_from = epoch;
   }
 
   for (const auto &cluster : inc.new_up_cluster)
-    osd_addrs->cluster_addrs[cluster.first].reset(
+    cow(osd_addrs).cluster_addrs[cluster.first].reset(
       new entity_addrvec_t(cluster.second));
 
   // info
@@ -2430,45 +2480,46 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   // uuid
   for (const auto &uuid : inc.new_uuid)
-    (*osd_uuid)[uuid.first] = uuid.second;
+    cow(osd_uuid)[uuid.first] = uuid.second;
 
   // pg rebuild
-  for (const auto &pg : inc.new_pg_temp) {
-    if (pg.second.empty())
-      pg_temp->erase(pg.first);
-    else
-      pg_temp->set(pg.first, pg.second);
-  }
   if (!inc.new_pg_temp.empty()) {
+    auto& temp = cow(pg_temp);
+    for (const auto &pg : inc.new_pg_temp) {
+      if (pg.second.empty())
+	temp.erase(pg.first);
+      else
+	temp.set(pg.first, pg.second);
+    }
     // make sure pg_temp is efficiently stored
-    pg_temp->rebuild();
+    temp.rebuild();
   }
 
   for (const auto &pg : inc.new_primary_temp) {
     if (pg.second == -1)
-      primary_temp->erase(pg.first);
+      cow(primary_temp).erase(pg.first);
     else
-      (*primary_temp)[pg.first] = pg.second;
+      cow(primary_temp)[pg.first] = pg.second;
   }
 
   for (auto& p : inc.new_pg_upmap) {
-    pg_upmap[p.first] = p.second;
+    cow(pg_upmap)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap) {
-    pg_upmap.erase(pg);
+    cow(pg_upmap).erase(pg);
   }
   for (auto& p : inc.new_pg_upmap_items) {
-    pg_upmap_items[p.first] = p.second;
+    cow(pg_upmap_items)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap_items) {
-    pg_upmap_items.erase(pg);
+    cow(pg_upmap_items).erase(pg);
   }
 
   for (auto& [pg, prim] : inc.new_pg_upmap_primary) {
-    pg_upmap_primaries[pg] = prim;
+    cow(pg_upmap_primaries)[pg] = prim;
   }
   for (auto& pg : inc.old_pg_upmap_primary) {
-    pg_upmap_primaries.erase(pg);
+    cow(pg_upmap_primaries).erase(pg);
   }
 
   // blocklist
@@ -2690,8 +2741,8 @@ int OSDMap::_pick_primary(const vector<int>& osds) const
 void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) const
 {
   pg_t pg = pi.raw_pg_to_pg(raw_pg);
-  auto p = pg_upmap.find(pg);
-  if (p != pg_upmap.end()) {
+  auto p = pg_upmap->find(pg);
+  if (p != pg_upmap->end()) {
     // make sure targets aren't marked out
     for (auto osd : p->second) {
       if (osd != CRUSH_ITEM_NONE && osd < max_osd && osd >= 0 &&
@@ -2704,8 +2755,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
     // continue to check and apply pg_upmap_items if any
   }
 
-  auto q = pg_upmap_items.find(pg);
-  if (q != pg_upmap_items.end()) {
+  auto q = pg_upmap_items->find(pg);
+  if (q != pg_upmap_items->end()) {
     // NOTE: this approach does not allow a bidirectional swap,
     // e.g., [[1,2],[2,1]] applied to [0,1,2] -> [0,2,1].
     for (auto& [osd_from, osd_to] : q->second) {
@@ -2732,8 +2783,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
       }
     }
   }
-  auto r = pg_upmap_primaries.find(pg);
-  if (r != pg_upmap_primaries.end()) {
+  auto r = pg_upmap_primaries->find(pg);
+  if (r != pg_upmap_primaries->end()) {
     auto new_prim = r->second;	
     // Apply mapping only if new primary is not marked out and valid osd id
     if (new_prim != CRUSH_ITEM_NONE && new_prim < max_osd && new_prim >= 0 &&
@@ -2937,17 +2988,9 @@ void OSDMap::_pg_to_up_acting_osds(
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
   if (_acting.empty() || up || up_primary) {
     _pg_to_raw_osds(*pool, pg, &raw, &pps);
-    _apply_upmap(*pool, pg, &raw);
-    _raw_to_up_osds(*pool, raw, &_up);
-    _up_primary = _pick_primary(_up);
-    _apply_primary_affinity(pps, *pool, &_up, &_up_primary);
-    if (_acting.empty()) {
-      _acting = _up;
-      if (_acting_primary == -1) {
-        _acting_primary = _up_primary;
-      }
-    }
-  
+    _raw_to_up_acting_osds(*pool, pg, pps, &raw, &_up, &_up_primary,
+			   &_acting, &_acting_primary);
+
     if (up)
       up->swap(_up);
     if (up_primary)
@@ -2960,6 +3003,58 @@ void OSDMap::_pg_to_up_acting_osds(
     *acting_primary = _acting_primary;
 }
 
+void OSDMap::_raw_to_up_acting_osds(
+  const pg_pool_t& pool, pg_t pg, ps_t pps, vector<int> *raw,
+  vector<int> *up, int *up_primary,
+  vector<int> *acting, int *acting_primary) const
+{
+  _apply_upmap(pool, pg, raw);
+  _raw_to_up_osds(pool, *raw, up);
+  *up_primary = _pick_primary(*up);
+  _apply_primary_affinity(pps, pool, up, up_primary);
+  if (acting->empty()) {
+    *acting = *up;
+    if (*acting_primary == -1) {
+      *acting_primary = *up_primary;
+    }
+  }
+}
+
+void OSDMap::pgs_to_up_acting_osds(
+  int64_t poolid, unsigned ps_begin, unsigned ps_end,
+  const std::function<void(unsigned ps,
+			   vector<int>&& up, int up_primary,
+			   vector<int>&& acting, int acting_primary)>& f) const
+{
+  const pg_pool_t *pool = get_pg_pool(poolid);
+  ceph_assert(pool);
+  ceph_assert(ps_begin <= ps_end);
+  vector<int> pps;
+  pps.reserve(ps_end - ps_begin);
+  for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+    pps.push_back(pool->raw_pg_to_pps(pg_t(ps, poolid)));
+  }
+  vector<vector<int>> raws;
+  int ruleno = pool->get_crush_rule();
+  if (ruleno >= 0) {
+    crush->do_rule_batch(ruleno, pps, raws, pool->get_size(), osd_weight,
+			 poolid);
+  } else {
+    raws.resize(pps.size());
+  }
+  for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+    pg_t pg(ps, poolid);
+    auto& raw = raws[ps - ps_begin];
+    vector<int> up, acting;
+    int up_primary, acting_primary;
+    _remove_nonexistent_osds(*pool, raw);
+    _get_temp_osds(*pool, pg, &acting, &acting_primary);
+    _raw_to_up_acting_osds(*pool, pg, pps[ps - ps_begin], &raw,
+			   &up, &up_primary, &acting, &acting_primary);
+    f(ps, std::move(up), up_primary, std::move(acting), acting_primary);
+  }
+}
+
 int OSDMap::calc_pg_role_broken(int osd, const vector<int>& acting, int nrep)
 {
   // This implementation is broken for EC PGs since the osd may appear
@@ -3250,11 +3345,11 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
     encode(erasure_code_profiles, bl);
 
     if (v >= 4) {
-      encode(pg_upmap, bl);
-      encode(pg_upmap_items, bl);
+      encode(*pg_upmap, bl);
+      encode(*pg_upmap_items, bl);
     } else {
-      ceph_assert(pg_upmap.empty());
-      ceph_assert(pg_upmap_items.empty());
+      ceph_assert(pg_upmap->empty());
+      ceph_assert(pg_upmap_items->empty());
     }
     if (v >= 6) {
       encode(crush_version, bl);
@@ -3268,9 +3363,9 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
       encode(last_in_change, bl);
     }
     if (v >= 10) {
-      encode(pg_upmap_primaries, bl);
+      encode(*pg_upmap_primaries, bl);
     } else {
-      ceph_assert(pg_upmap_primaries.empty());
+      ceph_assert(pg_upmap_primaries->empty());
     }
     ENCODE_FINISH(bl); // client-usable data
   }
@@ -3380,6 +3475,20 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
   crc_defined = true;
 }
 
+void OSDMap::reset_shared()
+{
+  osd_addrs = std::make_shared<addrs_s>();
+  pg_temp = std::make_shared<PGTempMap>();
+  primary_temp = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
+  osd_primary_affinity.reset();
+  pg_upmap = std::make_shared<
+    mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>>();
+  pg_upmap_items = std::make_shared<
+    mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>>>();
+  pg_upmap_primaries = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
+  osd_uuid = std::make_shared<mempool::osdmap::vector<uuid_d>>();
+}
+
 /* for a description of osdmap versions, and when they were introduced, please
  * refer to
  *    doc/dev/osd_internals/osdmap_versions.txt
@@ -3514,6 +3623,8 @@ void OSDMap::decode_classic(ceph::buffer::list::const_iterator& p)
 void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
 {
   using ceph::decode;
+  // this map may share its sub-maps with another epoch; decode into new ones
+  reset_shared();
   /**
    * Older encodings of the OSDMap had a single struct_v which
    * covered the whole encoding, and was prior to our modern
@@ -3591,11 +3702,11 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
     // version increased from 3 to 4 still in luminous, so same as above
     // applies.
     if (struct_v >= 4) {
-      decode(pg_upmap, bl);
-      decode(pg_upmap_items, bl);
+      decode(*pg_upmap, bl);
+      decode(*pg_upmap_items, bl);
     } else {
-      pg_upmap.clear();
-      pg_upmap_items.clear();
+      pg_upmap->clear();
+      pg_upmap_items->clear();
     }
     // again, version increased from 5 to 6 still in luminous, so above
     // applies.
@@ -3613,9 +3724,9 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
       decode(last_in_change, bl);
     }
     if (struct_v >= 10) {
-      decode(pg_upmap_primaries, bl);
+      decode(*pg_upmap_primaries, bl);
     } else {
-      pg_upmap_primaries.clear();
+      pg_upmap_primaries->clear();
     }
     DECODE_FINISH(bl); // client-usable data
   }
@@ -3925,7 +4036,7 @@ void OSDMap::dump(Formatter *f, CephContext *cct) const
   f->close_section();
 
   f->open_array_section("pg_upmap");
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("osds");
@@ -3938,7 +4049,7 @@ void OSDMap::dump(Formatter *f, CephContext *cct) const
   f->close_section();
 
   f->open_array_section("pg_upmap_items");
-  for (auto& [pgid, mappings] : pg_upmap_items) {
+  for (auto& [pgid, mappings] : *pg_upmap_items) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << pgid;
     f->open_array_section("mappings");
@@ -3954,7 +4065,7 @@ void OSDMap::dump(Formatter *f, CephContext *cct) const
   f->close_section();
 
   f->open_array_section("pg_upmap_primaries");
-  for (const auto& [pg, osd] : pg_upmap_primaries) {
+  for (const auto& [pg, osd] : *pg_upmap_primaries) {
     f->open_object_section("primary_mapping");
     f->dump_stream("pgid") << pg;
     f->dump_int("primary_osd", osd);
@@ -4257,14 +4368,14 @@ void OSDMap::print(CephContext *cct, ostream& out) const
   print_osds(out);
   out << std::endl;
 
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     out << "pg_upmap " << p.first << " " << p.second << "\n";
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     out << "pg_upmap_items " << p.first << " " << p.second << "\n";
   }
 
-  for (auto& [pg, osd] : pg_upmap_primaries) {
+  for (auto& [pg, osd] : *pg_upmap_primaries) {
     out << "pg_upmap_primary " << pg << " " << osd << "\n";
   }
 
@@ -5100,7 +5211,7 @@ int OSDMap::balance_primaries(
 	prim_dist_scores[up_primary] -= 1;
 
 	// Update the mappings
-	tmp_osd_map.pg_upmap_primaries[pg] = curr_best_osd;
+	cow(tmp_osd_map.pg_upmap_primaries)[pg] = curr_best_osd;
 	if (curr_best_osd == orig_prims[pg]) {
           pending_inc->new_pg_upmap_primary.erase(pg);
           prim_pgs_to_check[pg] = false;
@@ -5344,8 +5455,8 @@ int OSDMap::calc_pg_upmaps(
 
       // try upmap
       for (auto pg : pgs) {
-        auto temp_it = tmp_osd_map.pg_upmap.find(pg);
-        if (temp_it != tmp_osd_map.pg_upmap.end()) {
+        auto temp_it = tmp_osd_map.pg_upmap->find(pg);
+        if (temp_it != tmp_osd_map.pg_upmap->end()) {
           // leave pg_upmap alone
           // it must be specified by admin since balancer does not
           // support pg_upmap yet
@@ -5357,8 +5468,8 @@ int OSDMap::calc_pg_upmaps(
         auto pg_pool_size = tmp_osd_map.get_pg_pool_size(pg);
         mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
         set<int> existing;
-        auto it = tmp_osd_map.pg_upmap_items.find(pg);
-        if (it != tmp_osd_map.pg_upmap_items.end()) {
+        auto it = tmp_osd_map.pg_upmap_items->find(pg);
+        if (it != tmp_osd_map.pg_upmap_items->end()) {
 	  auto& um_items = it->second;
           if (um_items.size() >= (size_t)pg_pool_size) {
             ldout(cct, 10) << " " << pg << " already has full-size pg_upmap_items "
@@ -5733,8 +5844,8 @@ int OSDMap::pack_upmap_results(
   int num_changed = 0;
   for (auto& i : to_unmap) {
     ldout(cct, 10) << " unmap pg " << i << dendl;
-    ceph_assert(tmp_osd_map.pg_upmap_items.count(i));
-    tmp_osd_map.pg_upmap_items.erase(i);
+    ceph_assert(tmp_osd_map.pg_upmap_items->count(i));
+    cow(tmp_osd_map.pg_upmap_items).erase(i);
     pending_inc->old_pg_upmap_items.insert(i);
     ++num_changed;
   }
@@ -5742,7 +5853,7 @@ int OSDMap::pack_upmap_results(
     ldout(cct, 10) << " upmap pg " << pg
                    << " new pg_upmap_items " << um_items
                    << dendl;
-    tmp_osd_map.pg_upmap_items[pg] = um_items;
+    cow(tmp_osd_map.pg_upmap_items)[pg] = um_items;
     pending_inc->new_pg_upmap_items[pg] = um_items;
     ++num_changed;
   }
@@ -5791,8 +5902,8 @@ bool OSDMap::try_drop_remap_overfull(
   // if it found an item that can be dropped, false if not. 
   //
   for (auto pg : pgs) {
-    auto p = tmp_osd_map.pg_upmap_items.find(pg);
-    if (p == tmp_osd_map.pg_upmap_items.end())
+    auto p = tmp_osd_map.pg_upmap_items->find(pg);
+    if (p == tmp_osd_map.pg_upmap_items->end())
       continue;
     mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
     auto& pg_upmap_items = p->second;
@@ -5963,8 +6074,8 @@ OSDMap::candidates_t OSDMap::build_candidates(
   // build the candidates data structure
   //
   candidates_t candidates;
-  candidates.reserve(tmp_osd_map.pg_upmap_items.size());
-  for (auto& [pg, um_pair] : tmp_osd_map.pg_upmap_items) {
+  candidates.reserve(tmp_osd_map.pg_upmap_items->size());
+  for (auto& [pg, um_pair] : *tmp_osd_map.pg_upmap_items) {
     if (to_skip.count(pg))
       continue;
     if (!only_pools.empty() && !only_pools.count(pg.pool()))
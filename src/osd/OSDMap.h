@@ -28,6 +28,7 @@
 #include <list>
 #include <set>
 #include <map>
+#include <functional>
 #include <memory>
 
 #include <boost/smart_ptr/local_shared_ptr.hpp>
@@ -583,9 +584,9 @@ private:
   std::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
   // remap (post-CRUSH, pre-up)
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
-  mempool::osdmap::map<pg_t, int32_t> pg_upmap_primaries; ///< remap primary of a pg
+  std::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>> pg_upmap; ///< remap pg
+  std::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>> pg_upmap_items; ///< remap osds in up set
+  std::shared_ptr<mempool::osdmap::map<pg_t, int32_t>> pg_upmap_primaries; ///< remap primary of a pg
 
   mempool::osdmap::map<int64_t,pg_pool_t> pools;
   mempool::osdmap::map<int64_t,std::string> pool_name;
@@ -677,6 +678,9 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>>()),
+	     pg_upmap_items(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>>()),
+	     pg_upmap_primaries(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blocklist_entries(false),
@@ -690,6 +694,17 @@ private:
 private:
   OSDMap(const OSDMap& other) = default;
   OSDMap& operator=(const OSDMap& other) = default;
+
+  /// the shared member p points to, copied first if another map uses it
+  template <typename T>
+  static T& cow(std::shared_ptr<T>& p) {
+    if (p.use_count() > 1) {
+      p = std::make_shared<T>(*p);
+    }
+    return *p;
+  }
+  /// fresh, unshared instances of the shared members, before a decode
+  void reset_shared();
 public:
 
   /// return feature mask subset that is relevant to OSDMap encoding
@@ -700,19 +715,11 @@ public:
   uint64_t get_encoding_features() const;
 
   void deepish_copy_from(const OSDMap& o) {
+    // NOTE: the members held by shared_ptr (osd_addrs, pg_temp,
+    // primary_temp, osd_primary_affinity, pg_upmap*, osd_uuid and crush)
+    // stay shared with o.  whatever modifies one of them makes a private
+    // copy first (see cow()), so an epoch only pays for what it changes.
     *this = o;
-    primary_temp.reset(new mempool::osdmap::map<pg_t,int32_t>(*o.primary_temp));
-    pg_temp.reset(new PGTempMap(*o.pg_temp));
-    osd_uuid.reset(new mempool::osdmap::vector<uuid_d>(*o.osd_uuid));
-
-    if (o.osd_primary_affinity)
-      osd_primary_affinity.reset(new mempool::osdmap::vector<__u32>(*o.osd_primary_affinity));
-
-    // NOTE: this still references shared entity_addrvec_t's.
-    osd_addrs.reset(new addrs_s(*o.osd_addrs));
-
-    // NOTE: we do not copy crush.  note that apply_incremental will
-    // allocate a new CrushWrapper, though.
   }
 
   // map info
@@ -833,7 +840,7 @@ public:
       osd_primary_affinity.reset(
 	new mempool::osdmap::vector<__u32>(
 	  max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
-    (*osd_primary_affinity)[o] = w;
+    cow(osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
     ceph_assert(o < max_osd);
@@ -1133,6 +1140,14 @@ public:
   /// try to re-use/reference addrs in oldmap from newmap
   static void dedup(const OSDMap *oldmap, OSDMap *newmap);
 
+  /**
+   * true if everything but the pools that pg_to_up_acting_osds() looks at
+   * is the same in o, i.e. the pgs of a pool that did not change either
+   * map to the same up and acting sets and primaries in both maps. The
+   * members dedup() shares between epochs are compared by pointer first.
+   */
+  bool same_pg_mapping_inputs(const OSDMap& o) const;
+
   static void clean_temps(CephContext *cct,
 			  const OSDMap& oldmap,
 			  const OSDMap& nextmap,
@@ -1254,6 +1269,13 @@ private:
   void _pg_to_up_acting_osds(const pg_t& pg, std::vector<int> *up, int *up_primary,
                              std::vector<int> *acting, int *acting_primary,
 			     bool raw_pg_to_pg = true) const;
+  /// the rest of _pg_to_up_acting_osds() once raw is known, acting
+  /// and acting_primary being what _get_temp_osds() gave
+  void _raw_to_up_acting_osds(const pg_pool_t& pool, pg_t pg, ps_t pps,
+			      std::vector<int> *raw,
+			      std::vector<int> *up, int *up_primary,
+			      std::vector<int> *acting,
+			      int *acting_primary) const;
 
 public:
   /***
@@ -1289,6 +1311,18 @@ public:
                             std::vector<int> *acting, int *acting_primary) const {
     _pg_to_up_acting_osds(pg, up, up_primary, acting, acting_primary);
   }
+  /**
+   * pg_to_up_acting_osds() of each of the pgs [ps_begin, ps_end) of a
+   * pool, calling f with the result of each of them in order. The CRUSH
+   * rule of the pool is evaluated for the whole range at once, which is
+   * cheaper than one pg at a time when mapping a pool.
+   */
+  void pgs_to_up_acting_osds(
+    int64_t pool, unsigned ps_begin, unsigned ps_end,
+    const std::function<void(unsigned ps,
+			     std::vector<int>&& up, int up_primary,
+			     std::vector<int>&& acting,
+			     int acting_primary)>& f) const;
   void pg_to_up_acting_osds(pg_t pg, std::vector<int>& up, std::vector<int>& acting) const {
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
@@ -1661,8 +1695,8 @@ public:
   int get_osds_by_bucket_name(const std::string &name, std::set<int> *osds) const;
 
   bool have_pg_upmaps(pg_t pg) const {
-    return pg_upmap.count(pg) ||
-      pg_upmap_items.count(pg);
+    return pg_upmap->count(pg) ||
+      pg_upmap_items->count(pg);
   }
 
   bool check_full(const std::set<pg_shard_t> &missing_on) const {
@@ -1718,8 +1752,8 @@ public:
   int validate_crush_rules(CrushWrapper *crush, std::ostream *ss) const;
 
   void clear_temp() {
-    pg_temp->clear();
-    primary_temp->clear();
+    pg_temp = std::make_shared<PGTempMap>();
+    primary_temp = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
   }
 
 private:
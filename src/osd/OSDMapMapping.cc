@@ -114,15 +114,13 @@ void OSDMapMapping::_update_range(
   ceph_assert(i != pools.end());
   ceph_assert(pg_begin <= pg_end);
   ceph_assert(pg_end <= i->second.pg_num);
-  for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    std::vector<int> up, acting;
-    int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
-      pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
-  }
+  osdmap.pgs_to_up_acting_osds(
+    pool, pg_begin, pg_end,
+    [&](unsigned ps, std::vector<int>&& up, int up_primary,
+	std::vector<int>&& acting, int acting_primary) {
+      i->second.set(ps, std::move(up), up_primary,
+		    std::move(acting), acting_primary);
+    });
 }
 
 // ---------------------------
@@ -0,0 +1,215 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "osd/ObjectContextCache.h"
+
+ObjectContextCache::ObjectContextCache(size_t target_size)
+  : shards(1), target_size(target_size)
+{
+  shards[0].target_size = target_size;
+}
+
+ObjectContextCache::~ObjectContextCache()
+{
+  std::vector<ObjectContext*> victims;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard.lock};
+    ceph_assert(shard.obcs.size() == shard.lru.size());
+    shard.lru.clear();
+    shard.obcs.clear_and_dispose([&victims](ObjectContext *obc) {
+      victims.push_back(obc);
+    });
+  }
+  for (auto obc : victims) {
+    delete obc;
+  }
+}
+
+void ObjectContextCache::set_num_shards(unsigned num_shards)
+{
+  ceph_assert(num_shards > 0);
+  ceph_assert(get_count() == 0);
+  std::vector<Shard>(num_shards).swap(shards);
+  set_target_size(target_size);
+}
+
+void ObjectContextCache::set_target_size(size_t size)
+{
+  target_size = size;
+  std::vector<ObjectContext*> victims;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard.lock};
+    shard.target_size = size / shards.size();
+    evict(shard, &victims);
+  }
+  for (auto obc : victims) {
+    delete obc;
+  }
+}
+
+// called with the shard lock held
+ObjectContextRef ObjectContextCache::get_ref(ObjectContext& obc)
+{
+  if (auto ref = obc.cache_ref.lock(); ref) {
+    return ref;
+  }
+  // either unreferenced, or the last reference is being released right
+  // now and its deleter is waiting for the shard lock
+  if (obc.cache_lru_hook.is_linked()) {
+    ceph_assert(obc.cache_refs == 0);
+    auto& shard = get_shard(obc.cache_key.first);
+    shard.lru.erase(shard.lru.iterator_to(obc));
+  }
+  ObjectContextRef ref(&obc, Release{this});
+  obc.cache_ref = ref;
+  ++obc.cache_refs;
+  return ref;
+}
+
+// called with the shard lock held; the victims are freed by the caller
+// after dropping it, as freeing an obc may drop the last PG reference
+void ObjectContextCache::evict(Shard& shard,
+			       std::vector<ObjectContext*> *victims)
+{
+  while (!shard.lru.empty() && shard.obcs.size() > shard.target_size) {
+    auto& obc = shard.lru.front();
+    shard.lru.pop_front();
+    shard.obcs.erase(shard.obcs.iterator_to(obc));
+    victims->push_back(&obc);
+    ++evictions;
+  }
+}
+
+void ObjectContextCache::release(ObjectContext *obc)
+{
+  std::vector<ObjectContext*> victims;
+  {
+    auto& shard = get_shard(obc->cache_key.first);
+    std::lock_guard l{shard.lock};
+    ceph_assert(obc->cache_refs > 0);
+    if (--obc->cache_refs > 0) {
+      // it was handed out again while this reference was on its way out
+      return;
+    }
+    if (obc->cache_keep) {
+      shard.lru.push_back(*obc);
+      evict(shard, &victims);
+    } else {
+      shard.obcs.erase(shard.obcs.iterator_to(*obc));
+      victims.push_back(obc);
+    }
+  }
+  for (auto victim : victims) {
+    delete victim;
+  }
+}
+
+ObjectContextRef ObjectContextCache::lookup(const spg_t& pgid,
+					    const hobject_t& oid,
+					    bool create)
+{
+  ObjectContextRef ref;
+  std::vector<ObjectContext*> victims;
+  {
+    auto& shard = get_shard(pgid);
+    std::lock_guard l{shard.lock};
+    key_t key{pgid, oid};
+    if (auto p = shard.obcs.find(key); p != shard.obcs.end()) {
+      ref = get_ref(*p);
+      p->cache_keep = true;
+    } else if (create) {
+      auto obc = new ObjectContext;
+      obc->cache_key = std::move(key);
+      obc->cache_keep = true;
+      shard.obcs.insert(*obc);
+      ref = get_ref(*obc);
+      evict(shard, &victims);
+    }
+  }
+  for (auto victim : victims) {
+    delete victim;
+  }
+  return ref;
+}
+
+bool ObjectContextCache::get_next(const spg_t& pgid, const hobject_t& oid,
+				  std::pair<hobject_t, ObjectContextRef> *next)
+{
+  std::pair<hobject_t, ObjectContextRef> r;
+  {
+    auto& shard = get_shard(pgid);
+    std::lock_guard l{shard.lock};
+    auto p = shard.obcs.upper_bound(key_t{pgid, oid});
+    if (p == shard.obcs.end() || p->cache_key.first != pgid) {
+      return false;
+    }
+    if (next) {
+      r = std::make_pair(p->cache_key.second, get_ref(*p));
+    }
+  }
+  // overwriting *next may release the last reference to the previous obc,
+  // which takes the shard lock
+  if (next) {
+    *next = std::move(r);
+  }
+  return true;
+}
+
+void ObjectContextCache::clear_range(const spg_t& pgid,
+				     const hobject_t& from,
+				     const hobject_t& to)
+{
+  std::vector<ObjectContext*> victims;
+  {
+    auto& shard = get_shard(pgid);
+    std::lock_guard l{shard.lock};
+    auto p = shard.obcs.lower_bound(key_t{pgid, from});
+    auto end = shard.obcs.upper_bound(key_t{pgid, to});
+    while (p != end) {
+      auto& obc = *p++;
+      obc.cache_keep = false;
+      if (obc.cache_lru_hook.is_linked()) {
+	shard.lru.erase(shard.lru.iterator_to(obc));
+	shard.obcs.erase(shard.obcs.iterator_to(obc));
+	victims.push_back(&obc);
+      }
+    }
+  }
+  for (auto victim : victims) {
+    delete victim;
+  }
+}
+
+size_t ObjectContextCache::get_count(const spg_t& pgid)
+{
+  auto& shard = get_shard(pgid);
+  std::lock_guard l{shard.lock};
+  auto p = shard.obcs.lower_bound(key_t{pgid, hobject_t()});
+  auto end = shard.obcs.upper_bound(key_t{pgid, hobject_t::get_max()});
+  return std::distance(p, end);
+}
+
+size_t ObjectContextCache::get_count()
+{
+  size_t count = 0;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard.lock};
+    count += shard.obcs.size();
+  }
+  return count;
+}
+
+void ObjectContextCache::dump(ceph::Formatter *f)
+{
+  size_t count = 0, unreferenced = 0;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard.lock};
+    count += shard.obcs.size();
+    unreferenced += shard.lru.size();
+  }
+  f->dump_unsigned("target_size", target_size);
+  f->dump_unsigned("num_shards", shards.size());
+  f->dump_unsigned("count", count);
+  f->dump_unsigned("unreferenced", unreferenced);
+  f->dump_unsigned("evictions", evictions);
+}
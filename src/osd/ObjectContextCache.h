@@ -0,0 +1,158 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_OBJECTCONTEXTCACHE_H
+#define CEPH_OSD_OBJECTCONTEXTCACHE_H
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/set.hpp>
+
+#include "common/ceph_mutex.h"
+#include "common/Formatter.h"
+#include "osd/osd_internal_types.h"
+
+/**
+ * ObjectContextCache
+ *
+ * One cache of ObjectContexts for all the PGs of an OSD, modeled on
+ * ceph::common::intrusive_lru.  Contexts live in an intrusive set keyed by
+ * (pgid, oid) for as long as they are referenced; once the last reference
+ * goes away they move to an lru list with their decoded object_info and
+ * snapset still attached, and are only freed when the cache is over its
+ * target size.  The budget is per OSD, so a PG with a hot working set may
+ * keep many more contexts than the old fixed per-PG limit allowed.
+ *
+ * The cache is split into shards the same way PGs are spread over the OSD
+ * op shards, so lookups from different op shards do not share a lock.
+ *
+ * ObjectContextRef remains a std::shared_ptr.  Whenever an unreferenced
+ * context is handed out again it gets a fresh shared_ptr whose deleter
+ * returns the context to the cache instead of freeing it.
+ */
+class ObjectContextCache {
+  using key_t = std::pair<spg_t, hobject_t>;
+
+  struct key_of_obc {
+    using type = key_t;
+    const type& operator()(const ObjectContext& obc) const {
+      return obc.cache_key;
+    }
+  };
+
+  using obc_set_t = boost::intrusive::set<
+    ObjectContext,
+    boost::intrusive::member_hook<
+      ObjectContext,
+      boost::intrusive::set_member_hook<>,
+      &ObjectContext::cache_set_hook>,
+    boost::intrusive::key_of_value<key_of_obc>>;
+
+  using obc_lru_t = boost::intrusive::list<
+    ObjectContext,
+    boost::intrusive::member_hook<
+      ObjectContext,
+      boost::intrusive::list_member_hook<>,
+      &ObjectContext::cache_lru_hook>>;
+
+  struct Shard {
+    ceph::mutex lock = ceph::make_mutex("ObjectContextCache::Shard::lock");
+    obc_set_t obcs;
+    obc_lru_t lru;        ///< unreferenced obcs, least recently used first
+    size_t target_size = 0;
+  };
+
+  /// returns an obc to the cache when a reference handed out is dropped
+  struct Release {
+    ObjectContextCache *cache;
+    void operator()(ObjectContext *obc) const {
+      cache->release(obc);
+    }
+  };
+
+  std::vector<Shard> shards;
+  size_t target_size;
+  std::atomic<uint64_t> evictions = 0;
+
+  Shard& get_shard(const spg_t& pgid) {
+    return shards[pgid.hash_to_shard(shards.size())];
+  }
+
+  ObjectContextRef get_ref(ObjectContext& obc);
+  void evict(Shard& shard, std::vector<ObjectContext*> *victims);
+  void release(ObjectContext *obc);
+
+public:
+  explicit ObjectContextCache(size_t target_size = 0);
+  ~ObjectContextCache();
+
+  ObjectContextCache(const ObjectContextCache&) = delete;
+  ObjectContextCache& operator=(const ObjectContextCache&) = delete;
+
+  /// must be called before the first PG is created
+  void set_num_shards(unsigned num_shards);
+  /// total number of obcs to keep, referenced or not
+  void set_target_size(size_t size);
+
+  ObjectContextRef lookup(const spg_t& pgid, const hobject_t& oid,
+			  bool create);
+  /// find the first live obc of the PG that sorts after oid
+  bool get_next(const spg_t& pgid, const hobject_t& oid,
+		std::pair<hobject_t, ObjectContextRef> *next);
+  /**
+   * Drop the unreferenced obcs of the PG in [from, to] -- note that to is
+   * inclusive.  Referenced obcs stay visible to lookups but are freed
+   * rather than cached once they are released.
+   */
+  void clear_range(const spg_t& pgid, const hobject_t& from,
+		   const hobject_t& to);
+  size_t get_count(const spg_t& pgid);
+  size_t get_count();
+  void dump(ceph::Formatter *f);
+
+  /// the per-PG view PrimaryLogPG works with
+  class PGCache {
+    ObjectContextCache& cache;
+    const spg_t pgid;
+  public:
+    PGCache(ObjectContextCache& cache, spg_t pgid)
+      : cache(cache), pgid(pgid) {}
+
+    ObjectContextRef lookup(const hobject_t& oid) {
+      return cache.lookup(pgid, oid, false);
+    }
+    ObjectContextRef lookup_or_create(const hobject_t& oid) {
+      return cache.lookup(pgid, oid, true);
+    }
+    bool get_next(const hobject_t& oid,
+		  std::pair<hobject_t, ObjectContextRef> *next) {
+      return cache.get_next(pgid, oid, next);
+    }
+    void clear_range(const hobject_t& from, const hobject_t& to) {
+      cache.clear_range(pgid, from, to);
+    }
+    void clear() {
+      cache.clear_range(pgid, hobject_t(), hobject_t::get_max());
+    }
+    bool empty() {
+      return cache.get_count(pgid) == 0;
+    }
+    int get_count() {
+      return cache.get_count(pgid);
+    }
+  };
+};
+
+#endif
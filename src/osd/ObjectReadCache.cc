@@ -0,0 +1,144 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "osd/ObjectReadCache.h"
+
+ObjectReadCache::ObjectReadCache(uint64_t max_bytes,
+				 uint64_t max_object_size)
+  : shards(1), max_bytes(max_bytes), max_object_size(max_object_size)
+{
+  shards[0].max_bytes = max_bytes;
+}
+
+void ObjectReadCache::set_num_shards(unsigned num_shards)
+{
+  ceph_assert(num_shards > 0);
+  ceph_assert(bytes == 0);
+  std::vector<Shard>(num_shards).swap(shards);
+  set_max_bytes(max_bytes);
+}
+
+void ObjectReadCache::set_max_bytes(uint64_t max)
+{
+  max_bytes = max;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard.lock};
+    shard.max_bytes = max / shards.size();
+    evict(shard);
+  }
+}
+
+void ObjectReadCache::erase(Shard& shard, lru_t::iterator p)
+{
+  shard.bytes -= p->data.length();
+  bytes -= p->data.length();
+  shard.entries.erase(p->key);
+  shard.lru.erase(p);
+}
+
+void ObjectReadCache::evict(Shard& shard)
+{
+  while (!shard.lru.empty() && shard.bytes > shard.max_bytes) {
+    erase(shard, shard.lru.begin());
+    ++evictions;
+  }
+}
+
+bool ObjectReadCache::lookup(const spg_t& pgid, const hobject_t& oid,
+			     eversion_t version, ceph::buffer::list *out)
+{
+  auto& shard = get_shard(pgid);
+  std::lock_guard l{shard.lock};
+  auto p = shard.entries.find(key_t{pgid, oid});
+  if (p == shard.entries.end()) {
+    return false;
+  }
+  auto entry = p->second;
+  if (entry->version != version) {
+    erase(shard, entry);
+    return false;
+  }
+  shard.lru.splice(shard.lru.end(), shard.lru, entry);
+  // shares the buffer; nobody modifies it once it is cached
+  out->append(entry->data);
+  return true;
+}
+
+void ObjectReadCache::insert(const spg_t& pgid, const hobject_t& oid,
+			     eversion_t version,
+			     const ceph::buffer::list& data)
+{
+  if (!may_cache(data.length())) {
+    return;
+  }
+  auto& shard = get_shard(pgid);
+  if (data.length() > shard.max_bytes) {
+    return;
+  }
+  // a private copy, so we do not pin a larger buffer of the ObjectStore
+  ceph::buffer::list copy;
+  copy.append(data);
+  copy.rebuild();
+
+  std::lock_guard l{shard.lock};
+  key_t key{pgid, oid};
+  if (auto p = shard.entries.find(key); p != shard.entries.end()) {
+    erase(shard, p->second);
+  }
+  shard.lru.push_back(Entry{key, version, std::move(copy)});
+  auto entry = std::prev(shard.lru.end());
+  shard.entries.emplace(key, entry);
+  shard.bytes += entry->data.length();
+  bytes += entry->data.length();
+  evict(shard);
+}
+
+bool ObjectReadCache::admit(const spg_t& pgid, const hobject_t& oid,
+			    const object_info_t& oi, bool hot,
+			    const ceph::buffer::list& data)
+{
+  if (!hot || !may_cache(data.length()) || !oi.is_data_digest() ||
+      data.length() != oi.size || data.crc32c(-1) != oi.data_digest) {
+    return false;
+  }
+  insert(pgid, oid, oi.version, data);
+  return true;
+}
+
+void ObjectReadCache::invalidate(const spg_t& pgid, const hobject_t& oid)
+{
+  if (bytes == 0) {
+    return;
+  }
+  auto& shard = get_shard(pgid);
+  std::lock_guard l{shard.lock};
+  if (auto p = shard.entries.find(key_t{pgid, oid});
+      p != shard.entries.end()) {
+    erase(shard, p->second);
+  }
+}
+
+void ObjectReadCache::clear()
+{
+  for (auto& shard : shards) {
+    std::lock_guard l{shard.lock};
+    while (!shard.lru.empty()) {
+      erase(shard, shard.lru.begin());
+    }
+  }
+}
+
+void ObjectReadCache::dump(ceph::Formatter *f)
+{
+  size_t count = 0;
+  for (auto& shard : shards) {
+    std::lock_guard l{shard.lock};
+    count += shard.entries.size();
+  }
+  f->dump_unsigned("max_bytes", max_bytes);
+  f->dump_unsigned("max_object_size", max_object_size);
+  f->dump_unsigned("num_shards", shards.size());
+  f->dump_unsigned("count", count);
+  f->dump_unsigned("bytes", bytes);
+  f->dump_unsigned("evictions", evictions);
+}
@@ -0,0 +1,136 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_OBJECTREADCACHE_H
+#define CEPH_OSD_OBJECTREADCACHE_H
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/Formatter.h"
+#include "include/buffer.h"
+#include "osd/osd_types.h"
+
+/**
+ * ObjectReadCache
+ *
+ * The content of small objects that are read often, for all the PGs of an
+ * OSD, so that a read of a whole object can be answered without going to
+ * the ObjectStore.  What goes in is up to admit(): objects the PG's HitSet
+ * had already seen when they were read again, checked against their data
+ * digest.
+ *
+ * Every entry remembers the version of the object it was read at, and a
+ * lookup only hits if the object is still at that version; a write always
+ * bumps the version, so an entry can never serve stale data even if it
+ * missed an invalidate().  Writes still invalidate() so the memory is
+ * freed early.
+ *
+ * The budget is in bytes of cached data, split evenly between shards that
+ * are picked the same way as the OSD op shards, like ObjectContextCache.
+ */
+class ObjectReadCache {
+  using key_t = std::pair<spg_t, hobject_t>;
+
+  struct Entry {
+    key_t key;
+    eversion_t version;
+    ceph::buffer::list data;
+  };
+  using lru_t = std::list<Entry>;
+
+  struct Shard {
+    ceph::mutex lock = ceph::make_mutex("ObjectReadCache::Shard::lock");
+    lru_t lru;  ///< least recently used first
+    std::map<key_t, lru_t::iterator> entries;
+    uint64_t bytes = 0;
+    uint64_t max_bytes = 0;
+  };
+
+  std::vector<Shard> shards;
+  std::atomic<uint64_t> max_bytes;
+  std::atomic<uint64_t> max_object_size;
+  std::atomic<uint64_t> bytes = 0;
+  std::atomic<uint64_t> evictions = 0;
+
+  Shard& get_shard(const spg_t& pgid) {
+    return shards[pgid.hash_to_shard(shards.size())];
+  }
+  /// called with the shard lock held
+  void erase(Shard& shard, lru_t::iterator p);
+  void evict(Shard& shard);
+
+public:
+  explicit ObjectReadCache(uint64_t max_bytes = 0,
+			   uint64_t max_object_size = 0);
+
+  ObjectReadCache(const ObjectReadCache&) = delete;
+  ObjectReadCache& operator=(const ObjectReadCache&) = delete;
+
+  void set_num_shards(unsigned num_shards);
+  void set_max_bytes(uint64_t max);
+  void set_max_object_size(uint64_t max) {
+    max_object_size = max;
+  }
+
+  bool enabled() const {
+    return max_bytes > 0;
+  }
+  /// whether an object of this size may be cached at all
+  bool may_cache(uint64_t size) const {
+    return enabled() && size <= max_object_size;
+  }
+  /**
+   * whether a read of off~len of the object may be served by the cache:
+   * only reads of a whole small object with a data digest, by an op that
+   * does not write
+   */
+  bool may_cache_read(const object_info_t& oi, uint64_t off, uint64_t len,
+		      bool may_write) const {
+    return may_cache(oi.size) && oi.is_data_digest() &&
+      off == 0 && len == oi.size && !may_write;
+  }
+
+  /**
+   * append the cached content of oid to out if it was cached at version
+   *
+   * @return true on a hit; an entry of another version is dropped
+   */
+  bool lookup(const spg_t& pgid, const hobject_t& oid, eversion_t version,
+	      ceph::buffer::list *out);
+  /// cache the whole content of oid, as of version
+  void insert(const spg_t& pgid, const hobject_t& oid, eversion_t version,
+	      const ceph::buffer::list& data);
+  /**
+   * insert data read from oid if the PG's HitSet had seen the object
+   * before this read (hot), and data is the whole object and matches its
+   * data digest, so that a hit needs no check
+   *
+   * @return true if data was cached
+   */
+  bool admit(const spg_t& pgid, const hobject_t& oid,
+	     const object_info_t& oi, bool hot,
+	     const ceph::buffer::list& data);
+  void invalidate(const spg_t& pgid, const hobject_t& oid);
+  void clear();
+
+  uint64_t get_bytes() const {
+    return bytes;
+  }
+  void dump(ceph::Formatter *f);
+};
+
+#endif
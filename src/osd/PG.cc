@@ -47,6 +47,7 @@
 #include "messages/MOSDScrubReserve.h"
 #include "messages/MOSDRepOp.h"
 #include "messages/MOSDRepOpReply.h"
+#include "messages/MOSDRepOpBatch.h"
 #include "messages/MOSDRepScrubMap.h"
 #include "messages/MOSDPGRecoveryDelete.h"
 #include "messages/MOSDPGRecoveryDeleteReply.h"
@@ -745,6 +746,7 @@ void PG::clear_recovery_state()
 
   backfill_info.clear();
   peer_backfill_info.clear();
+  peer_backfill_digest_scans.clear();
   waiting_on_backfill.clear();
   _clear_recovery_state();  // pg impl specific hook
 }
@@ -779,6 +781,8 @@ void PG::send_cluster_message(
   if (share_map_update) {
     osd->maybe_share_map(con.get(), get_osdmap());
   }
+  // the notifies and infos of this PG held back for target go first
+  osd->flush_peering_batch(target, con);
   osd->send_message_osd_cluster(m, con.get());
 }
 
@@ -1170,17 +1174,43 @@ void PG::update_snap_map(
   const vector<pg_log_entry_t> &log_entries,
   ObjectStore::Transaction &t)
 {
+  OSDriver::OSTransaction _t(osdriver.get_transaction(&t));
+  // consecutive removals and updates of distinct clones, e.g. the clones
+  // trimmed in one transaction, go to the SnapMapper together so that it
+  // can remove their keys as ranges
+  vector<pair<hobject_t, set<snapid_t>>> batch;
+  set<hobject_t> batched;
+  auto flush_batch = [&] {
+    if (batch.size() == 1) {
+      auto& [soid, snaps] = batch.front();
+      if (snaps.empty()) {
+	int r = snap_mapper.remove_oid(soid, &_t);
+	if (r)
+	  derr << __func__ << " remove_oid " << soid << " failed with " << r << dendl;
+	// On removal tolerate missing key corruption
+	ceph_assert(r == 0 || r == -ENOENT);
+      } else {
+	int r = snap_mapper.update_snaps(soid, snaps, 0, &_t);
+	ceph_assert(r == 0);
+      }
+    } else if (!batch.empty()) {
+      int r = snap_mapper.update_snaps_batch(batch, &_t);
+      if (r)
+	derr << __func__ << " update_snaps_batch of " << batch.size()
+	     << " objects failed with " << r << dendl;
+      ceph_assert(r == 0);
+    }
+    batch.clear();
+    batched.clear();
+  };
   for (auto i = log_entries.cbegin(); i != log_entries.cend(); ++i) {
-    OSDriver::OSTransaction _t(osdriver.get_transaction(&t));
     if (i->soid.snap < CEPH_MAXSNAP) {
+      if (batched.count(i->soid)) {
+	flush_batch();
+      }
       if (i->is_delete()) {
-	int r = snap_mapper.remove_oid(
-	  i->soid,
-	  &_t);
-	if (r)
-	  derr << __func__ << " remove_oid " << i->soid << " failed with " << r << dendl;
-        // On removal tolerate missing key corruption
-        ceph_assert(r == 0 || r == -ENOENT);
+	batch.emplace_back(i->soid, set<snapid_t>{});
+	batched.insert(i->soid);
       } else if (i->is_update()) {
 	ceph_assert(i->snaps.length() > 0);
 	vector<snapid_t> snaps;
@@ -1195,23 +1225,21 @@ void PG::update_snap_map(
 	set<snapid_t> _snaps(snaps.begin(), snaps.end());
 
 	if (i->is_clone() || i->is_promote()) {
+	  flush_batch();
 	  snap_mapper.add_oid(
 	    i->soid,
 	    _snaps,
 	    &_t);
 	} else if (i->is_modify()) {
-	  int r = snap_mapper.update_snaps(
-	    i->soid,
-	    _snaps,
-	    0,
-	    &_t);
-	  ceph_assert(r == 0);
+	  batch.emplace_back(i->soid, std::move(_snaps));
+	  batched.insert(i->soid);
 	} else {
 	  ceph_assert(i->is_clean());
 	}
       }
     }
   }
+  flush_batch();
 }
 
 /**
@@ -2445,6 +2473,8 @@ bool PG::can_discard_request(OpRequestRef& op)
     return can_discard_replica_op<MOSDPGPushReply, MSG_OSD_PG_PUSH_REPLY>(op);
   case MSG_OSD_REPOPREPLY:
     return can_discard_replica_op<MOSDRepOpReply, MSG_OSD_REPOPREPLY>(op);
+  case MSG_OSD_REPOP_BATCH:
+    return can_discard_replica_op<MOSDRepOpBatch, MSG_OSD_REPOP_BATCH>(op);
   case MSG_OSD_PG_RECOVERY_DELETE:
     return can_discard_replica_op<MOSDPGRecoveryDelete, MSG_OSD_PG_RECOVERY_DELETE>(op);
 
@@ -771,6 +771,10 @@ public:
     OpRequestRef& op,
     ThreadPool::TPHandle &handle
   ) = 0;
+  /// read left by do_request() to run once the pg lock is dropped, if any
+  virtual Context *take_unlocked_read() {
+    return nullptr;
+  }
   virtual void clear_cache() = 0;
   virtual int get_cache_obj_count() = 0;
 
@@ -930,6 +934,9 @@ protected:
 protected:
   BackfillInterval backfill_info;
   std::map<pg_shard_t, BackfillInterval> peer_backfill_info;
+  /// range digest scans of backfill targets waiting for their reply
+  std::map<pg_shard_t, BackfillDigestScan> peer_backfill_digest_scans;
+  uint64_t last_backfill_digest_scan = 0;
   bool backfill_reserving;
 
   // The primary's num_bytes and local num_bytes for this pg, only valid
@@ -17,6 +17,8 @@
 
 
 #include "common/errno.h"
+#include "include/crc32c.h"
+#include "include/intarith.h"
 #include "common/scrub_types.h"
 #include "ReplicatedBackend.h"
 #include "osd/scrubber/ScrubStore.h"
@@ -633,6 +635,13 @@ int PGBackend::be_scan_list(
       o.attrs);
 
     if (pos.deep) {
+      if (pos.data_pos == 0 && pos.omap_pos.empty() &&
+	  pos.incremental_since != eversion_t()) {
+	auto oi = be_get_object_info(o);
+	pos.sampling = oi && be_should_sample(
+	  pos, *oi, be_can_sample_data(*oi),
+	  cct->_conf.get_val<double>("osd_deep_scrub_incremental_sample_ratio"));
+      }
       r = be_deep_scrub(poid, map, pos, o);
     }
     dout(25) << __func__ << "  " << poid << dendl;
@@ -654,3 +663,83 @@ int PGBackend::be_scan_list(
   pos.next_object();
   return 0;
 }
+
+std::optional<object_info_t> PGBackend::be_get_object_info(
+  const ScrubMap::object &o)
+{
+  auto p = o.attrs.find(OI_ATTR);
+  if (p == o.attrs.end()) {
+    return std::nullopt;
+  }
+  object_info_t oi;
+  try {
+    bufferlist bl;
+    bl.push_back(p->second);
+    auto bliter = bl.cbegin();
+    decode(oi, bliter);
+  } catch (ceph::buffer::error&) {
+    return std::nullopt;
+  }
+  return oi;
+}
+
+bool PGBackend::be_should_sample(
+  const ScrubMapBuilder &pos,
+  const object_info_t &oi,
+  bool can_sample,
+  double ratio)
+{
+  return pos.incremental_since != eversion_t() && ratio > 0 &&
+    oi.version <= pos.incremental_since && can_sample;
+}
+
+uint64_t PGBackend::be_next_sampled_stride(
+  uint32_t seed,
+  uint32_t hash,
+  double ratio,
+  uint64_t from)
+{
+  // every period-th stride, starting at one that changes with each scrub.
+  // A ratio set to 0 while sampling reads every remaining stride.
+  const uint64_t period = ratio > 0 ?
+    std::max<uint64_t>(1, std::llround(std::min(1 / ratio, 1e9))) : 1;
+  const uint64_t first = ceph_crc32c(
+    seed, (const unsigned char*)&hash, sizeof(hash)) % period;
+  return from + (first + period - from % period) % period;
+}
+
+int PGBackend::be_sample_data(
+  const hobject_t &poid,
+  ScrubMapBuilder &pos,
+  uint64_t stride,
+  uint32_t fadvise_flags,
+  ScrubMap::object &o)
+{
+  if (o.size == 0) {
+    return 0;
+  }
+  const uint64_t i = be_next_sampled_stride(
+    pos.sample_seed, poid.get_hash(),
+    cct->_conf.get_val<double>("osd_deep_scrub_incremental_sample_ratio"),
+    pos.data_pos / stride);
+  if (i >= div_round_up(o.size, stride)) {
+    return 0;
+  }
+
+  bufferlist bl;
+  int r = store->read(
+    ch,
+    ghobject_t(
+      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+    i * stride,
+    stride, bl,
+    fadvise_flags);
+  if (r < 0) {
+    dout(20) << __func__ << "  " << poid << " got "
+	     << r << " on read of stride " << i << ", read_error" << dendl;
+    o.read_error = true;
+    return 0;
+  }
+  pos.data_pos = (i + 1) * stride;
+  return pos.data_pos < (int64_t)o.size ? -EINPROGRESS : 0;
+}
@@ -263,6 +263,14 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
        GenContext<ThreadPool::TPHandle&> *c,
        uint64_t cost) = 0;
 
+     /// queue a call to flush_batched_ops() after delay, unless the pg
+     /// has been reset by then
+     virtual void schedule_batched_ops_flush(ceph::timespan delay) = 0;
+
+     /// queue a call to hedge_reads() after delay, unless the pg has been
+     /// reset by then
+     virtual void schedule_read_hedge(ceph::timespan delay) = 0;
+
      virtual pg_shard_t whoami_shard() const = 0;
      int whoami() const {
        return whoami_shard().osd;
@@ -413,6 +421,17 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
    virtual void on_change() = 0;
    virtual void clear_recovery_state() = 0;
 
+   /**
+    * send the replica messages held back to be batched
+    *
+    * Called once the batching window expires, and before sending
+    * anything to the replicas which must not overtake them.
+    */
+   virtual void flush_batched_ops() {}
+
+   /// read from more shards for the reads which are due to be hedged
+   virtual void hedge_reads() {}
+
    virtual IsPGRecoverablePredicate *get_is_recoverable_predicate() const = 0;
    virtual IsPGReadablePredicate *get_is_readable_predicate() const = 0;
    virtual int get_ec_data_chunk_count() const { return 0; };
@@ -594,6 +613,55 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
      ScrubMapBuilder &pos,
      ScrubMap::object &o) = 0;
 
+   /**
+    * whether the persisted digests of an object not modified since the
+    * previous deep scrub stand for its data, so that an incremental deep
+    * scrub only needs to sample the data
+    */
+   virtual bool be_can_sample_data(const object_info_t &oi) const = 0;
+
+   /// @return the object info among the attrs of a scanned object
+   static std::optional<object_info_t> be_get_object_info(
+     const ScrubMap::object &o);
+
+   /**
+    * whether an incremental deep scrub only samples the data of an object:
+    * one not modified after pos.incremental_since, whose persisted digests
+    * stand for its data (can_sample). With a sample ratio of 0 the data is
+    * read in full, nothing is skipped without being read.
+    */
+   static bool be_should_sample(
+     const ScrubMapBuilder &pos,
+     const object_info_t &oi,
+     bool can_sample,
+     double ratio);
+
+   /**
+    * the index of the first stride at or after stride from that the deep
+    * scrub seeded with seed samples in the object of hash hash: every
+    * round(1 / ratio)-th stride, starting at one picked by the seed
+    */
+   static uint64_t be_next_sampled_stride(
+     uint32_t seed,
+     uint32_t hash,
+     double ratio,
+     uint64_t from);
+
+   /**
+    * read the strides of an object that this incremental deep scrub picks,
+    * osd_deep_scrub_incremental_sample_ratio of them, for the object store
+    * to verify their checksums
+    *
+    * @return -EINPROGRESS while strides are left to read, 0 once done,
+    *         with o.read_error set if a read failed
+    */
+   int be_sample_data(
+     const hobject_t &oid,
+     ScrubMapBuilder &pos,
+     uint64_t stride,
+     uint32_t fadvise_flags,
+     ScrubMap::object &o);
+
    static PGBackend *build_pg_backend(
      const pg_pool_t &pool,
      const std::map<std::string,std::string>& profile,
@@ -88,7 +88,7 @@ void PGLog::IndexedLog::trim(
 	*write_from_dups = e.version;
       }
       dups.push_back(pg_log_dup_t(e));
-      index(dups.back());
+      index_dup(dups.get_back_seq());
       uint32_t idx = 0;
       for (const auto& extra : e.extra_reqids) {
 	int return_code = e.return_code;
@@ -104,7 +104,7 @@ void PGLog::IndexedLog::trim(
 	// note: extras have the same version as outer op
 	dups.push_back(pg_log_dup_t(e.version, extra.second,
 				    extra.first, return_code));
-	index(dups.back());
+	index_dup(dups.get_back_seq());
       }
     }
 
@@ -143,7 +143,7 @@ void PGLog::IndexedLog::trim(
   for (size_t max_dups_to_trim = cct->_conf->osd_pg_log_trim_max;
        max_dups_to_trim > 0 && dups.size() > max_dups;
        max_dups_to_trim--) {
-    const auto& e = *dups.begin();
+    const auto e = dups.front();
     lgeneric_subdout(cct, osd, 20) << "trim dup " << e << dendl;
     if (trimmed_dups)
       trimmed_dups->insert(e.get_key_name());
@@ -535,7 +535,7 @@ bool PGLog::merge_log_dups(const pg_log_t& olog) {
       // since our log.dups is empty just copy them
       for (const auto& i : olog.dups) {
 	log.dups.push_back(i);
-	log.index(log.dups.back());
+	log.index_dup(log.dups.get_back_seq());
       }
     } else {
       // since our log.dups is not empty try to extend on each end
@@ -548,19 +548,16 @@ bool PGLog::merge_log_dups(const pg_log_t& olog) {
 
 	auto log_tail_version = log.dups.back().version;
 
-	auto insert_cursor = log.dups.end();
-	eversion_t last_shared = eversion_t::max();
-	for (auto i = olog.dups.crbegin(); i != olog.dups.crend(); ++i) {
-	  if (i->version <= log_tail_version) break;
-	  log.dups.insert(insert_cursor, *i);
-	  last_shared = i->version;
-
-	  auto prev = insert_cursor;
-	  --prev;
-	  // be sure to pass reference of copy in log.dups
-	  log.index(*prev);
-
-	  --insert_cursor; // make sure we insert in reverse order
+	// find the oldest of the newer dups, then append from there
+	size_t first = olog.dups.size();
+	while (first > 0 &&
+	       olog.dups.get_version(first - 1) > log_tail_version) {
+	  --first;
+	}
+	eversion_t last_shared = olog.dups.get_version(first);
+	for (size_t i = first; i < olog.dups.size(); ++i) {
+	  log.dups.push_back(olog.dups[i]);
+	  log.index_dup(log.dups.get_back_seq());
 	}
 	mark_dirty_from_dups(last_shared);
       }
@@ -571,16 +568,17 @@ bool PGLog::merge_log_dups(const pg_log_t& olog) {
 	  olog.dups.front().version << dendl;
 	changed = true;
 
-	eversion_t last;
-	auto insert_cursor = log.dups.begin();
-	for (auto i = olog.dups.cbegin(); i != olog.dups.cend(); ++i) {
-	  if (i->version >= insert_cursor->version) break;
-	  log.dups.insert(insert_cursor, *i);
-	  last = i->version;
-	  auto prev = insert_cursor;
-	  --prev;
-	  // be sure to pass address of copy in log.dups
-	  log.index(*prev);
+	// find the newest of the older dups, then prepend from there
+	auto log_head_version = log.dups.front().version;
+	size_t end = 0;
+	while (end < olog.dups.size() &&
+	       olog.dups.get_version(end) < log_head_version) {
+	  ++end;
+	}
+	eversion_t last = olog.dups.get_version(end - 1);
+	for (size_t i = end; i > 0; --i) {
+	  log.dups.push_front(olog.dups[i - 1]);
+	  log.index_dup(log.dups.get_front_seq());
 	}
 	mark_dirty_to_dups(last);
       }
@@ -808,23 +806,24 @@ void PGLog::_write_log_and_missing_wo_missing(
 
   ldpp_dout(dpp, 10) << __func__ << " going to encode log.dups.size()="
 		     << log.dups.size() << dendl;
-  for (const auto& entry : log.dups) {
-    if (entry.version > dirty_to_dups)
+  for (size_t i = 0; i < log.dups.size(); ++i) {
+    if (log.dups.get_version(i) > dirty_to_dups)
       break;
+    auto entry = log.dups[i];
     bufferlist bl;
     encode(entry, bl);
     (*km)[entry.get_key_name()] = std::move(bl);
   }
   ldpp_dout(dpp, 10) << __func__ << " 1st round encoded log.dups.size()="
 		     << log.dups.size() << dendl;
-  for (auto p = log.dups.rbegin();
-       p != log.dups.rend() &&
-	 (p->version >= dirty_from_dups || p->version >= write_from_dups) &&
-	 p->version >= dirty_to_dups;
-       ++p) {
+  for (size_t i = log.dups.size(); i > 0; --i) {
+    auto v = log.dups.get_version(i - 1);
+    if ((v < dirty_from_dups && v < write_from_dups) || v < dirty_to_dups)
+      break;
+    auto entry = log.dups[i - 1];
     bufferlist bl;
-    encode(*p, bl);
-    (*km)[p->get_key_name()] = std::move(bl);
+    encode(entry, bl);
+    (*km)[entry.get_key_name()] = std::move(bl);
   }
   ldpp_dout(dpp, 10) << __func__ << " 2st round encoded log.dups.size()="
 		     << log.dups.size() << dendl;
@@ -956,9 +955,10 @@ void PGLog::_write_log_and_missing(
 
   ldpp_dout(dpp, 10) << __func__ << " going to encode log.dups.size()="
 		     << log.dups.size() << dendl;
-  for (const auto& entry : log.dups) {
-    if (entry.version > dirty_to_dups)
+  for (size_t i = 0; i < log.dups.size(); ++i) {
+    if (log.dups.get_version(i) > dirty_to_dups)
       break;
+    auto entry = log.dups[i];
     bufferlist bl;
     encode(entry, bl);
     (*km)[entry.get_key_name()] = std::move(bl);
@@ -966,14 +966,14 @@ void PGLog::_write_log_and_missing(
   ldpp_dout(dpp, 10) << __func__ << " 1st round encoded log.dups.size()="
 		     << log.dups.size() << dendl;
 
-  for (auto p = log.dups.rbegin();
-       p != log.dups.rend() &&
-	 (p->version >= dirty_from_dups || p->version >= write_from_dups) &&
-	 p->version >= dirty_to_dups;
-       ++p) {
+  for (size_t i = log.dups.size(); i > 0; --i) {
+    auto v = log.dups.get_version(i - 1);
+    if ((v < dirty_from_dups && v < write_from_dups) || v < dirty_to_dups)
+      break;
+    auto entry = log.dups[i - 1];
     bufferlist bl;
-    encode(*p, bl);
-    (*km)[p->get_key_name()] = std::move(bl);
+    encode(entry, bl);
+    (*km)[entry.get_key_name()] = std::move(bl);
   }
   ldpp_dout(dpp, 10) << __func__ << " 2st round encoded log.dups.size()="
 		     << log.dups.size() << dendl;
@@ -1088,7 +1088,7 @@ namespace {
     std::map<eversion_t, hobject_t> divergent_priors;
     bool must_rebuild = false;
     std::list<pg_log_entry_t> entries;
-    std::list<pg_log_dup_t> dups;
+    pg_log_dups_t dups;
 
     std::optional<std::string> next;
 
@@ -149,7 +149,7 @@ public:
     mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
     mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
     mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    mutable mempool::osd_pglog::unordered_map<osd_reqid_t,pg_log_dups_t::seq_t> dup_index;  // seqs in dups
 
     // recovery pointers
     std::list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -391,11 +391,14 @@ public:
       }
       auto q = dup_index.find(r);
       if (q != dup_index.end()) {
-	*version = q->second->version;
-	*user_version = q->second->user_version;
-	*return_code = q->second->return_code;
-	*op_returns = q->second->op_returns;
-	return true;
+	// a stale index entry is a miss, the dup is gone
+	if (auto dup = dups.at_seq(q->second); dup) {
+	  *version = dup->version;
+	  *user_version = dup->user_version;
+	  *return_code = dup->return_code;
+	  *op_returns = std::move(dup->op_returns);
+	  return true;
+	}
       }
 
       return false;
@@ -458,8 +461,8 @@ public:
 	extra_caller_ops.clear();
       if (to_index & PGLOG_INDEXED_DUPS) {
 	dup_index.clear();
-	for (auto& i : dups) {
-	  dup_index[i.reqid] = const_cast<pg_log_dup_t*>(&i);
+	for (size_t i = 0; i < dups.size(); ++i) {
+	  dup_index[dups.get_reqid(i)] = dups.get_front_seq() + i;
 	}
       }
 
@@ -572,9 +575,10 @@ public:
       }
     }
 
-    void index(pg_log_dup_t& e) {
+    /// index the dup with the given seq, see pg_log_dups_t
+    void index_dup(pg_log_dups_t::seq_t seq) {
       if (indexed_data & PGLOG_INDEXED_DUPS) {
-	dup_index[e.reqid] = &e;
+	dup_index[dups.get_reqid(seq - dups.get_front_seq())] = seq;
       }
     }
 
@@ -1450,7 +1454,7 @@ public:
     bool must_rebuild = false;
     missing.may_include_deletes = false;
     std::list<pg_log_entry_t> entries;
-    std::list<pg_log_dup_t> dups;
+    pg_log_dups_t dups;
     const auto NUM_DUPS_WARN_THRESHOLD = 2*cct->_conf->osd_pg_log_dups_tracked;
     if (p) {
       using ceph::decode;
@@ -218,3 +218,5 @@ struct DeferBackfill : boost::statechart::event<DeferBackfill> {
 };
 
 TrivialEvent(RenewLease)
+TrivialEvent(FlushBatchedOps)
+TrivialEvent(HedgeReads)
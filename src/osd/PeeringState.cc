@@ -6323,6 +6323,20 @@ boost::statechart::result PeeringState::Active::react(const CheckReadable &evt)
   return discard_event();
 }
 
+boost::statechart::result PeeringState::Active::react(const FlushBatchedOps &evt)
+{
+  DECLARE_LOCALS;
+  pl->flush_batched_ops();
+  return discard_event();
+}
+
+boost::statechart::result PeeringState::Active::react(const HedgeReads &evt)
+{
+  DECLARE_LOCALS;
+  pl->hedge_reads();
+  return discard_event();
+}
+
 /*
  * update info.history.last_epoch_started ONLY after we and all
  * replicas have activated AND committed the activate transaction
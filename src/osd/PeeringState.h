@@ -301,6 +301,10 @@ public:
     virtual void schedule_renew_lease(epoch_t plr, ceph::timespan delay) = 0;
     virtual void queue_check_readable(epoch_t lpr, ceph::timespan delay) = 0;
     virtual void recheck_readable() = 0;
+    /// send the replica ops held back for batching
+    virtual void flush_batched_ops() = 0;
+    /// read from more shards for the slow reads
+    virtual void hedge_reads() = 0;
 
     virtual unsigned get_target_pg_log_entries() const = 0;
 
@@ -866,7 +870,9 @@ public:
       boost::statechart::custom_reaction< DoRecovery>,
       boost::statechart::custom_reaction< RenewLease>,
       boost::statechart::custom_reaction< MLeaseAck>,
-      boost::statechart::custom_reaction< CheckReadable>
+      boost::statechart::custom_reaction< CheckReadable>,
+      boost::statechart::custom_reaction< FlushBatchedOps>,
+      boost::statechart::custom_reaction< HedgeReads>
       > reactions;
     boost::statechart::result react(const QueryState& q);
     boost::statechart::result react(const QueryUnfound& q);
@@ -905,6 +911,8 @@ public:
       return discard_event();
     }
     boost::statechart::result react(const CheckReadable&);
+    boost::statechart::result react(const FlushBatchedOps&);
+    boost::statechart::result react(const HedgeReads&);
     void all_activated_and_committed();
   };
 
@@ -531,6 +531,31 @@ void PrimaryLogPG::schedule_recovery_work(
     recovery_state.get_recovery_op_priority());
 }
 
+void PrimaryLogPG::schedule_batched_ops_flush(ceph::timespan delay)
+{
+  // like the lease renewal, don't hold up the timer on the pg lock
+  auto spgid = info.pgid;
+  auto lpr = get_last_peering_reset();
+  auto o = osd;
+  osd->mono_timer.add_event(
+    delay,
+    [o, lpr, spgid]() {
+      o->queue_flush_batched_ops(lpr, spgid);
+    });
+}
+
+void PrimaryLogPG::schedule_read_hedge(ceph::timespan delay)
+{
+  auto spgid = info.pgid;
+  auto lpr = get_last_peering_reset();
+  auto o = osd;
+  osd->mono_timer.add_event(
+    delay,
+    [o, lpr, spgid]() {
+      o->queue_hedge_reads(lpr, spgid);
+    });
+}
+
 void PrimaryLogPG::replica_clear_repop_obc(
   const vector<pg_log_entry_t> &logv,
   ObjectStore::Transaction &t)
@@ -575,6 +600,32 @@ bool PrimaryLogPG::should_send_op(
   return should_send;
 }
 
+bool PrimaryLogPG::same_repop_peers(
+  const hobject_t &first,
+  const hobject_t &hoid)
+{
+  // issue_repop() and the backends ask should_send_op() about the object
+  // of the op only, so the others in the op must get the same answer
+  for (auto &peer : get_backfill_targets()) {
+    auto sent = [&](const hobject_t &oid) {
+      return oid <= last_backfill_started ||
+	oid <= recovery_state.get_peer_info(peer).last_backfill;
+    };
+    bool first_sent = sent(first);
+    if (sent(hoid) != first_sent || sent(hoid.get_head()) != first_sent) {
+      return false;
+    }
+  }
+  for (auto &peer : get_async_recovery_targets()) {
+    auto &missing = recovery_state.get_peer_missing(peer);
+    bool first_missing = missing.is_missing(first);
+    if (missing.is_missing(hoid) != first_missing ||
+	missing.is_missing(hoid.get_head()) != first_missing) {
+      return false;
+    }
+  }
+  return true;
+}
 
 ConnectionRef PrimaryLogPG::get_con_osd_cluster(
   int peer, epoch_t from_epoch)
@@ -1758,7 +1809,7 @@ PrimaryLogPG::PrimaryLogPG(OSDService *o, OSDMapRef curmap,
   pgbackend(
     PGBackend::build_pg_backend(
       _pool.info, ec_profile, this, coll_t(p), ch, o->store, cct)),
-  object_contexts(o->cct, o->cct->_conf->osd_pg_object_context_cache_count),
+  object_contexts(o->obc_cache, p),
   new_backfill(false),
   temp_seq(0),
   snap_trimmer_machine(this)
@@ -2438,6 +2489,7 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
   dout(25) << __func__ << " oi " << obc->obs.oi << dendl;
 
   OpContext *ctx = new OpContext(op, m->get_reqid(), &m->ops, obc, this);
+  ctx->hot = in_hit_set;
 
   if (m->has_flag(CEPH_OSD_FLAG_SKIPRWLOCKS)) {
     dout(20) << __func__ << ": skipping rw locks" << dendl;
@@ -2499,8 +2551,17 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
     return;
   }
 
+  if (wait_for_unlocked_reads(ctx)) {
+    return;
+  }
+
   op->mark_started();
 
+  if (can_read_unlocked(ctx)) {
+    start_unlocked_read(ctx);
+    return;
+  }
+
   execute_ctx(ctx);
   utime_t prepare_latency = ceph_clock_now();
   prepare_latency -= op->get_dequeued_time();
@@ -4455,6 +4516,7 @@ void PrimaryLogPG::do_scan(
 
   switch (m->op) {
   case MOSDPGScan::OP_SCAN_GET_DIGEST:
+  case MOSDPGScan::OP_SCAN_GET_RANGE_DIGEST:
     {
       auto dpp = get_dpp();
       if (osd->check_backfill_full(dpp)) {
@@ -4470,38 +4532,91 @@ void PrimaryLogPG::do_scan(
 
       BackfillInterval bi;
       bi.begin = m->begin;
-      // No need to flush, there won't be any in progress writes occuring
-      // past m->begin
-      scan_range(
-	cct->_conf->osd_backfill_scan_min,
-	cct->_conf->osd_backfill_scan_max,
-	&bi,
-	handle);
-      MOSDPGScan *reply = new MOSDPGScan(
-	MOSDPGScan::OP_SCAN_DIGEST,
-	pg_whoami,
-	get_osdmap_epoch(), m->query_epoch,
-	spg_t(info.pgid.pgid, get_primary().shard), bi.begin, bi.end);
-      encode(bi.objects, reply->get_data());
+      MOSDPGScan *reply = nullptr;
+      if (m->op == MOSDPGScan::OP_SCAN_GET_DIGEST) {
+	// No need to flush, there won't be any in progress writes occuring
+	// past m->begin
+	scan_range(
+	  cct->_conf->osd_backfill_scan_min,
+	  cct->_conf->osd_backfill_scan_max,
+	  &bi,
+	  handle);
+	reply = new MOSDPGScan(
+	  MOSDPGScan::OP_SCAN_DIGEST,
+	  pg_whoami,
+	  get_osdmap_epoch(), m->query_epoch,
+	  spg_t(info.pgid.pgid, get_primary().shard), bi.begin, bi.end);
+	encode(bi.objects, reply->get_data());
+      } else {
+	uint64_t id;
+	vector<BackfillRangeDigest> ranges;
+	auto p = m->get_data().cbegin();
+	decode(id, p);
+	decode(ranges, p);
+	bi.end = m->end;
+	vector<hobject_t> ls;
+	int r = pgbackend->objects_list_range(bi.begin, bi.end, &ls);
+	ceph_assert(r >= 0);
+	scan_versions(ls, &bi, handle);
+	map<hobject_t, eversion_t> mismatched;
+	auto mismatched_ranges = BackfillDigestScan::compare(
+	  bi.begin, ranges, bi.objects, &mismatched);
+	dout(10) << __func__ << " " << mismatched_ranges.size() << "/"
+		 << ranges.size() << " ranges differ, sending "
+		 << mismatched.size() << "/" << bi.objects.size()
+		 << " objects" << dendl;
+	reply = new MOSDPGScan(
+	  MOSDPGScan::OP_SCAN_RANGE_DIGEST,
+	  pg_whoami,
+	  get_osdmap_epoch(), m->query_epoch,
+	  spg_t(info.pgid.pgid, get_primary().shard), bi.begin, bi.end);
+	encode(id, reply->get_data());
+	encode(mismatched_ranges, reply->get_data());
+	encode(mismatched, reply->get_data());
+      }
       osd->send_message_osd_cluster(reply, m->get_connection());
     }
     break;
 
   case MOSDPGScan::OP_SCAN_DIGEST:
+  case MOSDPGScan::OP_SCAN_RANGE_DIGEST:
     {
       pg_shard_t from = m->from;
 
       // Check that from is in backfill_targets vector
       ceph_assert(is_backfill_target(from));
 
-      BackfillInterval& bi = peer_backfill_info[from];
-      bi.begin = m->begin;
-      bi.end = m->end;
       auto p = m->get_data().cbegin();
-
-      // take care to preserve ordering!
-      bi.clear_objects();
-      decode_noclear(bi.objects, p);
+      if (m->op == MOSDPGScan::OP_SCAN_DIGEST) {
+	BackfillInterval& bi = peer_backfill_info[from];
+	bi.begin = m->begin;
+	bi.end = m->end;
+
+	// take care to preserve ordering!
+	bi.clear_objects();
+	decode_noclear(bi.objects, p);
+      } else {
+	uint64_t id;
+	decode(id, p);
+	auto scan = peer_backfill_digest_scans.find(from);
+	if (scan == peer_backfill_digest_scans.end() ||
+	    scan->second.id != id) {
+	  // we canceled backfill for a while and scanned the peer again
+	  dout(10) << __func__ << " ignoring reply to stale range digest scan "
+		   << id << dendl;
+	  break;
+	}
+	std::set<uint32_t> mismatched_ranges;
+	map<hobject_t, eversion_t> mismatched;
+	decode(mismatched_ranges, p);
+	decode(mismatched, p);
+	dout(10) << __func__ << " " << mismatched_ranges.size() << "/"
+		 << scan->second.ranges.size() << " ranges differ" << dendl;
+	scan->second.apply(mismatched_ranges, std::move(mismatched),
+			   &peer_backfill_info[from]);
+	peer_backfill_digest_scans.erase(scan);
+      }
+      const BackfillInterval& bi = peer_backfill_info[from];
       dout(10) << __func__ << " bi.begin=" << bi.begin << " bi.end=" << bi.end
                << " bi.objects.size()=" << bi.objects.size() << dendl;
 
@@ -4630,8 +4745,6 @@ int PrimaryLogPG::trim_object(
   bool first, const hobject_t &coid, snapid_t snap_to_trim,
   PrimaryLogPG::OpContextUPtr *ctxp)
 {
-  *ctxp = NULL;
-
   // load clone info
   bufferlist bl;
   ObjectContextRef obc = get_object_context(coid, false, NULL);
@@ -4692,28 +4805,45 @@ int PrimaryLogPG::trim_object(
     }
   }
 
-  OpContextUPtr ctx = simple_opc_create(obc);
-  ctx->head_obc = head_obc;
+  // a clone trimmed after others goes into their transaction; nothing is
+  // changed before both locks are taken, so on failure the batch is intact
+  const bool batched = bool(*ctxp);
+  OpContextUPtr ctx = batched ? std::move(*ctxp) : simple_opc_create(obc);
+  auto unable_to_lock = [&](const hobject_t &oid) {
+    if (batched) {
+      *ctxp = std::move(ctx);
+    } else {
+      close_op_ctx(ctx.release());
+    }
+    dout(10) << __func__ << ": Unable to get a wlock on " << oid << dendl;
+    return -ENOLCK;
+  };
 
   if (!ctx->lock_manager.get_snaptrimmer_write(
 	coid,
 	obc,
 	first)) {
-    close_op_ctx(ctx.release());
-    dout(10) << __func__ << ": Unable to get a wlock on " << coid << dendl;
-    return -ENOLCK;
+    return unable_to_lock(coid);
   }
 
   if (!ctx->lock_manager.get_snaptrimmer_write(
 	head_oid,
 	head_obc,
 	first)) {
-    close_op_ctx(ctx.release());
-    dout(10) << __func__ << ": Unable to get a wlock on " << head_oid << dendl;
-    return -ENOLCK;
+    return unable_to_lock(head_oid);
   }
 
-  ctx->at_version = get_next_version();
+  if (batched) {
+    // the previous head took the last version
+    ctx->at_version.version++;
+  } else {
+    ctx->at_version = get_next_version();
+  }
+  // issue_repop() only adds the obcs of the last clone of a batch, the
+  // backend needs those of every object the log entries touch
+  ctx->op_t->add_obc(obc);
+  ctx->op_t->add_obc(head_obc);
+  ctx->head_obc = head_obc;
 
   PGTransaction *t = ctx->op_t.get();
 
@@ -4774,7 +4904,7 @@ int PrimaryLogPG::trim_object(
 	pg_log_entry_t::DELETE,
 	coid,
 	ctx->at_version,
-	ctx->obs->oi.version,
+	coi.version,
 	0,
 	osd_reqid_t(),
 	ctx->mtime,
@@ -5842,10 +5972,26 @@ int PrimaryLogPG::do_read(OpContext *ctx, OSDOp& osd_op) {
     ctx->op_finishers[ctx->current_osd_subop_num].reset(
       new ReadFinisher(osd_op));
   } else {
-    int r = pgbackend->objects_read_sync(
-      soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata);
+    bool cacheable = ctx->op &&
+      osd->read_cache.may_cache_read(oi, op.extent.offset, op.extent.length,
+				     ctx->op->may_write());
+    bool cached = cacheable &&
+      osd->read_cache.lookup(info.pgid, soid, ctx->obs->oi.version,
+			     &osd_op.outdata);
+    int r;
+    if (cached) {
+      // its digest was verified when it was cached
+      osd->logger->inc(l_osd_read_cache_hit);
+      r = oi.size;
+    } else {
+      r = pgbackend->objects_read_sync(
+	soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata);
+      if (cacheable) {
+	osd->logger->inc(l_osd_read_cache_miss);
+      }
+    }
     // whole object?  can we verify the checksum?
-    if (r >= 0 && op.extent.offset == 0 &&
+    if (!cached && r >= 0 && op.extent.offset == 0 &&
         (uint64_t)r == oi.size && oi.is_data_digest()) {
       uint32_t crc = osd_op.outdata.crc32c(-1);
       if (oi.data_digest != crc) {
@@ -5856,6 +6002,10 @@ int PrimaryLogPG::do_read(OpContext *ctx, OSDOp& osd_op) {
         r = -EIO; // try repair later
       }
     }
+    if (cacheable && !cached && r >= 0 &&
+	osd->read_cache.admit(info.pgid, soid, oi, ctx->hot, osd_op.outdata)) {
+      osd->logger->set(l_osd_read_cache_bytes, osd->read_cache.get_bytes());
+    }
     if (r == -EIO) {
       r = rep_repair_primary_object(soid, ctx);
     }
@@ -8603,7 +8753,11 @@ void PrimaryLogPG::make_writeable(OpContext *ctx)
       ctx->clone_obc->obs.oi = static_snap_oi;
       ctx->clone_obc->obs.exists = true;
       ctx->clone_obc->ssc = ctx->obc->ssc;
-      ctx->clone_obc->ssc->ref++;
+      {
+	// the obc may be evicted, and put the ssc, from another PG's thread
+	std::lock_guard l(snapset_contexts_lock);
+	ctx->clone_obc->ssc->ref++;
+      }
       if (pool.info.is_erasure())
 	ctx->clone_obc->attr_cache = ctx->obc->attr_cache;
       snap_oi = &ctx->clone_obc->obs.oi;
@@ -8944,6 +9098,7 @@ void PrimaryLogPG::finish_ctx(OpContext *ctx, int log_op_type, int result)
 	   << " op " << pg_log_entry_t::get_op_name(log_op_type)
 	   << dendl;
   utime_t now = ceph_clock_now();
+  osd->read_cache.invalidate(info.pgid, soid);
 
 
   // Drop the reference if deduped chunk is modified
@@ -9117,6 +9272,331 @@ void PrimaryLogPG::complete_read_ctx(int result, OpContext *ctx)
   close_op_ctx(ctx);
 }
 
+bool PrimaryLogPG::can_read_unlocked(const OpContext *ctx) const
+{
+  if (!osd->osd_unlocked_reads ||
+      !is_primary() ||
+      pool.info.is_erasure() ||
+      pool.info.is_tier() ||
+      pool.info.has_tiers()) {
+    return false;
+  }
+  const OpRequestRef& op = ctx->op;
+  auto m = op->get_req<MOSDOp>();
+  if (op->may_write() ||
+      op->may_cache() ||
+      ctx->lock_type != RWState::RWREAD ||
+      m->get_snapid() != CEPH_NOSNAP ||
+      ctx->obc->obs.oi.has_manifest()) {
+    return false;
+  }
+  for (const auto& osd_op : *ctx->ops) {
+    switch (osd_op.op.op) {
+    case CEPH_OSD_OP_READ:
+    case CEPH_OSD_OP_STAT:
+      break;
+    case CEPH_OSD_OP_GETXATTR:
+      if (osd_op.indata.length() < osd_op.op.xattr.name_len) {
+	return false;
+      }
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PrimaryLogPG::wait_for_unlocked_reads(OpContext *ctx)
+{
+  const hobject_t& soid = ctx->obc->obs.oi.soid;
+  auto p = unlocked_reads.find(soid);
+  if (p == unlocked_reads.end()) {
+    return false;
+  }
+  auto& reads = p->second;
+  // another unlocked read may go right away, its reply is queued behind
+  // the ones in flight
+  if (!reads.requeue && reads.waiting.empty() && can_read_unlocked(ctx)) {
+    return false;
+  }
+  dout(10) << __func__ << " " << soid << " " << *ctx->op->get_req() << dendl;
+  reads.waiting.push_back(ctx->op);
+  ctx->op->mark_delayed("waiting for unlocked reads");
+  close_op_ctx(ctx);
+  return true;
+}
+
+void PrimaryLogPG::start_unlocked_read(OpContext *ctx)
+{
+  const hobject_t& soid = ctx->obc->obs.oi.soid;
+  dout(20) << __func__ << " " << soid << " " << *ctx->ops << dendl;
+  ceph_assert(!pending_unlocked_read);
+  auto& reads = unlocked_reads[soid];
+  ceph_assert(!reads.requeue && reads.waiting.empty());
+  auto& in_flight = reads.in_flight.emplace_back(
+    ctx, get_last_peering_reset());
+  in_flight.ops = *ctx->ops;
+  ctx->ops = &in_flight.ops;
+  // PGOpItem::run() holds a pg ref while this runs, and the read stays in
+  // in_flight, or in cancelled_unlocked_reads, until it is done
+  pending_unlocked_read = new LambdaContext(
+    [this, read=&in_flight, soid](int) {
+      OpContext *ctx = read->ctx;
+      {
+#ifdef WITH_LTTNG
+	osd_reqid_t reqid = ctx->op->get_reqid();
+#endif
+	tracepoint(osd, prepare_tx_enter, reqid.name._type,
+		   reqid.name._num, reqid.tid, reqid.inc);
+      }
+      bool need_repair = false;
+      int result = do_unlocked_read(ctx, &need_repair);
+      {
+#ifdef WITH_LTTNG
+	osd_reqid_t reqid = ctx->op->get_reqid();
+#endif
+	tracepoint(osd, prepare_tx_exit, reqid.name._type,
+		   reqid.name._num, reqid.tid, reqid.inc);
+      }
+      utime_t prepare_latency = ceph_clock_now();
+      prepare_latency -= ctx->op->get_dequeued_time();
+      osd->logger->tinc(l_osd_op_prepare_lat, prepare_latency);
+      osd->logger->tinc(l_osd_op_r_prepare_lat, prepare_latency);
+
+      std::scoped_lock locker{*this};
+      if (read->cancelled) {
+	// its op went back to the queue, or the pg is shutting down
+	close_op_ctx(ctx);
+	cancelled_unlocked_reads.remove_if(
+	  [read](const UnlockedRead& r) { return &r == read; });
+	return;
+      }
+      read->result = result;
+      read->need_repair = need_repair;
+      read->done = true;
+      finish_unlocked_reads(soid);
+    });
+}
+
+int PrimaryLogPG::do_unlocked_read(OpContext *ctx, bool *need_repair)
+{
+  // no pg lock here: only ctx (new_obs is a copy of the object info taken
+  // under the lock), the op and the object store may be touched.  The
+  // obc read lock keeps writers to this object away.
+  const object_info_t& oi = ctx->new_obs.oi;
+  const hobject_t& soid = oi.soid;
+  int result = 0;
+
+  for (auto& osd_op : *ctx->ops) {
+    ceph_osd_op& op = osd_op.op;
+    switch (op.op) {
+    case CEPH_OSD_OP_READ:
+      {
+	++ctx->num_read;
+	tracepoint(osd, do_osd_op_pre_read, soid.oid.name.c_str(),
+		   soid.snap.val, oi.size, oi.truncate_seq, op.extent.offset,
+		   op.extent.length, op.extent.truncate_size,
+		   op.extent.truncate_seq);
+	// munge -1 truncate to 0 truncate, and trim, as do_osd_ops() and
+	// do_read() do
+	if (op.extent.truncate_seq == 1 &&
+	    op.extent.truncate_size == (-1ULL)) {
+	  op.extent.truncate_size = 0;
+	  op.extent.truncate_seq = 0;
+	}
+	if (!ctx->data_off) {
+	  ctx->data_off = op.extent.offset;
+	}
+	uint64_t size = oi.size;
+	if ((oi.truncate_seq < op.extent.truncate_seq) &&
+	    (op.extent.offset + op.extent.length > op.extent.truncate_size) &&
+	    (size > op.extent.truncate_size)) {
+	  size = op.extent.truncate_size;
+	}
+	if (op.extent.length == 0) {
+	  op.extent.length = size;
+	}
+	bool trimmed_read = false;
+	if (op.extent.offset >= size) {
+	  op.extent.length = 0;
+	  trimmed_read = true;
+	} else if (op.extent.offset + op.extent.length > size) {
+	  op.extent.length = size - op.extent.offset;
+	  trimmed_read = true;
+	}
+	if (!trimmed_read || op.extent.length > 0) {
+	  int r = pgbackend->objects_read_sync(
+	    soid, op.extent.offset, op.extent.length, op.flags,
+	    &osd_op.outdata);
+	  if (r >= 0 && op.extent.offset == 0 &&
+	      (uint64_t)r == oi.size && oi.is_data_digest()) {
+	    uint32_t crc = osd_op.outdata.crc32c(-1);
+	    if (oi.data_digest != crc) {
+	      osd->clog->error() << pg_id << std::hex
+				 << " full-object read crc 0x" << crc
+				 << " != expected 0x" << oi.data_digest
+				 << std::dec << " on " << soid;
+	      r = -EIO;
+	    }
+	  }
+	  if (r == -EIO) {
+	    // try repair later, under the pg lock
+	    *need_repair = true;
+	    return r;
+	  }
+	  if (r >= 0) {
+	    op.extent.length = r;
+	  } else {
+	    result = r;
+	    op.extent.length = 0;
+	  }
+	  dout(10) << __func__ << " read got " << r << " / "
+		   << op.extent.length << " bytes from obj " << soid << dendl;
+	}
+	if (result >= 0) {
+	  ctx->delta_stats.num_rd_kb += shift_round_up(op.extent.length, 10);
+	  ctx->delta_stats.num_rd++;
+	}
+      }
+      break;
+
+    case CEPH_OSD_OP_STAT:
+      tracepoint(osd, do_osd_op_pre_stat, soid.oid.name.c_str(),
+		 soid.snap.val);
+      if (ctx->new_obs.exists && !oi.is_whiteout()) {
+	encode(oi.size, osd_op.outdata);
+	encode(oi.mtime, osd_op.outdata);
+      } else {
+	result = -ENOENT;
+      }
+      ctx->delta_stats.num_rd++;
+      break;
+
+    case CEPH_OSD_OP_GETXATTR:
+      {
+	++ctx->num_read;
+	string aname;
+	auto bp = osd_op.indata.cbegin();
+	bp.copy(op.xattr.name_len, aname);
+	tracepoint(osd, do_osd_op_pre_getxattr, soid.oid.name.c_str(),
+		   soid.snap.val, aname.c_str());
+	int r = pgbackend->objects_get_attr(soid, "_" + aname,
+					    &osd_op.outdata);
+	if (r >= 0) {
+	  op.xattr.value_len = osd_op.outdata.length();
+	  ctx->delta_stats.num_rd_kb +=
+	    shift_round_up(osd_op.outdata.length(), 10);
+	} else {
+	  result = r;
+	}
+	ctx->delta_stats.num_rd++;
+      }
+      break;
+
+    default:
+      ceph_abort_msg("unexpected op in unlocked read");
+    }
+
+    osd_op.rval = result;
+    if (result < 0 && (op.flags & CEPH_OSD_OP_FLAG_FAILOK)) {
+      result = 0;
+    }
+    if (result < 0) {
+      break;
+    }
+  }
+  return result;
+}
+
+void PrimaryLogPG::finish_unlocked_reads(const hobject_t& soid)
+{
+  auto p = unlocked_reads.find(soid);
+  ceph_assert(p != unlocked_reads.end());
+  auto& reads = p->second;
+  // the replies go out in the order of the ops
+  while (!reads.in_flight.empty() && reads.in_flight.front().done) {
+    auto& read = reads.in_flight.front();
+    OpContext *ctx = read.ctx;
+    OpRequestRef op = ctx->op;
+    auto m = op->get_req<MOSDOp>();
+    if (!reads.requeue && pg_has_reset_since(read.reset_epoch)) {
+      dout(10) << __func__ << " " << *m << " raced with interval change"
+	       << dendl;
+      reads.requeue = true;
+    }
+    if (reads.requeue) {
+      dout(20) << __func__ << " requeueing " << *m << dendl;
+      reads.requeued.push_back(op);
+      close_op_ctx(ctx);
+    } else if (read.need_repair) {
+      // the op waits for the object to be recovered, like in do_read(),
+      // and so do the ones after it
+      rep_repair_primary_object(soid, ctx);
+      close_op_ctx(ctx);
+      reads.requeue = true;
+    } else {
+      osd->logger->inc(l_osd_op_r_unlocked);
+      if (read.result >= 0) {
+	unstable_stats.add(ctx->delta_stats);
+      }
+      ctx->reply = new MOSDOpReply(m, read.result, get_osdmap_epoch(), 0,
+				   false);
+      // what the read did went to its copy of the ops
+      std::vector<OSDOp> out(read.ops);
+      for (auto& osd_op : out) {
+	osd_op.indata.clear();
+      }
+      ctx->reply->claim_ops(out);
+      dout(20) << __func__ << " alloc reply " << ctx->reply
+	       << " result " << read.result << dendl;
+      if (read.result >= 0) {
+	do_osd_op_effects(ctx, m->get_connection());
+      }
+      complete_read_ctx(read.result, ctx);
+    }
+    reads.in_flight.pop_front();
+  }
+  if (reads.in_flight.empty()) {
+    reads.requeued.splice(reads.requeued.end(), reads.waiting);
+    if (is_primary()) {
+      requeue_ops(reads.requeued);
+    }
+    unlocked_reads.erase(p);
+  }
+}
+
+void PrimaryLogPG::cancel_unlocked_reads(bool requeue)
+{
+  for (auto& [soid, reads] : unlocked_reads) {
+    // the ops of the object, oldest first: the reads already cancelled,
+    // the ones in flight, then the ops that came after them
+    std::list<OpRequestRef> ops;
+    ops.splice(ops.end(), reads.requeued);
+    while (!reads.in_flight.empty()) {
+      auto& read = reads.in_flight.front();
+      ops.push_back(read.ctx->op);
+      if (read.done) {
+	close_op_ctx(read.ctx);
+	reads.in_flight.pop_front();
+      } else {
+	// the reading thread still uses ctx, it closes it once done
+	read.cancelled = true;
+	cancelled_unlocked_reads.splice(cancelled_unlocked_reads.end(),
+					reads.in_flight,
+					reads.in_flight.begin());
+      }
+    }
+    ops.splice(ops.end(), reads.waiting);
+    dout(10) << __func__ << " " << soid << " " << (requeue ? "requeue " : "drop ")
+	     << ops.size() << " ops" << dendl;
+    if (requeue) {
+      requeue_ops(ops);
+    }
+  }
+  unlocked_reads.clear();
+}
+
 // ========================================================================
 // copyfrom
 
@@ -11562,6 +12042,8 @@ void PrimaryLogPG::submit_log_entries(
 
   pgbackend->call_write_ordered(
     [this, entries, repop, on_complete]() {
+      // the replicas have to apply the entries after the writes before them
+      pgbackend->flush_batched_ops();
       ObjectStore::Transaction t;
       eversion_t old_last_update = info.last_update;
       recovery_state.merge_new_log_entries(
@@ -11853,6 +12335,7 @@ ObjectContextRef PrimaryLogPG::get_object_context(
     dout(10) << __func__ << ": found obc in cache: " << *obc
 	     << dendl;
   } else {
+    osd->logger->inc(l_osd_object_ctx_cache_miss);
     dout(10) << __func__ << ": obc NOT found in cache: " << soid << dendl;
     // check disk
     bufferlist bv;
@@ -12932,6 +13415,7 @@ void PrimaryLogPG::on_shutdown()
   object_contexts.clear();
 
   clear_async_reads();
+  cancel_unlocked_reads(false);
 
   osd->remote_reserver.cancel_reservation(info.pgid);
   osd->local_reserver.cancel_reservation(info.pgid);
@@ -13090,6 +13574,7 @@ void PrimaryLogPG::on_change(ObjectStore::Transaction &t)
     if (is_primary())
       requeue_op(i->first);
   }
+  cancel_unlocked_reads(is_primary());
 
   // this will requeue ops we were working on but didn't finish, and
   // any dups
@@ -13854,6 +14339,12 @@ uint64_t PrimaryLogPG::recover_backfill(
   update_range(&backfill_info, handle);
 
   unsigned ops = 0;
+  // small objects share a recovery op, and their pushes a message
+  const uint64_t small_object_size =
+    cct->_conf.get_val<Option::size_t>("osd_backfill_small_object_size");
+  const uint64_t small_object_batch =
+    cct->_conf.get_val<uint64_t>("osd_backfill_small_object_batch");
+  uint64_t small_objects = 0;
   vector<boost::tuple<hobject_t, eversion_t, pg_shard_t> > to_remove;
   set<hobject_t> add_to_stat;
 
@@ -13892,10 +14383,15 @@ uint64_t PrimaryLogPG::recover_backfill(
 	  !pbi.extends_to_end() && pbi.empty()) {
 	dout(10) << " scanning peer osd." << bt << " from " << pbi.end << dendl;
 	epoch_t e = get_osdmap_epoch();
-	MOSDPGScan *m = new MOSDPGScan(
-	  MOSDPGScan::OP_SCAN_GET_DIGEST, pg_whoami, e, get_last_peering_reset(),
-	  spg_t(info.pgid.pgid, bt.shard),
-	  pbi.end, hobject_t());
+	MOSDPGScan *m = nullptr;
+	if (cct->_conf.get_val<bool>("osd_backfill_scan_digest")) {
+	  m = prep_backfill_digest_scan(bt, pbi.end, handle);
+	} else {
+	  m = new MOSDPGScan(
+	    MOSDPGScan::OP_SCAN_GET_DIGEST, pg_whoami, e, get_last_peering_reset(),
+	    spg_t(info.pgid.pgid, bt.shard),
+	    pbi.end, hobject_t());
+	}
 
 	if (cct->_conf->osd_op_queue == "mclock_scheduler") {
 	  /* This guard preserves legacy WeightedPriorityQueue behavior for
@@ -14017,7 +14513,16 @@ uint64_t PrimaryLogPG::recover_backfill(
 	    dout(0) << __func__ << " Error " << r << " trying to backfill " << backfill_info.begin << dendl;
 	    break;
 	  }
-	  ops++;
+	  if (small_object_batch > 1 &&
+	      obc->obs.oi.size <= small_object_size &&
+	      !obc->obs.oi.is_omap()) {
+	    if (++small_objects == small_object_batch) {
+	      small_objects = 0;
+	      ops++;
+	    }
+	  } else {
+	    ops++;
+	  }
 	} else {
 	  *work_started = true;
 	  dout(20) << "backfill blocking on " << backfill_info.begin
@@ -14172,7 +14677,7 @@ uint64_t PrimaryLogPG::recover_backfill(
     }
   }
 
-  if (ops)
+  if (ops || small_objects)
     *work_started = true;
   return ops;
 }
@@ -14207,6 +14712,35 @@ int PrimaryLogPG::prep_backfill_object_push(
   return r;
 }
 
+MOSDPGScan *PrimaryLogPG::prep_backfill_digest_scan(
+  pg_shard_t peer, const hobject_t &begin,
+  ThreadPool::TPHandle &handle)
+{
+  BackfillInterval local;
+  local.begin = begin;
+  scan_range(
+    cct->_conf->osd_backfill_scan_min,
+    cct->_conf->osd_backfill_scan_max,
+    &local,
+    handle);
+  BackfillDigestScan &scan = peer_backfill_digest_scans[peer];
+  scan.id = ++last_backfill_digest_scan;
+  scan.build(
+    std::move(local),
+    cct->_conf.get_val<uint64_t>("osd_backfill_scan_digest_range"));
+  dout(10) << __func__ << " " << scan.id << " " << scan.begin << "-"
+	   << scan.end << " " << scan.objects.size() << " objects in "
+	   << scan.ranges.size() << " ranges" << dendl;
+
+  MOSDPGScan *m = new MOSDPGScan(
+    MOSDPGScan::OP_SCAN_GET_RANGE_DIGEST, pg_whoami, get_osdmap_epoch(),
+    get_last_peering_reset(), spg_t(info.pgid.pgid, peer.shard),
+    scan.begin, scan.end);
+  encode(scan.id, m->get_data());
+  encode(scan.ranges, m->get_data());
+  return m;
+}
+
 void PrimaryLogPG::update_range(
   BackfillInterval *bi,
   ThreadPool::TPHandle &handle)
@@ -14284,8 +14818,14 @@ void PrimaryLogPG::scan_range(
   ceph_assert(r >= 0);
   dout(10) << " got " << ls.size() << " items, next " << bi->end << dendl;
   dout(20) << ls << dendl;
+  scan_versions(ls, bi, handle);
+}
 
-  for (vector<hobject_t>::iterator p = ls.begin(); p != ls.end(); ++p) {
+void PrimaryLogPG::scan_versions(
+  const vector<hobject_t> &ls, BackfillInterval *bi,
+  ThreadPool::TPHandle &handle)
+{
+  for (auto p = ls.begin(); p != ls.end(); ++p) {
     handle.reset_tp_timeout();
     ObjectContextRef obc;
     if (is_primary())
@@ -15662,10 +16202,13 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
   // we need to look for at least 1 snaptrim, otherwise we'll misinterpret
   // the ENOENT below and erase snap_to_trim.
   ceph_assert(max > 0);
-  to_trim.reserve(max);
+  // each of the (up to) max transactions in flight trims a batch of clones
+  const unsigned batch_size = std::max<uint64_t>(
+    1, pg->cct->_conf.get_val<uint64_t>("osd_snap_trim_batch_size"));
+  to_trim.reserve(max * batch_size);
   int r = pg->snap_mapper.get_next_objects_to_trim(
     snap_to_trim,
-    max,
+    max * batch_size,
     &to_trim);
   if (r != 0 && r != -ENOENT) {
     lderr(pg->cct) << "get_next_objects_to_trim returned "
@@ -15706,11 +16249,43 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
   }
   ceph_assert(!to_trim.empty());
 
+  OpContextUPtr ctx;
+  vector<hobject_t> batch;
+  auto submit_batch = [&] {
+    if (!ctx) {
+      return;
+    }
+    in_flight.insert(batch.begin(), batch.end());
+    ctx->register_on_success(
+      [pg, batch, &in_flight]() {
+	for (auto &object : batch) {
+	  ceph_assert(in_flight.find(object) != in_flight.end());
+	  in_flight.erase(object);
+	}
+	if (in_flight.empty()) {
+	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
+	    pg->snap_trimmer_machine.process_event(Reset());
+	  } else {
+	    pg->snap_trimmer_machine.process_event(RepopsComplete());
+	  }
+	}
+      });
+
+    pg->simple_opc_submit(std::move(ctx));
+    batch.clear();
+  };
+
   for (auto &&object: to_trim) {
     // Get next
     ldout(pg->cct, 10) << "AwaitAsyncWork react trimming " << object << dendl;
-    OpContextUPtr ctx;
-    int error = pg->trim_object(in_flight.empty(), object, snap_to_trim, &ctx);
+    if (ctx && !pg->same_repop_peers(batch.front(), object)) {
+      // a backfill or async recovery target is between the two
+      ldout(pg->cct, 20) << "not batching " << object << " with "
+			 << batch.front() << dendl;
+      submit_batch();
+    }
+    int error = pg->trim_object(in_flight.empty() && !ctx, object,
+				snap_to_trim, &ctx);
     if (error) {
       if (error == -ENOLCK) {
 	ldout(pg->cct, 10) << "could not get write lock on obj "
@@ -15719,6 +16294,7 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
 	pg->state_set(PG_STATE_SNAPTRIM_ERROR);
 	ldout(pg->cct, 10) << "Snaptrim error=" << error << dendl;
       }
+      submit_batch();
       if (!in_flight.empty()) {
 	ldout(pg->cct, 10) << "letting the ones we already started finish" << dendl;
 	return transit< WaitRepops >();
@@ -15731,22 +16307,12 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
       return transit< NotTrimming >();
     }
 
-    in_flight.insert(object);
-    ctx->register_on_success(
-      [pg, object, &in_flight]() {
-	ceph_assert(in_flight.find(object) != in_flight.end());
-	in_flight.erase(object);
-	if (in_flight.empty()) {
-	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
-	    pg->snap_trimmer_machine.process_event(Reset());
-	  } else {
-	    pg->snap_trimmer_machine.process_event(RepopsComplete());
-	  }
-	}
-      });
-
-    pg->simple_opc_submit(std::move(ctx));
+    batch.push_back(object);
+    if (batch.size() >= batch_size) {
+      submit_batch();
+    }
   }
+  submit_batch();
 
   return transit< WaitRepops >();
 }
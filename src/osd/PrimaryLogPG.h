@@ -22,12 +22,12 @@
 #include "DynamicPerfStats.h"
 #include "OSD.h"
 #include "PG.h"
+#include "ObjectContextCache.h"
 #include "Watch.h"
 #include "TierAgentState.h"
 #include "messages/MOSDOpReply.h"
 #include "common/Checksummer.h"
 #include "common/sharedptr_registry.hpp"
-#include "common/shared_cache.hpp"
 #include "ReplicatedBackend.h"
 #include "PGTransaction.h"
 #include "cls/cas/cls_cas_ops.h"
@@ -38,6 +38,7 @@ struct RefCountCallback;
 
 class PrimaryLogPG;
 class PGLSFilter;
+class MOSDPGScan;
 class HitSet;
 struct TierAgentState;
 class OSDService;
@@ -513,6 +514,8 @@ public:
   bool should_send_op(
     pg_shard_t peer,
     const hobject_t &hoid) override;
+  /// true if a repop of hoid reaches every peer as one of first does
+  bool same_repop_peers(const hobject_t &first, const hobject_t &hoid);
 
   bool pg_is_undersized() const override {
     return is_undersized();
@@ -546,6 +549,15 @@ public:
     GenContext<ThreadPool::TPHandle&> *c,
     uint64_t cost) override;
 
+  void schedule_batched_ops_flush(ceph::timespan delay) override;
+  void flush_batched_ops() override {
+    pgbackend->flush_batched_ops();
+  }
+  void schedule_read_hedge(ceph::timespan delay) override;
+  void hedge_reads() override {
+    pgbackend->hedge_reads();
+  }
+
   pg_shard_t whoami_shard() const override {
     return pg_whoami;
   }
@@ -634,6 +646,8 @@ public:
     bool cache_operation;     ///< true if this is a cache eviction
     bool ignore_cache;    ///< true if IGNORE_CACHE flag is std::set
     bool ignore_log_op_stats;  // don't log op stats
+    /// the object was in the HitSet before this op, see ObjectReadCache
+    bool hot = false;
     bool update_log_only; ///< this is a write that returned an error - just record in pg log for dup detection
     ObjectCleanRegions clean_regions;
 
@@ -996,7 +1010,7 @@ protected:
   bool already_complete(eversion_t v);
 
   // projected object info
-  SharedLRU<hobject_t, ObjectContext> object_contexts;
+  ObjectContextCache::PGCache object_contexts;
   // std::map from oid.snapdir() to SnapSetContext *
   std::map<hobject_t, SnapSetContext*> snapset_contexts;
   ceph::mutex snapset_contexts_lock =
@@ -1248,6 +1262,56 @@ protected:
   std::list<std::pair<OpRequestRef, OpContext*> > in_progress_async_reads;
   void complete_read_ctx(int result, OpContext *ctx);
 
+  /**
+   * unlocked reads
+   *
+   * Ops made only of READ, STAT and GETXATTR on a replicated pool go
+   * through do_op() and take their obc read lock as usual, but the object
+   * store is only touched once the pg lock has been dropped (see
+   * PGOpItem::run()), so other threads of the shard can work on this pg
+   * meanwhile.  Back under the pg lock, the replies to an object go out in
+   * the order of their ops, and other ops to the object wait until no
+   * unlocked read of it is in flight.  If the pg went through a new
+   * interval, the read and every op to the object after it are requeued:
+   * on_change() requeues them right away, in op order, and the reads
+   * still running only release their ctx once back under the pg lock.
+   */
+  struct UnlockedRead {
+    OpContext *ctx;
+    epoch_t reset_epoch;
+    /// the read's own copy of the ops, ctx->ops points to it: the op may
+    /// be requeued, and run again, while the read still runs
+    std::vector<OSDOp> ops;
+    int result = 0;
+    bool need_repair = false;
+    bool done = false;
+    /// its op was requeued or dropped, see cancel_unlocked_reads()
+    bool cancelled = false;
+    UnlockedRead(OpContext *ctx, epoch_t reset_epoch)
+      : ctx(ctx), reset_epoch(reset_epoch) {}
+  };
+  struct UnlockedReads {
+    std::list<UnlockedRead> in_flight;  ///< in op order
+    /// set once one of in_flight is requeued, the ones after it follow
+    bool requeue = false;
+    std::list<OpRequestRef> requeued;
+    /// ops to the object that came after in_flight
+    std::list<OpRequestRef> waiting;
+  };
+  std::map<hobject_t, UnlockedReads> unlocked_reads;
+  /// cancelled reads still running without the pg lock
+  std::list<UnlockedRead> cancelled_unlocked_reads;
+  Context *pending_unlocked_read = nullptr;
+  bool can_read_unlocked(const OpContext *ctx) const;
+  /// true if ctx has to wait for the unlocked reads of its object
+  bool wait_for_unlocked_reads(OpContext *ctx);
+  void start_unlocked_read(OpContext *ctx);
+  int do_unlocked_read(OpContext *ctx, bool *need_repair);
+  void finish_unlocked_reads(const hobject_t& soid);
+  /// on a new interval or shutdown: requeue, or drop, every op that
+  /// waits for unlocked reads, the reads themselves included
+  void cancel_unlocked_reads(bool requeue);
+
   // pg on-disk content
   void check_local() override;
 
@@ -1282,6 +1346,16 @@ protected:
     ThreadPool::TPHandle &handle
     );
 
+  /// add the versions of the listed objects that still exist to bi
+  void scan_versions(
+    const std::vector<hobject_t> &ls, BackfillInterval *bi,
+    ThreadPool::TPHandle &handle);
+
+  /// scan our objects from begin and send their range digests to peer
+  MOSDPGScan *prep_backfill_digest_scan(
+    pg_shard_t peer, const hobject_t &begin,
+    ThreadPool::TPHandle &handle);
+
   /// Update a hash range to reflect changes since the last scan
   void update_range(
     BackfillInterval *bi,        ///< [in,out] interval to update
@@ -1493,6 +1567,9 @@ public:
   void do_request(
     OpRequestRef& op,
     ThreadPool::TPHandle &handle) override;
+  Context *take_unlocked_read() override {
+    return std::exchange(pending_unlocked_read, nullptr);
+  }
   void do_op(OpRequestRef& op);
   void record_write_error(OpRequestRef op, const hobject_t &soid,
 			  MOSDOpReply *orig_reply, int r,
@@ -1506,6 +1583,7 @@ public:
 
   void handle_backoff(OpRequestRef& op);
 
+  /// trim coid into *ctxp, which is created unless it holds a batch already
   int trim_object(bool first, const hobject_t &coid, snapid_t snap_to_trim,
 		  OpContextUPtr *ctxp);
   void snap_trimmer(epoch_t e) override;
@@ -0,0 +1,55 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "osd/RepOpBatcher.h"
+
+#include "messages/MOSDRepOpBatch.h"
+
+bool RepOpBatcher::queue(pg_shard_t shard, ceph::ref_t<MOSDRepOp> op,
+			 uint64_t max_bytes)
+{
+  auto& p = pending[shard];
+  p.bytes += op->get_data().length() + op->logbl.length();
+  p.ops.push_back(std::move(op));
+  if (p.bytes >= max_bytes) {
+    send_pending(shard, p);
+    pending.erase(shard);
+    return false;
+  }
+  return true;
+}
+
+void RepOpBatcher::send(pg_shard_t shard, ceph::ref_t<MOSDRepOp> op)
+{
+  flush(shard);
+  send_message(shard, op.detach());
+}
+
+void RepOpBatcher::flush(pg_shard_t shard)
+{
+  if (auto p = pending.find(shard); p != pending.end()) {
+    send_pending(shard, p->second);
+    pending.erase(p);
+  }
+}
+
+void RepOpBatcher::flush()
+{
+  for (auto& [shard, p] : pending) {
+    send_pending(shard, p);
+  }
+  pending.clear();
+}
+
+void RepOpBatcher::send_pending(pg_shard_t shard, Pending& p)
+{
+  Message *m;
+  if (p.ops.size() == 1) {
+    m = p.ops.front().detach();
+  } else {
+    auto& front = p.ops.front();
+    m = new MOSDRepOpBatch(front->pgid, front->map_epoch, front->min_epoch,
+			   std::move(p.ops));
+  }
+  send_message(shard, m);
+}
@@ -0,0 +1,74 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_REPOPBATCHER_H
+#define CEPH_OSD_REPOPBATCHER_H
+
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "messages/MOSDRepOp.h"
+#include "osd/osd_types.h"
+
+/**
+ * RepOpBatcher
+ *
+ * The repops of a PG held back per replica, to be sent together as one
+ * MOSDRepOpBatch.  A replica must get the repops in the order they were
+ * issued, so whatever is sent to a replica without going through
+ * queue() has to go through send() too, which sends the held back
+ * repops of that replica first.
+ */
+class RepOpBatcher {
+public:
+  /// sends a message to the replica, a MOSDRepOp or a MOSDRepOpBatch
+  using send_t = std::function<void(pg_shard_t, Message*)>;
+
+  explicit RepOpBatcher(send_t send)
+    : send_message(std::move(send)) {}
+
+  /**
+   * hold back op for shard
+   *
+   * Sends what is held back for shard, op included, once that is at
+   * least max_bytes.
+   *
+   * @return true if op is held back
+   */
+  bool queue(pg_shard_t shard, ceph::ref_t<MOSDRepOp> op, uint64_t max_bytes);
+  /// send op right away, after what is held back for shard
+  void send(pg_shard_t shard, ceph::ref_t<MOSDRepOp> op);
+  /// send what is held back for shard
+  void flush(pg_shard_t shard);
+  /// send what is held back for every shard
+  void flush();
+  /// drop what is held back, the interval changed
+  void clear() {
+    pending.clear();
+  }
+  bool empty() const {
+    return pending.empty();
+  }
+
+private:
+  struct Pending {
+    std::vector<ceph::ref_t<MOSDRepOp>> ops;
+    uint64_t bytes = 0;
+  };
+  send_t send_message;
+  std::map<pg_shard_t, Pending> pending;
+
+  void send_pending(pg_shard_t shard, Pending& p);
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "messages/MOSDOp.h"
 #include "messages/MOSDRepOp.h"
 #include "messages/MOSDRepOpReply.h"
+#include "messages/MOSDRepOpBatch.h"
 #include "messages/MOSDPGPush.h"
 #include "messages/MOSDPGPull.h"
 #include "messages/MOSDPGPushReply.h"
@@ -92,7 +93,8 @@ struct ReplicatedBackend::C_OSD_RepModifyCommit : public Context {
 
 static void log_subop_stats(
   PerfCounters *logger,
-  OpRequestRef op, int subop)
+  OpRequestRef op, int subop,
+  std::optional<uint64_t> inb_override = std::nullopt)
 {
   utime_t latency = ceph_clock_now();
   latency -= op->get_req()->get_recv_stamp();
@@ -103,7 +105,7 @@ static void log_subop_stats(
   logger->inc(subop);
 
   if (subop != l_osd_sop_pull) {
-    uint64_t inb = op->get_req()->get_data().length();
+    uint64_t inb = inb_override.value_or(op->get_req()->get_data().length());
     logger->inc(l_osd_sop_inb, inb);
     if (subop == l_osd_sop_w) {
       logger->inc(l_osd_sop_w_inb, inb);
@@ -124,7 +126,10 @@ ReplicatedBackend::ReplicatedBackend(
   ObjectStore::CollectionHandle &c,
   ObjectStore *store,
   CephContext *cct) :
-  PGBackend(cct, pg, store, coll, c) {}
+  PGBackend(cct, pg, store, coll, c),
+  repop_batcher([this](pg_shard_t shard, Message *m) {
+    send_repops(shard, m);
+  }) {}
 
 void ReplicatedBackend::run_recovery_op(
   PGBackend::RecoveryHandle *_h,
@@ -229,6 +234,11 @@ bool ReplicatedBackend::_handle_message(
     return true;
   }
 
+  case MSG_OSD_REPOP_BATCH: {
+    do_repop_batch(op);
+    return true;
+  }
+
   default:
     break;
   }
@@ -260,6 +270,8 @@ void ReplicatedBackend::on_change()
     op.second->on_commit = nullptr;
   }
   in_progress_ops.clear();
+  repop_batcher.clear();
+  repop_flush_scheduled = false;
   clear_recovery_state();
 }
 
@@ -650,6 +662,19 @@ int ReplicatedBackend::be_deep_scrub(
   }
 
   ceph_assert(poid == pos.ls[pos.pos]);
+  if (!pos.data_done() && pos.sampling) {
+    r = be_sample_data(poid, pos, cct->_conf->osd_deep_scrub_stride,
+		       fadvise_flags, o);
+    if (r == -EINPROGRESS || o.read_error) {
+      return r;
+    }
+    // unchanged since the previous deep scrub, the digest still holds
+    pos.data_pos = -1;
+    o.digest = be_get_object_info(o)->data_digest;
+    o.digest_present = true;
+    dout(20) << __func__ << "  " << poid << " done sampling data, digest 0x"
+	     << std::hex << o.digest << std::dec << dendl;
+  }
   if (!pos.data_done()) {
     if (pos.data_pos == 0) {
       pos.data_hash = bufferhash(-1);
@@ -932,15 +957,12 @@ void ReplicatedBackend::do_push_reply(OpRequestRef op)
   ceph_assert(m->get_type() == MSG_OSD_PG_PUSH_REPLY);
   pg_shard_t from = m->from;
 
-  vector<PushOp> replies(1);
+  vector<PushOp> replies;
   for (vector<PushReplyOp>::const_iterator i = m->replies.begin();
        i != m->replies.end();
        ++i) {
-    bool more = handle_push_reply(from, *i, &(replies.back()));
-    if (more)
-      replies.push_back(PushOp());
+    handle_push_reply(from, *i, &replies);
   }
-  replies.erase(replies.end() - 1);
 
   map<pg_shard_t, vector<PushOp> > _replies;
   _replies[from].swap(replies);
@@ -1031,6 +1053,7 @@ void ReplicatedBackend::issue_op(
     // avoid doing the same work in generate_subop
     bufferlist logs;
     encode(log_entries, logs);
+    const bool batch = should_batch_repops();
 
     for (const auto& shard : get_parent()->get_acting_recovery_backfill_shards()) {
       if (shard == parent->whoami_shard()) continue;
@@ -1053,20 +1076,92 @@ void ReplicatedBackend::issue_op(
 	  pinfo);
       if (op->op && op->op->pg_trace)
 	wr->trace.init("replicated op", nullptr, &op->op->pg_trace);
-      get_parent()->send_message_osd_cluster(
-	  shard.osd, wr, get_osdmap_epoch());
+      ceph::ref_t<MOSDRepOp> repop(static_cast<MOSDRepOp*>(wr), false);
+      if (!batch) {
+	// after what was held back before batching was turned off
+	repop_batcher.send(shard, std::move(repop));
+      } else if (repop_batcher.queue(
+		   shard, std::move(repop),
+		   cct->_conf.get_val<Option::size_t>(
+		     "osd_repop_batch_max_bytes")) &&
+		 !repop_flush_scheduled) {
+	repop_flush_scheduled = true;
+	get_parent()->schedule_batched_ops_flush(
+	  std::chrono::microseconds(
+	    cct->_conf.get_val<uint64_t>("osd_repop_batch_window_us")));
+      }
     }
   }
 }
 
+bool ReplicatedBackend::should_batch_repops() const
+{
+  // a peer on a release without MOSDRepOpBatch needs the legacy repop
+  // encoding, don't batch then either
+  return cct->_conf.get_val<uint64_t>("osd_repop_batch_window_us") > 0 &&
+    HAVE_FEATURE(parent->min_peer_features(), OSD_REPOP_MLCOD);
+}
+
+void ReplicatedBackend::send_repops(pg_shard_t shard, Message *m)
+{
+  dout(20) << __func__ << " " << *m << " to " << shard << dendl;
+  if (m->get_type() == MSG_OSD_REPOP_BATCH) {
+    auto logger = get_parent()->get_logger();
+    logger->inc(l_osd_sop_w_batch);
+    logger->inc(l_osd_sop_w_batched,
+		static_cast<MOSDRepOpBatch*>(m)->ops.size());
+  }
+  get_parent()->send_message_osd_cluster(shard.osd, m, get_osdmap_epoch());
+}
+
+void ReplicatedBackend::flush_batched_ops()
+{
+  repop_flush_scheduled = false;
+  repop_batcher.flush();
+}
+
 // sub op modify
 void ReplicatedBackend::do_repop(OpRequestRef op)
 {
-  static_cast<MOSDRepOp*>(op->get_nonconst_req())->finish_decode();
-  auto m = op->get_req<MOSDRepOp>();
+  auto m = ceph::ref_t<MOSDRepOp>(
+    static_cast<MOSDRepOp*>(op->get_nonconst_req()));
+  m->finish_decode();
   int msg_type = m->get_type();
   ceph_assert(MSG_OSD_REPOP == msg_type);
 
+  op->mark_started();
+  vector<ObjectStore::Transaction> tls;
+  tls.reserve(2);
+  prepare_repop(op, m, tls);
+  parent->queue_transactions(tls, op);
+  // op is cleaned up by oncommit/onapply when both are executed
+  dout(30) << __func__ << " missing after" << get_parent()->get_log().get_missing().get_items() << dendl;
+}
+
+void ReplicatedBackend::do_repop_batch(OpRequestRef op)
+{
+  auto m = op->get_req<MOSDRepOpBatch>();
+  ceph_assert(m->get_type() == MSG_OSD_REPOP_BATCH);
+  dout(10) << __func__ << " " << *m << dendl;
+
+  op->mark_started();
+  // one queue_transactions for the whole batch, each repop is still
+  // committed and replied to on its own
+  vector<ObjectStore::Transaction> tls;
+  tls.reserve(2 * m->ops.size());
+  for (auto &repop : m->ops) {
+    repop->finish_decode();
+    prepare_repop(op, repop, tls);
+  }
+  parent->queue_transactions(tls, op);
+  dout(30) << __func__ << " missing after" << get_parent()->get_log().get_missing().get_items() << dendl;
+}
+
+void ReplicatedBackend::prepare_repop(
+  OpRequestRef op,
+  const ceph::ref_t<MOSDRepOp> &m,
+  vector<ObjectStore::Transaction> &tls)
+{
   const hobject_t& soid = m->poid;
 
   dout(10) << __func__ << " " << soid
@@ -1084,10 +1179,9 @@ void ReplicatedBackend::do_repop(OpRequestRef op)
 
   int ackerosd = m->get_source().num();
 
-  op->mark_started();
-
   RepModifyRef rm(std::make_shared<RepModify>());
   rm->op = op;
+  rm->repop = m;
   rm->ackerosd = ackerosd;
   rm->last_complete = get_info().last_complete;
   rm->epoch_started = get_osdmap_epoch();
@@ -1153,13 +1247,8 @@ void ReplicatedBackend::do_repop(OpRequestRef op)
   rm->opt.register_on_commit(
     parent->bless_context(
       new C_OSD_RepModifyCommit(this, rm)));
-  vector<ObjectStore::Transaction> tls;
-  tls.reserve(2);
   tls.push_back(std::move(rm->localt));
   tls.push_back(std::move(rm->opt));
-  parent->queue_transactions(tls, op);
-  // op is cleaned up by oncommit/onapply when both are executed
-  dout(30) << __func__ << " missing after" << get_parent()->get_log().get_missing().get_items() << dendl;
 }
 
 void ReplicatedBackend::repop_commit(RepModifyRef rm)
@@ -1169,7 +1258,7 @@ void ReplicatedBackend::repop_commit(RepModifyRef rm)
   rm->committed = true;
 
   // send commit.
-  auto m = rm->op->get_req<MOSDRepOp>();
+  auto m = rm->repop.get();
   ceph_assert(m->get_type() == MSG_OSD_REPOP);
   dout(10) << __func__ << " on op " << *m
 	   << ", sending commit to osd." << rm->ackerosd
@@ -1188,7 +1277,9 @@ void ReplicatedBackend::repop_commit(RepModifyRef rm)
   get_parent()->send_message_osd_cluster(
     rm->ackerosd, reply, get_osdmap_epoch());
 
-  log_subop_stats(get_parent()->get_logger(), rm->op, l_osd_sop_w);
+  // rm->op may be a whole batch, count the data of this repop only
+  log_subop_stats(get_parent()->get_logger(), rm->op, l_osd_sop_w,
+		  m->get_data().length());
 }
 
 
@@ -1600,6 +1691,7 @@ int ReplicatedBackend::prep_push(
   if (r < 0)
     return r;
   push_info.recovery_progress = new_progress;
+  push_info.chunks_in_flight = 1;
   return 0;
 }
 
@@ -1963,6 +2055,12 @@ void ReplicatedBackend::handle_push(
 
 void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &pushes)
 {
+  flush_batched_ops();
+  // as many small pushes as backfill starts in one op count as one object
+  const uint64_t small_object_size =
+    cct->_conf.get_val<Option::size_t>("osd_backfill_small_object_size");
+  const uint64_t small_object_batch =
+    cct->_conf.get_val<uint64_t>("osd_backfill_small_object_batch");
   for (map<pg_shard_t, vector<PushOp> >::iterator i = pushes.begin();
        i != pushes.end();
        ++i) {
@@ -1975,6 +2073,7 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
     while (j != i->second.end()) {
       uint64_t cost = 0;
       uint64_t pushes = 0;
+      uint64_t small_pushes = 0;
       MOSDPGPush *msg = new MOSDPGPush();
       msg->from = get_parent()->whoami_shard();
       msg->pgid = get_parent()->primary_spg_t();
@@ -1989,8 +2088,17 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
 	   ++j) {
 	dout(20) << __func__ << ": sending push " << *j
 		 << " to osd." << i->first << dendl;
-	cost += j->cost(cct);
-	pushes += 1;
+	uint64_t push_cost = j->cost(cct);
+	cost += push_cost;
+	if (small_object_batch > 1 &&
+	    push_cost <= small_object_size + cct->_conf->osd_push_per_object_cost) {
+	  if (++small_pushes == small_object_batch) {
+	    small_pushes = 0;
+	    pushes += 1;
+	  }
+	} else {
+	  pushes += 1;
+	}
 	msg->pushes.push_back(*j);
       }
       msg->set_cost(cost);
@@ -2206,72 +2314,94 @@ void ReplicatedBackend::prep_push_op_blank(const hobject_t& soid, PushOp *op)
   op->soid = soid;
 }
 
-bool ReplicatedBackend::handle_push_reply(
-  pg_shard_t peer, const PushReplyOp &op, PushOp *reply)
+int ReplicatedBackend::fill_push_window(
+  push_info_t *push_info, vector<PushOp> *pushes, bool cache_dont_need)
+{
+  // the peer applies the chunks of an object in the order we send them,
+  // so the next ones can be read and sent before the previous are acked
+  const auto window = cct->_conf.get_val<uint64_t>("osd_recovery_push_window");
+  while (!push_info->recovery_progress.data_complete &&
+	 push_info->chunks_in_flight < window) {
+    dout(10) << " pushing more from, "
+	     << push_info->recovery_progress.data_recovered_to
+	     << " of " << push_info->recovery_info.copy_subset << dendl;
+    ObjectRecoveryProgress new_progress;
+    pushes->push_back(PushOp());
+    int r = build_push_op(
+      push_info->recovery_info,
+      push_info->recovery_progress, &new_progress, &pushes->back(),
+      &(push_info->stat), cache_dont_need);
+    if (r < 0) {
+      pushes->pop_back();
+      return r;
+    }
+    push_info->recovery_progress = new_progress;
+    ++push_info->chunks_in_flight;
+  }
+  return 0;
+}
+
+void ReplicatedBackend::handle_push_reply(
+  pg_shard_t peer, const PushReplyOp &op, vector<PushOp> *replies)
 {
   const hobject_t &soid = op.soid;
   if (pushing.count(soid) == 0) {
     dout(10) << "huh, i wasn't pushing " << soid << " to osd." << peer
 	     << ", or anybody else"
 	     << dendl;
-    return false;
+    return;
   } else if (pushing[soid].count(peer) == 0) {
     dout(10) << "huh, i wasn't pushing " << soid << " to osd." << peer
 	     << dendl;
-    return false;
+    return;
   } else {
     push_info_t *push_info = &pushing[soid][peer];
     bool error = pushing[soid].begin()->second.recovery_progress.error;
+    if (push_info->chunks_in_flight > 0)
+      --push_info->chunks_in_flight;
 
     if (!push_info->recovery_progress.data_complete && !error) {
-      dout(10) << " pushing more from, "
-	       << push_info->recovery_progress.data_recovered_to
-	       << " of " << push_info->recovery_info.copy_subset << dendl;
-      ObjectRecoveryProgress new_progress;
-      int r = build_push_op(
-	push_info->recovery_info,
-	push_info->recovery_progress, &new_progress, reply,
-	&(push_info->stat));
+      int r = fill_push_window(push_info, replies);
       // Handle the case of a read error right after we wrote, which is
       // hopefully extremely rare.
       if (r < 0) {
         dout(5) << __func__ << ": oid " << soid << " error " << r << dendl;
 
 	error = true;
-	goto done;
+	pushing[soid].begin()->second.recovery_progress.error = true;
       }
-      push_info->recovery_progress = new_progress;
-      return true;
-    } else {
-      // done!
-done:
+    }
+    if (push_info->chunks_in_flight > 0) {
+      // more to push, or acks of pipelined chunks still to come
+      return;
+    }
+
+    // done!
+    if (!error)
+      get_parent()->on_peer_recover( peer, soid, push_info->recovery_info);
+
+    get_parent()->release_locks(push_info->lock_manager);
+    object_stat_sum_t stat = push_info->stat;
+    eversion_t v = push_info->recovery_info.version;
+    pushing[soid].erase(peer);
+    push_info = nullptr;
+
+    if (pushing[soid].empty()) {
       if (!error)
-	get_parent()->on_peer_recover( peer, soid, push_info->recovery_info);
-
-      get_parent()->release_locks(push_info->lock_manager);
-      object_stat_sum_t stat = push_info->stat;
-      eversion_t v = push_info->recovery_info.version;
-      pushing[soid].erase(peer);
-      push_info = nullptr;
-
-      if (pushing[soid].empty()) {
-	if (!error)
-	  get_parent()->on_global_recover(soid, stat, false);
-	else
-	  get_parent()->on_failed_pull(
-	    std::set<pg_shard_t>{ get_parent()->whoami_shard() },
-	    soid,
-	    v);
-	pushing.erase(soid);
-      } else {
-	// This looks weird, but we erased the current peer and need to remember
-	// the error on any other one, while getting more acks.
-	if (error)
-	  pushing[soid].begin()->second.recovery_progress.error = true;
-	dout(10) << "pushed " << soid << ", still waiting for push ack from "
-		 << pushing[soid].size() << " others" << dendl;
-      }
-      return false;
+	get_parent()->on_global_recover(soid, stat, false);
+      else
+	get_parent()->on_failed_pull(
+	  std::set<pg_shard_t>{ get_parent()->whoami_shard() },
+	  soid,
+	  v);
+      pushing.erase(soid);
+    } else {
+      // This looks weird, but we erased the current peer and need to remember
+      // the error on any other one, while getting more acks.
+      if (error)
+	pushing[soid].begin()->second.recovery_progress.error = true;
+      dout(10) << "pushed " << soid << ", still waiting for push ack from "
+	       << pushing[soid].size() << " others" << dendl;
     }
   }
 }
@@ -2412,18 +2542,21 @@ int ReplicatedBackend::start_pushes(
   // If more than 1 read will occur ignore possible request to not cache
   bool cache = shards.size() == 1 ? h->cache_dont_need : false;
 
+  map<pg_shard_t, size_t> queued;
   for (auto j : shards) {
     pg_shard_t peer = j->first;
+    queued[peer] = h->pushes[peer].size();
     h->pushes[peer].push_back(PushOp());
     int r = prep_push_to_replica(obc, soid, peer,
 	    &(h->pushes[peer].back()), cache);
+    if (r >= 0) {
+      r = fill_push_window(&pushing[soid][peer], &h->pushes[peer], cache);
+    }
     if (r < 0) {
       // Back out all failed reads
-      for (auto k : shards) {
-	pg_shard_t p = k->first;
+      for (auto [p, n] : queued) {
 	dout(10) << __func__ << " clean up peer " << p << dendl;
-	h->pushes[p].pop_back();
-	if (p == peer) break;
+	h->pushes[p].resize(n);
       }
       return r;
     }
@@ -16,6 +16,8 @@
 #define REPBACKEND_H
 
 #include "PGBackend.h"
+#include "messages/MOSDRepOp.h"
+#include "RepOpBatcher.h"
 
 struct C_ReplicatedBackend_OnPullComplete;
 class ReplicatedBackend : public PGBackend {
@@ -161,8 +163,10 @@ private:
     ObjectContextRef obc;
     object_stat_sum_t stat;
     ObcLockManager lock_manager;
+    unsigned chunks_in_flight = 0;
 
     void dump(ceph::Formatter *f) const {
+      f->dump_unsigned("chunks_in_flight", chunks_in_flight);
       {
 	f->open_object_section("recovery_progress");
 	recovery_progress.dump(f);
@@ -229,7 +233,8 @@ private:
   void do_pull(OpRequestRef op);
   void do_push_reply(OpRequestRef op);
 
-  bool handle_push_reply(pg_shard_t peer, const PushReplyOp &op, PushOp *reply);
+  void handle_push_reply(pg_shard_t peer, const PushReplyOp &op,
+			 std::vector<PushOp> *replies);
   void handle_pull(pg_shard_t peer, PullOp &op, PushOp *reply);
 
   struct pull_complete_info {
@@ -295,6 +300,8 @@ private:
   int prep_push_to_replica(
     ObjectContextRef obc, const hobject_t& soid, pg_shard_t peer,
     PushOp *pop, bool cache_dont_need = true);
+  int fill_push_window(push_info_t *push_info, std::vector<PushOp> *pushes,
+		       bool cache_dont_need = true);
   int prep_push(
     ObjectContextRef obc,
     const hobject_t& oid, pg_shard_t dest,
@@ -396,9 +403,25 @@ private:
   void op_commit(const ceph::ref_t<InProgressOp>& op);
   void do_repop_reply(OpRequestRef op);
   void do_repop(OpRequestRef op);
+  void do_repop_batch(OpRequestRef op);
+  void prepare_repop(
+    OpRequestRef op,
+    const ceph::ref_t<MOSDRepOp> &m,
+    std::vector<ObjectStore::Transaction> &tls);
+
+  RepOpBatcher repop_batcher;
+  bool repop_flush_scheduled = false;
+
+  bool should_batch_repops() const;
+  /// send a MOSDRepOp or MOSDRepOpBatch of repop_batcher
+  void send_repops(pg_shard_t shard, Message *m);
+public:
+  void flush_batched_ops() override;
+private:
 
   struct RepModify {
     OpRequestRef op;
+    ceph::ref_t<MOSDRepOp> repop; ///< may be one of a batch in op
     bool committed;
     int ackerosd;
     eversion_t last_complete;
@@ -423,6 +446,10 @@ private:
     ScrubMapBuilder &pos,
     ScrubMap::object &o) override;
 
+  bool be_can_sample_data(const object_info_t &oi) const override {
+    return store->has_builtin_csum() && oi.is_data_digest();
+  }
+
   uint64_t be_get_ondisk_size(uint64_t logical_size) const final {
     return logical_size;
   }
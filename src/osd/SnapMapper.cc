@@ -504,6 +504,122 @@ int SnapMapper::update_snaps(
   return 0;
 }
 
+string SnapMapper::get_owned_prefix(const hobject_t &oid) const
+{
+  string key = shard_prefix + oid.to_str();
+  for (auto& prefix : prefixes) {
+    if (key.compare(0, prefix.size(), prefix) == 0) {
+      return prefix;
+    }
+  }
+  return string();
+}
+
+int SnapMapper::update_snaps_batch(
+  const vector<pair<hobject_t, set<snapid_t>>> &updates,
+  MapCacher::Transaction<std::string, ceph::buffer::list> *t)
+{
+  map<string, ceph::buffer::list> to_set;
+  map<string, string> to_remove;
+  for (auto& [oid, new_snaps] : updates) {
+    dout(20) << __func__ << " " << oid << " " << new_snaps << dendl;
+    ceph_assert(check(oid));
+    object_snaps out;
+    int r = get_snaps(oid, &out);
+    // Tolerate missing keys but not disk errors
+    if (r < 0 && r != -ENOENT)
+      return r;
+    // an oid outside of the prefixes is never removed as part of a range
+    const string prefix = get_owned_prefix(oid);
+    auto owned = [&prefix](const string &key_prefix) {
+      return prefix.empty() ? string() : key_prefix + prefix;
+    };
+    if (new_snaps.empty()) {
+      if (r == -ENOENT) {
+	dout(10) << __func__ << " " << oid << " not mapped, skipping" << dendl;
+	continue;
+      }
+      to_remove.emplace(to_object_key(oid), owned(OBJECT_PREFIX));
+    } else {
+      object_snaps in(oid, new_snaps);
+      encode(in, to_set[to_object_key(oid)]);
+    }
+    for (auto snap : out.snaps) {
+      if (!new_snaps.count(snap)) {
+	to_remove.emplace(to_raw_key(make_pair(snap, oid)),
+			  owned(get_prefix(oid.pool, snap)));
+      }
+    }
+  }
+  if (g_conf()->subsys.should_gather<ceph_subsys_osd, 20>()) {
+    for (auto& i : to_set) {
+      dout(20) << __func__ << " set " << i.first << dendl;
+    }
+  }
+  // set first, so that the walk over the removed keys sees these
+  if (!to_set.empty()) {
+    backend.set_keys(to_set, t);
+  }
+  return remove_keys_as_ranges(to_remove, t);
+}
+
+int SnapMapper::remove_keys_as_ranges(
+  const map<string, string> &to_remove,
+  MapCacher::Transaction<std::string, ceph::buffer::list> *t)
+{
+  // Keys of other PGs may be in flight on other sequencers without being
+  // visible here, so a range must not leave the prefix the key space of
+  // this PG is made of.  Find the runs first, so that a read error does
+  // not leave a partial removal in t.
+  vector<set<string>> runs;
+  set<string> singles;
+  set<string> run;
+  string run_prefix;
+  auto close_run = [&] {
+    if (run.size() > 1) {
+      runs.push_back(std::move(run));
+    } else {
+      singles.merge(run);
+    }
+    run.clear();
+  };
+  for (auto& [key, prefix] : to_remove) {
+    if (!run.empty()) {
+      bool adjacent = false;
+      if (!prefix.empty() && prefix == run_prefix) {
+	pair<string, ceph::buffer::list> next;
+	int r = backend.get_next(*run.rbegin(), &next);
+	if (r < 0 && r != -ENOENT)
+	  return r;
+	adjacent = (r == 0 && next.first == key);
+      }
+      if (!adjacent) {
+	close_run();
+      }
+    }
+    run.insert(key);
+    run_prefix = prefix;
+  }
+  close_run();
+
+  for (auto& keys : runs) {
+    // the smallest key past the last one of the run
+    string last = *keys.rbegin() + '\0';
+    dout(20) << __func__ << " rm [" << *keys.begin() << ", " << *keys.rbegin()
+	     << "] (" << keys.size() << " keys)" << dendl;
+    backend.remove_range(keys, *keys.begin(), last, t);
+  }
+  if (!singles.empty()) {
+    if (g_conf()->subsys.should_gather<ceph_subsys_osd, 20>()) {
+      for (auto& i : singles) {
+	dout(20) << __func__ << " rm " << i << dendl;
+      }
+    }
+    backend.remove_keys(singles, t);
+  }
+  return 0;
+}
+
 void SnapMapper::add_oid(
   const hobject_t &oid,
   const set<snapid_t>& snaps,
@@ -66,6 +66,11 @@ public:
       const std::set<std::string> &to_remove) override {
       t->omap_rmkeys(cid, hoid, to_remove);
     }
+    void remove_range(
+      const std::string &first,
+      const std::string &last) override {
+      t->omap_rmkeyrange(cid, hoid, first, last);
+    }
     void add_callback(
       Context *c) override {
       t->register_on_applied(c);
@@ -277,6 +282,16 @@ private:
     MapCacher::Transaction<std::string, ceph::buffer::list> *t ///< [out] transaction
     );
 
+  /// The one of prefixes oid falls under, empty if none
+  std::string get_owned_prefix(const hobject_t &oid) const;
+
+  /// Remove keys, runs of them adjacent in the store and under the same
+  /// prefix of this PG as ranges
+  int remove_keys_as_ranges(
+    const std::map<std::string, std::string> &to_remove, ///< [in] key -> prefix
+    MapCacher::Transaction<std::string, ceph::buffer::list> *t ///< [out] transaction
+    ); ///< @return error, 0 on success
+
   /// Get snaps (as an 'object_snaps' object) for oid
   tl::expected<object_snaps, SnapMapReaderI::result_t> get_snaps_common(
     const hobject_t &hoid) const;
@@ -333,6 +348,21 @@ private:
     MapCacher::Transaction<std::string, ceph::buffer::list> *t ///< [out] transaction
     ); ///@ return error, 0 on success
 
+  /**
+   * Update snaps for several distinct oids, e.g. the clones trimmed together
+   *
+   * Same as update_snaps() for each of them, where an empty set of snaps
+   * removes the mapping and oids that are not mapped are skipped.  The
+   * mapping keys of one snap sort together, so the keys of the clones
+   * trimmed from a snap mostly form a run in the store; such runs are
+   * removed as a range, which the store may turn into a single range
+   * tombstone rather than one tombstone per key.
+   */
+  int update_snaps_batch(
+    const std::vector<std::pair<hobject_t, std::set<snapid_t>>> &updates,
+    MapCacher::Transaction<std::string, ceph::buffer::list> *t ///< [out] transaction
+    ); ///@ return error, 0 on success
+
   /// Add mapping for oid, must not already be mapped
   void add_oid(
     const hobject_t &oid,       ///< [in] oid to add
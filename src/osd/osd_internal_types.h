@@ -4,6 +4,9 @@
 #ifndef CEPH_OSD_INTERNAL_TYPES_H
 #define CEPH_OSD_INTERNAL_TYPES_H
 
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/set.hpp>
+
 #include "osd_types.h"
 #include "OpRequest.h"
 #include "object_state.h"
@@ -190,6 +193,14 @@ public:
   /// in-progress copyfrom ops for this object
   bool blocked;
   bool requeue_scrub_on_unblock;    // true if we need to requeue scrub on unblock
+
+  // ObjectContextCache bookkeeping, protected by the cache shard lock
+  boost::intrusive::set_member_hook<> cache_set_hook;
+  boost::intrusive::list_member_hook<> cache_lru_hook;
+  std::pair<spg_t, hobject_t> cache_key;
+  std::weak_ptr<ObjectContext> cache_ref; ///< last reference handed out
+  unsigned cache_refs = 0;   ///< references handed out and not yet released
+  bool cache_keep = false;   ///< cache once unreferenced rather than free
 };
 
 inline std::ostream& operator<<(std::ostream& out, const ObjectState& obs)
@@ -80,6 +80,9 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_time_avg(
     l_osd_op_r_prepare_lat, "op_r_prepare_latency",
     "Latency of read operations (excluding queue time and wait for finished)");
+  osd_plb.add_u64_counter(
+    l_osd_op_r_unlocked, "op_r_unlocked",
+    "Client read operations served without holding the PG lock");
   osd_plb.add_u64_counter(
     l_osd_op_w, "op_w", "Client write operations");
   osd_plb.add_u64_counter(
@@ -144,6 +147,14 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     l_osd_sop_w_inb, "subop_w_in_bytes", "Replicated written data size", NULL, 0, unit_t(UNIT_BYTES));
   osd_plb.add_time_avg(
     l_osd_sop_w_lat, "subop_w_latency", "Replicated writes latency");
+  osd_plb.add_u64_counter(
+    l_osd_sop_w_batch, "subop_w_batch", "Batches of replicated writes sent");
+  osd_plb.add_u64_counter(
+    l_osd_sop_w_batched, "subop_w_batched",
+    "Replicated writes sent as part of a batch");
+  osd_plb.add_u64_counter(
+    l_osd_sop_ec_read_hedge, "subop_ec_read_hedge",
+    "Erasure coded reads also sent to an extra shard");
   osd_plb.add_u64_counter(
     l_osd_sop_pull, "subop_pull", "Suboperations pull requests");
   osd_plb.add_time_avg(
@@ -169,6 +180,10 @@ PerfCounters *build_osd_logger(CephContext *cct) {
    "recovery bytes",
    "rbt", PerfCountersBuilder::PRIO_INTERESTING);
 
+  osd_plb.add_u64(
+    l_osd_recovery_max_active, "recovery_max_active",
+    "Recovery ops allowed in flight by the adaptive limit");
+
   osd_plb.add_time_avg(
     l_osd_recovery_push_queue_lat,
     "l_osd_recovery_push_queue_latency",
@@ -302,6 +317,9 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     l_osd_object_ctx_cache_hit, "object_ctx_cache_hit", "Object context cache hits");
   osd_plb.add_u64_counter(
     l_osd_object_ctx_cache_total, "object_ctx_cache_total", "Object context cache lookups");
+  osd_plb.add_u64_counter(
+    l_osd_object_ctx_cache_miss, "object_ctx_cache_miss",
+    "Object context cache misses, loaded from the object store");
 
   osd_plb.add_u64_counter(l_osd_op_cache_hit, "op_cache_hit");
   osd_plb.add_time_avg(
@@ -319,6 +337,36 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_pg_split, "pg_split", "PGs created by splitting a PG");
+  osd_plb.add_time_avg(
+    l_osd_pg_split_lat, "pg_split_latency",
+    "Time a PG spent splitting into its children, blocking its ops");
+  osd_plb.add_time_avg(
+    l_osd_pg_split_ready_lat, "pg_split_ready_latency",
+    "Time from the split of a PG until its children serve ops");
+
+  osd_plb.add_u64_counter(
+    l_osd_peering_batched, "peering_batched",
+    "PG notifies and infos sent batched with those of other PGs");
+  osd_plb.add_u64_counter(
+    l_osd_pg_map_reuse, "pg_map_reuse",
+    "PG up and acting sets reused from the previous epoch on map advance");
+
+  osd_plb.add_u64(
+    l_osd_hb_channel_peers, "heartbeat_channel_peers",
+    "Heartbeat peers pinged on the heartbeat channel only");
+
+  osd_plb.add_u64_counter(
+    l_osd_read_cache_hit, "read_cache_hit",
+    "Whole object reads served from the object read cache");
+  osd_plb.add_u64_counter(
+    l_osd_read_cache_miss, "read_cache_miss",
+    "Whole object reads of cacheable objects that missed the read cache");
+  osd_plb.add_u64(
+    l_osd_read_cache_bytes, "read_cache_bytes",
+    "Object data held in the object read cache", NULL, 0, unit_t(UNIT_BYTES));
+
   return osd_plb.create_perf_counters();
 }
  
@@ -21,6 +21,7 @@ enum {
   l_osd_op_r_lat_outb_hist,
   l_osd_op_r_process_lat,
   l_osd_op_r_prepare_lat,
+  l_osd_op_r_unlocked,
   l_osd_op_w,
   l_osd_op_w_inb,
   l_osd_op_w_lat,
@@ -48,6 +49,9 @@ enum {
   l_osd_sop_w,
   l_osd_sop_w_inb,
   l_osd_sop_w_lat,
+  l_osd_sop_w_batch,
+  l_osd_sop_w_batched,
+  l_osd_sop_ec_read_hedge,
   l_osd_sop_pull,
   l_osd_sop_pull_lat,
   l_osd_sop_push,
@@ -60,6 +64,7 @@ enum {
 
   l_osd_rop,
   l_osd_rbytes,
+  l_osd_recovery_max_active,
 
   l_osd_recovery_push_queue_lat,
   l_osd_recovery_push_reply_queue_lat,
@@ -121,6 +126,7 @@ enum {
 
   l_osd_object_ctx_cache_hit,
   l_osd_object_ctx_cache_total,
+  l_osd_object_ctx_cache_miss,
 
   l_osd_op_cache_hit,
   l_osd_tier_flush_lat,
@@ -131,6 +137,19 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_pg_split,
+  l_osd_pg_split_lat,
+  l_osd_pg_split_ready_lat,
+
+  l_osd_peering_batched,
+  l_osd_pg_map_reuse,
+
+  l_osd_hb_channel_peers,
+
+  l_osd_read_cache_hit,
+  l_osd_read_cache_miss,
+  l_osd_read_cache_bytes,
+
   l_osd_last,
 };
 
@@ -3431,7 +3431,7 @@ void pool_stat_t::generate_test_instances(list<pool_stat_t*>& o)
 
 void pg_history_t::encode(ceph::buffer::list &bl) const
 {
-  ENCODE_START(10, 4, bl);
+  ENCODE_START(11, 4, bl);
   encode(epoch_created, bl);
   encode(last_epoch_started, bl);
   encode(last_epoch_clean, bl);
@@ -3449,12 +3449,14 @@ void pg_history_t::encode(ceph::buffer::list &bl) const
   encode(last_interval_clean, bl);
   encode(epoch_pool_created, bl);
   encode(prior_readable_until_ub, bl);
+  encode(last_deep_scrub_start, bl);
+  encode(last_deep_scrub_recovered, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_history_t::decode(ceph::buffer::list::const_iterator &bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(10, 4, 4, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(11, 4, 4, bl);
   decode(epoch_created, bl);
   decode(last_epoch_started, bl);
   if (struct_v >= 3)
@@ -3502,6 +3504,10 @@ void pg_history_t::decode(ceph::buffer::list::const_iterator &bl)
   if (struct_v >= 10) {
     decode(prior_readable_until_ub, bl);
   }
+  if (struct_v >= 11) {
+    decode(last_deep_scrub_start, bl);
+    decode(last_deep_scrub_recovered, bl);
+  }
   DECODE_FINISH(bl);
 }
 
@@ -3523,6 +3529,8 @@ void pg_history_t::dump(Formatter *f) const
   f->dump_stream("last_deep_scrub") << last_deep_scrub;
   f->dump_stream("last_deep_scrub_stamp") << last_deep_scrub_stamp;
   f->dump_stream("last_clean_scrub_stamp") << last_clean_scrub_stamp;
+  f->dump_stream("last_deep_scrub_start") << last_deep_scrub_start;
+  f->dump_int("last_deep_scrub_recovered", last_deep_scrub_recovered);
   f->dump_float(
     "prior_readable_until_ub",
     std::chrono::duration<double>(prior_readable_until_ub).count());
@@ -3549,6 +3557,8 @@ void pg_history_t::generate_test_instances(list<pg_history_t*>& o)
   o.back()->last_deep_scrub_stamp = utime_t(14, 15);
   o.back()->last_clean_scrub_stamp = utime_t(16, 17);
   o.back()->last_epoch_marked_full = 18;
+  o.back()->last_deep_scrub_start = eversion_t(12, 10);
+  o.back()->last_deep_scrub_recovered = 19;
 }
 
 
@@ -5143,6 +5153,162 @@ std::ostream& operator<<(std::ostream& out, const pg_log_dup_t& e) {
   return out << ")";
 }
 
+// -- pg_log_dups_t --
+
+uint32_t pg_log_dups_t::get_client(const osd_reqid_t& reqid)
+{
+  auto [p, inserted] = client_ids.try_emplace(
+    std::make_pair(reqid.name, reqid.inc), 0);
+  if (inserted) {
+    if (free_clients.empty()) {
+      p->second = clients.size();
+      clients.emplace_back();
+    } else {
+      p->second = free_clients.back();
+      free_clients.pop_back();
+    }
+    auto& c = clients[p->second];
+    c.name = reqid.name;
+    c.inc = reqid.inc;
+  }
+  ++clients[p->second].refs;
+  return p->second;
+}
+
+void pg_log_dups_t::put_client(uint32_t id)
+{
+  auto& c = clients[id];
+  ceph_assert(c.refs > 0);
+  if (--c.refs == 0) {
+    client_ids.erase(std::make_pair(c.name, c.inc));
+    free_clients.push_back(id);
+  }
+}
+
+void pg_log_dups_t::grow()
+{
+  decltype(rows) bigger(std::max<size_t>(8, rows.size() * 2));
+  for (size_t i = 0; i < count; ++i) {
+    bigger[i] = row(i);
+  }
+  rows.swap(bigger);
+  head = 0;
+}
+
+void pg_log_dups_t::push(const pg_log_dup_t& e, bool front)
+{
+  if (count == rows.size()) {
+    grow();
+  }
+  row_t r;
+  r.tid = e.reqid.tid;
+  r.version = e.version.version;
+  r.user_version = e.user_version;
+  r.client = get_client(e.reqid);
+  r.epoch = e.version.epoch;
+  r.return_code = e.return_code;
+  seq_t seq;
+  if (front) {
+    head = (head + rows.size() - 1) % rows.size();
+    rows[head] = r;
+    ++count;
+    seq = --front_seq;
+  } else {
+    rows[(head + count) % rows.size()] = r;
+    ++count;
+    seq = get_back_seq();
+  }
+  if (!e.op_returns.empty()) {
+    op_returns[seq] = e.op_returns;
+  }
+}
+
+void pg_log_dups_t::pop(bool front)
+{
+  ceph_assert(!empty());
+  seq_t seq;
+  if (front) {
+    seq = front_seq++;
+    put_client(row(0).client);
+    head = (head + 1) % rows.size();
+  } else {
+    seq = get_back_seq();
+    put_client(row(count - 1).client);
+  }
+  --count;
+  if (!op_returns.empty()) {
+    op_returns.erase(seq);
+  }
+}
+
+void pg_log_dups_t::clear()
+{
+  decltype(rows)().swap(rows);
+  head = 0;
+  count = 0;
+  op_returns.clear();
+  clients.clear();
+  free_clients.clear();
+  client_ids.clear();
+  front_seq = first_seq;
+}
+
+osd_reqid_t pg_log_dups_t::get_reqid(size_t i) const
+{
+  auto& r = row(i);
+  auto& c = clients[r.client];
+  return osd_reqid_t(c.name, c.inc, r.tid);
+}
+
+pg_log_dup_t pg_log_dups_t::operator[](size_t i) const
+{
+  auto& r = row(i);
+  pg_log_dup_t e(eversion_t(r.epoch, r.version), r.user_version,
+		 get_reqid(i), r.return_code);
+  if (!op_returns.empty()) {
+    if (auto p = op_returns.find(front_seq + i); p != op_returns.end()) {
+      e.op_returns = p->second;
+    }
+  }
+  return e;
+}
+
+void pg_log_dups_t::encode(ceph::buffer::list &bl) const
+{
+  using ceph::encode;
+  __u32 n = size();
+  encode(n, bl);
+  for (size_t i = 0; i < n; ++i) {
+    encode((*this)[i], bl);
+  }
+}
+
+void pg_log_dups_t::decode(ceph::buffer::list::const_iterator &bl)
+{
+  using ceph::decode;
+  clear();
+  __u32 n;
+  decode(n, bl);
+  while (n--) {
+    pg_log_dup_t e;
+    decode(e, bl);
+    push_back(e);
+  }
+}
+
+bool pg_log_dups_t::operator==(const pg_log_dups_t &rhs) const
+{
+  if (size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < size(); ++i) {
+    if ((*this)[i] != rhs[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 
 // -- pg_log_t --
 
@@ -5266,12 +5432,13 @@ static void _handle_dups(CephContext* cct, pg_log_t &target, const pg_log_t &oth
   lgeneric_subdout(cct, osd, 20) << __func__ << " earliest_dup_version "
 				 << earliest_dup_version << dendl;
 
-  for (auto d = other.dups.cbegin(); d != other.dups.cend(); ++d) {
-    if (d->version.version >= earliest_dup_version) {
+  for (size_t i = 0; i < other.dups.size(); ++i) {
+    if (auto v = other.dups.get_version(i);
+	v.version >= earliest_dup_version) {
       lgeneric_subdout(cct, osd, 20)
 	      << "copy_up_to/copy_after copy dup version "
-	      << d->version << dendl;
-      target.dups.push_back(pg_log_dup_t(*d));
+	      << v << dendl;
+      target.dups.push_back(other.dups[i]);
     }
   }
 
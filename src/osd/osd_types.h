@@ -2799,6 +2799,13 @@ struct pg_history_t {
   utime_t last_scrub_stamp;
   utime_t last_deep_scrub_stamp;
   utime_t last_clean_scrub_stamp;
+  /// the PG's version when the last deep scrub started, objects not
+  /// modified after it were deep scrubbed; zero if unknown
+  eversion_t last_deep_scrub_start;
+  /// the PG's num_objects_recovered when the last deep scrub finished:
+  /// recovered and backfilled objects keep their version, so the next deep
+  /// scrub may only rely on last_deep_scrub_start if it is unchanged
+  int64_t last_deep_scrub_recovered = 0;
 
   /// upper bound on how long prior interval readable (relative to encode time)
   ceph::timespan prior_readable_until_ub = ceph::timespan::zero();
@@ -2821,6 +2828,8 @@ struct pg_history_t {
       l.last_scrub_stamp == r.last_scrub_stamp &&
       l.last_deep_scrub_stamp == r.last_deep_scrub_stamp &&
       l.last_clean_scrub_stamp == r.last_clean_scrub_stamp &&
+      l.last_deep_scrub_start == r.last_deep_scrub_start &&
+      l.last_deep_scrub_recovered == r.last_deep_scrub_recovered &&
       l.prior_readable_until_ub == r.prior_readable_until_ub;
   }
 
@@ -2897,6 +2906,12 @@ struct pg_history_t {
       last_deep_scrub_stamp = other.last_deep_scrub_stamp;
       modified = true;
     }
+    if (other.last_deep_scrub_start > last_deep_scrub_start) {
+      // both describe the same deep scrub
+      last_deep_scrub_start = other.last_deep_scrub_start;
+      last_deep_scrub_recovered = other.last_deep_scrub_recovered;
+      modified = true;
+    }
     if (other.last_clean_scrub_stamp > last_clean_scrub_stamp) {
       last_clean_scrub_stamp = other.last_clean_scrub_stamp;
       modified = true;
@@ -4429,6 +4444,217 @@ WRITE_CLASS_ENCODER(pg_log_dup_t)
 
 std::ostream& operator<<(std::ostream& out, const pg_log_dup_t& e);
 
+/**
+ * pg_log_dups_t - the dup entries of a pg log, oldest first
+ *
+ * Each PG keeps up to osd_pg_log_dups_tracked of these, so they make up
+ * most of the in-memory pg log.  Rather than a list of pg_log_dup_t, the
+ * fixed-size part of the entries is packed in rows of a single ring
+ * buffer (accounted to the osd_pglog mempool, and not allocated at all
+ * while empty), and the client part of the reqid (name and incarnation)
+ * is interned as a PG sees the same clients over and over.  op_returns
+ * are rare and kept aside.
+ *
+ * Entries are handed out as pg_log_dup_t values.  Each entry also has a
+ * sequence number that does not change while it stays in the container,
+ * which is what IndexedLog::dup_index refers to.
+ */
+class pg_log_dups_t {
+public:
+  using seq_t = uint64_t;
+
+private:
+  struct row_t {
+    ceph_tid_t tid;
+    version_t version;
+    version_t user_version;
+    uint32_t client;                ///< index into clients
+    epoch_t epoch;
+    int32_t return_code;
+  } __attribute__ ((packed));
+
+  struct client_t {
+    entity_name_t name;
+    int32_t inc = 0;
+    uint32_t refs = 0;
+  };
+
+  mempool::osd_pglog::vector<row_t> rows;  ///< ring buffer, grown by doubling
+  size_t head = 0;                  ///< position of the front entry in rows
+  size_t count = 0;
+  mempool::osd_pglog::map<seq_t, std::vector<pg_log_op_return_item_t>>
+    op_returns;
+
+  mempool::osd_pglog::vector<client_t> clients;
+  mempool::osd_pglog::vector<uint32_t> free_clients;
+  mempool::osd_pglog::map<std::pair<entity_name_t, int32_t>, uint32_t>
+    client_ids;
+
+  /// leave room to push_front() below the first sequence number
+  static constexpr seq_t first_seq = seq_t(1) << 62;
+  seq_t front_seq = first_seq;
+
+  uint32_t get_client(const osd_reqid_t& reqid);
+  void put_client(uint32_t id);
+  const row_t& row(size_t i) const {
+    return rows[(head + i) % rows.size()];
+  }
+  void grow();
+  void push(const pg_log_dup_t& e, bool front);
+  void pop(bool front);
+
+public:
+  class const_iterator {
+    const pg_log_dups_t *dups = nullptr;
+    ssize_t pos = 0;
+    int step = 1;                   ///< -1 for the reverse iterators
+
+    struct arrow_proxy {
+      pg_log_dup_t e;
+      const pg_log_dup_t* operator->() const {
+	return &e;
+      }
+    };
+
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = pg_log_dup_t;
+    using difference_type = ssize_t;
+    using pointer = void;
+    using reference = pg_log_dup_t;
+
+    const_iterator() = default;
+    const_iterator(const pg_log_dups_t *dups, ssize_t pos, int step)
+      : dups(dups), pos(pos), step(step) {}
+
+    pg_log_dup_t operator*() const {
+      return (*dups)[pos];
+    }
+    arrow_proxy operator->() const {
+      return arrow_proxy{(*dups)[pos]};
+    }
+    const_iterator& operator++() {
+      pos += step;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto r = *this;
+      pos += step;
+      return r;
+    }
+    const_iterator& operator--() {
+      pos -= step;
+      return *this;
+    }
+    const_iterator operator--(int) {
+      auto r = *this;
+      pos -= step;
+      return r;
+    }
+    bool operator==(const const_iterator& rhs) const {
+      return pos == rhs.pos;
+    }
+    bool operator!=(const const_iterator& rhs) const {
+      return pos != rhs.pos;
+    }
+    /// sequence number of the entry this refers to
+    seq_t get_seq() const {
+      return dups->front_seq + pos;
+    }
+  };
+  using iterator = const_iterator;
+  using reverse_iterator = const_iterator;
+  using const_reverse_iterator = const_iterator;
+
+  size_t size() const {
+    return count;
+  }
+  bool empty() const {
+    return count == 0;
+  }
+  void clear();
+
+  pg_log_dup_t operator[](size_t i) const;
+  pg_log_dup_t front() const {
+    return (*this)[0];
+  }
+  pg_log_dup_t back() const {
+    return (*this)[size() - 1];
+  }
+  /// the version of an entry, without building a pg_log_dup_t
+  eversion_t get_version(size_t i) const {
+    auto& r = row(i);
+    return eversion_t(r.epoch, r.version);
+  }
+
+  void push_back(const pg_log_dup_t& e) {
+    push(e, false);
+  }
+  void push_front(const pg_log_dup_t& e) {
+    push(e, true);
+  }
+  void pop_front() {
+    pop(true);
+  }
+  void pop_back() {
+    pop(false);
+  }
+
+  seq_t get_front_seq() const {
+    return front_seq;
+  }
+  seq_t get_back_seq() const {
+    return front_seq + size() - 1;
+  }
+  /// true if seq refers to an entry that is still here
+  bool contains(seq_t seq) const {
+    return seq >= front_seq && seq - front_seq < size();
+  }
+  /// the entry seq refers to, none if it is gone
+  std::optional<pg_log_dup_t> at_seq(seq_t seq) const {
+    if (!contains(seq)) {
+      return std::nullopt;
+    }
+    return (*this)[seq - front_seq];
+  }
+  osd_reqid_t get_reqid(size_t i) const;
+
+  const_iterator begin() const {
+    return const_iterator(this, 0, 1);
+  }
+  const_iterator end() const {
+    return const_iterator(this, size(), 1);
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  const_iterator cend() const {
+    return end();
+  }
+  const_iterator rbegin() const {
+    return const_iterator(this, (ssize_t)size() - 1, -1);
+  }
+  const_iterator rend() const {
+    return const_iterator(this, -1, -1);
+  }
+  const_iterator crbegin() const {
+    return rbegin();
+  }
+  const_iterator crend() const {
+    return rend();
+  }
+
+  // encoded as a list of pg_log_dup_t
+  void encode(ceph::buffer::list &bl) const;
+  void decode(ceph::buffer::list::const_iterator &bl);
+
+  bool operator==(const pg_log_dups_t &rhs) const;
+  bool operator!=(const pg_log_dups_t &rhs) const {
+    return !(*this == rhs);
+  }
+};
+WRITE_CLASS_ENCODER(pg_log_dups_t)
+
 /**
  * pg_log_t - incremental log of recent pg changes.
  *
@@ -4457,7 +4683,7 @@ public:
   mempool::osd_pglog::list<pg_log_entry_t> log;
 
   // entries just for dup op detection ordered oldest to newest
-  mempool::osd_pglog::list<pg_log_dup_t> dups;
+  pg_log_dups_t dups;
 
   pg_log_t() = default;
   pg_log_t(const eversion_t &last_update,
@@ -4465,7 +4691,7 @@ public:
 	   const eversion_t &can_rollback_to,
 	   const eversion_t &rollback_info_trimmed_to,
 	   mempool::osd_pglog::list<pg_log_entry_t> &&entries,
-	   mempool::osd_pglog::list<pg_log_dup_t> &&dup_entries)
+	   pg_log_dups_t &&dup_entries)
     : head(last_update), tail(log_tail), can_rollback_to(can_rollback_to),
       rollback_info_trimmed_to(rollback_info_trimmed_to),
       log(std::move(entries)), dups(std::move(dup_entries)) {}
@@ -4474,15 +4700,13 @@ public:
 	   const eversion_t &can_rollback_to,
 	   const eversion_t &rollback_info_trimmed_to,
 	   const std::list<pg_log_entry_t> &entries,
-	   const std::list<pg_log_dup_t> &dup_entries)
+	   pg_log_dups_t &&dup_entries)
     : head(last_update), tail(log_tail), can_rollback_to(can_rollback_to),
-      rollback_info_trimmed_to(rollback_info_trimmed_to) {
+      rollback_info_trimmed_to(rollback_info_trimmed_to),
+      dups(std::move(dup_entries)) {
     for (auto &&entry: entries) {
       log.push_back(entry);
     }
-    for (auto &&entry: dup_entries) {
-      dups.push_back(entry);
-    }
   }
 
   void clear() {
@@ -4575,11 +4799,11 @@ public:
 
     // sort and merge dups
     std::multimap<eversion_t,pg_log_dup_t> sorted;
-    for (auto& d : dups) {
+    for (const auto& d : dups) {
       sorted.emplace(d.version, d);
     }
     for (auto l : slogs) {
-      for (auto& d : l->dups) {
+      for (const auto& d : l->dups) {
 	sorted.emplace(d.version, d);
       }
     }
@@ -6187,6 +6411,10 @@ WRITE_CLASS_ENCODER(ScrubMap)
 
 struct ScrubMapBuilder {
   bool deep = false;
+  /// if set, a deep scrub only samples the data of the objects not modified
+  /// after this version and which have a persisted digest
+  eversion_t incremental_since;
+  uint32_t sample_seed = 0;  ///< picks the sampled strides
   std::vector<hobject_t> ls;
   size_t pos = 0;
   int64_t data_pos = 0;
@@ -6195,6 +6423,7 @@ struct ScrubMapBuilder {
   ceph::buffer::hash data_hash, omap_hash;  ///< accumulatinng hash value
   uint64_t omap_keys = 0;
   uint64_t omap_bytes = 0;
+  bool sampling = false;  ///< only sampling the data of the current object
 
   bool empty() {
     return ls.empty();
@@ -6216,6 +6445,7 @@ struct ScrubMapBuilder {
     omap_pos.clear();
     omap_keys = 0;
     omap_bytes = 0;
+    sampling = false;
   }
 
   friend std::ostream& operator<<(std::ostream& out, const ScrubMapBuilder& pos) {
@@ -6232,6 +6462,12 @@ struct ScrubMapBuilder {
     if (pos.deep) {
       out << " deep";
     }
+    if (pos.incremental_since != eversion_t()) {
+      out << " since " << pos.incremental_since;
+    }
+    if (pos.sampling) {
+      out << " sampling";
+    }
     if (pos.ret) {
       out << " ret " << pos.ret;
     }
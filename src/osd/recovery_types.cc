@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "recovery_types.h"
+#include "common/ceph_crypto.h"
 
 std::ostream& operator<<(std::ostream& out, const BackfillInterval& bi)
 {
@@ -13,4 +14,102 @@ std::ostream& operator<<(std::ostream& out, const BackfillInterval& bi)
   return out;
 }
 
+void BackfillRangeDigest::encode(ceph::buffer::list &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  encode(end, bl);
+  encode(num_objects, bl);
+  encode(digest, bl);
+  ENCODE_FINISH(bl);
+}
+
+void BackfillRangeDigest::decode(ceph::buffer::list::const_iterator &bl)
+{
+  DECODE_START(1, bl);
+  decode(end, bl);
+  decode(num_objects, bl);
+  decode(digest, bl);
+  DECODE_FINISH(bl);
+}
+
+sha256_digest_t BackfillDigestScan::calc_digest(
+  std::map<hobject_t, eversion_t>::const_iterator first,
+  std::map<hobject_t, eversion_t>::const_iterator last)
+{
+  ceph::buffer::list bl;
+  for (; first != last; ++first) {
+    encode(first->first, bl);
+    encode(first->second, bl);
+  }
+  ceph::crypto::SHA256 h;
+  h.Update(reinterpret_cast<const unsigned char*>(bl.c_str()), bl.length());
+  sha256_digest_t digest;
+  h.Final(digest.v);
+  return digest;
+}
 
+void BackfillDigestScan::build(BackfillInterval &&local, unsigned per_range)
+{
+  ceph_assert(per_range > 0);
+  begin = local.begin;
+  end = local.end;
+  objects = std::move(local.objects);
+  ranges.clear();
+  auto first = objects.begin();
+  while (first != objects.end()) {
+    auto last = first;
+    uint32_t n = 0;
+    for (; last != objects.end() && n < per_range; ++last, ++n) ;
+    BackfillRangeDigest range;
+    range.end = last == objects.end() ? end : last->first;
+    range.num_objects = n;
+    range.digest = calc_digest(first, last);
+    ranges.push_back(std::move(range));
+    first = last;
+  }
+  if (ranges.empty()) {
+    // the target may still have objects we no longer do
+    BackfillRangeDigest range;
+    range.end = end;
+    range.digest = calc_digest(objects.end(), objects.end());
+    ranges.push_back(std::move(range));
+  }
+}
+
+std::set<uint32_t> BackfillDigestScan::compare(
+  const hobject_t &begin,
+  const std::vector<BackfillRangeDigest> &ranges,
+  const std::map<hobject_t, eversion_t> &objects,
+  std::map<hobject_t, eversion_t> *mismatched)
+{
+  std::set<uint32_t> ret;
+  auto first = objects.lower_bound(begin);
+  for (uint32_t i = 0; i < ranges.size(); ++i) {
+    auto last = objects.lower_bound(ranges[i].end);
+    if (std::distance(first, last) != ranges[i].num_objects ||
+	calc_digest(first, last) != ranges[i].digest) {
+      ret.insert(i);
+      mismatched->insert(first, last);
+    }
+    first = last;
+  }
+  return ret;
+}
+
+void BackfillDigestScan::apply(
+  const std::set<uint32_t> &mismatched_ranges,
+  std::map<hobject_t, eversion_t> &&mismatched,
+  BackfillInterval *bi) const
+{
+  bi->begin = begin;
+  bi->end = end;
+  bi->objects = std::move(mismatched);
+  auto first = objects.begin();
+  for (uint32_t i = 0; i < ranges.size(); ++i) {
+    auto last = objects.lower_bound(ranges[i].end);
+    if (!mismatched_ranges.count(i)) {
+      bi->objects.insert(first, last);
+    }
+    first = last;
+  }
+}
@@ -4,6 +4,8 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <vector>
 
 #include "osd_types.h"
 
@@ -93,6 +95,71 @@ struct BackfillInterval {
 
 std::ostream &operator<<(std::ostream &out, const BackfillInterval &bi);
 
+/**
+ * BackfillRangeDigest
+ *
+ * sha256 of the names and versions of the objects in one range of a
+ * BackfillDigestScan.  The range starts at the end of the previous one, or
+ * at the beginning of the scan, and ends before @end.
+ */
+struct BackfillRangeDigest {
+  hobject_t end;
+  uint32_t num_objects = 0;
+  sha256_digest_t digest;
+
+  void encode(ceph::buffer::list &bl) const;
+  void decode(ceph::buffer::list::const_iterator &bl);
+};
+WRITE_CLASS_ENCODER(BackfillRangeDigest)
+
+/**
+ * BackfillDigestScan
+ *
+ * Scanning a backfill target normally ships the name and version of every
+ * object of the scanned interval to the primary.  A target that already
+ * holds most of the pg, e.g. one that was down for longer than the pg log
+ * covers, can instead be sent the primary's objects of the interval as
+ * digests of consecutive ranges; it replies with its own objects only for
+ * the ranges that differ, and the primary fills in the others with the
+ * objects it computed the matching digests from.
+ */
+struct BackfillDigestScan {
+  uint64_t id = 0;  ///< matches the reply to the scan
+  hobject_t begin;
+  hobject_t end;
+  /// the primary's objects in [begin, end) the digests were computed from
+  std::map<hobject_t, eversion_t> objects;
+  std::vector<BackfillRangeDigest> ranges;
+
+  /// split a local scan into ranges of up to per_range objects
+  void build(BackfillInterval &&local, unsigned per_range);
+
+  /**
+   * compare a backfill target's objects against the ranges
+   *
+   * @param begin      start of the first range
+   * @param ranges     digests of the primary
+   * @param objects    the target's objects from begin to the end of the
+   *                   last range
+   * @param mismatched [out] objects of the ranges that differ
+   * @return indexes of the ranges that differ
+   */
+  static std::set<uint32_t> compare(
+    const hobject_t &begin,
+    const std::vector<BackfillRangeDigest> &ranges,
+    const std::map<hobject_t, eversion_t> &objects,
+    std::map<hobject_t, eversion_t> *mismatched);
+
+  /// rebuild the target's interval from the reply to the scan
+  void apply(const std::set<uint32_t> &mismatched_ranges,
+	     std::map<hobject_t, eversion_t> &&mismatched,
+	     BackfillInterval *bi) const;
+
+  static sha256_digest_t calc_digest(
+    std::map<hobject_t, eversion_t>::const_iterator first,
+    std::map<hobject_t, eversion_t>::const_iterator last);
+};
+
 #if FMT_VERSION >= 90000
 template <> struct fmt::formatter<BackfillInterval> : fmt::ostream_formatter {};
 #endif
@@ -31,7 +31,11 @@ void PGOpItem::run(
   ThreadPool::TPHandle &handle)
 {
   osd->dequeue_op(pg, op, handle);
+  Context *unlocked_read = pg->take_unlocked_read();
   pg->unlock();
+  if (unlocked_read) {
+    unlocked_read->complete(0);
+  }
 }
 
 void PGPeeringItem::run(
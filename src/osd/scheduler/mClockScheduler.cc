@@ -13,8 +13,10 @@
  */
 
 
+#include <charconv>
 #include <memory>
 #include <functional>
+#include <sstream>
 
 #include "osd/scheduler/mClockScheduler.h"
 #include "common/dout.h"
@@ -42,10 +44,21 @@ mClockScheduler::mClockScheduler(CephContext *cct,
     shard_id(shard_id),
     is_rotational(is_rotational),
     monc(monc),
+    client_qos_key(get_client_qos_key(cct)),
     scheduler(
       std::bind(&mClockScheduler::ClientRegistry::get_info,
                 &client_registry,
                 _1),
+      // with a tracking record per client or pool, idle ones have to be
+      // erased for the map to stay bounded
+      std::chrono::seconds(std::max<int64_t>(
+	1, cct->_conf.get_val<std::chrono::seconds>(
+	  "osd_mclock_scheduler_client_erase_age").count() / 2)),
+      cct->_conf.get_val<std::chrono::seconds>(
+	"osd_mclock_scheduler_client_erase_age"),
+      std::chrono::seconds(std::max<int64_t>(
+	1, cct->_conf.get_val<std::chrono::seconds>(
+	  "osd_mclock_scheduler_client_erase_age").count() / 10)),
       dmc::AtLimit::Wait,
       cct->_conf.get_val<double>("osd_mclock_scheduler_anticipation_timeout"))
 {
@@ -53,8 +66,58 @@ mClockScheduler::mClockScheduler(CephContext *cct,
   ceph_assert(num_shards > 0);
   set_osd_capacity_params_from_config();
   set_config_defaults_from_profile();
-  client_registry.update_from_config(
-    cct->_conf, osd_bandwidth_capacity_per_shard);
+  update_client_registry(cct->_conf);
+}
+
+mClockScheduler::client_qos_key_t mClockScheduler::get_client_qos_key(
+  CephContext *cct)
+{
+  auto key = cct->_conf.get_val<std::string>(
+    "osd_mclock_scheduler_client_qos_key");
+  if (key == "client") {
+    return client_qos_key_t::client;
+  } else if (key == "pool") {
+    return client_qos_key_t::pool;
+  } else {
+    return client_qos_key_t::none;
+  }
+}
+
+std::optional<client_profile_id_t> mClockScheduler::parse_client_profile(
+  std::string_view who)
+{
+  auto parse_id = [](std::string_view s) -> std::optional<uint64_t> {
+    uint64_t id = 0;
+    auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), id);
+    if (ec != std::errc() || p != s.data() + s.size() || s.empty()) {
+      return std::nullopt;
+    }
+    return id;
+  };
+  if (who.starts_with("client.")) {
+    if (auto id = parse_id(who.substr(7)); id) {
+      return client_profile_id_t(*id, 0);
+    }
+  } else if (who.starts_with("pool.")) {
+    if (auto id = parse_id(who.substr(5)); id) {
+      // see get_scheduler_id()
+      return client_profile_id_t(0, *id + 1);
+    }
+  }
+  return std::nullopt;
+}
+
+void mClockScheduler::update_client_registry(const ConfigProxy &conf)
+{
+  auto rejected = client_registry.update_from_config(
+    conf, osd_bandwidth_capacity_per_shard);
+  for (auto &entry : rejected) {
+    derr << __func__ << " ignoring invalid entry '" << entry
+         << "' in osd_mclock_scheduler_client_profiles" << dendl;
+  }
+  // the scheduler caches the ClientInfo of every client it tracks
+  scheduler.update_client_infos();
+  client_registry.drop_retired_profiles();
 }
 
 /* ClientRegistry holds the dmclock::ClientInfo configuration parameters
@@ -71,10 +134,11 @@ mClockScheduler::mClockScheduler(CephContext *cct,
  * for the osd_mclock_scheduler_client_* parameters prior to calling
  * update_from_config -- see set_config_defaults_from_profile().
  */
-void mClockScheduler::ClientRegistry::update_from_config(
+std::vector<std::string> mClockScheduler::ClientRegistry::update_from_config(
   const ConfigProxy &conf,
   const double capacity_per_shard)
 {
+  std::lock_guard l(lock);
 
   auto get_res = [&](double res) {
     if (res) {
@@ -129,13 +193,70 @@ void mClockScheduler::ClientRegistry::update_from_config(
       get_res(res),
       wgt,
       get_lim(lim));
+
+  // Set per client (or pool) infos, "<who>=<res>,<wgt>,<lim> ..."
+  std::vector<std::string> rejected;
+  std::set<client_profile_id_t> configured;
+  std::istringstream profiles(
+    conf.get_val<std::string>("osd_mclock_scheduler_client_profiles"));
+  for (std::string entry; profiles >> entry; ) {
+    auto eq = entry.find('=');
+    std::optional<client_profile_id_t> id;
+    if (eq != std::string::npos) {
+      id = parse_client_profile(std::string_view(entry).substr(0, eq));
+    }
+    std::istringstream params(
+      eq == std::string::npos ? std::string() : entry.substr(eq + 1));
+    char sep1 = 0, sep2 = 0;
+    if (!id ||
+	!(params >> res >> sep1 >> wgt >> sep2 >> lim) ||
+	sep1 != ',' || sep2 != ',' || !params.eof() ||
+	res < 0 || lim < 0 || wgt == 0) {
+      rejected.push_back(entry);
+      continue;
+    }
+    configured.insert(*id);
+    retired_profiles.erase(*id);
+    if (auto i = external_client_infos.find(*id);
+	i != external_client_infos.end()) {
+      i->second.update(get_res(res), wgt, get_lim(lim));
+    } else {
+      external_client_infos.emplace(
+	*id, dmc::ClientInfo(get_res(res), wgt, get_lim(lim)));
+    }
+  }
+  for (auto &[id, info] : external_client_infos) {
+    if (!configured.count(id)) {
+      retired_profiles.insert(id);
+    }
+  }
+  return rejected;
+}
+
+void mClockScheduler::ClientRegistry::drop_retired_profiles()
+{
+  std::lock_guard l(lock);
+  for (auto &id : retired_profiles) {
+    external_client_infos.erase(id);
+  }
+  retired_profiles.clear();
+}
+
+size_t mClockScheduler::ClientRegistry::get_num_profiles() const
+{
+  std::lock_guard l(lock);
+  return external_client_infos.size() - retired_profiles.size();
 }
 
 const dmc::ClientInfo *mClockScheduler::ClientRegistry::get_external_client(
   const client_profile_id_t &client) const
 {
+  if (client == client_profile_id_t()) {
+    return &default_external_client_info;
+  }
+  std::lock_guard l(lock);
   auto ret = external_client_infos.find(client);
-  if (ret == external_client_infos.end())
+  if (ret == external_client_infos.end() || retired_profiles.count(client))
     return &default_external_client_info;
   else
     return &(ret->second);
@@ -365,6 +486,9 @@ void mClockScheduler::dump(ceph::Formatter &f) const
   f.dump_int("client_count", scheduler.client_count());
   out << scheduler;
   f.dump_string("clients", out.str());
+  f.dump_string("client_qos_key",
+    cct->_conf.get_val<std::string>("osd_mclock_scheduler_client_qos_key"));
+  f.dump_int("client_profile_count", client_registry.get_num_profiles());
   f.close_section();
 
   // Display sorted queues (res, wgt, lim)
@@ -501,6 +625,7 @@ const char** mClockScheduler::get_tracked_conf_keys() const
     "osd_mclock_max_sequential_bandwidth_hdd",
     "osd_mclock_max_sequential_bandwidth_ssd",
     "osd_mclock_profile",
+    "osd_mclock_scheduler_client_profiles",
     NULL
   };
   return KEYS;
@@ -513,19 +638,20 @@ void mClockScheduler::handle_conf_change(
   if (changed.count("osd_mclock_max_capacity_iops_hdd") ||
       changed.count("osd_mclock_max_capacity_iops_ssd")) {
     set_osd_capacity_params_from_config();
-    client_registry.update_from_config(
-      conf, osd_bandwidth_capacity_per_shard);
+    update_client_registry(conf);
   }
   if (changed.count("osd_mclock_max_sequential_bandwidth_hdd") ||
       changed.count("osd_mclock_max_sequential_bandwidth_ssd")) {
     set_osd_capacity_params_from_config();
-    client_registry.update_from_config(
-      conf, osd_bandwidth_capacity_per_shard);
+    update_client_registry(conf);
   }
   if (changed.count("osd_mclock_profile")) {
     set_config_defaults_from_profile();
-    client_registry.update_from_config(
-      conf, osd_bandwidth_capacity_per_shard);
+    update_client_registry(conf);
+  }
+  if (changed.count("osd_mclock_scheduler_client_profiles")) {
+    // applies on top of any osd_mclock_profile
+    update_client_registry(conf);
   }
 
   auto get_changed_key = [&changed]() -> std::optional<std::string> {
@@ -552,8 +678,7 @@ void mClockScheduler::handle_conf_change(
   if (auto key = get_changed_key(); key.has_value()) {
     auto mclock_profile = cct->_conf.get_val<std::string>("osd_mclock_profile");
     if (mclock_profile == "custom") {
-      client_registry.update_from_config(
-        conf, osd_bandwidth_capacity_per_shard);
+      update_client_registry(conf);
     } else {
       // Attempt to change QoS parameter for a built-in profile. Restore the
       // profile defaults by making one of the OSD shards remove the key from
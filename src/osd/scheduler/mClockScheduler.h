@@ -18,6 +18,9 @@
 #include <functional>
 #include <ostream>
 #include <map>
+#include <optional>
+#include <set>
+#include <string_view>
 #include <vector>
 
 #include "boost/variant.hpp"
@@ -27,6 +30,7 @@
 #include "osd/scheduler/OpScheduler.h"
 #include "common/config.h"
 #include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
 #include "common/mClockPriorityQueue.h"
 #include "osd/scheduler/OpSchedulerItem.h"
 
@@ -44,14 +48,15 @@ constexpr double default_max = std::numeric_limits<double>::is_iec559 ?
  * client_id - global id (client.####) for client QoS
  * profile_id - id generated by client's QoS profile
  *
- * Currently (Reef and below), both members are set to
- * 0 which ensures that all external clients share the
- * mClock profile allocated reservation and limit
- * bandwidth.
+ * By default both members are set to 0 which ensures that
+ * all external clients share the mClock profile allocated
+ * reservation and limit bandwidth.
  *
- * Note: Post Reef, both members will be set to non-zero
- * values when the distributed feature of the mClock
- * algorithm is utilized.
+ * With osd_mclock_scheduler_client_qos_key = client, client_id
+ * is the global id of the client, and with
+ * osd_mclock_scheduler_client_qos_key = pool, profile_id is
+ * the pool id plus one, so that every client or pool is
+ * tracked by mClock on its own.
  */
 struct client_profile_id_t {
   uint64_t client_id = 0;
@@ -142,6 +147,14 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
    */
   double osd_bandwidth_capacity_per_shard;
 
+  /// what external client ops are grouped by, see client_profile_id_t
+  enum class client_qos_key_t {
+    none,
+    client,
+    pool,
+  };
+  const client_qos_key_t client_qos_key;
+
   class ClientRegistry {
     std::array<
       crimson::dmclock::ClientInfo,
@@ -153,8 +166,21 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
     };
 
     crimson::dmclock::ClientInfo default_external_client_info = {1, 1, 1};
+
+    /// protects external_client_infos, which changes with the config
+    mutable ceph::mutex lock =
+      ceph::make_mutex("mClockScheduler::ClientRegistry::lock");
     std::map<client_profile_id_t,
 	     crimson::dmclock::ClientInfo> external_client_infos;
+    /**
+     * profiles removed from osd_mclock_scheduler_client_profiles
+     *
+     * The scheduler keeps pointers to the ClientInfo of every client it
+     * tracks, so these are only erased once it has been pointed at the
+     * default again, see drop_retired_profiles().
+     */
+    std::set<client_profile_id_t> retired_profiles;
+
     const crimson::dmclock::ClientInfo *get_external_client(
       const client_profile_id_t &client) const;
   public:
@@ -163,13 +189,16 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
      *
      * Sets the mclock paramaters (reservation, weight, and limit)
      * for each class of IO (background_recovery, background_best_effort,
-     * and client).
+     * and client), and for the clients or pools which have a profile of
+     * their own.  Returns the profile entries which could not be parsed.
      */
-    void update_from_config(
+    std::vector<std::string> update_from_config(
       const ConfigProxy &conf,
       double capacity_per_shard);
     const crimson::dmclock::ClientInfo *get_info(
       const scheduler_id_t &id) const;
+    void drop_retired_profiles();
+    size_t get_num_profiles() const;
   } client_registry;
 
   using mclock_queue_t = crimson::dmclock::PullPriorityQueue<
@@ -192,13 +221,38 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
   SubQueue high_priority;
   priority_t immediate_class_priority = std::numeric_limits<priority_t>::max();
 
-  static scheduler_id_t get_scheduler_id(const OpSchedulerItem &item) {
-    return scheduler_id_t{
-      item.get_scheduler_class(),
-      client_profile_id_t()
-    };
+  scheduler_id_t get_scheduler_id(const OpSchedulerItem &item) const {
+    auto class_id = item.get_scheduler_class();
+    if (class_id != op_scheduler_class::client) {
+      return scheduler_id_t{class_id, client_profile_id_t()};
+    }
+    switch (client_qos_key) {
+    case client_qos_key_t::client:
+      return scheduler_id_t{class_id, client_profile_id_t(item.get_owner(), 0)};
+    case client_qos_key_t::pool:
+      return scheduler_id_t{
+	class_id,
+	client_profile_id_t(
+	  0, static_cast<uint64_t>(item.get_ordering_token().pool()) + 1)};
+    default:
+      return scheduler_id_t{class_id, client_profile_id_t()};
+    }
   }
 
+  static client_qos_key_t get_client_qos_key(CephContext *cct);
+
+  /**
+   * parse_client_profile
+   *
+   * Parses the <who> part of an osd_mclock_scheduler_client_profiles
+   * entry into the id get_scheduler_id() gives the matching client ops.
+   */
+  static std::optional<client_profile_id_t> parse_client_profile(
+    std::string_view who);
+
+  /// update client_registry, and the scheduler's view of it
+  void update_client_registry(const ConfigProxy &conf);
+
   static unsigned int get_io_prio_cut(CephContext *cct) {
     if (cct->_conf->osd_op_queue_cut_off == "debug_random") {
       std::random_device rd;
@@ -754,17 +754,21 @@ bool PgScrubber::select_range()
   const int divisor = static_cast<int>(preemption_data.chunk_divisor());
   const int min_chunk_sz = std::max(3, min_from_conf / divisor);
   const int max_chunk_sz = std::max(min_chunk_sz, max_from_conf / divisor);
+  const int chunk_sz = m_chunk_sizer.next_size(
+      ceph::make_timespan(
+	  conf.get_val<double>("osd_scrub_chunk_target_duration")),
+      min_chunk_sz, max_chunk_sz);
 
   dout(10) << fmt::format(
-		  "{}: Min: {} Max: {} Div: {}", __func__, min_chunk_sz,
-		  max_chunk_sz, divisor)
+		  "{}: Min: {} Max: {} Div: {} Size: {}", __func__, min_chunk_sz,
+		  max_chunk_sz, divisor, chunk_sz)
 	   << dendl;
 
   hobject_t start = m_start;
   hobject_t candidate_end;
   std::vector<hobject_t> objects;
   int ret = m_pg->get_pgbackend()->objects_list_partial(
-      start, min_chunk_sz, max_chunk_sz, &objects, &candidate_end);
+      start, min_chunk_sz, chunk_sz, &objects, &candidate_end);
   ceph_assert(ret >= 0);
 
   if (!objects.empty()) {
@@ -803,6 +807,7 @@ bool PgScrubber::select_range()
   m_end = candidate_end;
   if (m_end > m_max_end)
     m_max_end = m_end;
+  m_chunk_selected_at = ceph::mono_clock::now();
 
   dout(15) << __func__ << " range selected: " << m_start << " //// " << m_end
 	   << " //// " << m_max_end << dendl;
@@ -974,6 +979,8 @@ void PgScrubber::_request_scrub_map(pg_shard_t replica,
 				     allow_preemption,
 				     m_flags.priority,
 				     m_pg->ops_blocked_by_scrub());
+  repscrubop->incremental_since = m_incremental_since;
+  repscrubop->sample_seed = m_sample_seed;
 
   // default priority. We want the replica-scrub processed prior to any recovery
   // or client io messages (we are holding a lock!)
@@ -1005,6 +1012,8 @@ void PgScrubber::on_init()
   preemption_data.reset();
   m_interval_start = m_pg->get_history().same_interval_since;
   dout(10) << __func__ << " start same_interval:" << m_interval_start << dendl;
+  // shallow and deep scrubs take very different times per object
+  m_chunk_sizer = Scrub::ChunkSizer{};
 
   m_be = std::make_unique<ScrubBackend>(
     *this,
@@ -1146,6 +1155,10 @@ int PgScrubber::build_scrub_map_chunk(ScrubMap& map,
   while (pos.empty()) {
 
     pos.deep = deep;
+    if (deep) {
+      pos.incremental_since = m_incremental_since;
+      pos.sample_seed = m_sample_seed;
+    }
     map.valid_through = m_pg->info.last_update;
 
     // objects
@@ -1346,6 +1359,8 @@ void PgScrubber::maps_compare_n_cleanup()
 
   auto required_fixes =
     m_be->scrub_compare_maps(m_end.is_max(), get_snap_mapper_accessor());
+  m_chunk_sizer.add_sample(ceph::mono_clock::now() - m_chunk_selected_at,
+			   m_be->get_primary_scrubmap().objects.size());
   if (!required_fixes.inconsistent_objs.empty()) {
     if (state_test(PG_STATE_REPAIR)) {
       dout(10) << __func__ << ": discarding scrub results (repairing)" << dendl;
@@ -1399,6 +1414,8 @@ void PgScrubber::replica_scrub_op(OpRequestRef op)
   m_end = msg->end;
   m_max_end = msg->end;
   m_is_deep = msg->deep;
+  m_incremental_since = msg->incremental_since;
+  m_sample_seed = msg->sample_seed;
   m_interval_start = m_pg->info.history.same_interval_since;
   m_replica_request_priority = msg->high_priority
 				 ? Scrub::scrub_prio_t::high_priority
@@ -1461,6 +1478,21 @@ void PgScrubber::set_op_parameters(const requested_scrub_t& request)
     update_op_mode_text();
   }
 
+  // a deep scrub that was asked for, or that may repair, reads everything
+  m_scrub_start_version = m_pg->info.last_update;
+  m_incremental_since = eversion_t{};
+  m_sample_seed = m_epoch_start;
+  if (m_is_deep && !m_is_repair && !m_flags.required &&
+      get_pg_cct()->_conf.get_val<bool>("osd_deep_scrub_incremental") &&
+      m_pg->info.history.last_deep_scrub_start != eversion_t{} &&
+      !m_pg->info.stats.stats_invalid &&
+      m_pg->info.history.last_deep_scrub_recovered ==
+	m_pg->info.stats.stats.sum.num_objects_recovered) {
+    m_incremental_since = m_pg->info.history.last_deep_scrub_start;
+  }
+  dout(10) << __func__ << " incremental since: " << m_incremental_since
+	   << dendl;
+
   // The publishing here is required for tests synchronization.
   // The PG state flags were modified.
   m_pg->publish_stats_to_osd();
@@ -1879,6 +1911,11 @@ void PgScrubber::scrub_finish()
 	if (m_is_deep) {
 	  history.last_deep_scrub = m_pg->recovery_state.get_info().last_update;
 	  history.last_deep_scrub_stamp = now;
+	  // objects modified while we scrubbed were possibly scanned before
+	  // that, the next incremental deep scrub will read them again
+	  history.last_deep_scrub_start = m_scrub_start_version;
+	  history.last_deep_scrub_recovered =
+	    stats.stats.sum.num_objects_recovered;
 	}
 
 	if (m_is_deep) {
@@ -81,6 +81,7 @@ Main Scrubber interfaces:
 #include "ScrubStore.h"
 #include "osd_scrub_sched.h"
 #include "scrub_backend.h"
+#include "scrub_chunk_sizer.h"
 #include "scrub_machine_lstnr.h"
 
 namespace Scrub {
@@ -752,6 +753,17 @@ class PgScrubber : public ScrubPgIF,
    */
   epoch_t m_epoch_start{0};  ///< the actual epoch when scrubbing started
 
+  /**
+   * set for an incremental deep scrub: the data of objects not modified
+   * after this version is only sampled, see osd_deep_scrub_incremental.
+   * Sent to the replicas along with the seed picking the sampled strides.
+   */
+  eversion_t m_incremental_since{};
+  uint32_t m_sample_seed{0};
+
+  /// (primary) the PG's last_update when this scrub started
+  eversion_t m_scrub_start_version{};
+
   /**
    * (replica) a tag identifying a specific scrub "session". Incremented
    * whenever the Primary releases the replica scrub resources. When the scrub
@@ -802,6 +814,13 @@ class PgScrubber : public ScrubPgIF,
 
   eversion_t m_subset_last_update{};
 
+  /// sizes the chunks by the time they take, if
+  /// osd_scrub_chunk_target_duration is set
+  Scrub::ChunkSizer m_chunk_sizer;
+
+  /// when the range of the current chunk was selected
+  ceph::mono_clock::time_point m_chunk_selected_at;
+
   std::unique_ptr<Scrub::Store> m_store;
 
   int num_digest_updates_pending{0};
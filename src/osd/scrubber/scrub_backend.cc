@@ -16,6 +16,7 @@
 #include "osd/PG.h"
 #include "osd/PrimaryLogPG.h"
 #include "osd/osd_types_fmt.h"
+#include "osd/scrubber/scrub_compare_pool.h"
 
 #include "pg_scrubber.h"
 
@@ -413,8 +414,10 @@ static inline int dcount(const object_info_t& oi)
   return (oi.is_data_digest() ? 1 : 0) + (oi.is_omap_digest() ? 1 : 0);
 }
 
-auth_selection_t ScrubBackend::select_auth_object(const hobject_t& ho,
-                                                  stringstream& errstream)
+auth_selection_t ScrubBackend::select_auth_object(
+  const hobject_t& ho,
+  ScrubMap::object* const* row,
+  stringstream& errstream)
 {
   // Create a list of shards (with the Primary first, so that it will be
   // auth-copy, all other things being equal)
@@ -423,27 +426,30 @@ auth_selection_t ScrubBackend::select_auth_object(const hobject_t& ho,
   /// selecting best auth source below. Then - stopping on the first one
   /// that is auth eligible.
   /// This creates an issue with 'digest_match' that should be handled.
-  std::list<pg_shard_t> shards;
-  for (const auto& [srd, smap] : this_chunk->received_maps) {
-    if (srd != m_pg_whoami) {
-      shards.push_back(srd);
+  const auto& chunk_shards = this_chunk->shards;
+  std::list<size_t> shards;
+  for (size_t i = 0; i < chunk_shards.size(); ++i) {
+    if (chunk_shards[i]->first != m_pg_whoami) {
+      shards.push_back(i);
+    } else {
+      shards.push_front(i);
     }
   }
-  shards.push_front(m_pg_whoami);
 
   auth_selection_t ret_auth;
   ret_auth.auth = this_chunk->received_maps.end();
   eversion_t auth_version;
 
-  for (auto& l : shards) {
+  for (auto ndx : shards) {
 
-    auto shard_ret = possible_auth_shard(ho, l, ret_auth.shard_map);
+    const auto& l = chunk_shards[ndx]->first;
+    auto shard_ret = possible_auth_shard(ho, ndx, row[ndx], ret_auth.shard_map);
 
     // digest_match will only be true if computed digests are the same
     if (auth_version != eversion_t() &&
-        ret_auth.auth->second.objects[ho].digest_present &&
+        ret_auth.auth_obj->digest_present &&
         shard_ret.digest.has_value() &&
-        ret_auth.auth->second.objects[ho].digest != *shard_ret.digest) {
+        ret_auth.auth_obj->digest != *shard_ret.digest) {
 
       ret_auth.digest_match = false;
       dout(10) << fmt::format(
@@ -451,7 +457,7 @@ auth_selection_t ScrubBackend::select_auth_object(const hobject_t& ho,
                     "data_digest 0x{:x}",
                     __func__,
                     ho,
-                    ret_auth.auth->second.objects[ho].digest,
+                    ret_auth.auth_obj->digest,
                     *shard_ret.digest)
                << dendl;
     }
@@ -500,6 +506,7 @@ auth_selection_t ScrubBackend::select_auth_object(const hobject_t& ho,
 
         ret_auth.auth = shard_ret.auth_iter;
         ret_auth.auth_shard = ret_auth.auth->first;
+        ret_auth.auth_obj = row[ndx];
         ret_auth.auth_oi = shard_ret.oi;
         auth_version = shard_ret.oi.version;
         ret_auth.is_auth_available = true;
@@ -561,9 +568,11 @@ static inline bool test_error_cond(bool error_pred,
   return error_pred;
 }
 
-shard_as_auth_t ScrubBackend::possible_auth_shard(const hobject_t& obj,
-                                                  const pg_shard_t& srd,
-                                                  shard_info_map_t& shard_map)
+shard_as_auth_t ScrubBackend::possible_auth_shard(
+  const hobject_t& obj,
+  size_t shard_ndx,
+  const ScrubMap::object* smap_obj_ptr,
+  shard_info_map_t& shard_map)
 {
   //  'maps' (originally called with this_chunk->maps): this_chunk->maps
   //  'auth_oi' (called with 'auth_oi', which wasn't initialized at call site)
@@ -571,14 +580,12 @@ shard_as_auth_t ScrubBackend::possible_auth_shard(const hobject_t& obj,
   //  'shard_map' - the one created in select_auth_object()
   //     - used to access the 'shard_info'
 
-  const auto j = this_chunk->received_maps.find(srd);
+  const auto j = this_chunk->shards[shard_ndx];
   const auto& j_shard = j->first;
-  const auto& j_smap = j->second;
-  auto i = j_smap.objects.find(obj);
-  if (i == j_smap.objects.end()) {
+  if (!smap_obj_ptr) {
     return shard_as_auth_t{};
   }
-  const auto& smap_obj = i->second;
+  const auto& smap_obj = *smap_obj_ptr;
 
   auto& shard_info = shard_map[j_shard];
   if (j_shard == m_pg_whoami) {
@@ -757,30 +764,128 @@ void ScrubBackend::compare_smaps()
            << ": authoritative-set #: " << this_chunk->authoritative_set.size()
            << dendl;
 
-  std::for_each(this_chunk->authoritative_set.begin(),
-                this_chunk->authoritative_set.end(),
-                [this](const auto& ho) {
-                  if (auto maybe_clust_err = compare_obj_in_maps(ho);
-                      maybe_clust_err) {
-                    clog.error() << *maybe_clust_err;
-                  }
-                });
+  build_entries_table();
+
+  // a large chunk is split into ranges, compared concurrently. The PG lock
+  // is held meanwhile, but for a fraction of the time. The threads helping
+  // with the ranges are shared by all the PGs of the OSD.
+  const size_t obj_count = this_chunk->authoritative_set.size();
+  const auto min_objects =
+    m_conf.get_val<uint64_t>("osd_scrub_compare_parallel_min_objects");
+  const auto threads = m_conf.get_val<uint64_t>("osd_scrub_compare_threads");
+  size_t ranges = 1;
+  if (threads > 1 && min_objects > 0 && obj_count >= min_objects) {
+    ranges = std::min<size_t>(threads, obj_count);
+  }
+  const size_t per_range = (obj_count + ranges - 1) / std::max<size_t>(1, ranges);
+
+  std::vector<compare_results_t> results(ranges);
+  std::vector<Scrub::ComparePool::task_t> tasks;
+  tasks.reserve(ranges);
+  auto first = this_chunk->authoritative_set.cbegin();
+  for (size_t r = 0; r < ranges; ++r) {
+    const size_t begin = r * per_range;
+    if (begin >= obj_count && r > 0) {
+      break;
+    }
+    tasks.emplace_back(
+      [this, ho = std::next(first, std::min(obj_count, begin)), begin,
+       end = std::min(obj_count, begin + per_range),
+       &res = results[r]] { compare_range(ho, begin, end, res); });
+  }
+  if (tasks.size() == 1) {
+    tasks.front()();
+  } else {
+    Scrub::ComparePool::get(m_scrubber.get_pg_cct())
+      .run(tasks, threads - 1);
+  }
+
+  dout(15) << fmt::format("{}: compared {} objects in {} ranges",
+                          __func__,
+                          obj_count,
+                          tasks.size())
+           << dendl;
+  for (auto& res : results) {
+    merge_results(std::move(res));
+  }
 }
 
-std::optional<std::string> ScrubBackend::compare_obj_in_maps(
-  const hobject_t& ho)
+void ScrubBackend::build_entries_table()
+{
+  auto& chunk = *this_chunk;
+  chunk.shards.clear();
+  for (auto it = chunk.received_maps.begin(); it != chunk.received_maps.end();
+       ++it) {
+    chunk.shards.push_back(it);
+  }
+
+  const size_t n = chunk.shards.size();
+  chunk.entries.assign(chunk.authoritative_set.size() * n, nullptr);
+  for (size_t i = 0; i < n; ++i) {
+    // both sorted, and the authoritative set has all of the map's objects
+    auto& objects = chunk.shards[i]->second.objects;
+    auto obj = objects.begin();
+    size_t row = 0;
+    for (auto ho = chunk.authoritative_set.cbegin();
+         ho != chunk.authoritative_set.cend() && obj != objects.end();
+         ++ho, ++row) {
+      if (obj->first == *ho) {
+        chunk.entries[row * n + i] = &obj->second;
+        ++obj;
+      }
+    }
+  }
+}
+
+void ScrubBackend::compare_range(std::set<hobject_t>::const_iterator ho,
+                                 size_t begin,
+                                 size_t end,
+                                 compare_results_t& res)
+{
+  const size_t n = this_chunk->shards.size();
+  for (size_t i = begin; i < end; ++i, ++ho) {
+    compare_obj_in_maps(*ho, &this_chunk->entries[i * n], res);
+  }
+}
+
+void ScrubBackend::merge_results(compare_results_t&& res)
+{
+  auto& chunk = *this_chunk;
+  chunk.m_error_counts.shallow_errors += res.m_error_counts.shallow_errors;
+  chunk.m_error_counts.deep_errors += res.m_error_counts.deep_errors;
+  std::move(res.m_inconsistent_objs.begin(),
+            res.m_inconsistent_objs.end(),
+            std::back_inserter(chunk.m_inconsistent_objs));
+  chunk.authoritative.merge(res.authoritative);
+  std::move(res.missing_digest.begin(),
+            res.missing_digest.end(),
+            std::back_inserter(chunk.missing_digest));
+  for (auto& [ho, shards] : res.m_missing) {
+    m_missing[ho] = std::move(shards);
+  }
+  for (auto& [ho, shards] : res.m_inconsistent) {
+    m_inconsistent[ho] = std::move(shards);
+  }
+  for (const auto& err : res.cluster_errors) {
+    clog.error() << err;
+  }
+}
+
+void ScrubBackend::compare_obj_in_maps(const hobject_t& ho,
+                                       ScrubMap::object* const* row,
+                                       compare_results_t& res)
 {
   // clear per-object data:
-  this_chunk->cur_inconsistent.clear();
-  this_chunk->cur_missing.clear();
-  this_chunk->fix_digest = false;
+  res.cur_inconsistent.clear();
+  res.cur_missing.clear();
+  res.fix_digest = false;
 
   stringstream candidates_errors;
-  auto auth_res = select_auth_object(ho, candidates_errors);
+  auto auth_res = select_auth_object(ho, row, candidates_errors);
   if (candidates_errors.str().size()) {
     // a collection of shard-specific errors detected while
     // finding the best shard to serve as authoritative
-    clog.error() << candidates_errors.str();
+    res.cluster_errors.push_back(candidates_errors.str());
   }
 
   inconsistent_obj_wrapper object_error{ho};
@@ -790,20 +895,22 @@ std::optional<std::string> ScrubBackend::compare_obj_in_maps(
     object_error.set_auth_missing(ho,
                                   this_chunk->received_maps,
                                   auth_res.shard_map,
-                                  this_chunk->m_error_counts.shallow_errors,
-                                  this_chunk->m_error_counts.deep_errors,
+                                  res.m_error_counts.shallow_errors,
+                                  res.m_error_counts.deep_errors,
                                   m_pg_whoami);
 
     if (object_error.has_deep_errors()) {
-      this_chunk->m_error_counts.deep_errors++;
+      res.m_error_counts.deep_errors++;
     } else if (object_error.has_shallow_errors()) {
-      this_chunk->m_error_counts.shallow_errors++;
+      res.m_error_counts.shallow_errors++;
     }
 
-    this_chunk->m_inconsistent_objs.push_back(std::move(object_error));
-    return fmt::format("{} soid {} : failed to pick suitable object info\n",
-                       m_scrubber.get_pgid().pgid,
-                       ho);
+    res.m_inconsistent_objs.push_back(std::move(object_error));
+    res.cluster_errors.push_back(
+      fmt::format("{} soid {} : failed to pick suitable object info\n",
+                  m_scrubber.get_pgid().pgid,
+                  ho));
+    return;
   }
 
   stringstream errstream;
@@ -812,11 +919,11 @@ std::optional<std::string> ScrubBackend::compare_obj_in_maps(
   // an auth source was selected
 
   object_error.set_version(auth_res.auth_oi.user_version);
-  ScrubMap::object& auth_object = auth->second.objects[ho];
-  ceph_assert(!this_chunk->fix_digest);
+  ScrubMap::object& auth_object = *auth_res.auth_obj;
+  ceph_assert(!res.fix_digest);
 
   auto [auths, objerrs] =
-    match_in_shards(ho, auth_res, object_error, errstream);
+    match_in_shards(ho, row, auth_res, object_error, res, errstream);
 
   auto opt_ers =
     for_empty_auth_list(std::move(auths),
@@ -833,6 +940,7 @@ std::optional<std::string> ScrubBackend::compare_obj_in_maps(
                   auth_object,
                   auth_res.auth_oi,
                   std::move(*opt_ers),
+                  res,
                   errstream);
   } else {
 
@@ -841,19 +949,17 @@ std::optional<std::string> ScrubBackend::compare_obj_in_maps(
   }
 
   if (object_error.has_deep_errors()) {
-    this_chunk->m_error_counts.deep_errors++;
+    res.m_error_counts.deep_errors++;
   } else if (object_error.has_shallow_errors()) {
-    this_chunk->m_error_counts.shallow_errors++;
+    res.m_error_counts.shallow_errors++;
   }
 
   if (object_error.errors || object_error.union_shards.errors) {
-    this_chunk->m_inconsistent_objs.push_back(std::move(object_error));
+    res.m_inconsistent_objs.push_back(std::move(object_error));
   }
 
-  if (errstream.str().empty()) {
-    return std::nullopt;
-  } else {
-    return errstream.str();
+  if (!errstream.str().empty()) {
+    res.cluster_errors.push_back(errstream.str());
   }
 }
 
@@ -895,12 +1001,13 @@ void ScrubBackend::inconsistents(const hobject_t& ho,
                                  ScrubMap::object& auth_object,
                                  object_info_t& auth_oi,
                                  auth_and_obj_errs_t&& auth_n_errs,
+                                 compare_results_t& res,
                                  stringstream& errstream)
 {
   auto& object_errors = auth_n_errs.object_errors;
   auto& auth_list = auth_n_errs.auth_list;
 
-  this_chunk->cur_inconsistent.insert(object_errors.begin(),
+  res.cur_inconsistent.insert(object_errors.begin(),
                                       object_errors.end());  // merge?
 
   dout(15) << fmt::format(
@@ -909,19 +1016,19 @@ void ScrubBackend::inconsistents(const hobject_t& ho,
                 __func__,
                 object_errors.size(),
                 auth_list.size(),
-                this_chunk->cur_missing.size(),
-                this_chunk->cur_inconsistent.size())
+                res.cur_missing.size(),
+                res.cur_inconsistent.size())
            << dendl;
 
 
-  if (!this_chunk->cur_missing.empty()) {
-    m_missing[ho] = this_chunk->cur_missing;
+  if (!res.cur_missing.empty()) {
+    res.m_missing[ho] = res.cur_missing;
   }
-  if (!this_chunk->cur_inconsistent.empty()) {
-    m_inconsistent[ho] = this_chunk->cur_inconsistent;
+  if (!res.cur_inconsistent.empty()) {
+    res.m_inconsistent[ho] = res.cur_inconsistent;
   }
 
-  if (this_chunk->fix_digest) {
+  if (res.fix_digest) {
 
     ceph_assert(auth_object.digest_present);
     std::optional<uint32_t> data_digest{auth_object.digest};
@@ -930,16 +1037,16 @@ void ScrubBackend::inconsistents(const hobject_t& ho,
     if (auth_object.omap_digest_present) {
       omap_digest = auth_object.omap_digest;
     }
-    this_chunk->missing_digest.push_back(
+    res.missing_digest.push_back(
       make_pair(ho, make_pair(data_digest, omap_digest)));
   }
 
-  if (!this_chunk->cur_inconsistent.empty() ||
-      !this_chunk->cur_missing.empty()) {
+  if (!res.cur_inconsistent.empty() ||
+      !res.cur_missing.empty()) {
 
-    this_chunk->authoritative[ho] = auth_list;
+    res.authoritative[ho] = auth_list;
 
-  } else if (!this_chunk->fix_digest && m_is_replicated) {
+  } else if (!res.fix_digest && m_is_replicated) {
 
     auto is_to_fix =
       should_fix_digest(ho, auth_object, auth_oi, m_repair, errstream);
@@ -979,7 +1086,7 @@ void ScrubBackend::inconsistents(const hobject_t& ho,
           dout(20) << __func__ << ": will update omap digest on " << ho
                    << dendl;
         }
-        this_chunk->missing_digest.push_back(
+        res.missing_digest.push_back(
           make_pair(ho, make_pair(data_digest, omap_digest)));
         break;
     }
@@ -1031,31 +1138,35 @@ ScrubBackend::digest_fixing_t ScrubBackend::should_fix_digest(
 
 ScrubBackend::auth_and_obj_errs_t ScrubBackend::match_in_shards(
   const hobject_t& ho,
+  ScrubMap::object* const* row,
   auth_selection_t& auth_sel,
   inconsistent_obj_wrapper& obj_result,
+  compare_results_t& res,
   stringstream& errstream)
 {
   std::list<pg_shard_t> auth_list;     // out "param" to
   std::set<pg_shard_t> object_errors;  // be returned
 
-  for (auto& [srd, smap] : this_chunk->received_maps) {
+  for (size_t ndx = 0; ndx < this_chunk->shards.size(); ++ndx) {
 
+    const auto& srd = this_chunk->shards[ndx]->first;
     if (srd == auth_sel.auth_shard) {
       auth_sel.shard_map[auth_sel.auth_shard].selected_oi = true;
     }
 
-    if (smap.objects.count(ho)) {
+    if (row[ndx]) {
 
       // the scrub-map has our object
-      auth_sel.shard_map[srd].set_object(smap.objects[ho]);
+      const auto& smap_obj = *row[ndx];
+      auth_sel.shard_map[srd].set_object(smap_obj);
 
       // Compare
       stringstream ss;
-      const auto& auth_object = auth_sel.auth->second.objects[ho];
+      const auto& auth_object = *auth_sel.auth_obj;
       const bool discrep_found = compare_obj_details(auth_sel.auth_shard,
                                                      auth_object,
                                                      auth_sel.auth_oi,
-                                                     smap.objects[ho],
+                                                     smap_obj,
                                                      auth_sel.shard_map[srd],
                                                      obj_result,
                                                      ss,
@@ -1077,8 +1188,8 @@ ScrubBackend::auth_and_obj_errs_t ScrubBackend::match_in_shards(
 		      "{}: <{}> auth:{} ({}/{}) vs {} ({}/{}) {}", __func__, ho,
 		      auth_sel.auth_shard, auth_object.omap_digest_present,
 		      auth_object.omap_digest, srd,
-		      smap.objects[ho].omap_digest_present ? true : false,
-		      smap.objects[ho].omap_digest, ss.str())
+		      smap_obj.omap_digest_present ? true : false,
+		      smap_obj.omap_digest, ss.str())
 		 << dendl;
       }
 
@@ -1089,7 +1200,7 @@ ScrubBackend::auth_and_obj_errs_t ScrubBackend::match_in_shards(
           auth_sel.shard_map[srd].only_data_digest_mismatch_info() &&
           auth_object.digest_present) {
         // Set in missing_digests
-        this_chunk->fix_digest = true;
+        res.fix_digest = true;
         // Clear the error
         auth_sel.shard_map[srd].clear_data_digest_mismatch_info();
         errstream << m_pg_id << " soid " << ho
@@ -1100,11 +1211,11 @@ ScrubBackend::auth_and_obj_errs_t ScrubBackend::match_in_shards(
       // Some errors might have already been set in select_auth_object()
       if (auth_sel.shard_map[srd].errors != 0) {
 
-        this_chunk->cur_inconsistent.insert(srd);
+        res.cur_inconsistent.insert(srd);
         if (auth_sel.shard_map[srd].has_deep_errors()) {
-          this_chunk->m_error_counts.deep_errors++;
+          res.m_error_counts.deep_errors++;
         } else {
-          this_chunk->m_error_counts.shallow_errors++;
+          res.m_error_counts.shallow_errors++;
         }
 
         if (discrep_found) {
@@ -1131,12 +1242,12 @@ ScrubBackend::auth_and_obj_errs_t ScrubBackend::match_in_shards(
 
     } else {
 
-      this_chunk->cur_missing.insert(srd);
+      res.cur_missing.insert(srd);
       auth_sel.shard_map[srd].set_missing();
       auth_sel.shard_map[srd].primary = (srd == m_pg_whoami);
 
       // Can't have any other errors if there is no information available
-      this_chunk->m_error_counts.shallow_errors++;
+      res.m_error_counts.shallow_errors++;
       errstream << m_pg_id << " shard " << srd << " " << ho << " : missing\n";
     }
     obj_result.add_shard(srd, auth_sel.shard_map[srd]);
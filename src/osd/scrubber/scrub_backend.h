@@ -212,6 +212,7 @@ struct fmt::formatter<shard_as_auth_t> {
 struct auth_selection_t {
   shard_to_scrubmap_t::iterator auth;  ///< an iter into one of this_chunk->maps
   pg_shard_t auth_shard;               // set to auth->first
+  ScrubMap::object* auth_obj{nullptr};  ///< the object in auth->second
   object_info_t auth_oi;
   shard_info_map_t shard_map;
   bool is_auth_available{false};  ///< managed to select an auth' source?
@@ -258,6 +259,18 @@ struct scrub_chunk_t {
   /// a collection of all objs mentioned in the maps
   std::set<hobject_t> authoritative_set;
 
+  /// the maps of received_maps, in its order
+  std::vector<shard_to_scrubmap_t::iterator> shards;
+
+  /**
+   * a flat table of the entries of the objects in the maps: for the n-th
+   * object of authoritative_set, entries[n * shards.size() + i] is the
+   * object in the map of shards[i], or nullptr if missing there.
+   * Built once per chunk by a merge walk of the sorted maps, so that
+   * comparing the objects does not look each one up in every map.
+   */
+  std::vector<ScrubMap::object*> entries;
+
   utime_t started{ceph_clock_now()};
 
   digests_fixes_t missing_digest;
@@ -269,6 +282,25 @@ struct scrub_chunk_t {
 
   /// shallow/deep error counters
   error_counters_t m_error_counts;
+};
+
+/**
+ * the results of comparing a range of the chunk's objects across the maps.
+ *
+ * The ranges of a large chunk are compared concurrently, each into its own
+ * results, which are then merged - in objects order - into this_chunk and
+ * the session-wide tables.
+ */
+struct compare_results_t {
+  error_counters_t m_error_counts;
+  inconsistent_objs_t m_inconsistent_objs;
+  std::map<hobject_t, std::list<pg_shard_t>> authoritative;
+  digests_fixes_t missing_digest;
+  HobjToShardSetMapping m_missing;
+  HobjToShardSetMapping m_inconsistent;
+
+  /// to be cluster-logged once the comparison is done
+  std::vector<std::string> cluster_errors;
 
   // these must be reset for each element:
 
@@ -405,10 +437,30 @@ class ScrubBackend {
   // note: used by both Primary & replicas
   static ScrubMap clean_meta_map(ScrubMap& cleaned, bool max_reached);
 
+  /**
+   * compare all the objects of the chunk, splitting a chunk of at least
+   * osd_scrub_compare_parallel_min_objects objects into ranges compared by
+   * concurrent threads
+   */
   void compare_smaps();
 
-  /// might return error messages to be cluster-logged
-  std::optional<std::string> compare_obj_in_maps(const hobject_t& ho);
+  /// fill this_chunk->shards & this_chunk->entries
+  void build_entries_table();
+
+  /// compare the objects [begin, end) of authoritative_set, by index, 'ho'
+  /// being the begin-th one
+  void compare_range(std::set<hobject_t>::const_iterator ho,
+                     size_t begin,
+                     size_t end,
+                     compare_results_t& res);
+
+  /// add the errors found in a range to this_chunk and the session's tables
+  void merge_results(compare_results_t&& res);
+
+  /// errors to be cluster-logged are added to res.cluster_errors
+  void compare_obj_in_maps(const hobject_t& ho,
+                           ScrubMap::object* const* row,
+                           compare_results_t& res);
 
   void omap_checks();
 
@@ -420,8 +472,10 @@ class ScrubBackend {
     std::stringstream& errstream);
 
   auth_and_obj_errs_t match_in_shards(const hobject_t& ho,
+                                      ScrubMap::object* const* row,
                                       auth_selection_t& auth_sel,
                                       inconsistent_obj_wrapper& obj_result,
+                                      compare_results_t& res,
                                       std::stringstream& errstream);
 
   // returns: true if a discrepancy was found
@@ -442,16 +496,19 @@ class ScrubBackend {
    * An auxiliary used by select_auth_object() to test a specific shard
    * as a possible auth candidate.
    * @param ho        the hobject for which we are looking for an auth source
-   * @param srd       the candidate shard
+   * @param shard_ndx the candidate shard, an index into this_chunk->shards
+   * @param smap_obj  the object in the candidate's map, nullptr if missing
    * @param shard_map [out] a collection of shard_info-s per shard.
    * possible_auth_shard() might set error flags in the relevant (this shard's)
    * entry.
    */
   shard_as_auth_t possible_auth_shard(const hobject_t& ho,
-                                      const pg_shard_t& srd,
+                                      size_t shard_ndx,
+                                      const ScrubMap::object* smap_obj,
                                       shard_info_map_t& shard_map);
 
   auth_selection_t select_auth_object(const hobject_t& ho,
+                                      ScrubMap::object* const* row,
                                       std::stringstream& errstream);
 
 
@@ -471,6 +528,7 @@ class ScrubBackend {
                      ScrubMap::object& auth_object,
                      object_info_t& auth_oi,  // consider moving to object
                      auth_and_obj_errs_t&& auth_n_errs,
+                     compare_results_t& res,
                      std::stringstream& errstream);
 
   int process_clones_to(const std::optional<hobject_t>& head,
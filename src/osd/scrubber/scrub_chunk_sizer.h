@@ -0,0 +1,72 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/ceph_time.h"
+
+namespace Scrub {
+
+/**
+ * ChunkSizer picks the number of objects of the next scrub chunk from the
+ * time the previous chunks took, rather than from a fixed count.
+ *
+ * The writes to a chunk's range are blocked from the moment the range is
+ * selected until the chunk's maps were compared. A chunk of small objects
+ * takes little time, so it may hold many more of them than a chunk of
+ * large objects, for the same blocking of the client IO. The time per
+ * object is an exponentially weighted moving average over the chunks
+ * handled so far; the size picked is the target duration divided by it.
+ */
+class ChunkSizer {
+ public:
+  /**
+   * @param target   the desired duration of a chunk; 0 disables the sizing
+   * @param min_sz   the fewest objects in a chunk
+   * @param max_sz   the most objects in a chunk
+   * @return the number of objects for the next chunk: max_sz if disabled,
+   *         min_sz until a chunk was timed, otherwise within [min_sz, max_sz]
+   */
+  int next_size(ceph::timespan target, int min_sz, int max_sz) const
+  {
+    if (target == ceph::timespan::zero()) {
+      return max_sz;
+    }
+    if (m_per_object <= 0) {
+      return min_sz;
+    }
+    const double fit =
+      std::chrono::duration<double>(target).count() / m_per_object;
+    return static_cast<int>(
+      std::clamp(std::floor(fit), double(min_sz), double(max_sz)));
+  }
+
+  /// account a chunk of 'objects' objects that took 'elapsed'
+  void add_sample(ceph::timespan elapsed, int objects)
+  {
+    if (objects <= 0 || elapsed <= ceph::timespan::zero()) {
+      return;
+    }
+    const double per_object =
+      std::chrono::duration<double>(elapsed).count() / objects;
+    if (m_per_object <= 0) {
+      m_per_object = per_object;
+    } else {
+      m_per_object = alpha * per_object + (1 - alpha) * m_per_object;
+    }
+  }
+
+  /// @return the average time per object, zero until a chunk was timed
+  ceph::timespan get_per_object() const
+  {
+    return ceph::make_timespan(m_per_object);
+  }
+
+ private:
+  static constexpr double alpha = 0.3;
+  double m_per_object{0};  ///< seconds
+};
+
+}  // namespace Scrub
@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "./scrub_compare_pool.h"
+
+#include <algorithm>
+
+#include "common/Thread.h"
+#include "common/ceph_context.h"
+
+using namespace Scrub;
+
+ComparePool& ComparePool::get(CephContext* cct)
+{
+  return cct->lookup_or_create_singleton_object<ComparePool>(
+    "osd_scrub_compare_pool", true);
+}
+
+ComparePool::~ComparePool()
+{
+  {
+    std::lock_guard l{m_lock};
+    m_stopping = true;
+  }
+  m_cond.notify_all();
+  for (auto& t : m_threads) {
+    t.join();
+  }
+}
+
+size_t ComparePool::claim(batch_t& b)
+{
+  size_t i = b.next++;
+  if (b.next == b.tasks.size()) {
+    m_batches.erase(std::find(m_batches.begin(), m_batches.end(), &b));
+  }
+  return i;
+}
+
+void ComparePool::run(std::vector<task_t>& tasks, size_t max_threads)
+{
+  if (tasks.empty()) {
+    return;
+  }
+  batch_t b{tasks};
+  {
+    std::lock_guard l{m_lock};
+    while (m_threads.size() < max_threads) {
+      m_threads.push_back(make_named_thread("scrub_cmp", [this] { worker(); }));
+    }
+    m_batches.push_back(&b);
+  }
+  m_cond.notify_all();
+
+  std::unique_lock l{m_lock};
+  while (b.next < tasks.size()) {
+    size_t i = claim(b);
+    l.unlock();
+    tasks[i]();
+    l.lock();
+    ++b.done;
+  }
+  b.cond.wait(l, [&] { return b.done == tasks.size(); });
+}
+
+void ComparePool::worker()
+{
+  std::unique_lock l{m_lock};
+  while (!m_stopping) {
+    if (m_batches.empty()) {
+      m_cond.wait(l);
+      continue;
+    }
+    auto& b = *m_batches.front();
+    size_t i = claim(b);
+    l.unlock();
+    b.tasks[i]();
+    l.lock();
+    if (++b.done == b.tasks.size()) {
+      b.cond.notify_all();
+    }
+  }
+}
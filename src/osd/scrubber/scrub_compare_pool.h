@@ -0,0 +1,62 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+
+class CephContext;
+
+namespace Scrub {
+
+/**
+ * ComparePool holds the threads that help comparing the scrub maps of
+ * large chunks, one pool shared by all the PGs of the OSD.
+ *
+ * The PG handing its ranges over runs them as well, and takes back the
+ * ones no pool thread picked up yet. It thus never waits for the ranges of
+ * other PGs, and however many PGs scrub at once, no more than the pool's
+ * threads help them.
+ */
+class ComparePool {
+ public:
+  using task_t = std::function<void()>;
+
+  /// the pool of the process cct belongs to
+  static ComparePool& get(CephContext* cct);
+
+  ~ComparePool();
+
+  /**
+   * run tasks, some of them on the pool's threads
+   *
+   * @param max_threads  the pool grows up to this many threads
+   * @return once every task is done
+   */
+  void run(std::vector<task_t>& tasks, size_t max_threads);
+
+ private:
+  struct batch_t {
+    std::vector<task_t>& tasks;
+    size_t next = 0;  ///< the first task not started yet
+    size_t done = 0;
+    ceph::condition_variable cond;
+  };
+
+  ceph::mutex m_lock = ceph::make_mutex("Scrub::ComparePool::m_lock");
+  ceph::condition_variable m_cond;
+  /// batches with tasks not started yet
+  std::deque<batch_t*> m_batches;
+  std::vector<std::thread> m_threads;
+  bool m_stopping{false};
+
+  /// the next task of b; b leaves m_batches with its last one
+  size_t claim(batch_t& b);
+  void worker();
+};
+
+}  // namespace Scrub
@@ -39,4 +39,9 @@
      --read <file>           calculate pg upmap entries to balance pg primaries
      --read-pool <poolname>  specify which pool the read balancer should adjust
      --vstart                prefix upmap and read output with './bin/'
+     --bench-apply <epochs> [--bench-keep <maps>]
+                             time applying <epochs> synthetic incrementals,
+                             keeping the last <maps> maps [default: 50]
+     --bench-mapping <rounds> time mapping all pgs <rounds> times, one pg
+                             at a time and one pool at a time
   [1]
@@ -0,0 +1,130 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "common/TrackedOp.h"
+#include "common/Formatter.h"
+#include "global/global_context.h"
+
+using namespace std;
+
+namespace {
+
+struct TestOp : public TrackedOp {
+  explicit TestOp(OpTracker *tracker)
+    : TrackedOp(tracker, ceph_clock_now()) {}
+
+  bool is_sampled() const {
+    return sampled;
+  }
+  size_t num_events() const {
+    std::lock_guard l(lock);
+    return events.size();
+  }
+
+protected:
+  void _dump_op_descriptor(ostream& stream) const override {
+    stream << "test_op(" << seq << ")";
+  }
+};
+
+TrackedOpRef start_op(OpTracker *tracker)
+{
+  auto op = new TestOp(tracker);
+  TrackedOpRef ref(op);
+  op->tracking_start();
+  op->mark_event("started");
+  return ref;
+}
+
+} // anonymous namespace
+
+TEST(OpTracker, sample_rate)
+{
+  OpTracker tracker(g_ceph_context, true, 1);
+  auto count = [&] {
+    unsigned n = 0;
+    for (uint64_t seq = 1; seq <= 1000; ++seq) {
+      n += tracker.is_sampled(seq);
+    }
+    return n;
+  };
+  ASSERT_EQ(1000u, count());
+  tracker.set_sample_rate(0.25);
+  ASSERT_EQ(250u, count());
+  ASSERT_FALSE(tracker.is_sampled(1));
+  ASSERT_TRUE(tracker.is_sampled(4));
+  tracker.set_sample_rate(0);
+  ASSERT_EQ(0u, count());
+  tracker.on_shutdown();
+}
+
+TEST(OpTracker, unsampled_ops)
+{
+  OpTracker tracker(g_ceph_context, true, 4);
+  tracker.set_history_size_and_duration(1000, 600);
+  tracker.set_history_slow_op_size_and_threshold(20, 10);
+  tracker.set_sample_rate(0);
+
+  {
+    auto op = start_op(&tracker);
+    auto test_op = static_cast<TestOp*>(op.get());
+    ASSERT_FALSE(test_op->is_sampled());
+    ASSERT_EQ(0u, test_op->num_events());
+  }
+  // ops completed by other threads end up in the rings of those threads
+  std::thread t([&] {
+    for (int i = 0; i < 10; ++i) {
+      start_op(&tracker);
+    }
+  });
+  t.join();
+
+  auto ops = tracker.get_unsampled_history();
+  ASSERT_EQ(11u, ops.size());
+  set<uint64_t> seqs;
+  for (auto& op : ops) {
+    seqs.insert(op.seq);
+    ASSERT_LE(op.initiated, op.done);
+  }
+  ASSERT_EQ(11u, seqs.size());
+
+  JSONFormatter f;
+  ASSERT_TRUE(tracker.dump_historic_ops(&f));
+  stringstream ss;
+  f.flush(ss);
+  ASSERT_NE(string::npos, ss.str().find("\"unsampled_ops\""));
+  tracker.on_shutdown();
+}
+
+TEST(OpTracker, unsampled_ring_wraps)
+{
+  OpTracker tracker(g_ceph_context, true, 1);
+  tracker.set_history_slow_op_size_and_threshold(20, 10);
+  tracker.set_sample_rate(0);
+  const unsigned n = OPTRACKER_HISTORY_RING_SIZE + 10;
+  for (unsigned i = 0; i < n; ++i) {
+    start_op(&tracker);
+  }
+  auto ops = tracker.get_unsampled_history();
+  ASSERT_EQ((size_t)OPTRACKER_HISTORY_RING_SIZE, ops.size());
+  for (auto& op : ops) {
+    // the oldest ones were overwritten
+    ASSERT_GT(op.seq, 10u);
+  }
+  tracker.on_shutdown();
+}
+
+TEST(OpTracker, slow_unsampled_op_is_kept_whole)
+{
+  OpTracker tracker(g_ceph_context, true, 1);
+  tracker.set_history_size_and_duration(20, 600);
+  tracker.set_history_slow_op_size_and_threshold(20, 0);
+  tracker.set_sample_rate(0);
+  start_op(&tracker);
+  ASSERT_TRUE(tracker.get_unsampled_history().empty());
+  tracker.on_shutdown();
+}
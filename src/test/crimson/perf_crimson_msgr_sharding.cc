@@ -0,0 +1,389 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Measure how the crimson messenger scales with the number of reactors.
+ *
+ * The server messenger accepts on every shard (dispatch_only_on_this_shard
+ * is false), so connections are balanced across cores by the kernel and
+ * each MOSDOp is decoded on the core owning its socket.  With
+ * --handoff=pg every op is then handed, without copying, to the core its
+ * PG maps to through a seastar::foreign_ptr, mirroring what the OSD does
+ * when the socket core and the PG core differ; the reply is sent from the
+ * socket core again.  With --handoff=none ops are answered where they were
+ * decoded, which gives the upper bound.
+ *
+ * Clients run in the same process, one messenger per shard, each keeping
+ * --depth ops in flight on each of its --conns connections.  Run it with
+ * increasing --smp to see the per-core rates as the core count scales:
+ *
+ *   perf-crimson-msgr-sharding --smp 4 --handoff pg --duration 10
+ */
+
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+#include <seastar/core/app-template.hh>
+#include <seastar/core/do_with.hh>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/sharded.hh>
+#include <seastar/core/sleep.hh>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "messages/MOSDOp.h"
+#include "messages/MOSDOpReply.h"
+#include "crimson/auth/DummyAuth.h"
+#include "crimson/common/config_proxy.h"
+#include "crimson/common/log.h"
+#include "crimson/net/Connection.h"
+#include "crimson/net/Dispatcher.h"
+#include "crimson/net/Messenger.h"
+
+using namespace std::chrono_literals;
+namespace bpo = boost::program_options;
+using crimson::common::local_conf;
+
+namespace {
+
+seastar::logger& logger() {
+  return crimson::get_logger(ceph_subsys_test);
+}
+
+template <typename T, typename... Args>
+seastar::future<T*> create_sharded(Args... args) {
+  // we should only construct/stop shards on #0
+  return seastar::smp::submit_to(0, [=] {
+    auto sharded_obj = seastar::make_lw_shared<seastar::sharded<T>>();
+    return sharded_obj->start(args...
+    ).then([sharded_obj] {
+      seastar::engine().at_exit([sharded_obj] {
+        return sharded_obj->stop().then([sharded_obj] {});
+      });
+      return sharded_obj.get();
+    });
+  }).then([](seastar::sharded<T> *ptr_shard) {
+    return &ptr_shard->local();
+  });
+}
+
+enum class handoff_t {
+  none,
+  pg,
+};
+
+struct core_stats_t {
+  uint64_t received = 0;   // ops decoded on this core
+  uint64_t handled = 0;    // ops executed on this core
+  uint64_t handed_off = 0; // ops sent to another core to be executed
+};
+
+class Server final
+  : public crimson::net::Dispatcher,
+    public seastar::peering_sharded_service<Server> {
+public:
+  Server(seastar::shard_id msgr_sid, handoff_t handoff)
+    : msgr_sid{msgr_sid}, handoff{handoff} {}
+
+  seastar::future<> init(const entity_addr_t& addr) {
+    return container().invoke_on(msgr_sid, [addr](auto &server) {
+      server.msgr = crimson::net::Messenger::create(
+        entity_name_t::OSD(0), "server", 0, false);
+      server.msgr->set_default_policy(
+        crimson::net::SocketPolicy::stateless_server(0));
+      server.msgr->set_auth_client(&server.dummy_auth);
+      server.msgr->set_auth_server(&server.dummy_auth);
+      return server.msgr->bind(entity_addrvec_t{addr}
+      ).safe_then([&server] {
+        return server.msgr->start({&server});
+      }, crimson::net::Messenger::bind_ertr::all_same_way(
+          [addr] (const std::error_code& e) {
+        logger().error("Server: there is another instance running at {}", addr);
+        ceph_abort();
+      }));
+    });
+  }
+
+  seastar::future<> shutdown() {
+    return container().invoke_on(msgr_sid, [](auto &server) {
+      server.msgr->stop();
+      return server.msgr->shutdown();
+    }).then([this] {
+      return container().invoke_on_all([](auto &server) {
+        return server.gate.close();
+      });
+    });
+  }
+
+  seastar::future<std::vector<core_stats_t>> collect_stats() {
+    return container().map([](auto &server) {
+      return server.stats;
+    });
+  }
+
+  static seastar::future<Server*> create(handoff_t handoff) {
+    return create_sharded<Server>(seastar::this_shard_id(), handoff);
+  }
+
+private:
+  std::optional<seastar::future<>> ms_dispatch(
+      crimson::net::ConnectionRef c, MessageRef m) override {
+    ceph_assert(m->get_type() == CEPH_MSG_OSD_OP);
+    auto &local = container().local();
+    ++local.stats.received;
+
+    auto req = boost::static_pointer_cast<MOSDOp>(m);
+    seastar::shard_id target = seastar::this_shard_id();
+    if (handoff == handoff_t::pg) {
+      // same mapping as the OSD's PG-to-core assignment
+      target = req->get_spg().pgid.ps() % seastar::smp::count;
+    }
+    if (target == seastar::this_shard_id()) {
+      ++local.stats.handled;
+      std::ignore = c->send(make_reply(*req));
+      return {seastar::now()};
+    }
+
+    ++local.stats.handed_off;
+    std::ignore = seastar::with_gate(local.gate, [this, c, req, target] {
+      // the message is only borrowed by the target core: its refcount is
+      // not atomic, so the reference must be dropped where it was taken
+      return seastar::smp::submit_to(
+        target, [this, fm=seastar::make_foreign(req)] {
+        ++container().local().stats.handled;
+        return fm->ops.size() == 1 ? 0 : -EINVAL;
+      }).then([c, req](int r) {
+        // the connection can only be used on its own core
+        return c->send(make_reply(*req, r));
+      });
+    });
+    return {seastar::now()};
+  }
+
+  static MURef<MOSDOpReply> make_reply(const MOSDOp &req, int r = 0) {
+    return crimson::make_message<MOSDOpReply>(
+      &req, r, 0, CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK, false);
+  }
+
+  // msgr_sid only
+  const seastar::shard_id msgr_sid;
+  crimson::net::MessengerRef msgr;
+  crimson::auth::DummyAuthClientServer dummy_auth;
+
+  // per shard
+  const handoff_t handoff;
+  core_stats_t stats;
+  seastar::gate gate;
+};
+
+class Client final
+  : public crimson::net::Dispatcher,
+    public seastar::peering_sharded_service<Client> {
+public:
+  Client(unsigned num_conns, unsigned depth)
+    : num_conns{num_conns}, depth{depth} {}
+
+  seastar::future<> init(const entity_addr_t& server_addr) {
+    return container().invoke_on_all([server_addr](auto &client) {
+      auto sid = seastar::this_shard_id();
+      client.msgr = crimson::net::Messenger::create(
+        entity_name_t::CLIENT(sid + 1), "client", sid + 1, true);
+      client.msgr->set_default_policy(
+        crimson::net::SocketPolicy::lossy_client(0));
+      client.msgr->set_auth_client(&client.dummy_auth);
+      client.msgr->set_auth_server(&client.dummy_auth);
+      return client.msgr->start({&client}).then([&client, server_addr] {
+        for (unsigned i = 0; i < client.num_conns; ++i) {
+          client.conns.push_back(
+            client.msgr->connect(server_addr, entity_name_t::TYPE_OSD));
+        }
+      });
+    });
+  }
+
+  seastar::future<> run(std::chrono::seconds duration) {
+    return container().invoke_on_all([duration](auto &client) {
+      client.stop_time = mono_clock::now() + duration;
+      for (auto &conn : client.conns) {
+        for (unsigned i = 0; i < client.depth; ++i) {
+          client.send_one(conn);
+        }
+      }
+      return seastar::sleep(duration);
+    }).then([this] {
+      // wait for the ops in flight
+      return container().invoke_on_all([](auto &client) {
+        return client.gate.close();
+      });
+    });
+  }
+
+  seastar::future<> shutdown() {
+    return container().invoke_on_all([](auto &client) {
+      client.msgr->stop();
+      return client.msgr->shutdown();
+    });
+  }
+
+  seastar::future<std::vector<uint64_t>> collect_completed() {
+    return container().map([](auto &client) {
+      return client.completed;
+    });
+  }
+
+  static seastar::future<Client*> create(unsigned num_conns, unsigned depth) {
+    return create_sharded<Client>(num_conns, depth);
+  }
+
+private:
+  void send_one(crimson::net::ConnectionRef conn) {
+    if (mono_clock::now() >= stop_time) {
+      return;
+    }
+    // spread the objects over the PGs and thereby over the server cores
+    pg_t pgid(next_ps++, 0);
+    hobject_t hobj(object_t(fmt::format("obj{}", next_ps)), "", CEPH_NOSNAP,
+                   pgid.ps(), pgid.pool(), "");
+    auto m = crimson::make_message<MOSDOp>(
+      0, ++next_tid, hobj, spg_t(pgid), 0, CEPH_OSD_FLAG_READ, 0);
+    m->stat();
+    std::ignore = seastar::with_gate(gate, [conn, m=std::move(m)]() mutable {
+      return conn->send(std::move(m));
+    });
+  }
+
+  std::optional<seastar::future<>> ms_dispatch(
+      crimson::net::ConnectionRef c, MessageRef m) override {
+    ceph_assert(m->get_type() == CEPH_MSG_OSD_OPREPLY);
+    auto &local = container().local();
+    ++local.completed;
+    local.send_one(c);
+    return {seastar::now()};
+  }
+
+  const unsigned num_conns;
+  const unsigned depth;
+  crimson::net::MessengerRef msgr;
+  crimson::auth::DummyAuthClientServer dummy_auth;
+  std::vector<crimson::net::ConnectionRef> conns;
+  mono_time stop_time;
+  uint32_t next_ps = 0;
+  ceph_tid_t next_tid = 0;
+  uint64_t completed = 0;
+  seastar::gate gate;
+};
+
+seastar::future<> run_bench(handoff_t handoff,
+                            unsigned num_conns,
+                            unsigned depth,
+                            std::chrono::seconds duration)
+{
+  entity_addr_t addr;
+  addr.parse("v2:127.0.0.1:9030", nullptr);
+  return seastar::when_all_succeed(
+    Server::create(handoff),
+    Client::create(num_conns, depth)
+  ).then_unpack([addr, duration](auto *server, auto *client) {
+    return server->init(addr).then([client, addr] {
+      return client->init(addr);
+    }).then([client] {
+      // let the connections settle on their cores
+      return seastar::sleep(500ms);
+    }).then([client, duration] {
+      logger().info("running for {}s on {} cores...",
+                    duration.count(), seastar::smp::count);
+      return client->run(duration);
+    }).then([server, client, duration] {
+      return seastar::when_all_succeed(
+        server->collect_stats(),
+        client->collect_completed()
+      ).then_unpack([duration](auto stats, auto completed) {
+        double secs = duration.count();
+        uint64_t total_handled = 0;
+        uint64_t total_completed = 0;
+        for (unsigned i = 0; i < seastar::smp::count; ++i) {
+          logger().info("core {}: received {:.0f}/s, handled {:.0f}/s, "
+                        "handed off {:.0f}/s, client completed {:.0f}/s",
+                        i,
+                        stats[i].received / secs,
+                        stats[i].handled / secs,
+                        stats[i].handed_off / secs,
+                        completed[i] / secs);
+          total_handled += stats[i].handled;
+          total_completed += completed[i];
+        }
+        logger().info("total: {:.0f} ops/s handled by the server, "
+                      "{:.0f} ops/s per core, {:.0f} ops/s completed",
+                      total_handled / secs,
+                      total_handled / secs / seastar::smp::count,
+                      total_completed / secs);
+      });
+    }).then([client] {
+      return client->shutdown();
+    }).then([server] {
+      return server->shutdown();
+    });
+  });
+}
+
+seastar::future<> do_bench(seastar::app_template& app)
+{
+  std::vector<const char*> args;
+  std::string cluster;
+  std::string conf_file_list;
+  auto init_params = ceph_argparse_early_args(args,
+                                              CEPH_ENTITY_TYPE_CLIENT,
+                                              &cluster,
+                                              &conf_file_list);
+  return crimson::common::sharded_conf().start(
+    init_params.name, cluster
+  ).then([] {
+    return local_conf().start();
+  }).then([&app] {
+    auto&& config = app.configuration();
+    auto handoff_str = config["handoff"].as<std::string>();
+    handoff_t handoff;
+    if (handoff_str == "pg") {
+      handoff = handoff_t::pg;
+    } else if (handoff_str == "none") {
+      handoff = handoff_t::none;
+    } else {
+      throw std::invalid_argument(
+        fmt::format("unknown handoff mode {}", handoff_str));
+    }
+    auto conns = config["conns"].as<unsigned>();
+    auto depth = config["depth"].as<unsigned>();
+    auto duration = std::chrono::seconds(config["duration"].as<unsigned>());
+    logger().info("handoff={}, conns={} per core, depth={}, smp={}",
+                  handoff_str, conns, depth, seastar::smp::count);
+    return run_bench(handoff, conns, depth, duration);
+  }).finally([] {
+    return crimson::common::sharded_conf().stop();
+  });
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  seastar::app_template app;
+  app.add_options()
+    ("handoff", bpo::value<std::string>()->default_value("pg"),
+     "where ops are executed: \"pg\" hands them off to the core of their PG, "
+     "\"none\" executes them on the core that decoded them")
+    ("conns", bpo::value<unsigned>()->default_value(4),
+     "number of client connections per core")
+    ("depth", bpo::value<unsigned>()->default_value(16),
+     "ops in flight per connection")
+    ("duration", bpo::value<unsigned>()->default_value(10),
+     "seconds to run");
+  return app.run(argc, argv, [&app] {
+    return do_bench(app).then([] {
+      return 0;
+    }).handle_exception([](auto eptr) {
+      logger().error("perf-crimson-msgr-sharding failed: {}", eptr);
+      return 1;
+    });
+  });
+}
@@ -265,6 +265,41 @@ TEST_F(CRUSHTest, indep_out_progressive) {
 
 }
 
+TEST_F(CRUSHTest, do_rule_batch) {
+  // hosts of 37 osds, so that straw2 hashes full and partial blocks
+  std::unique_ptr<CrushWrapper> c(build_indep_map(cct, 3, 2, 37));
+  vector<__u32> weight(c->get_max_devices(), 0x10000);
+  for (unsigned i = 0; i < weight.size(); i += 7) {
+    weight[i] = 0;
+  }
+  weight[1] = 0x8000;
+  vector<int> xs;
+  for (int x = 0; x < 1000; ++x) {
+    xs.push_back(x * 7919);
+  }
+  vector<vector<int>> batch;
+  c->do_rule_batch(0, xs, batch, 5, weight, 0);
+  ASSERT_EQ(xs.size(), batch.size());
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    vector<int> out;
+    c->do_rule(0, xs[i], out, 5, weight, 0);
+    ASSERT_EQ(out, batch[i]) << "x " << xs[i];
+  }
+}
+
+TEST_F(CRUSHTest, hash32_3_block) {
+  vector<__s32> b;
+  for (int i = -20; i < 23; ++i) {
+    b.push_back(i * 104729);
+  }
+  vector<__u32> out(b.size());
+  crush_hash32_3_block(CRUSH_HASH_RJENKINS1, 1234, b.data(), 5, out.data(),
+		       b.size());
+  for (unsigned i = 0; i < b.size(); ++i) {
+    ASSERT_EQ(crush_hash32_3(CRUSH_HASH_RJENKINS1, 1234, b[i], 5), out[i]);
+  }
+}
+
 TEST_F(CRUSHTest, straw_zero) {
   // zero weight items should have no effect on placement.
 
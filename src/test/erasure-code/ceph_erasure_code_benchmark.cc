@@ -59,7 +59,9 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run encode, decode or overwrite")
+    ("overwrite-size", po::value<int>()->default_value(4096),
+     "size of the partial stripe overwrite of the overwrite workload")
     ("erasures,e", po::value<int>()->default_value(1),
      "number of erasures when decoding")
     ("erased", po::value<vector<int> >(),
@@ -119,6 +121,7 @@ int ErasureCodeBench::setup(int argc, char** argv) {
   }
 
   in_size = vm["size"].as<int>();
+  overwrite_size = vm["overwrite-size"].as<int>();
   max_iterations = vm["iterations"].as<int>();
   plugin = vm["plugin"].as<string>();
   workload = vm["workload"].as<string>();
@@ -158,6 +161,8 @@ int ErasureCodeBench::run() {
 
   if (workload == "encode")
     return encode();
+  else if (workload == "overwrite")
+    return overwrite();
   else
     return decode();
 }
@@ -194,6 +199,103 @@ int ErasureCodeBench::encode()
   return 0;
 }
 
+/*
+ * Overwrite overwrite_size bytes at the start of a stripe of size bytes,
+ * either re-encoding the stripe, which reads the k data chunks and
+ * writes all the chunks, or encoding the difference between the old
+ * and new content of the modified chunks, which reads and writes only
+ * those and the coding chunks.  Displays, for each, the time and the
+ * KB read and written for all the iterations.
+ */
+int ErasureCodeBench::overwrite()
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf().get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+  if (!(erasure_code->get_supported_optimizations() &
+	ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION)) {
+    cerr << "plugin " << plugin << " does not support parity deltas" << endl;
+    return -EOPNOTSUPP;
+  }
+
+  const unsigned chunk_size = erasure_code->get_chunk_size(in_size);
+  const unsigned stripe_width = chunk_size * k;
+  if (overwrite_size <= 0 || (unsigned)overwrite_size > stripe_width) {
+    cerr << "--overwrite-size must be between 1 and " << stripe_width << endl;
+    return -EINVAL;
+  }
+  const unsigned modified = (overwrite_size + chunk_size - 1) / chunk_size;
+
+  bufferlist in;
+  in.append(string(stripe_width, 'X'));
+  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  set<int> want_to_encode, coding;
+  for (int i = 0; i < k + m; i++) {
+    want_to_encode.insert(i);
+    if (i >= k)
+      coding.insert(i);
+  }
+  map<int,bufferlist> encoded;
+  code = erasure_code->encode(want_to_encode, in, &encoded);
+  if (code)
+    return code;
+
+  utime_t begin_time = ceph_clock_now();
+  for (int i = 0; i < max_iterations; i++) {
+    bufferlist stripe;
+    stripe.append(in.c_str(), stripe_width);
+    stripe.begin().copy_in(overwrite_size, string(overwrite_size, 'Y').c_str());
+    std::map<int,bufferlist> out;
+    code = erasure_code->encode(want_to_encode, stripe, &out);
+    if (code)
+      return code;
+  }
+  utime_t end_time = ceph_clock_now();
+  cout << "full\t" << (end_time - begin_time)
+       << "\t" << (uint64_t)max_iterations * k * chunk_size / 1024
+       << "\t" << (uint64_t)max_iterations * (k + m) * chunk_size / 1024
+       << endl;
+
+  begin_time = ceph_clock_now();
+  for (int i = 0; i < max_iterations; i++) {
+    bufferptr delta = buffer::create_aligned(stripe_width,
+					     ErasureCode::SIMD_ALIGN);
+    delta.zero();
+    char *d = delta.c_str();
+    const char *old_data = in.c_str();
+    for (int j = 0; j < overwrite_size; j++) {
+      d[j] = old_data[j] ^ 'Y';
+    }
+    bufferlist delta_bl;
+    delta_bl.push_back(std::move(delta));
+    std::map<int,bufferlist> out;
+    code = erasure_code->encode(coding, delta_bl, &out);
+    if (code)
+      return code;
+    for (auto &&c : coding) {
+      bufferptr parity(encoded[c].c_str(), chunk_size);
+      char *p = parity.c_str();
+      const char *e = out[c].c_str();
+      for (unsigned j = 0; j < chunk_size; j++) {
+	p[j] ^= e[j];
+      }
+    }
+  }
+  end_time = ceph_clock_now();
+  cout << "delta\t" << (end_time - begin_time)
+       << "\t" << (uint64_t)max_iterations * (modified + m) * chunk_size / 1024
+       << "\t" << (uint64_t)max_iterations * (modified + m) * chunk_size / 1024
+       << endl;
+  return 0;
+}
+
 static void display_chunks(const map<int,bufferlist> &chunks,
 			   unsigned int chunk_count) {
   cout << "chunks ";
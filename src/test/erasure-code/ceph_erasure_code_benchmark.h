@@ -32,6 +32,7 @@
 
 class ErasureCodeBench {
   int in_size;
+  int overwrite_size;
   int max_iterations;
   int erasures;
   int k;
@@ -57,6 +58,7 @@ public:
 		      ErasureCodeInterfaceRef erasure_code);
   int decode();
   int encode();
+  int overwrite();
 };
 
 #endif
@@ -331,6 +331,27 @@ TEST(EventCenterTest, DispatchTest) {
   worker2.join();
 }
 
+TEST(EventCenterTest, BusyPollDispatchTest) {
+  Worker worker(g_ceph_context, 3);
+  // long enough for the next event to arrive while we are still polling
+  worker.center.set_busy_poll(100000);
+  std::atomic<unsigned> count = { 0 };
+  ceph::mutex lock = ceph::make_mutex("BusyPollDispatchTest::lock");
+  ceph::condition_variable cond;
+  worker.create("worker_3");
+  for (int i = 0; i < 10000; ++i) {
+    count++;
+    worker.center.dispatch_event_external(EventCallbackRef(new CountEvent(&count, &lock, &cond)));
+    std::unique_lock l{lock};
+    cond.wait(l, [&] { return count == 0; });
+  }
+  worker.stop();
+  worker.join();
+  auto stats = worker.center.take_busy_poll_stats();
+  ASSERT_GT(stats.hits, 0u);
+  ASSERT_GT(stats.time, ceph::timespan::zero());
+}
+
 INSTANTIATE_TEST_SUITE_P(
   AsyncMessenger,
   EventDriverTest,
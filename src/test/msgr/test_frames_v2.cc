@@ -422,6 +422,80 @@ INSTANTIATE_TEST_SUITE_P(
         ::testing::ValuesIn(round_trip_instances),
         ::testing::ValuesIn(modes)));
 
+TEST(CompressionStreamTest, Unsupported) {
+  // a peer may ask for a stream the compressor does not support
+  CompConnectionMeta comp_meta;
+  comp_meta.con_mode = Compressor::COMP_FORCE;
+  comp_meta.con_method = Compressor::COMP_ALG_ZLIB;
+  comp_meta.con_stream = true;
+  auto comp = ceph::compression::onwire::rxtx_t::create_handler_pair(
+    g_ceph_context, comp_meta, /*min_compress_size=*/COMP_THRESHOLD);
+  ASSERT_FALSE(comp.rx);
+  ASSERT_FALSE(comp.tx);
+
+  // or a dictionary we do not have
+  comp_meta.con_method = Compressor::COMP_ALG_ZSTD;
+  comp_meta.con_dictionary_id = 7;
+  comp = ceph::compression::onwire::rxtx_t::create_handler_pair(
+    g_ceph_context, comp_meta, /*min_compress_size=*/COMP_THRESHOLD);
+  ASSERT_FALSE(comp.rx);
+  ASSERT_FALSE(comp.tx);
+}
+
+TEST(CompressionStreamTest, RoundTrip) {
+  constexpr uint64_t threshold = COMP_THRESHOLD;
+  ceph::crypto::onwire::rxtx_t crypto;
+  CompConnectionMeta comp_meta;
+  comp_meta.con_mode = Compressor::COMP_FORCE;
+  comp_meta.con_method = Compressor::COMP_ALG_ZSTD;
+  comp_meta.con_stream = true;
+  // zstd also takes raw content as a dictionary
+  bufferlist dict;
+  for (int i = 0; i < 64; i++) {
+    dict.append("pg_log_entry_t(modify rbd_data.10236b8b4567.");
+  }
+  auto tx_comp = ceph::compression::onwire::rxtx_t::create_handler_pair(
+    g_ceph_context, comp_meta, /*min_compress_size=*/COMP_THRESHOLD, dict);
+  auto rx_comp = ceph::compression::onwire::rxtx_t::create_handler_pair(
+    g_ceph_context, comp_meta, /*min_compress_size=*/COMP_THRESHOLD, dict);
+  FrameAssembler tx_frame_asm(&crypto, true, true, &tx_comp);
+  FrameAssembler rx_frame_asm(&crypto, true, true, &rx_comp);
+
+  uint64_t first_onwire_len = 0;
+  for (int i = 0; i < 100; i++) {
+    bufferlist header = make_bufferlist(53, 'H');
+    bufferlist front;
+    while (front.length() < 2 * threshold) {
+      front.append("pg_log_entry_t(modify rbd_data.10236b8b4567." +
+                   std::to_string(i) + ")");
+    }
+    bufferlist data;
+    if (i % 2) {
+      // below the threshold: sent uncompressed, not part of the stream
+      front.clear();
+      front.append("small");
+    }
+    auto tx_frame = TestFrame::Encode(header, front, {}, data);
+    auto onwire_bl = tx_frame.get_buffer(tx_frame_asm);
+    if (i % 2 == 0) {
+      ASSERT_LT(onwire_bl.length(), front.length());
+    }
+    if (i == 0) {
+      first_onwire_len = onwire_bl.length();
+    }
+
+    Tag rx_tag;
+    segment_bls_t rx_segment_bls;
+    ASSERT_TRUE(disassemble_frame(rx_frame_asm, onwire_bl, rx_tag,
+                                  rx_segment_bls));
+    auto rx_frame = TestFrame::Decode(rx_segment_bls);
+    ASSERT_TRUE(header.contents_equal(rx_frame.header()));
+    ASSERT_TRUE(front.contents_equal(rx_frame.front()));
+  }
+  // the dictionary makes even the first frame small
+  EXPECT_LT(first_onwire_len, threshold / 2);
+}
+
 class RoundTripPerfTest : public RoundTripTestBase {};
 
 TEST_P(RoundTripPerfTest, DISABLED_Basic) {
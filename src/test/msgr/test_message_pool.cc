@@ -0,0 +1,124 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "messages/MOSDOp.h"
+#include "msg/MessagePool.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+// only allocations made by the test thread while counting is set are
+// recorded; the context's service threads keep allocating in the background
+thread_local bool counting = false;
+thread_local unsigned num_allocs = 0;
+
+struct PooledObj final {
+  char pad[200];
+  MESSAGE_POOL_HELPERS(PooledObj);
+};
+
+} // anonymous namespace
+
+void *operator new(std::size_t size)
+{
+  if (counting)
+    ++num_allocs;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+using pooled_obj_pool = ceph::msg::message_pool<PooledObj>;
+
+TEST(MessagePool, recycle_same_thread)
+{
+  auto before = pooled_obj_pool::instance().get_stats();
+  auto a = new PooledObj;
+  delete a;
+
+  counting = true;
+  num_allocs = 0;
+  auto b = new PooledObj;
+  counting = false;
+  ASSERT_EQ(a, b);
+  ASSERT_EQ(0u, num_allocs);
+  delete b;
+
+  auto after = pooled_obj_pool::instance().get_stats();
+  ASSERT_GE(after.recycled, before.recycled + 1);
+}
+
+TEST(MessagePool, recycle_across_threads)
+{
+  // producer/consumer: allocated here, released by another thread, the way
+  // messenger workers and OSD shards hand messages over
+  constexpr unsigned n = 1000;
+  std::vector<PooledObj*> objs;
+  for (unsigned i = 0; i < n; ++i)
+    objs.push_back(new PooledObj);
+
+  std::thread releaser([&objs] {
+    for (auto o : objs)
+      delete o;
+  });
+  releaser.join();
+  objs.clear();
+
+  auto before = pooled_obj_pool::instance().get_stats();
+  for (unsigned i = 0; i < n; ++i)
+    objs.push_back(new PooledObj);
+  auto after = pooled_obj_pool::instance().get_stats();
+  // everything but the tail that did not fill a whole batch comes back
+  ASSERT_GE(after.recycled - before.recycled, n - 64);
+  for (auto o : objs)
+    delete o;
+}
+
+TEST(MessagePool, mosdop_decode_allocations)
+{
+  hobject_t hoid(object_t("obj"), "", CEPH_NOSNAP, 0x1234, 1, "");
+  spg_t pgid(pg_t(0x1234, 1));
+  auto src = ceph::make_message<MOSDOp>(1, 2, hoid, pgid, 3,
+					 CEPH_OSD_FLAG_READ, CEPH_FEATURES_ALL);
+  src->stat();
+  src->encode(CEPH_FEATURES_ALL, 0);
+  ceph::buffer::list front = src->get_payload();
+  front.rebuild();
+  ceph_msg_header header = src->get_header();
+
+  // warm up the pool so the message itself comes from a cache
+  ceph::make_message<MOSDOp>().reset();
+
+  counting = true;
+  num_allocs = 0;
+  {
+    auto m = ceph::make_message<MOSDOp>();
+    m->set_header(header);
+    m->set_payload(front);
+    m->decode_payload();
+    m->finish_decode();
+    counting = false;
+
+    ASSERT_EQ(hoid, m->get_hobj());
+    ASSERT_EQ(1u, m->ops.size());
+    ASSERT_EQ(CEPH_OSD_OP_STAT, m->ops[0].op.op);
+  }
+  // the ops vector is the only thing left to allocate for a small op with
+  // a short object name; anything more is a regression
+  ASSERT_LE(num_allocs, 1u);
+}
@@ -2393,6 +2393,9 @@ INSTANTIATE_TEST_SUITE_P(
   Messenger,
   MessengerTest,
   ::testing::Values(
+#ifdef __linux__
+    "async+shm",
+#endif
     "async+posix"
   )
 );
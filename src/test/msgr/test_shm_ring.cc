@@ -0,0 +1,165 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "msg/async/shm/ShmRing.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+struct RingMem {
+  std::unique_ptr<char[]> mem;
+  shm_ring_header_t *hdr;
+  ShmRing ring;
+  explicit RingMem(uint64_t capacity)
+    : mem(new char[ShmRing::region_size(capacity) + 64]) {
+    void *base = mem.get() + (64 - reinterpret_cast<uintptr_t>(mem.get()) % 64);
+    hdr = static_cast<shm_ring_header_t*>(base);
+    ring.attach(base, capacity);
+    ring.init();
+  }
+};
+
+} // anonymous namespace
+
+TEST(ShmRing, basic)
+{
+  RingMem m(4096);
+  ShmRing& r = m.ring;
+  ASSERT_TRUE(r.is_valid());
+  ASSERT_EQ(0, r.readable());
+  ASSERT_EQ(4096, r.writable());
+
+  char buf[16];
+  ASSERT_EQ(0, r.read(buf, sizeof(buf)));
+  ASSERT_EQ(5, r.write("hello", 5));
+  ASSERT_EQ(5, r.readable());
+  ASSERT_EQ(5, r.read(buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "hello", 5));
+  ASSERT_EQ(0, r.readable());
+}
+
+TEST(ShmRing, wrap_and_full)
+{
+  RingMem m(4096);
+  ShmRing& r = m.ring;
+  std::vector<char> in(6000), out(6000);
+  std::iota(in.begin(), in.end(), 0);
+
+  // move the positions close to the end of the data area
+  ASSERT_EQ(4000, r.write(in.data(), 4000));
+  ASSERT_EQ(4000, r.read(out.data(), 4000));
+
+  // a write larger than the capacity is truncated and wraps around
+  ASSERT_EQ(4096, r.write(in.data(), in.size()));
+  ASSERT_EQ(0, r.writable());
+  ASSERT_EQ(0, r.write(in.data(), 1));
+  ASSERT_EQ(4096, r.read(out.data(), out.size()));
+  ASSERT_EQ(0, memcmp(in.data(), out.data(), 4096));
+}
+
+TEST(ShmRing, wakeup_flags)
+{
+  RingMem m(4096);
+  ShmRing& r = m.ring;
+
+  // nothing to wake up unless somebody announced it is going to sleep
+  ASSERT_EQ(1, r.write("x", 1));
+  ASSERT_FALSE(r.reader_needs_wakeup());
+
+  // data is pending, so the reader must not sleep
+  ASSERT_FALSE(r.prepare_read_wait());
+  char c;
+  ASSERT_EQ(1, r.read(&c, 1));
+  ASSERT_TRUE(r.prepare_read_wait());
+  ASSERT_EQ(1, r.write("y", 1));
+  ASSERT_TRUE(r.reader_needs_wakeup());
+  ASSERT_FALSE(r.reader_needs_wakeup());
+
+  std::vector<char> fill(4096);
+  r.write(fill.data(), fill.size());
+  ASSERT_TRUE(r.prepare_write_wait());
+  ASSERT_EQ(1, r.read(&c, 1));
+  ASSERT_TRUE(r.writer_needs_wakeup());
+
+  ASSERT_FALSE(r.is_closed());
+  r.mark_closed();
+  ASSERT_TRUE(r.is_closed());
+}
+
+TEST(ShmRing, bad_head)
+{
+  RingMem m(4096);
+  ShmRing& r = m.ring;
+  char buf[16];
+  ASSERT_EQ(5, r.write("hello", 5));
+  ASSERT_EQ(2, r.read(buf, 2));
+
+  // the writer claims more than the ring holds
+  m.hdr->head = 2 + 4096 + 1;
+  ASSERT_EQ(-EPROTO, r.readable());
+  ASSERT_EQ(-EPROTO, r.read(buf, sizeof(buf)));
+  ASSERT_FALSE(r.prepare_read_wait());
+
+  // or moves back
+  m.hdr->head = 4;
+  ASSERT_EQ(-EPROTO, r.read(buf, sizeof(buf)));
+}
+
+TEST(ShmRing, bad_tail)
+{
+  RingMem m(4096);
+  ShmRing& r = m.ring;
+  char buf[16];
+  ASSERT_EQ(5, r.write("hello", 5));
+  ASSERT_EQ(3, r.read(buf, 3));
+  ASSERT_EQ(4096 - 2, r.writable());
+
+  // the reader read more than was written
+  m.hdr->tail = 6;
+  ASSERT_EQ(-EPROTO, r.writable());
+  ASSERT_EQ(-EPROTO, r.write("x", 1));
+  ASSERT_FALSE(r.prepare_write_wait());
+
+  // or moves back
+  m.hdr->tail = 1;
+  ASSERT_EQ(-EPROTO, r.write("x", 1));
+}
+
+TEST(ShmRing, spsc_stream)
+{
+  RingMem m(4096);
+  ShmRing& r = m.ring;
+  constexpr size_t total = 1 << 20;
+
+  std::thread producer([&r] {
+    char buf[1500];
+    uint64_t seq = 0;
+    size_t sent = 0;
+    while (sent < total) {
+      size_t len = std::min(sizeof(buf), total - sent);
+      for (size_t i = 0; i < len; ++i)
+	buf[i] = static_cast<char>(seq + i);
+      size_t off = 0;
+      while (off < len)
+	off += r.write(buf + off, len - off);
+      seq += len;
+      sent += len;
+    }
+  });
+
+  char buf[1000];
+  uint64_t seq = 0;
+  while (seq < total) {
+    size_t n = r.read(buf, sizeof(buf));
+    for (size_t i = 0; i < n; ++i)
+      ASSERT_EQ(static_cast<char>(seq + i), buf[i]);
+    seq += n;
+  }
+  producer.join();
+  ASSERT_EQ(0, r.readable());
+}
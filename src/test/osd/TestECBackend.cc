@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <signal.h>
 #include "osd/ECBackend.h"
+#include "osd/ECMsgTypes.h"
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -60,3 +61,113 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECBackend, split_read_to_segments)
+{
+  const uint64_t swidth = 4096;
+  ECUtil::stripe_info_t s(4, swidth);
+  using extents_t = list<boost::tuple<uint64_t, uint64_t, uint32_t>>;
+
+  // small reads and unaligned reads are not split
+  extents_t small{{0, 2 * swidth, 0}};
+  ASSERT_EQ(1u, ECBackend::split_read_to_segments(s, small, 0).size());
+  ASSERT_EQ(1u, ECBackend::split_read_to_segments(s, small, 2 * swidth).size());
+  extents_t unaligned{{10, 20 * swidth, 0}};
+  ASSERT_EQ(1u, ECBackend::split_read_to_segments(s, unaligned, swidth).size());
+
+  // the segment size is rounded up to whole stripes
+  extents_t large{{swidth, 7 * swidth, 1}, {20 * swidth, 3 * swidth, 1}};
+  auto segments = ECBackend::split_read_to_segments(s, large, 3 * swidth - 1);
+  ASSERT_EQ(4u, segments.size());
+  uint64_t total = 0;
+  for (auto &&segment : segments) {
+    uint64_t len = 0;
+    for (auto &&extent : segment) {
+      ASSERT_TRUE(s.logical_offset_is_stripe_aligned(extent.get<0>()));
+      ASSERT_EQ(1u, extent.get<2>());
+      len += extent.get<1>();
+    }
+    ASSERT_LE(len, 3 * swidth);
+    total += len;
+  }
+  ASSERT_EQ(10 * swidth, total);
+  // the third segment spans the end of the first extent and the second one
+  auto third = std::next(segments.begin(), 2);
+  ASSERT_EQ(2u, third->size());
+  ASSERT_EQ(7 * swidth, third->front().get<0>());
+  ASSERT_EQ(swidth, third->front().get<1>());
+  ASSERT_EQ(20 * swidth, third->back().get<0>());
+  ASSERT_EQ(2 * swidth, third->back().get<1>());
+}
+
+TEST(ECBackend, plan_hedge_reads)
+{
+  const uint64_t swidth = 2 * 4096;
+  ECUtil::stripe_info_t s(2, swidth);
+  using extents_t = list<boost::tuple<uint64_t, uint64_t, uint32_t>>;
+  const vector<pair<int, int>> subchunks{{0, 1}};
+  // k=2, m=2, shard i on osd i
+  map<shard_id_t, pg_shard_t> all;
+  for (int i = 0; i < 4; ++i) {
+    all[shard_id_t(i)] = pg_shard_t(i, shard_id_t(i));
+  }
+  const pg_shard_t s0 = all[shard_id_t(0)], s1 = all[shard_id_t(1)];
+  const hobject_t waiting(object_t("waiting"), "", CEPH_NOSNAP, 1, 1, "");
+  const hobject_t done(object_t("done"), "", CEPH_NOSNAP, 2, 1, "");
+
+  auto make_op = [&](bool redundant) {
+    map<hobject_t, set<int>> want{{waiting, {0, 1}}, {done, {0, 1}}};
+    map<hobject_t, ECBackend::read_request_t> to_read;
+    to_read.emplace(
+      waiting,
+      ECBackend::read_request_t(extents_t{{swidth, 2 * swidth, 0}},
+				{{s0, subchunks}, {s1, subchunks}},
+				false, nullptr));
+    // all of its shards replied already
+    to_read.emplace(
+      done,
+      ECBackend::read_request_t(extents_t{{0, swidth, 0}}, {}, false, nullptr));
+    ECBackend::ReadOp op(CEPH_MSG_PRIO_DEFAULT, 1, redundant, false,
+			 OpRequestRef(), std::move(want), std::move(to_read));
+    op.obj_to_source[waiting] = {s0, s1};
+    op.in_progress = {s0, s1};
+    return op;
+  };
+  map<hobject_t, map<shard_id_t, pg_shard_t>> avail{
+    {waiting, all}, {done, all}};
+
+  auto op = make_op(false);
+  ASSERT_TRUE(op.may_hedge());
+  auto messages = ECBackend::plan_hedge_reads(s, 1, op, avail);
+  // one more shard for the object still waiting, none for the other
+  ASSERT_EQ(1u, messages.size());
+  const pg_shard_t s2 = all[shard_id_t(2)];
+  ASSERT_EQ(s2, messages.begin()->first);
+  auto &msg = messages.begin()->second;
+  ASSERT_EQ(1u, msg.to_read.size());
+  ASSERT_EQ(1u, msg.to_read.count(waiting));
+  auto &extent = msg.to_read[waiting].front();
+  ASSERT_EQ(swidth / 2, extent.get<0>());
+  ASSERT_EQ(swidth, extent.get<1>());
+  ASSERT_EQ(subchunks, msg.subchunks[waiting]);
+  ASSERT_EQ(3u, op.to_read.at(waiting).need.size());
+  ASSERT_EQ(1u, op.obj_to_source[waiting].count(s2));
+  ASSERT_EQ(1u, op.source_to_obj[s2].count(waiting));
+
+  // only once
+  ASSERT_TRUE(op.hedged);
+  ASSERT_FALSE(op.may_hedge());
+  ASSERT_TRUE(ECBackend::plan_hedge_reads(s, 1, op, avail).empty());
+
+  // redundant reads asked every shard already
+  auto redundant = make_op(true);
+  ASSERT_FALSE(redundant.may_hedge());
+  ASSERT_TRUE(ECBackend::plan_hedge_reads(s, 1, redundant, avail).empty());
+
+  // no shard left to ask
+  auto no_spare = make_op(false);
+  map<hobject_t, map<shard_id_t, pg_shard_t>> busy{
+    {waiting, {{shard_id_t(0), s0}, {shard_id_t(1), s1}}}};
+  ASSERT_TRUE(ECBackend::plan_hedge_reads(s, 1, no_spare, busy).empty());
+  ASSERT_TRUE(no_spare.hedged);
+}
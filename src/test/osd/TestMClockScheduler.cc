@@ -258,3 +258,35 @@ TEST_F(mClockSchedulerTest, TestAllQueuesEnqueueDequeue) {
 
   ASSERT_TRUE(q.empty());
 }
+
+TEST_F(mClockSchedulerTest, TestPerClientProfiles) {
+  // client ops are only tracked per client with this set, which is
+  // read when the scheduler is created
+  g_ceph_context->_conf.set_val_or_die(
+    "osd_mclock_scheduler_client_qos_key", "client");
+  g_ceph_context->_conf.set_val_or_die(
+    "osd_mclock_scheduler_client_profiles",
+    "client." + std::to_string(client1) + "=0,3,0 "
+    "client." + std::to_string(client2) + "=0,1,0 "
+    "bogus=1,2,3");
+  mClockScheduler tq(
+    g_ceph_context, whoami, num_shards, shard_id, is_rotational, monc);
+
+  const unsigned NUM = 200;
+  for (unsigned i = 0; i < NUM; ++i) {
+    for (auto &&c: {client1, client2}) {
+      tq.enqueue(create_item(i, c, op_scheduler_class::client));
+    }
+  }
+
+  // each client's ops stay in order, and client1 gets ~3x the share
+  std::map<uint64_t, epoch_t> next = {{client1, 0}, {client2, 0}};
+  for (unsigned i = 0; i < NUM; ++i) {
+    auto r = get_item(tq.dequeue());
+    ASSERT_EQ(next[r.get_owner()]++, r.get_map_epoch());
+  }
+  ASSERT_GT(next[client1], 2 * next[client2]);
+
+  g_ceph_context->_conf.rm_val("osd_mclock_scheduler_client_qos_key");
+  g_ceph_context->_conf.rm_val("osd_mclock_scheduler_client_profiles");
+}
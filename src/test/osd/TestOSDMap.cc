@@ -401,6 +401,59 @@ TEST_F(OSDMapTest, PrimaryTempRespected) {
   EXPECT_EQ(acting_primary, acting_osds[1]);
 }
 
+TEST_F(OSDMapTest, SamePGMappingInputs) {
+  set_up_map();
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+
+  // a new pool changes nothing the existing pgs map with
+  OSDMap next;
+  next.deepish_copy_from(osdmap);
+  {
+    OSDMap::Incremental inc(next.get_epoch() + 1);
+    inc.new_pool_max = next.get_pool_max();
+    inc.fsid = next.get_fsid();
+    set_rep_pool("another", inc, false);
+    next.apply_incremental(inc);
+  }
+  ASSERT_TRUE(osdmap.same_pg_mapping_inputs(next));
+
+  // neither do the addresses of an osd
+  {
+    OSDMap::Incremental inc(next.get_epoch() + 1);
+    entity_addrvec_t addrs;
+    addrs.v.push_back(entity_addr_t());
+    addrs.v[0].nonce = 100;
+    inc.new_hb_back_up[0] = addrs;
+    next.apply_incremental(inc);
+  }
+  ASSERT_TRUE(osdmap.same_pg_mapping_inputs(next));
+
+  // a pg_temp does
+  OSDMap temp;
+  temp.deepish_copy_from(next);
+  {
+    OSDMap::Incremental inc(temp.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+      acting_osds.rbegin(), acting_osds.rend());
+    temp.apply_incremental(inc);
+  }
+  ASSERT_FALSE(next.same_pg_mapping_inputs(temp));
+
+  // and so does an osd going down
+  OSDMap down;
+  down.deepish_copy_from(next);
+  {
+    OSDMap::Incremental inc(down.get_epoch() + 1);
+    inc.new_state[up_osds[0]] = CEPH_OSD_UP;
+    down.apply_incremental(inc);
+  }
+  ASSERT_FALSE(next.same_pg_mapping_inputs(down));
+}
+
 TEST_F(OSDMapTest, CleanTemps) {
   set_up_map();
 
@@ -2446,7 +2446,7 @@ public:
   void check_order() {
     eversion_t prev(0, 0);
 
-    for (auto& i : log.dups) {
+    for (const auto& i : log.dups) {
       EXPECT_LT(prev, i.version) << "verify versions monotonically increase";
       prev = i.version;
     }
@@ -2454,7 +2454,7 @@ public:
 
   void check_index() {
     EXPECT_EQ(log.dups.size(), log.dup_index.size());
-    for (auto& i : log.dups) {
+    for (const auto& i : log.dups) {
       EXPECT_EQ(1u, log.dup_index.count(i.reqid));
     }
   }
@@ -0,0 +1,22 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#pragma once
+
+/// \file objects and PGs for the tests of the OSD-wide caches
+
+#include <string>
+
+#include "osd/osd_types.h"
+
+namespace CacheTest {
+
+inline hobject_t make_oid(unsigned i)
+{
+  return hobject_t(object_t("obj" + std::to_string(i)), "", CEPH_NOSNAP, i,
+		   1, "");
+}
+
+inline const spg_t pg_a(pg_t(0, 1));
+inline const spg_t pg_b(pg_t(1, 1));
+
+}  // namespace CacheTest
@@ -0,0 +1,237 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Read throughput of a single PG.
+ *
+ * All objects share one locator key, so they land in the same PG and the
+ * same OSD shard, and every client thread competes for that PG.  With
+ * osd_unlocked_reads the object store reads no longer serialize on the PG
+ * lock, so the rate should grow with osd_op_num_threads_per_shard.
+ *
+ *   ceph_bench_pg_read --pool rbd --threads 32 --op read --compare
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/rados/librados.hpp"
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/errno.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+
+using namespace std;
+using namespace librados;
+
+struct Config {
+  string pool = "rbd";
+  string key = "pg_read_bench";
+  unsigned objects = 16;
+  uint64_t size = 4096;
+  unsigned threads = 16;
+  unsigned seconds = 10;
+  string op = "read";
+  bool compare = false;
+};
+
+struct Result {
+  uint64_t ops = 0;
+  double seconds = 0;
+};
+
+static void usage()
+{
+  cout << "usage: ceph_bench_pg_read [options]\n"
+       << "  --pool <name>      pool to use (default rbd)\n"
+       << "  --objects <n>      number of objects, all in one pg (default 16)\n"
+       << "  --size <bytes>     object size (default 4096)\n"
+       << "  --threads <n>      concurrent client threads (default 16)\n"
+       << "  --seconds <n>      duration of each run (default 10)\n"
+       << "  --op <op>          read, stat or getxattr (default read)\n"
+       << "  --compare          run with osd_unlocked_reads off, then on\n"
+       << std::endl;
+  generic_client_usage();
+}
+
+static string obj_name(unsigned i)
+{
+  return "pg_read_bench." + std::to_string(i);
+}
+
+static int prepare(IoCtx& ioctx, const Config& cfg)
+{
+  bufferlist data;
+  data.append_zero(cfg.size);
+  bufferlist xattr;
+  xattr.append("v");
+  for (unsigned i = 0; i < cfg.objects; ++i) {
+    ObjectWriteOperation op;
+    op.write_full(data);
+    op.setxattr("bench", xattr);
+    if (int r = ioctx.operate(obj_name(i), &op); r < 0) {
+      cerr << "failed to write " << obj_name(i) << ": " << cpp_strerror(r)
+	   << std::endl;
+      return r;
+    }
+  }
+  return 0;
+}
+
+static int set_unlocked_reads(Rados& rados, bool on)
+{
+  string cmd = string("{\"prefix\": \"config set\", \"who\": \"osd\", "
+		      "\"name\": \"osd_unlocked_reads\", \"value\": \"") +
+    (on ? "true" : "false") + "\"}";
+  bufferlist inbl, outbl;
+  int r = rados.mon_command(cmd, inbl, &outbl, nullptr);
+  if (r < 0) {
+    cerr << "config set osd_unlocked_reads failed: " << cpp_strerror(r)
+	 << std::endl;
+    return r;
+  }
+  // give the osds a moment to pick up the change
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+  return 0;
+}
+
+static Result run(IoCtx& ioctx, const Config& cfg)
+{
+  std::atomic<bool> stop = false;
+  std::atomic<uint64_t> total = 0;
+  std::atomic<int> error = 0;
+  vector<std::thread> workers;
+  for (unsigned t = 0; t < cfg.threads; ++t) {
+    workers.emplace_back([&, t] {
+      uint64_t done = 0;
+      for (unsigned i = t; !stop; ++i) {
+	ObjectReadOperation op;
+	bufferlist bl;
+	uint64_t size;
+	time_t mtime;
+	int rval = 0;
+	if (cfg.op == "stat") {
+	  op.stat(&size, &mtime, &rval);
+	} else if (cfg.op == "getxattr") {
+	  op.getxattr("bench", &bl, &rval);
+	} else {
+	  op.read(0, cfg.size, &bl, &rval);
+	}
+	int r = ioctx.operate(obj_name(i % cfg.objects), &op, nullptr);
+	if (r < 0) {
+	  error = r;
+	  break;
+	}
+	++done;
+      }
+      total += done;
+    });
+  }
+  auto start = ceph::mono_clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(cfg.seconds));
+  stop = true;
+  for (auto& w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> elapsed = ceph::mono_clock::now() - start;
+  if (error) {
+    cerr << "op failed: " << cpp_strerror(error) << std::endl;
+  }
+  return Result{total, elapsed.count()};
+}
+
+static void report(const string& label, const Config& cfg, const Result& res)
+{
+  double rate = res.ops / res.seconds;
+  cout << label << ": " << res.ops << " " << cfg.op << " ops in "
+       << res.seconds << "s, " << rate << " ops/s, "
+       << (res.ops ? cfg.threads * res.seconds * 1e6 / res.ops : 0.0)
+       << " us avg latency" << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  Config cfg;
+  string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--pool", (char*)nullptr)) {
+      cfg.pool = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--objects", (char*)nullptr)) {
+      cfg.objects = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--size", (char*)nullptr)) {
+      cfg.size = strtoull(val.c_str(), nullptr, 10);
+    } else if (ceph_argparse_witharg(args, i, &val, "--threads", (char*)nullptr)) {
+      cfg.threads = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--seconds", (char*)nullptr)) {
+      cfg.seconds = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--op", (char*)nullptr)) {
+      if (val != "read" && val != "stat" && val != "getxattr") {
+	cerr << "unknown op " << val << std::endl;
+	exit(1);
+      }
+      cfg.op = val;
+    } else if (ceph_argparse_flag(args, i, "--compare", (char*)nullptr)) {
+      cfg.compare = true;
+    } else {
+      cerr << "unrecognized argument " << *i << std::endl;
+      exit(1);
+    }
+  }
+  common_init_finish(g_ceph_context);
+
+  Rados rados;
+  if (int r = rados.init_with_context(g_ceph_context); r < 0) {
+    cerr << "failed to initialize rados: " << cpp_strerror(r) << std::endl;
+    exit(1);
+  }
+  if (int r = rados.connect(); r < 0) {
+    cerr << "failed to connect: " << cpp_strerror(r) << std::endl;
+    exit(1);
+  }
+  IoCtx ioctx;
+  if (int r = rados.ioctx_create(cfg.pool.c_str(), ioctx); r < 0) {
+    cerr << "failed to open pool " << cfg.pool << ": " << cpp_strerror(r)
+	 << std::endl;
+    exit(1);
+  }
+  ioctx.locator_set_key(cfg.key);
+  if (prepare(ioctx, cfg) < 0) {
+    exit(1);
+  }
+
+  if (cfg.compare) {
+    if (set_unlocked_reads(rados, false) < 0) {
+      exit(1);
+    }
+    report("pg locked  ", cfg, run(ioctx, cfg));
+    if (set_unlocked_reads(rados, true) < 0) {
+      exit(1);
+    }
+    report("pg unlocked", cfg, run(ioctx, cfg));
+  } else {
+    report("result", cfg, run(ioctx, cfg));
+  }
+
+  for (unsigned i = 0; i < cfg.objects; ++i) {
+    ioctx.remove(obj_name(i));
+  }
+  rados.shutdown();
+  return 0;
+}
@@ -0,0 +1,432 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Op scheduler simulator.
+ *
+ * Drives the OpScheduler implementations of the OSD with synthetic client,
+ * recovery, scrub and snap trim workloads in front of a simple device
+ * model, and reports the throughput and latency each workload gets.
+ *
+ *   ceph_test_op_scheduler_sim --scheduler wpq,mclock_scheduler \
+ *     --clients 8 --recovery-depth 8 --seconds 10
+ *
+ * Every workload keeps a fixed number of ops outstanding and queues a new
+ * op as soon as one completes.  The device serves up to --device-depth ops
+ * at a time, each taking its latency (+/- 50%) plus size / bandwidth.  The
+ * simulation runs in real time, so that mclock's reservations and limits
+ * apply as they would in an OSD, and the scheduler is told the capacity of
+ * the modelled device.
+ *
+ * With --check the simulator fails if a workload was starved, or if the
+ * ops of one workload were dequeued out of order.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/TextTable.h"
+#include "include/str_list.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include "osd/scheduler/OpScheduler.h"
+#include "osd/scheduler/OpSchedulerItem.h"
+
+using namespace std;
+using namespace ceph::osd::scheduler;
+
+struct Device {
+  bool rotational = false;
+  unsigned depth = 4;
+  double latency = 0.0001;	///< seconds per op
+  double bandwidth = 1e9;	///< bytes per second
+
+  void set_type(const string& type) {
+    rotational = (type == "hdd");
+    if (rotational) {
+      depth = 1;
+      latency = 0.005;
+      bandwidth = 150e6;
+    }
+  }
+};
+
+struct Config {
+  vector<string> schedulers = {"wpq", "mclock_scheduler"};
+  double seconds = 5;
+  Device device;
+  unsigned clients = 4;
+  unsigned client_depth = 8;
+  uint64_t client_bytes = 4096;
+  unsigned recovery_depth = 4;
+  uint64_t recovery_bytes = 1 << 20;
+  unsigned scrub_depth = 2;
+  uint64_t scrub_bytes = 512 << 10;
+  unsigned snaptrim_depth = 2;
+  uint64_t snaptrim_bytes = 4096;
+  unsigned seed = 0;
+  bool check = false;
+};
+
+struct Workload {
+  string name;
+  op_scheduler_class scheduler_class;
+  unsigned priority;
+  unsigned depth;
+  uint64_t bytes;
+  uint64_t owner;
+  int64_t pool;
+
+  epoch_t next_seq = 0;
+  epoch_t next_dequeue = 0;
+  bool reordered = false;
+  vector<double> latencies;	///< seconds, of every completed op
+};
+
+/// stands in for the PG ops, only its scheduler class matters
+class SimItem : public PGOpQueueable {
+  op_scheduler_class scheduler_class;
+public:
+  SimItem(spg_t pgid, op_scheduler_class scheduler_class)
+    : PGOpQueueable(pgid),
+      scheduler_class(scheduler_class) {}
+
+  ostream &print(ostream &rhs) const final {
+    return rhs << "SimItem(" << get_pgid() << ")";
+  }
+  std::string print() const final {
+    return "SimItem";
+  }
+  std::optional<OpRequestRef> maybe_get_op() const final {
+    return std::nullopt;
+  }
+  op_scheduler_class get_scheduler_class() const final {
+    return scheduler_class;
+  }
+  void run(OSD *osd, OSDShard *sdata, PGRef& pg,
+	   ThreadPool::TPHandle &handle) final {}
+};
+
+static void usage()
+{
+  cout << "usage: ceph_test_op_scheduler_sim [options]\n"
+       << "  --scheduler <a,b>        schedulers to compare (default wpq,mclock_scheduler)\n"
+       << "  --seconds <n>            duration of each run (default 5)\n"
+       << "  --device <ssd|hdd>       device model (default ssd)\n"
+       << "  --device-depth <n>       ops served concurrently\n"
+       << "  --device-latency-us <n>  per op latency\n"
+       << "  --device-bandwidth <n>   bytes per second\n"
+       << "  --clients <n>            client workloads (default 4)\n"
+       << "  --client-depth <n>       outstanding ops per client (default 8)\n"
+       << "  --client-bytes <n>       size of client ops (default 4096)\n"
+       << "  --recovery-depth <n>     outstanding recovery ops (default 4)\n"
+       << "  --recovery-bytes <n>     size of recovery ops (default 1M)\n"
+       << "  --scrub-depth <n>        outstanding scrub ops (default 2)\n"
+       << "  --scrub-bytes <n>        size of scrub ops (default 512K)\n"
+       << "  --snaptrim-depth <n>     outstanding snap trim ops (default 2)\n"
+       << "  --snaptrim-bytes <n>     size of snap trim ops (default 4096)\n"
+       << "  --seed <n>               seed of the device latency jitter\n"
+       << "  --check                  fail on starved or reordered workloads\n"
+       << std::endl;
+  generic_client_usage();
+}
+
+static vector<Workload> make_workloads(const Config& cfg)
+{
+  auto& conf = g_ceph_context->_conf;
+  vector<Workload> workloads;
+  for (unsigned i = 0; i < cfg.clients; ++i) {
+    workloads.push_back(Workload{
+	"client." + std::to_string(i), op_scheduler_class::client,
+	static_cast<unsigned>(conf->osd_client_op_priority),
+	cfg.client_depth, cfg.client_bytes, 4100 + i, 1 + i % 2});
+  }
+  workloads.push_back(Workload{
+      "recovery", op_scheduler_class::background_recovery,
+      static_cast<unsigned>(conf->osd_recovery_op_priority),
+      cfg.recovery_depth, cfg.recovery_bytes, 1, 1});
+  workloads.push_back(Workload{
+      "scrub", op_scheduler_class::background_best_effort,
+      static_cast<unsigned>(conf->osd_scrub_priority),
+      cfg.scrub_depth, cfg.scrub_bytes, 2, 1});
+  workloads.push_back(Workload{
+      "snaptrim", op_scheduler_class::background_best_effort,
+      static_cast<unsigned>(conf->osd_snap_trim_priority),
+      cfg.snaptrim_depth, cfg.snaptrim_bytes, 3, 2});
+  std::erase_if(workloads, [](auto& w) { return w.depth == 0; });
+  return workloads;
+}
+
+static void configure(const Config& cfg, const string& scheduler)
+{
+  auto& conf = g_ceph_context->_conf;
+  const Device& dev = cfg.device;
+  // the capacity mclock divides between the classes
+  double iops = dev.depth / (dev.latency + 4096 / dev.bandwidth);
+  string suffix = dev.rotational ? "hdd" : "ssd";
+  conf.set_val_or_die("osd_op_queue", scheduler);
+  conf.set_val_or_die("osd_mclock_max_capacity_iops_" + suffix,
+		      std::to_string(iops));
+  conf.set_val_or_die("osd_mclock_max_sequential_bandwidth_" + suffix,
+		      std::to_string(static_cast<uint64_t>(dev.bandwidth)));
+  conf.apply_changes(nullptr);
+}
+
+/// run one scheduler, returns the workloads with their results
+static vector<Workload> simulate(const Config& cfg, const string& type)
+{
+  using clock = ceph::mono_clock;
+  struct InFlight {
+    clock::time_point done;
+    size_t workload;
+    utime_t start;
+    bool operator>(const InFlight& rhs) const {
+      return done > rhs.done;
+    }
+  };
+
+  configure(cfg, type);
+  auto scheduler = make_scheduler(
+    g_ceph_context, 0, 1, 0, cfg.device.rotational, "bluestore", nullptr);
+  auto workloads = make_workloads(cfg);
+  map<uint64_t, size_t> by_owner;
+  for (size_t i = 0; i < workloads.size(); ++i) {
+    by_owner[workloads[i].owner] = i;
+  }
+
+  auto enqueue = [&scheduler](Workload& w) {
+    scheduler->enqueue(OpSchedulerItem(
+      std::make_unique<SimItem>(spg_t(pg_t(w.owner, w.pool)),
+				w.scheduler_class),
+      w.bytes, w.priority, ceph_clock_now(), w.owner, w.next_seq++));
+  };
+  for (auto& w : workloads) {
+    for (unsigned i = 0; i < w.depth; ++i) {
+      enqueue(w);
+    }
+  }
+
+  std::mt19937 rng(cfg.seed);
+  std::uniform_real_distribution<double> jitter(0.5, 1.5);
+  std::priority_queue<InFlight, vector<InFlight>, greater<InFlight>> device;
+  const auto end = clock::now() + ceph::make_timespan(cfg.seconds);
+  for (;;) {
+    auto now = clock::now();
+    while (!device.empty() && device.top().done <= now) {
+      auto& w = workloads[device.top().workload];
+      w.latencies.push_back(ceph_clock_now() - device.top().start);
+      device.pop();
+      if (now < end) {
+	enqueue(w);
+      }
+    }
+    if (now >= end) {
+      if (device.empty()) {
+	break;
+      }
+      // let the ops in flight complete, queue nothing new
+      std::this_thread::sleep_until(device.top().done);
+      continue;
+    }
+
+    auto until = end;
+    if (device.size() < cfg.device.depth && !scheduler->empty()) {
+      auto work = scheduler->dequeue();
+      if (auto item = std::get_if<OpSchedulerItem>(&work)) {
+	auto i = by_owner.at(item->get_owner());
+	auto& w = workloads[i];
+	if (item->get_map_epoch() != w.next_dequeue) {
+	  w.reordered = true;
+	}
+	w.next_dequeue = item->get_map_epoch() + 1;
+	double service = cfg.device.latency * jitter(rng) +
+	  item->get_cost() / cfg.device.bandwidth;
+	device.push(InFlight{
+	    now + ceph::make_timespan(service), i, item->get_start_time()});
+	continue;
+      } else if (auto when = std::get_if<double>(&work)) {
+	// every queued op is held back by a limit
+	double wait = std::max(0.0, *when - double(ceph_clock_now()));
+	until = std::min(until, now + ceph::make_timespan(wait));
+      } else {
+	cerr << type << ": dequeue returned nothing from a non-empty queue"
+	     << std::endl;
+	exit(1);
+      }
+    }
+    if (!device.empty()) {
+      until = std::min(until, device.top().done);
+    }
+    std::this_thread::sleep_until(until);
+  }
+  return workloads;
+}
+
+static double percentile(const vector<double>& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[std::min(sorted.size() - 1,
+			 static_cast<size_t>(p * sorted.size()))];
+}
+
+static void report(TextTable& tbl, const Config& cfg, const string& type,
+		   vector<Workload>& workloads)
+{
+  for (auto& w : workloads) {
+    auto& lat = w.latencies;
+    std::sort(lat.begin(), lat.end());
+    double sum = 0;
+    for (auto l : lat) {
+      sum += l;
+    }
+    double ms = 1000;
+    tbl << type << w.name << w.scheduler_class << w.depth
+	<< lat.size()
+	<< static_cast<uint64_t>(lat.size() / cfg.seconds)
+	<< lat.size() * w.bytes / cfg.seconds / (1 << 20)
+	<< (lat.empty() ? 0 : ms * sum / lat.size())
+	<< ms * percentile(lat, 0.5)
+	<< ms * percentile(lat, 0.99)
+	<< ms * (lat.empty() ? 0 : lat.back())
+	<< TextTable::endrow;
+  }
+}
+
+static bool check(const string& type, const vector<Workload>& workloads)
+{
+  bool ok = true;
+  for (auto& w : workloads) {
+    if (w.latencies.empty()) {
+      cerr << type << ": " << w.name << " was starved" << std::endl;
+      ok = false;
+    }
+    if (w.reordered) {
+      cerr << type << ": ops of " << w.name << " were reordered" << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_OSD,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  Config cfg;
+  string val;
+  std::optional<string> device_type;
+  std::optional<unsigned> device_depth;
+  std::optional<double> device_latency, device_bandwidth;
+  auto as_uint = [&val]() -> unsigned {
+    return static_cast<unsigned>(strtoul(val.c_str(), nullptr, 10));
+  };
+  auto as_bytes = [&val]() -> uint64_t {
+    return strtoull(val.c_str(), nullptr, 10);
+  };
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--scheduler", (char*)nullptr)) {
+      cfg.schedulers = get_str_vec(val, ",");
+    } else if (ceph_argparse_witharg(args, i, &val, "--seconds", (char*)nullptr)) {
+      cfg.seconds = std::max(0.1, atof(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--device", (char*)nullptr)) {
+      if (val != "ssd" && val != "hdd") {
+	cerr << "unknown device " << val << std::endl;
+	exit(1);
+      }
+      device_type = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--device-depth", (char*)nullptr)) {
+      device_depth = std::max(1u, as_uint());
+    } else if (ceph_argparse_witharg(args, i, &val, "--device-latency-us", (char*)nullptr)) {
+      device_latency = std::max(1.0, atof(val.c_str())) / 1e6;
+    } else if (ceph_argparse_witharg(args, i, &val, "--device-bandwidth", (char*)nullptr)) {
+      device_bandwidth = std::max(1.0, atof(val.c_str()));
+    } else if (ceph_argparse_witharg(args, i, &val, "--clients", (char*)nullptr)) {
+      cfg.clients = as_uint();
+    } else if (ceph_argparse_witharg(args, i, &val, "--client-depth", (char*)nullptr)) {
+      cfg.client_depth = as_uint();
+    } else if (ceph_argparse_witharg(args, i, &val, "--client-bytes", (char*)nullptr)) {
+      cfg.client_bytes = as_bytes();
+    } else if (ceph_argparse_witharg(args, i, &val, "--recovery-depth", (char*)nullptr)) {
+      cfg.recovery_depth = as_uint();
+    } else if (ceph_argparse_witharg(args, i, &val, "--recovery-bytes", (char*)nullptr)) {
+      cfg.recovery_bytes = as_bytes();
+    } else if (ceph_argparse_witharg(args, i, &val, "--scrub-depth", (char*)nullptr)) {
+      cfg.scrub_depth = as_uint();
+    } else if (ceph_argparse_witharg(args, i, &val, "--scrub-bytes", (char*)nullptr)) {
+      cfg.scrub_bytes = as_bytes();
+    } else if (ceph_argparse_witharg(args, i, &val, "--snaptrim-depth", (char*)nullptr)) {
+      cfg.snaptrim_depth = as_uint();
+    } else if (ceph_argparse_witharg(args, i, &val, "--snaptrim-bytes", (char*)nullptr)) {
+      cfg.snaptrim_bytes = as_bytes();
+    } else if (ceph_argparse_witharg(args, i, &val, "--seed", (char*)nullptr)) {
+      cfg.seed = as_uint();
+    } else if (ceph_argparse_flag(args, i, "--check", (char*)nullptr)) {
+      cfg.check = true;
+    } else {
+      cerr << "unrecognized argument " << *i << std::endl;
+      exit(1);
+    }
+  }
+  if (device_type) {
+    cfg.device.set_type(*device_type);
+  }
+  if (device_depth) {
+    cfg.device.depth = *device_depth;
+  }
+  if (device_latency) {
+    cfg.device.latency = *device_latency;
+  }
+  if (device_bandwidth) {
+    cfg.device.bandwidth = *device_bandwidth;
+  }
+  common_init_finish(g_ceph_context);
+
+  TextTable tbl;
+  tbl.define_column("SCHEDULER", TextTable::LEFT, TextTable::LEFT);
+  tbl.define_column("WORKLOAD", TextTable::LEFT, TextTable::LEFT);
+  tbl.define_column("CLASS", TextTable::LEFT, TextTable::LEFT);
+  tbl.define_column("DEPTH", TextTable::LEFT, TextTable::RIGHT);
+  tbl.define_column("OPS", TextTable::LEFT, TextTable::RIGHT);
+  tbl.define_column("OPS/S", TextTable::LEFT, TextTable::RIGHT);
+  tbl.define_column("MB/S", TextTable::LEFT, TextTable::RIGHT);
+  tbl.define_column("AVG_MS", TextTable::LEFT, TextTable::RIGHT);
+  tbl.define_column("P50_MS", TextTable::LEFT, TextTable::RIGHT);
+  tbl.define_column("P99_MS", TextTable::LEFT, TextTable::RIGHT);
+  tbl.define_column("MAX_MS", TextTable::LEFT, TextTable::RIGHT);
+
+  bool ok = true;
+  for (auto& type : cfg.schedulers) {
+    if (type != "wpq" && type != "mclock_scheduler") {
+      cerr << "unknown scheduler " << type << std::endl;
+      exit(1);
+    }
+    auto workloads = simulate(cfg, type);
+    report(tbl, cfg, type, workloads);
+    if (cfg.check && !check(type, workloads)) {
+      ok = false;
+    }
+  }
+  cout << tbl;
+  return ok ? 0 : 1;
+}
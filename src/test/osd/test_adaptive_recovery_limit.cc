@@ -0,0 +1,106 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <algorithm>
+#include <chrono>
+
+#include <gtest/gtest.h>
+#include "osd/AdaptiveRecoveryLimit.h"
+
+using namespace std::chrono_literals;
+
+static double seconds(ceph::timespan t)
+{
+  return std::chrono::duration<double>(t).count();
+}
+
+/// a device that completes `capacity` ops at a time, further ones queue
+static ceph::timespan device_latency(ceph::timespan base, unsigned capacity,
+				     unsigned in_flight)
+{
+  return std::chrono::duration_cast<ceph::timespan>(
+    base * std::max(1.0, double(in_flight) / capacity));
+}
+
+TEST(AdaptiveRecoveryLimit, grows_to_max_without_queueing)
+{
+  AdaptiveRecoveryLimit limit(16);
+  ASSERT_EQ(1u, limit.get());
+  for (unsigned i = 0; i < 200; ++i) {
+    limit.add_sample(10ms, limit.get());
+  }
+  ASSERT_NEAR(0.01, seconds(limit.get_base_latency()), 1e-6);
+  ASSERT_EQ(16u, limit.get());
+  // queueing pushes it down...
+  for (unsigned i = 0; i < 50; ++i) {
+    limit.add_sample(100ms, limit.get());
+  }
+  ASSERT_EQ(1u, limit.get());
+  // ...and it comes back once ops complete at the base latency again
+  for (unsigned i = 0; i < 200; ++i) {
+    limit.add_sample(10ms, limit.get());
+  }
+  ASSERT_EQ(16u, limit.get());
+}
+
+TEST(AdaptiveRecoveryLimit, app_limited)
+{
+  AdaptiveRecoveryLimit limit(16);
+  // a single op in flight does not tell whether more would queue
+  for (unsigned i = 0; i < 100; ++i) {
+    limit.add_sample(10ms, 1);
+  }
+  ASSERT_LE(limit.get(), 3u);
+}
+
+TEST(AdaptiveRecoveryLimit, converges_on_capacity)
+{
+  const unsigned capacity = 4;
+  AdaptiveRecoveryLimit limit(32, 100);
+  unsigned max_seen = 0;
+  for (unsigned i = 0; i < 2000; ++i) {
+    unsigned in_flight = limit.get();
+    limit.add_sample(device_latency(1ms, capacity, in_flight), in_flight);
+    max_seen = std::max(max_seen, limit.get());
+  }
+  // the probes at the end of each epoch keep the base from creeping up
+  ASSERT_NEAR(0.001, seconds(limit.get_base_latency()), 1e-6);
+  ASSERT_LE(max_seen, 2 * capacity);
+  ASSERT_GE(limit.get(), capacity / 2);
+}
+
+TEST(AdaptiveRecoveryLimit, base_follows_device)
+{
+  AdaptiveRecoveryLimit limit(16, 100);
+  for (unsigned i = 0; i < 50; ++i) {
+    limit.add_sample(1ms, limit.get());
+  }
+  // the device got slower for good, e.g. larger objects
+  for (unsigned i = 0; i < 150; ++i) {
+    limit.add_sample(10ms, limit.get());
+  }
+  ASSERT_NEAR(0.01, seconds(limit.get_base_latency()), 1e-6);
+  // no longer mistaken for queueing
+  for (unsigned i = 0; i < 90; ++i) {
+    limit.add_sample(10ms, limit.get());
+  }
+  ASSERT_GE(limit.get(), 8u);
+}
+
+TEST(AdaptiveRecoveryLimit, set_max)
+{
+  AdaptiveRecoveryLimit limit(16);
+  for (unsigned i = 0; i < 200; ++i) {
+    limit.add_sample(1ms, limit.get());
+  }
+  ASSERT_EQ(16u, limit.get());
+  limit.set_max(3);
+  ASSERT_EQ(3u, limit.get());
+  limit.set_max(0);
+  ASSERT_EQ(1u, limit.get());
+  limit.set_max(8);
+  for (unsigned i = 0; i < 100; ++i) {
+    limit.add_sample(1ms, limit.get());
+  }
+  ASSERT_EQ(8u, limit.get());
+}
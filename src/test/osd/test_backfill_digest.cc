@@ -0,0 +1,106 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+#include "osd/recovery_types.h"
+
+using namespace std;
+
+static hobject_t make_oid(unsigned i)
+{
+  char name[16];
+  snprintf(name, sizeof(name), "obj%04u", i);
+  return hobject_t(object_t(name), "", CEPH_NOSNAP, 0, 1, "");
+}
+
+static BackfillInterval make_interval(unsigned n)
+{
+  BackfillInterval bi;
+  bi.begin = make_oid(0);
+  bi.end = hobject_t::get_max();
+  for (unsigned i = 0; i < n; ++i) {
+    bi.objects[make_oid(i * 2)] = eversion_t(10, i + 1);
+  }
+  return bi;
+}
+
+/// run a scan of target against local and return the target's interval
+static BackfillInterval scan(const BackfillInterval &local,
+			     const map<hobject_t, eversion_t> &target,
+			     unsigned per_range,
+			     set<uint32_t> *mismatched_ranges,
+			     size_t *shipped)
+{
+  BackfillDigestScan scan;
+  scan.build(BackfillInterval(local), per_range);
+
+  bufferlist bl;
+  encode(scan.ranges, bl);
+  vector<BackfillRangeDigest> ranges;
+  auto p = bl.cbegin();
+  decode(ranges, p);
+
+  map<hobject_t, eversion_t> mismatched;
+  *mismatched_ranges = BackfillDigestScan::compare(
+    scan.begin, ranges, target, &mismatched);
+  *shipped = mismatched.size();
+  BackfillInterval bi;
+  scan.apply(*mismatched_ranges, std::move(mismatched), &bi);
+  return bi;
+}
+
+TEST(BackfillDigestScan, build)
+{
+  BackfillDigestScan scan;
+  scan.build(make_interval(100), 32);
+  ASSERT_EQ(100u, scan.objects.size());
+  ASSERT_EQ(4u, scan.ranges.size());
+  ASSERT_EQ(32u, scan.ranges[0].num_objects);
+  ASSERT_EQ(make_oid(64), scan.ranges[0].end);
+  ASSERT_EQ(4u, scan.ranges[3].num_objects);
+  ASSERT_TRUE(scan.ranges[3].end.is_max());
+
+  scan.build(make_interval(0), 32);
+  ASSERT_EQ(1u, scan.ranges.size());
+  ASSERT_EQ(0u, scan.ranges[0].num_objects);
+  ASSERT_TRUE(scan.ranges[0].end.is_max());
+}
+
+TEST(BackfillDigestScan, identical)
+{
+  auto local = make_interval(100);
+  set<uint32_t> mismatched_ranges;
+  size_t shipped;
+  auto bi = scan(local, local.objects, 16, &mismatched_ranges, &shipped);
+  ASSERT_TRUE(mismatched_ranges.empty());
+  ASSERT_EQ(0u, shipped);
+  ASSERT_EQ(local.begin, bi.begin);
+  ASSERT_EQ(local.end, bi.end);
+  ASSERT_EQ(local.objects, bi.objects);
+}
+
+TEST(BackfillDigestScan, differences)
+{
+  auto local = make_interval(100);
+  auto target = local.objects;
+  target[make_oid(10)] = eversion_t(9, 1);  // stale, range 0
+  target.erase(make_oid(70));               // missing, range 2
+  target[make_oid(199)] = eversion_t(9, 2); // gone from the primary, range 6
+  set<uint32_t> mismatched_ranges;
+  size_t shipped;
+  auto bi = scan(local, target, 16, &mismatched_ranges, &shipped);
+  ASSERT_EQ(set<uint32_t>({0, 2, 6}), mismatched_ranges);
+  ASSERT_EQ(16u + 15u + 5u, shipped);
+  ASSERT_EQ(target, bi.objects);
+}
+
+TEST(BackfillDigestScan, empty_primary)
+{
+  auto local = make_interval(0);
+  auto target = make_interval(10).objects;
+  set<uint32_t> mismatched_ranges;
+  size_t shipped;
+  auto bi = scan(local, target, 16, &mismatched_ranges, &shipped);
+  ASSERT_EQ(set<uint32_t>({0}), mismatched_ranges);
+  ASSERT_EQ(target, bi.objects);
+}
@@ -0,0 +1,91 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <set>
+
+#include <gtest/gtest.h>
+#include "osd/PGBackend.h"
+
+static object_info_t make_oi(eversion_t version)
+{
+  object_info_t oi;
+  oi.version = version;
+  return oi;
+}
+
+TEST(DeepScrubSample, should_sample)
+{
+  ScrubMapBuilder pos;
+  pos.deep = true;
+  // not an incremental deep scrub
+  ASSERT_FALSE(PGBackend::be_should_sample(
+    pos, make_oi(eversion_t(1, 5)), true, 0.1));
+
+  pos.incremental_since = eversion_t(2, 10);
+  ASSERT_TRUE(PGBackend::be_should_sample(
+    pos, make_oi(eversion_t(1, 5)), true, 0.1));
+  ASSERT_TRUE(PGBackend::be_should_sample(
+    pos, make_oi(eversion_t(2, 10)), true, 0.1));
+  // modified since the previous deep scrub
+  ASSERT_FALSE(PGBackend::be_should_sample(
+    pos, make_oi(eversion_t(2, 11)), true, 0.1));
+  ASSERT_FALSE(PGBackend::be_should_sample(
+    pos, make_oi(eversion_t(3, 1)), true, 0.1));
+  // no persisted digest standing for the data
+  ASSERT_FALSE(PGBackend::be_should_sample(
+    pos, make_oi(eversion_t(1, 5)), false, 0.1));
+  // a ratio of 0 reads the data in full rather than skipping it
+  ASSERT_FALSE(PGBackend::be_should_sample(
+    pos, make_oi(eversion_t(1, 5)), true, 0));
+}
+
+TEST(DeepScrubSample, every_stride)
+{
+  for (uint64_t from = 0; from < 10; ++from) {
+    ASSERT_EQ(from, PGBackend::be_next_sampled_stride(7, 0x1234, 1, from));
+    // set to 0 while sampling
+    ASSERT_EQ(from, PGBackend::be_next_sampled_stride(7, 0x1234, 0, from));
+  }
+}
+
+TEST(DeepScrubSample, stride_period)
+{
+  const uint32_t seed = 42;
+  const uint32_t hash = 0xdeadbeef;
+  // a quarter of the strides, all at the same offset in their period
+  const uint64_t first =
+    PGBackend::be_next_sampled_stride(seed, hash, 0.25, 0);
+  ASSERT_LT(first, 4u);
+  unsigned sampled = 0;
+  for (uint64_t i = PGBackend::be_next_sampled_stride(seed, hash, 0.25, 0);
+       i < 400;
+       i = PGBackend::be_next_sampled_stride(seed, hash, 0.25, i + 1)) {
+    ASSERT_EQ(first, i % 4);
+    ++sampled;
+  }
+  ASSERT_EQ(100u, sampled);
+  // resuming at any stride finds the next sampled one
+  for (uint64_t from = 0; from < 40; ++from) {
+    auto i = PGBackend::be_next_sampled_stride(seed, hash, 0.25, from);
+    ASSERT_LE(from, i);
+    ASSERT_LT(i, from + 4);
+    ASSERT_EQ(first, i % 4);
+  }
+}
+
+TEST(DeepScrubSample, seeds_cover_every_stride)
+{
+  // successive scrubs pick different strides of an unmodified object
+  std::set<uint64_t> firsts;
+  for (uint32_t seed = 1; seed <= 100; ++seed) {
+    firsts.insert(PGBackend::be_next_sampled_stride(seed, 0x1234, 0.1, 0));
+  }
+  ASSERT_EQ(10u, firsts.size());
+  ASSERT_EQ(9u, *firsts.rbegin());
+}
+
+TEST(DeepScrubSample, tiny_ratio)
+{
+  auto i = PGBackend::be_next_sampled_stride(3, 0x1234, 1e-30, 0);
+  ASSERT_LT(i, 1000000000u);
+}
@@ -12,7 +12,10 @@
  *
  */
 
+#include <cstring>
+
 #include <gtest/gtest.h>
+#include "erasure-code/ErasureCode.h"
 #include "osd/PGTransaction.h"
 #include "osd/ECTransaction.h"
 
@@ -122,3 +125,189 @@ TEST(ectransaction, many_writes)
   ASSERT_EQ(0u, plan.to_read.size());
   ASSERT_EQ(1u, plan.will_write.size());
 }
+
+TEST(ectransaction, parity_delta_plan)
+{
+  hobject_t h;
+  PGTransactionUPtr t(new PGTransaction);
+  bufferlist a;
+  a.append_zero(4096);
+  // k=4, 4K chunks, object of 4 stripes; overwrite the middle of chunk 1
+  // of the third stripe
+  ECUtil::stripe_info_t sinfo(4, 16384);
+  t->write(h, 2 * 16384 + 4096 + 1024, a.length(), a, 0);
+
+  auto plan = ECTransaction::get_write_plan(
+    sinfo,
+    *t,
+    [&](const hobject_t &i) {
+      ECUtil::HashInfoRef ref(new ECUtil::HashInfo(6));
+      ref->set_projected_total_logical_size(sinfo, 4 * 16384);
+      return ref;
+    },
+    &dpp);
+  generic_derr << "to_read " << plan.to_read << dendl;
+  generic_derr << "delta_chunks " << plan.delta_chunks << dendl;
+
+  ASSERT_EQ(1u, plan.to_read.size());
+  ASSERT_EQ(16384u, plan.to_read[h].size());
+  ASSERT_EQ(1u, plan.delta_chunks.size());
+  extent_set chunks;
+  chunks.insert(2 * 16384 + 4096, 8192);
+  ASSERT_EQ(chunks, plan.delta_chunks[h]);
+}
+
+TEST(ectransaction, parity_delta_plan_append)
+{
+  hobject_t h;
+  PGTransactionUPtr t(new PGTransaction);
+  bufferlist a;
+  a.append_zero(16384);
+  ECUtil::stripe_info_t sinfo(4, 16384);
+  // overwrites the end of the second stripe and extends the object
+  t->write(h, 16384 + 8192, a.length(), a, 0);
+
+  auto plan = ECTransaction::get_write_plan(
+    sinfo,
+    *t,
+    [&](const hobject_t &i) {
+      ECUtil::HashInfoRef ref(new ECUtil::HashInfo(6));
+      ref->set_projected_total_logical_size(sinfo, 2 * 16384);
+      return ref;
+    },
+    &dpp);
+  ASSERT_EQ(1u, plan.to_read.size());
+  ASSERT_EQ(0u, plan.delta_chunks.size());
+}
+
+/// a linear code: the first coding chunk is the XOR of the data chunks,
+/// the second the XOR of the even ones
+class ErasureCodeXor final : public ceph::ErasureCode {
+  const unsigned k, m;
+  const uint64_t flags;
+public:
+  ErasureCodeXor(unsigned k, unsigned m, uint64_t flags)
+    : k(k), m(m), flags(flags) {}
+
+  unsigned int get_chunk_count() const override {
+    return k + m;
+  }
+  unsigned int get_data_chunk_count() const override {
+    return k;
+  }
+  unsigned int get_chunk_size(unsigned int object_size) const override {
+    return (object_size + k - 1) / k;
+  }
+  uint64_t get_supported_optimizations() const override {
+    return flags;
+  }
+  int encode_chunks(const std::set<int> &want_to_encode,
+		    std::map<int, bufferlist> *encoded) override {
+    unsigned len = (*encoded)[0].length();
+    for (unsigned p = 0; p < m; ++p) {
+      char *out = (*encoded)[k + p].c_str();
+      memset(out, 0, len);
+      for (unsigned d = 0; d < k; d += p + 1) {
+	const char *in = (*encoded)[d].c_str();
+	for (unsigned i = 0; i < len; ++i) {
+	  out[i] ^= in[i];
+	}
+      }
+    }
+    return 0;
+  }
+  int decode_chunks(const std::set<int> &want_to_read,
+		    const std::map<int, bufferlist> &chunks,
+		    std::map<int, bufferlist> *decoded) override {
+    return -EOPNOTSUPP;
+  }
+};
+
+TEST(ectransaction, plan_parity_delta)
+{
+  hobject_t h;
+  ECUtil::stripe_info_t sinfo(4, 16384);
+  ECTransaction::WritePlan plan;
+  plan.to_read[h].insert(16384, 16384);
+  plan.will_write[h].insert(16384, 16384);
+  plan.delta_chunks[h].insert(16384 + 4096, 4096);
+
+  {
+    // reads chunk 1 and 2 coding chunks, writes the same instead of
+    // reading 4 and writing 6
+    ceph::ErasureCodeInterfaceRef ec(new ErasureCodeXor(4, 2,
+      ceph::ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION));
+    auto p = plan;
+    ASSERT_TRUE(ECTransaction::plan_parity_delta(sinfo, ec, p));
+    ASSERT_TRUE(p.parity_delta);
+    ASSERT_EQ((std::set<int>{1, 4, 5}), p.delta_shards[h]);
+  }
+  {
+    ceph::ErasureCodeInterfaceRef ec(new ErasureCodeXor(4, 2, 0));
+    auto p = plan;
+    ASSERT_FALSE(ECTransaction::plan_parity_delta(sinfo, ec, p));
+    ASSERT_FALSE(p.parity_delta);
+  }
+  {
+    // three of four data chunks: cheaper to rewrite the stripe
+    ceph::ErasureCodeInterfaceRef ec(new ErasureCodeXor(4, 2,
+      ceph::ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION));
+    auto p = plan;
+    p.delta_chunks[h].insert(16384, 4096);
+    p.delta_chunks[h].insert(16384 + 8192, 4096);
+    ASSERT_FALSE(ECTransaction::plan_parity_delta(sinfo, ec, p));
+  }
+  {
+    // another object which has to be read without parity deltas
+    ceph::ErasureCodeInterfaceRef ec(new ErasureCodeXor(4, 2,
+      ceph::ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION));
+    auto p = plan;
+    hobject_t other(object_t("other"), "", CEPH_NOSNAP, 0, 0, "");
+    p.to_read[other].insert(0, 16384);
+    ASSERT_FALSE(ECTransaction::plan_parity_delta(sinfo, ec, p));
+  }
+}
+
+TEST(ecutil, encode_parity_delta)
+{
+  const unsigned k = 4, m = 2, stripes = 3;
+  ECUtil::stripe_info_t sinfo(k, 4 * k);
+  ceph::ErasureCodeInterfaceRef ec(new ErasureCodeXor(k, m,
+    ceph::ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION));
+
+  bufferlist before, after;
+  for (unsigned i = 0; i < stripes * sinfo.get_stripe_width(); ++i) {
+    before.append(char(i * 7));
+    after.append(char(i * 7));
+  }
+  std::string update(2 * sinfo.get_chunk_size(), 'x');
+  // modifies chunks 1 and 2 of every stripe
+  for (unsigned s = 0; s < stripes; ++s) {
+    after.begin(s * sinfo.get_stripe_width() + sinfo.get_chunk_size() + 1)
+      .copy_in(update.size() - 2, update.c_str());
+  }
+  after.rebuild();
+
+  std::set<int> want;
+  for (unsigned i = 0; i < k + m; ++i) {
+    want.insert(i);
+  }
+  std::map<int, bufferlist> old_chunks, new_chunks;
+  ASSERT_EQ(0, ECUtil::encode(sinfo, ec, before, want, &old_chunks));
+  ASSERT_EQ(0, ECUtil::encode(sinfo, ec, after, want, &new_chunks));
+
+  std::map<int, bufferlist> old_data, new_data, parity;
+  for (int shard : {1, 2}) {
+    old_data[shard] = old_chunks[shard];
+    new_data[shard] = new_chunks[shard];
+  }
+  for (int shard : {4, 5}) {
+    parity[shard] = old_chunks[shard];
+  }
+  ASSERT_EQ(0, ECUtil::encode_parity_delta(
+    sinfo, ec, old_data, new_data, &parity));
+  for (int shard : {4, 5}) {
+    ASSERT_TRUE(parity[shard].contents_equal(new_chunks[shard]));
+    ASSERT_FALSE(parity[shard].contents_equal(old_chunks[shard]));
+  }
+}
@@ -0,0 +1,144 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "global/global_context.h"
+#include "messages/MOSDPing.h"
+#include "osd/HeartbeatChannel.h"
+
+using namespace std;
+using namespace std::chrono_literals;
+
+namespace {
+
+/// a channel bound to loopback that keeps what it received
+struct Endpoint {
+  ceph::mutex lock = ceph::make_mutex("Endpoint::lock");
+  ceph::condition_variable cond;
+  vector<HeartbeatChannel::Received> received;
+  HeartbeatChannel channel;
+
+  Endpoint()
+    : channel(g_ceph_context, [this](auto& batch) {
+	std::lock_guard l(lock);
+	for (auto& r : batch) {
+	  received.push_back(std::move(r));
+	}
+	cond.notify_all();
+      })
+  {
+    entity_addr_t addr;
+    addr.parse("127.0.0.1:0");
+    EXPECT_EQ(0, channel.bind(HeartbeatChannel::BACK, addr));
+    EXPECT_EQ(0, channel.bind(HeartbeatChannel::FRONT, addr));
+    EXPECT_EQ(0, channel.start());
+  }
+
+  bool wait_for(size_t n) {
+    std::unique_lock l(lock);
+    return cond.wait_for(l, 10s, [&] { return received.size() >= n; });
+  }
+};
+
+HeartbeatChannel::Ping make_ping(int from, uint8_t op)
+{
+  HeartbeatChannel::Ping p;
+  p.fsid.generate_random();
+  p.from = from;
+  p.op = op;
+  p.map_epoch = 20;
+  p.up_from = 18;
+  p.ping_stamp = utime_t(1000, 1);
+  p.mono_ping_stamp = ceph::make_timespan(1.5);
+  p.mono_send_stamp = ceph::make_timespan(2.5);
+  p.delta_ub = ceph::make_timespan(0.25);
+  return p;
+}
+
+} // anonymous namespace
+
+TEST(HeartbeatChannel, ping_encode_decode)
+{
+  auto ping = make_ping(3, MOSDPing::PING_REPLY);
+  bufferlist bl;
+  encode(ping, bl);
+  bl.append_zero(100);  // padding
+  HeartbeatChannel::Ping decoded;
+  auto p = bl.cbegin();
+  decode(decoded, p);
+  ASSERT_EQ(ping.fsid, decoded.fsid);
+  ASSERT_EQ(3, decoded.from);
+  ASSERT_EQ(MOSDPing::PING_REPLY, decoded.op);
+  ASSERT_EQ(20u, decoded.map_epoch);
+  ASSERT_EQ(18u, decoded.up_from);
+  ASSERT_EQ(ping.ping_stamp, decoded.ping_stamp);
+  ASSERT_EQ(ping.mono_ping_stamp, decoded.mono_ping_stamp);
+  ASSERT_EQ(ping.mono_send_stamp, decoded.mono_send_stamp);
+  ASSERT_EQ(ping.delta_ub, decoded.delta_ub);
+
+  bufferlist garbage;
+  garbage.append(string(64, 'x'));
+  auto q = garbage.cbegin();
+  ASSERT_THROW(decode(decoded, q), ceph::buffer::error);
+}
+
+TEST(HeartbeatChannel, send_receive)
+{
+  Endpoint a, b;
+  auto to = b.channel.get_addr(HeartbeatChannel::FRONT);
+  ASSERT_NE(0, to.get_port());
+
+  // each round takes two sendmmsg() calls, but stays well below the
+  // default socket receive buffer, so loopback does not drop any of it
+  const unsigned per_round = HeartbeatChannel::BATCH + 1;
+  const unsigned rounds = 3;
+  for (unsigned round = 0; round < rounds; ++round) {
+    for (unsigned i = 0; i < per_round; ++i) {
+      auto ping = make_ping(i, MOSDPing::PING);
+      a.channel.queue(HeartbeatChannel::FRONT, to, ping, 200);
+    }
+    a.channel.flush();
+    ASSERT_TRUE(b.wait_for((round + 1) * per_round));
+  }
+
+  std::lock_guard l(b.lock);
+  ASSERT_EQ(rounds * per_round, b.received.size());
+  auto from = a.channel.get_addr(HeartbeatChannel::FRONT);
+  for (auto& r : b.received) {
+    ASSERT_EQ(HeartbeatChannel::FRONT, r.iface);
+    ASSERT_TRUE(r.from_addr.is_same_host(from));
+    ASSERT_EQ(from.get_port(), r.from_addr.get_port());
+    ASSERT_EQ(200u, r.length);
+    ASSERT_EQ(MOSDPing::PING, r.ping.op);
+    ASSERT_EQ(18u, r.ping.up_from);
+  }
+}
+
+TEST(HeartbeatChannel, drops_malformed)
+{
+  Endpoint b;
+  auto to = b.channel.get_addr(HeartbeatChannel::BACK);
+  int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(fd, 0);
+  string garbage(100, 'x');
+  ASSERT_EQ((ssize_t)garbage.size(),
+	    ::sendto(fd, garbage.data(), garbage.size(), 0,
+		     to.get_sockaddr(), to.get_sockaddr_len()));
+
+  Endpoint a;
+  a.channel.queue(HeartbeatChannel::BACK, to,
+		  make_ping(7, MOSDPing::YOU_DIED), 0);
+  a.channel.flush();
+  ASSERT_TRUE(b.wait_for(1));
+  ::close(fd);
+
+  std::lock_guard l(b.lock);
+  ASSERT_EQ(1u, b.received.size());
+  ASSERT_EQ(HeartbeatChannel::BACK, b.received[0].iface);
+  ASSERT_EQ(7, b.received[0].ping.from);
+  ASSERT_EQ(MOSDPing::YOU_DIED, b.received[0].ping.op);
+}
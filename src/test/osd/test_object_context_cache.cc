@@ -0,0 +1,148 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "osd/ObjectContextCache.h"
+#include "test/osd/cache_test_utils.h"
+
+using namespace std;
+using namespace CacheTest;
+
+TEST(ObjectContextCache, lookup)
+{
+  ObjectContextCache cache(16);
+  ASSERT_FALSE(cache.lookup(pg_a, make_oid(1), false));
+  auto obc = cache.lookup(pg_a, make_oid(1), true);
+  ASSERT_TRUE(obc);
+  ASSERT_EQ(obc, cache.lookup(pg_a, make_oid(1), false));
+  ASSERT_EQ(obc, cache.lookup(pg_a, make_oid(1), true));
+  ASSERT_FALSE(cache.lookup(pg_b, make_oid(1), false));
+
+  // still there, with its state, once unreferenced
+  obc->obs.oi.size = 123;
+  auto raw = obc.get();
+  obc.reset();
+  obc = cache.lookup(pg_a, make_oid(1), false);
+  ASSERT_EQ(raw, obc.get());
+  ASSERT_EQ(123u, obc->obs.oi.size);
+}
+
+TEST(ObjectContextCache, evict_unreferenced_only)
+{
+  ObjectContextCache cache(4);
+  vector<ObjectContextRef> live;
+  for (unsigned i = 0; i < 8; ++i) {
+    live.push_back(cache.lookup(pg_a, make_oid(i), true));
+  }
+  ASSERT_EQ(8u, cache.get_count());
+
+  // release the oldest half first, it is evicted first
+  for (unsigned i = 0; i < 8; ++i) {
+    live[i].reset();
+  }
+  ASSERT_EQ(4u, cache.get_count());
+  for (unsigned i = 0; i < 4; ++i) {
+    ASSERT_FALSE(cache.lookup(pg_a, make_oid(i), false));
+  }
+  for (unsigned i = 4; i < 8; ++i) {
+    ASSERT_TRUE(cache.lookup(pg_a, make_oid(i), false));
+  }
+
+  // a lookup makes it the most recently used
+  auto hot = cache.lookup(pg_a, make_oid(4), false);
+  hot.reset();
+  cache.lookup(pg_a, make_oid(8), true);
+  ASSERT_TRUE(cache.lookup(pg_a, make_oid(4), false));
+  ASSERT_FALSE(cache.lookup(pg_a, make_oid(5), false));
+
+  cache.set_target_size(0);
+  ASSERT_EQ(0u, cache.get_count());
+}
+
+TEST(ObjectContextCache, budget_shared_by_pgs)
+{
+  ObjectContextCache cache(8);
+  for (unsigned i = 0; i < 8; ++i) {
+    cache.lookup(pg_a, make_oid(i), true);
+  }
+  ObjectContextCache::PGCache a(cache, pg_a);
+  ObjectContextCache::PGCache b(cache, pg_b);
+  ASSERT_EQ(8, a.get_count());
+  ASSERT_TRUE(b.empty());
+  b.lookup_or_create(make_oid(0));
+  ASSERT_EQ(7, a.get_count());
+  ASSERT_EQ(1, b.get_count());
+}
+
+TEST(ObjectContextCache, clear_range)
+{
+  ObjectContextCache cache(16);
+  ObjectContextCache::PGCache a(cache, pg_a);
+  ObjectContextCache::PGCache b(cache, pg_b);
+  auto live = a.lookup_or_create(make_oid(1));
+  a.lookup_or_create(make_oid(2));
+  b.lookup_or_create(make_oid(1));
+
+  a.clear();
+  ASSERT_EQ(1, a.get_count());
+  ASSERT_EQ(1, b.get_count());
+  // referenced obcs stay visible until they are released ...
+  ASSERT_EQ(live, a.lookup(make_oid(1)));
+  ASSERT_FALSE(a.lookup(make_oid(2)));
+  a.clear();
+  live.reset();
+  // ... and are then freed rather than cached
+  ASSERT_TRUE(a.empty());
+
+  // unless they were looked up again in the meantime
+  live = a.lookup_or_create(make_oid(3));
+  a.clear();
+  ASSERT_EQ(live, a.lookup(make_oid(3)));
+  live.reset();
+  ASSERT_EQ(1, a.get_count());
+}
+
+TEST(ObjectContextCache, get_next)
+{
+  ObjectContextCache cache(64);
+  cache.set_num_shards(4);
+  ObjectContextCache::PGCache a(cache, pg_a);
+  ObjectContextCache::PGCache b(cache, pg_b);
+  for (unsigned i = 0; i < 5; ++i) {
+    a.lookup_or_create(make_oid(i));
+    b.lookup_or_create(make_oid(i));
+  }
+  unsigned n = 0;
+  pair<hobject_t, ObjectContextRef> i;
+  while (a.get_next(i.first, &i)) {
+    ASSERT_TRUE(i.second);
+    ASSERT_EQ(i.second, a.lookup(i.first));
+    ++n;
+  }
+  ASSERT_EQ(5u, n);
+}
+
+TEST(ObjectContextCache, concurrent_release)
+{
+  ObjectContextCache cache(2);
+  cache.set_num_shards(2);
+  constexpr unsigned num_threads = 8;
+  vector<thread> threads;
+  for (unsigned t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&cache, t] {
+      for (unsigned i = 0; i < 10000; ++i) {
+	spg_t pgid(pg_t(i % 3, 1));
+	auto obc = cache.lookup(pgid, make_oid((i + t) % 5), true);
+	auto again = cache.lookup(pgid, make_oid((i + t) % 5), false);
+	ASSERT_EQ(obc, again);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_LE(cache.get_count(), 2u);
+}
@@ -0,0 +1,149 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+#include "osd/ObjectReadCache.h"
+#include "test/osd/cache_test_utils.h"
+
+using namespace std;
+using namespace CacheTest;
+
+static bufferlist make_data(unsigned len, char c)
+{
+  bufferlist bl;
+  bl.append(string(len, c));
+  return bl;
+}
+
+/// the object info of oid i holding data, at version
+static object_info_t make_oi(unsigned i, const bufferlist& data,
+			     eversion_t version)
+{
+  object_info_t oi(make_oid(i));
+  oi.version = version;
+  oi.size = data.length();
+  oi.set_data_digest(data.crc32c(-1));
+  return oi;
+}
+
+TEST(ObjectReadCache, may_cache_read)
+{
+  ObjectReadCache cache(4096, 1024);
+  auto oi = make_oi(1, make_data(100, 'a'), eversion_t(1, 1));
+  ASSERT_TRUE(cache.may_cache_read(oi, 0, 100, false));
+  // only whole objects, read by ops that do not write
+  ASSERT_FALSE(cache.may_cache_read(oi, 0, 50, false));
+  ASSERT_FALSE(cache.may_cache_read(oi, 50, 50, false));
+  ASSERT_FALSE(cache.may_cache_read(oi, 0, 100, true));
+  // which have a data digest to check what is cached
+  oi.clear_data_digest();
+  ASSERT_FALSE(cache.may_cache_read(oi, 0, 100, false));
+
+  auto large = make_oi(2, make_data(1025, 'a'), eversion_t(1, 1));
+  ASSERT_FALSE(cache.may_cache_read(large, 0, 1025, false));
+}
+
+TEST(ObjectReadCache, admit_hot_only)
+{
+  ObjectReadCache cache(4096, 1024);
+  auto data = make_data(100, 'a');
+  auto oi = make_oi(1, data, eversion_t(1, 1));
+  // the first read only puts the object in the HitSet
+  ASSERT_FALSE(cache.admit(pg_a, oi.soid, oi, false, data));
+  ASSERT_EQ(0u, cache.get_bytes());
+  ASSERT_TRUE(cache.admit(pg_a, oi.soid, oi, true, data));
+  ASSERT_EQ(100u, cache.get_bytes());
+  bufferlist out;
+  ASSERT_TRUE(cache.lookup(pg_a, oi.soid, oi.version, &out));
+  ASSERT_TRUE(out.contents_equal(data));
+
+  // a newer version replaces it
+  auto newer = make_data(50, 'b');
+  oi = make_oi(1, newer, eversion_t(1, 2));
+  ASSERT_TRUE(cache.admit(pg_a, oi.soid, oi, true, newer));
+  ASSERT_EQ(50u, cache.get_bytes());
+}
+
+TEST(ObjectReadCache, admit_checks_data_digest)
+{
+  ObjectReadCache cache(4096, 1024);
+  auto data = make_data(100, 'a');
+  auto oi = make_oi(1, data, eversion_t(1, 1));
+
+  // the object store returned something else than what was written
+  auto bad = make_data(100, 'x');
+  ASSERT_FALSE(cache.admit(pg_a, oi.soid, oi, true, bad));
+  // or not the whole object
+  ASSERT_FALSE(cache.admit(pg_a, oi.soid, oi, true, make_data(50, 'a')));
+  // or there is nothing to check it against
+  oi.clear_data_digest();
+  ASSERT_FALSE(cache.admit(pg_a, oi.soid, oi, true, data));
+  ASSERT_EQ(0u, cache.get_bytes());
+  bufferlist out;
+  ASSERT_FALSE(cache.lookup(pg_a, oi.soid, oi.version, &out));
+}
+
+TEST(ObjectReadCache, version_mismatch_drops)
+{
+  ObjectReadCache cache(4096, 1024);
+  cache.insert(pg_a, make_oid(1), eversion_t(1, 1), make_data(100, 'a'));
+  bufferlist out;
+  // the object was written behind our back
+  ASSERT_FALSE(cache.lookup(pg_a, make_oid(1), eversion_t(1, 2), &out));
+  ASSERT_TRUE(out.length() == 0);
+  ASSERT_EQ(0u, cache.get_bytes());
+  ASSERT_FALSE(cache.lookup(pg_a, make_oid(1), eversion_t(1, 1), &out));
+}
+
+TEST(ObjectReadCache, invalidate)
+{
+  ObjectReadCache cache(4096, 1024);
+  cache.insert(pg_a, make_oid(1), eversion_t(1, 1), make_data(100, 'a'));
+  cache.insert(pg_a, make_oid(2), eversion_t(1, 1), make_data(100, 'a'));
+  cache.invalidate(pg_a, make_oid(1));
+  ASSERT_EQ(100u, cache.get_bytes());
+  bufferlist out;
+  ASSERT_FALSE(cache.lookup(pg_a, make_oid(1), eversion_t(1, 1), &out));
+  ASSERT_TRUE(cache.lookup(pg_a, make_oid(2), eversion_t(1, 1), &out));
+  cache.clear();
+  ASSERT_EQ(0u, cache.get_bytes());
+}
+
+TEST(ObjectReadCache, size_limits)
+{
+  ObjectReadCache cache(1000, 300);
+  ASSERT_TRUE(cache.may_cache(300));
+  ASSERT_FALSE(cache.may_cache(301));
+  cache.insert(pg_a, make_oid(1), eversion_t(1, 1), make_data(301, 'a'));
+  ASSERT_EQ(0u, cache.get_bytes());
+
+  // least recently used first
+  for (unsigned i = 0; i < 3; ++i) {
+    cache.insert(pg_a, make_oid(i), eversion_t(1, 1), make_data(300, 'a'));
+  }
+  bufferlist out;
+  ASSERT_TRUE(cache.lookup(pg_a, make_oid(0), eversion_t(1, 1), &out));
+  cache.insert(pg_a, make_oid(3), eversion_t(1, 1), make_data(300, 'a'));
+  ASSERT_EQ(900u, cache.get_bytes());
+  ASSERT_TRUE(cache.lookup(pg_a, make_oid(0), eversion_t(1, 1), &out));
+  ASSERT_FALSE(cache.lookup(pg_a, make_oid(1), eversion_t(1, 1), &out));
+  ASSERT_TRUE(cache.lookup(pg_a, make_oid(3), eversion_t(1, 1), &out));
+
+  cache.set_max_bytes(0);
+  ASSERT_FALSE(cache.enabled());
+  ASSERT_EQ(0u, cache.get_bytes());
+}
+
+TEST(ObjectReadCache, shards)
+{
+  ObjectReadCache cache(0, 1024);
+  cache.set_num_shards(2);
+  cache.set_max_bytes(2000);
+  // each shard gets half of the budget
+  for (unsigned i = 0; i < 4; ++i) {
+    cache.insert(pg_a, make_oid(i), eversion_t(1, 1), make_data(400, 'a'));
+  }
+  ASSERT_EQ(800u, cache.get_bytes());
+  cache.insert(pg_b, make_oid(0), eversion_t(1, 1), make_data(400, 'b'));
+  ASSERT_EQ(1200u, cache.get_bytes());
+}
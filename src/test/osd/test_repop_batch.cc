@@ -0,0 +1,173 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include "global/global_context.h"
+#include "messages/MOSDRepOpBatch.h"
+#include "os/Transaction.h"
+#include "osd/RepOpBatcher.h"
+
+using namespace std;
+
+static const spg_t pgid(pg_t(3, 1));
+
+static ceph::ref_t<MOSDRepOp> make_repop(unsigned i)
+{
+  hobject_t soid(object_t("obj" + to_string(i)), "", CEPH_NOSNAP, i, 1, "");
+  auto m = ceph::make_message<MOSDRepOp>(
+    osd_reqid_t(entity_name_t::CLIENT(4100), 0, 100 + i),
+    pg_shard_t(0), pgid, soid, CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK,
+    20, 18, 1000 + i, eversion_t(20, i + 1));
+  ceph::os::Transaction t;
+  bufferlist data;
+  data.append(string(100 * (i + 1), 'a' + i));
+  t.write(coll_t(pgid), ghobject_t(soid), 0, data.length(), data);
+  encode(t, m->get_data());
+  m->logbl.append("log" + to_string(i));
+  m->pg_trim_to = eversion_t(20, i);
+  m->min_last_complete_ondisk = eversion_t(20, i);
+  return m;
+}
+
+TEST(MOSDRepOpBatch, encode_decode)
+{
+  vector<ceph::ref_t<MOSDRepOp>> ops, expected;
+  for (unsigned i = 0; i < 3; ++i) {
+    ops.push_back(make_repop(i));
+    expected.push_back(make_repop(i));
+  }
+  auto batch = ceph::make_message<MOSDRepOpBatch>(pgid, 20, 18, std::move(ops));
+  batch->get_header().src = entity_name_t::OSD(0);
+
+  bufferlist bl;
+  encode_message(batch.get(), CEPH_FEATURES_ALL, bl);
+  auto p = bl.cbegin();
+  ceph::ref_t<Message> m(decode_message(g_ceph_context, 0, p), false);
+  ASSERT_TRUE(m);
+  ASSERT_EQ(MSG_OSD_REPOP_BATCH, m->get_type());
+  auto decoded = static_cast<MOSDRepOpBatch*>(m.get());
+  ASSERT_EQ(pgid, decoded->get_spg());
+  ASSERT_EQ(20u, decoded->get_map_epoch());
+  ASSERT_EQ(18u, decoded->get_min_epoch());
+  ASSERT_EQ(3u, decoded->ops.size());
+  for (unsigned i = 0; i < 3; ++i) {
+    auto &op = decoded->ops[i];
+    op->finish_decode();
+    ASSERT_EQ(MSG_OSD_REPOP, op->get_type());
+    ASSERT_EQ(expected[i]->get_tid(), op->get_tid());
+    ASSERT_EQ(0, op->get_source().num());
+    ASSERT_EQ(expected[i]->reqid, op->reqid);
+    ASSERT_EQ(expected[i]->poid, op->poid);
+    ASSERT_EQ(expected[i]->version, op->version);
+    ASSERT_EQ(expected[i]->pg_trim_to, op->pg_trim_to);
+    ASSERT_EQ(expected[i]->min_last_complete_ondisk,
+	      op->min_last_complete_ondisk);
+    ASSERT_TRUE(expected[i]->logbl.contents_equal(op->logbl));
+    ASSERT_TRUE(expected[i]->get_data().contents_equal(op->get_data()));
+  }
+}
+
+namespace {
+
+/// what a RepOpBatcher sent, as (shard, tids) in the order it sent them
+struct Sent {
+  vector<pair<pg_shard_t, vector<ceph_tid_t>>> messages;
+
+  RepOpBatcher::send_t sender() {
+    return [this](pg_shard_t shard, Message *m) {
+      ceph::ref_t<Message> ref(m, false);
+      vector<ceph_tid_t> tids;
+      if (m->get_type() == MSG_OSD_REPOP_BATCH) {
+	for (auto &op : static_cast<MOSDRepOpBatch*>(m)->ops) {
+	  tids.push_back(op->get_tid());
+	}
+      } else {
+	ASSERT_EQ(MSG_OSD_REPOP, m->get_type());
+	tids.push_back(m->get_tid());
+      }
+      messages.emplace_back(shard, std::move(tids));
+    };
+  }
+};
+
+const pg_shard_t replica1(1), replica2(2);
+const uint64_t max_bytes = 1 << 20;
+
+} // anonymous namespace
+
+TEST(RepOpBatcher, batch_and_flush)
+{
+  Sent sent;
+  RepOpBatcher batcher(sent.sender());
+  for (unsigned i = 0; i < 3; ++i) {
+    ASSERT_TRUE(batcher.queue(replica1, make_repop(i), max_bytes));
+  }
+  ASSERT_TRUE(batcher.queue(replica2, make_repop(3), max_bytes));
+  ASSERT_TRUE(sent.messages.empty());
+  ASSERT_FALSE(batcher.empty());
+
+  batcher.flush();
+  ASSERT_TRUE(batcher.empty());
+  ASSERT_EQ(2u, sent.messages.size());
+  // a batch of the three, in issue order, and a lone repop on its own
+  ASSERT_EQ(replica1, sent.messages[0].first);
+  ASSERT_EQ((vector<ceph_tid_t>{1000, 1001, 1002}), sent.messages[0].second);
+  ASSERT_EQ(replica2, sent.messages[1].first);
+  ASSERT_EQ((vector<ceph_tid_t>{1003}), sent.messages[1].second);
+
+  batcher.flush();
+  ASSERT_EQ(2u, sent.messages.size());
+}
+
+TEST(RepOpBatcher, max_bytes)
+{
+  Sent sent;
+  RepOpBatcher batcher(sent.sender());
+  // make_repop(i) has 100 * (i + 1) bytes of data
+  ASSERT_TRUE(batcher.queue(replica1, make_repop(0), 300));
+  ASSERT_TRUE(batcher.queue(replica2, make_repop(1), 300));
+  ASSERT_FALSE(batcher.queue(replica1, make_repop(2), 300));
+  ASSERT_EQ(1u, sent.messages.size());
+  ASSERT_EQ(replica1, sent.messages[0].first);
+  ASSERT_EQ((vector<ceph_tid_t>{1000, 1002}), sent.messages[0].second);
+
+  // what is left for the other replica is still held back
+  ASSERT_FALSE(batcher.empty());
+  batcher.flush();
+  ASSERT_EQ(2u, sent.messages.size());
+  ASSERT_EQ((vector<ceph_tid_t>{1001}), sent.messages[1].second);
+}
+
+TEST(RepOpBatcher, send_keeps_order)
+{
+  Sent sent;
+  RepOpBatcher batcher(sent.sender());
+  ASSERT_TRUE(batcher.queue(replica1, make_repop(0), max_bytes));
+  ASSERT_TRUE(batcher.queue(replica1, make_repop(1), max_bytes));
+  ASSERT_TRUE(batcher.queue(replica2, make_repop(2), max_bytes));
+
+  // as when batching is turned off with repops still held back
+  batcher.send(replica1, make_repop(3));
+  ASSERT_EQ(2u, sent.messages.size());
+  ASSERT_EQ((vector<ceph_tid_t>{1000, 1001}), sent.messages[0].second);
+  ASSERT_EQ((vector<ceph_tid_t>{1003}), sent.messages[1].second);
+
+  batcher.send(replica2, make_repop(4));
+  ASSERT_EQ(4u, sent.messages.size());
+  ASSERT_EQ(replica2, sent.messages[2].first);
+  ASSERT_EQ((vector<ceph_tid_t>{1002}), sent.messages[2].second);
+  ASSERT_EQ((vector<ceph_tid_t>{1004}), sent.messages[3].second);
+  ASSERT_TRUE(batcher.empty());
+}
+
+TEST(RepOpBatcher, clear)
+{
+  Sent sent;
+  RepOpBatcher batcher(sent.sender());
+  ASSERT_TRUE(batcher.queue(replica1, make_repop(0), max_bytes));
+  batcher.clear();
+  ASSERT_TRUE(batcher.empty());
+  batcher.flush();
+  ASSERT_TRUE(sent.messages.empty());
+}
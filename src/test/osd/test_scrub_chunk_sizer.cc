@@ -0,0 +1,58 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+#include "osd/scrubber/scrub_chunk_sizer.h"
+
+using namespace std::chrono_literals;
+using Scrub::ChunkSizer;
+
+TEST(ChunkSizer, disabled)
+{
+  ChunkSizer sizer;
+  ASSERT_EQ(25, sizer.next_size(0s, 5, 25));
+  sizer.add_sample(1s, 25);
+  ASSERT_EQ(25, sizer.next_size(0s, 5, 25));
+}
+
+TEST(ChunkSizer, starts_small)
+{
+  ChunkSizer sizer;
+  ASSERT_EQ(5, sizer.next_size(100ms, 5, 1000));
+  // nothing learnt from an empty chunk
+  sizer.add_sample(10ms, 0);
+  ASSERT_EQ(5, sizer.next_size(100ms, 5, 1000));
+}
+
+TEST(ChunkSizer, fits_target)
+{
+  ChunkSizer sizer;
+  // small objects: 1ms each
+  sizer.add_sample(5ms, 5);
+  ASSERT_EQ(100, sizer.next_size(100ms, 5, 1000));
+  for (int i = 0; i < 20; ++i) {
+    sizer.add_sample(100ms, 100);
+  }
+  ASSERT_EQ(100, sizer.next_size(100ms, 5, 1000));
+  // bounded by the configured sizes
+  ASSERT_EQ(50, sizer.next_size(100ms, 5, 50));
+  ASSERT_EQ(200, sizer.next_size(10ms, 200, 1000));
+}
+
+TEST(ChunkSizer, follows_object_size)
+{
+  ChunkSizer sizer;
+  sizer.add_sample(10ms, 10);
+  ASSERT_EQ(100, sizer.next_size(100ms, 5, 1000));
+  // the objects got much larger: 10ms each
+  for (int i = 0; i < 20; ++i) {
+    int sz = sizer.next_size(100ms, 5, 1000);
+    sizer.add_sample(std::chrono::milliseconds(10 * sz), sz);
+  }
+  ASSERT_EQ(10, sizer.next_size(100ms, 5, 1000));
+  ASSERT_NEAR(0.01,
+	      std::chrono::duration<double>(sizer.get_per_object()).count(),
+	      1e-4);
+}
@@ -664,6 +664,23 @@ TEST_F(TestTScrubberBe_data_2, smaps_clone_size)
   EXPECT_EQ(incons.size(), 1);	// one inconsistency
 }
 
+// the same, with every object compared by a separate thread
+TEST_F(TestTScrubberBe_data_2, smaps_clone_size_parallel)
+{
+  ASSERT_TRUE(sbe);
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("osd_scrub_compare_parallel_min_objects", "1");
+  conf.set_val_or_die("osd_scrub_compare_threads", "16");
+  logger.set_expected_err_count(1);
+  auto [incons, fix_list] = sbe->scrub_compare_maps(true, *test_scrubber);
+  conf.rm_val("osd_scrub_compare_parallel_min_objects");
+  conf.rm_val("osd_scrub_compare_threads");
+
+  EXPECT_EQ(fix_list.size(), 0);  // snap-mapper fix should be empty
+
+  EXPECT_EQ(incons.size(), 1);	// one inconsistency
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_osdscrub ; ./unittest_osdscrub
 // --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* " End:
@@ -1328,6 +1328,163 @@ TEST(pg_missing_t, split_into)
   EXPECT_TRUE(missing.is_missing(oid2));
 }
 
+static pg_log_dup_t make_dup(unsigned client, version_t v, int rc = 0)
+{
+  return pg_log_dup_t(eversion_t(1, v), v,
+		      osd_reqid_t(entity_name_t::CLIENT(client), 0, v), rc);
+}
+
+TEST(pg_log_dups_t, push_pop)
+{
+  pg_log_dups_t dups;
+  EXPECT_TRUE(dups.empty());
+  for (unsigned v = 10; v < 20; ++v) {
+    dups.push_back(make_dup(v % 3, v));
+  }
+  dups.push_front(make_dup(5, 9, -ENOENT));
+  ASSERT_EQ(11u, dups.size());
+  EXPECT_EQ(make_dup(5, 9, -ENOENT), dups.front());
+  EXPECT_EQ(make_dup(19 % 3, 19), dups.back());
+  EXPECT_EQ(eversion_t(1, 12), dups.get_version(3));
+
+  // sequence numbers stay put as entries come and go at either end
+  auto seq = dups.get_front_seq() + 5;
+  auto dup = dups.at_seq(seq);
+  dups.pop_front();
+  dups.pop_back();
+  dups.push_front(make_dup(5, 8));
+  EXPECT_EQ(dup, dups.at_seq(seq));
+  EXPECT_FALSE(dups.contains(dups.get_back_seq() + 1));
+  EXPECT_FALSE(dups.at_seq(dups.get_back_seq() + 1));
+  EXPECT_FALSE(dups.at_seq(dups.get_front_seq() - 1));
+
+  eversion_t prev;
+  for (const auto& i : dups) {
+    EXPECT_LT(prev, i.version);
+    prev = i.version;
+  }
+  EXPECT_EQ(eversion_t(1, 18), prev);
+  prev = eversion_t::max();
+  for (auto p = dups.rbegin(); p != dups.rend(); ++p) {
+    EXPECT_GT(prev, p->version);
+    prev = p->version;
+  }
+  EXPECT_EQ(eversion_t(1, 8), prev);
+
+  while (!dups.empty()) {
+    dups.pop_back();
+  }
+  dups.push_back(make_dup(1, 1));
+  EXPECT_EQ(make_dup(1, 1), dups.front());
+}
+
+TEST(pg_log_dups_t, op_returns)
+{
+  pg_log_dups_t dups;
+  auto dup = make_dup(1, 1);
+  dup.op_returns.resize(2);
+  dup.op_returns[0].rval = -EINVAL;
+  dup.op_returns[1].bl.append("foo");
+  dups.push_back(make_dup(1, 0));
+  dups.push_back(dup);
+  dups.push_back(make_dup(1, 2));
+  EXPECT_EQ(dup, dups[1]);
+  EXPECT_TRUE(dups.front().op_returns.empty());
+  dups.pop_front();
+  EXPECT_EQ(dup, dups.front());
+  dups.pop_front();
+  dups.push_front(make_dup(1, 1));
+  EXPECT_TRUE(dups.front().op_returns.empty());
+}
+
+TEST(pg_log_dups_t, wrap_around)
+{
+  // trimming from the front while appending at the back, as a PG does,
+  // keeps going round the ring without growing it
+  pg_log_dups_t dups;
+  std::deque<pg_log_dup_t> expected;
+  for (unsigned v = 1; v < 100; ++v) {
+    dups.push_back(make_dup(v % 7, v));
+    expected.push_back(make_dup(v % 7, v));
+    if (expected.size() > 10) {
+      dups.pop_front();
+      expected.pop_front();
+    }
+    if (v % 25 == 0) {
+      dups.push_front(make_dup(1, 0));
+      expected.push_front(make_dup(1, 0));
+    }
+    ASSERT_EQ(expected.size(), dups.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(expected[i], dups[i]);
+    }
+  }
+  dups.clear();
+  EXPECT_TRUE(dups.empty());
+  dups.push_front(make_dup(2, 2));
+  EXPECT_EQ(make_dup(2, 2), dups.back());
+}
+
+TEST(pg_log_dups_t, encode_decode)
+{
+  pg_log_dups_t dups;
+  mempool::osd_pglog::list<pg_log_dup_t> list;
+  for (unsigned v = 1; v < 100; ++v) {
+    auto dup = make_dup(v % 7, v, v % 5 ? 0 : -EIO);
+    if (v % 11 == 0) {
+      dup.op_returns.resize(1);
+      dup.op_returns[0].rval = v;
+    }
+    dups.push_back(dup);
+    list.push_back(dup);
+  }
+
+  // same encoding as the list of pg_log_dup_t it replaces
+  bufferlist bl, list_bl;
+  encode(dups, bl);
+  encode(list, list_bl);
+  EXPECT_TRUE(bl.contents_equal(list_bl));
+
+  pg_log_dups_t decoded;
+  decoded.push_back(make_dup(1, 1000));
+  auto p = list_bl.cbegin();
+  decode(decoded, p);
+  EXPECT_EQ(dups, decoded);
+  EXPECT_EQ(list.size(), decoded.size());
+  auto i = decoded.begin();
+  for (auto& dup : list) {
+    EXPECT_EQ(dup, *i++);
+  }
+}
+
+TEST(pg_log_dups_t, interned_clients)
+{
+  pg_log_dups_t dups;
+  auto before = mempool::osd_pglog::allocated_bytes();
+  for (unsigned v = 0; v < 3000; ++v) {
+    dups.push_back(make_dup(v % 10, v));
+  }
+  auto compact = mempool::osd_pglog::allocated_bytes() - before;
+  mempool::osd_pglog::list<pg_log_dup_t> list;
+  for (const auto& i : dups) {
+    list.push_back(i);
+  }
+  auto listed = mempool::osd_pglog::allocated_bytes() - before - compact;
+  EXPECT_LT(compact * 2, listed);
+
+  // clients go away with their last dup, and their slots are reused
+  for (unsigned v = 0; v < 2995; ++v) {
+    dups.pop_front();
+  }
+  for (unsigned v = 0; v < 5; ++v) {
+    dups.push_back(make_dup(100 + v, 3000 + v));
+  }
+  for (unsigned v = 0; v < 5; ++v) {
+    EXPECT_EQ(make_dup(5 + v, 2995 + v), dups[v]);
+    EXPECT_EQ(make_dup(100 + v, 3000 + v), dups[5 + v]);
+  }
+}
+
 TEST(pg_pool_t_test, get_pg_num_divisor) {
   pg_pool_t p;
   p.set_pg_num(16);
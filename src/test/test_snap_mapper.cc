@@ -50,6 +50,14 @@ class PausyAsyncMap : public MapCacher::StoreDriver<string, bufferlist> {
       }
     }
   };
+  struct RemoveRange : public _Op {
+    string first, last;
+    RemoveRange(const string &first, const string &last)
+      : first(first), last(last) {}
+    void operate(map<string, bufferlist> *store) override {
+      store->erase(store->lower_bound(first), store->lower_bound(last));
+    }
+  };
   struct Insert : public _Op {
     map<string, bufferlist> to_insert;
     explicit Insert(const map<string, bufferlist> &to_insert) : to_insert(to_insert) {}
@@ -81,6 +89,9 @@ public:
     void remove_keys(const set<string> &r) override {
       ops.push_back(Op(new Remove(r)));
     }
+    void remove_range(const string &first, const string &last) override {
+      ops.push_back(Op(new RemoveRange(first, last)));
+    }
     void add_callback(Context *c) override {
       callbacks.push_back(Op(new Callback(c)));
     }
@@ -577,6 +588,43 @@ public:
     snap_to_hobject.erase(snap);
   }
 
+  void trim_snap_batched() {
+    std::lock_guard l{lock};
+    if (snap_to_hobject.empty())
+      return;
+    map<snapid_t, set<hobject_t> >::iterator snap =
+      rand_choose(snap_to_hobject);
+    set<hobject_t> hobjects = snap->second;
+
+    vector<hobject_t> hoids;
+    while (mapper->get_next_objects_to_trim(
+	     snap->first, rand() % 20 + 1, &hoids) == 0) {
+      vector<pair<hobject_t, set<snapid_t>>> updates;
+      for (auto &&hoid: hoids) {
+	ceph_assert(hobjects.count(hoid));
+	hobjects.erase(hoid);
+
+	map<hobject_t, set<snapid_t>>::iterator j =
+	  hobject_to_snap.find(hoid);
+	ceph_assert(j->second.count(snap->first));
+	j->second.erase(snap->first);
+	updates.emplace_back(hoid, j->second);
+	if (j->second.empty()) {
+	  hobject_to_snap.erase(j);
+	}
+      }
+      {
+	PausyAsyncMap::Transaction t;
+	int r = mapper->update_snaps_batch(updates, &t);
+	ceph_assert(r == 0);
+	driver->submit(&t);
+      }
+      hoids.clear();
+    }
+    ceph_assert(hobjects.empty());
+    snap_to_hobject.erase(snap);
+  }
+
   void remove_oid() {
     std::lock_guard l{lock};
     if (hobject_to_snap.empty())
@@ -650,7 +698,7 @@ protected:
     }
   }
 
-  void run() {
+  void run(bool batched_trim = false) {
     for (int i = 0; i < 5000; ++i) {
       if (!(i % 50))
 	std::cout << i << std::endl;
@@ -662,7 +710,10 @@ protected:
 	get_tester().create_object();
 	break;
       case 2:
-	get_tester().trim_snap();
+	if (batched_trim)
+	  get_tester().trim_snap_batched();
+	else
+	  get_tester().trim_snap();
 	break;
       case 3:
 	get_tester().check_oid();
@@ -692,6 +743,16 @@ TEST_F(SnapMapperTest, MultiPG) {
   run();
 }
 
+TEST_F(SnapMapperTest, BatchedTrim) {
+  init(1);
+  run(true);
+}
+
+TEST_F(SnapMapperTest, MultiPGBatchedTrim) {
+  init(50);
+  run(true);
+}
+
 // Check to_object_key against current format to detect accidental changes in encoding
 TEST_F(SnapMapperTest, CheckObjectKeyFormat) {
   init(1);
@@ -70,6 +70,11 @@ void usage()
   cout << "   --read <file>           calculate pg upmap entries to balance pg primaries" << std::endl;
   cout << "   --read-pool <poolname>  specify which pool the read balancer should adjust" << std::endl;
   cout << "   --vstart                prefix upmap and read output with './bin/'" << std::endl;
+  cout << "   --bench-apply <epochs> [--bench-keep <maps>]" << std::endl;
+  cout << "                           time applying <epochs> synthetic incrementals," << std::endl;
+  cout << "                           keeping the last <maps> maps [default: 50]" << std::endl;
+  cout << "   --bench-mapping <rounds> time mapping all pgs <rounds> times, one pg" << std::endl;
+  cout << "                           at a time and one pool at a time" << std::endl;
   exit(1);
 }
 
@@ -118,6 +123,177 @@ void print_inc_upmaps(const OSDMap::Incremental& pending_inc, int fd, bool vstar
   }
 }
 
+static entity_addrvec_t bench_addrs(int osd, int port)
+{
+  entity_addr_t a;
+  a.parse("v2:127.0.0.1:0");
+  a.set_port(port);
+  a.set_nonce(osd);
+  return entity_addrvec_t(a);
+}
+
+/*
+ * Apply a stream of synthetic incrementals on top of the given map the way
+ * an OSD does (copy, apply, encode for the crc, dedup against the previous
+ * epoch), keeping the last keep maps alive like the OSD map cache, and
+ * report the time spent per epoch and the osdmap mempool footprint.
+ */
+static void bench_apply(const OSDMap& base, int epochs, int keep)
+{
+  uint64_t features = CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED;
+  std::vector<pg_t> pgs;
+  for (auto& [poolid, pool] : base.get_pools()) {
+    for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+      pgs.emplace_back(ps, poolid);
+    }
+  }
+  int max_osd = base.get_max_osd();
+  if (pgs.empty() || max_osd < 2) {
+    cerr << "bench-apply needs a map with pools and at least 2 osds"
+	 << std::endl;
+    exit(1);
+  }
+  auto random_pg = [&pgs] {
+    return pgs[ceph::util::generate_random_number<size_t>(0, pgs.size() - 1)];
+  };
+  auto random_osd = [max_osd] {
+    return ceph::util::generate_random_number<int>(0, max_osd - 1);
+  };
+
+  std::set<pg_t> temps;
+  std::deque<std::shared_ptr<OSDMap>> maps;
+  auto prev = std::make_shared<OSDMap>();
+  prev->deepish_copy_from(base);
+  maps.push_back(prev);
+  size_t base_bytes = mempool::osdmap::allocated_bytes();
+
+  ceph::timespan apply_time{0}, encode_time{0}, dedup_time{0};
+  for (int e = 0; e < epochs; ++e) {
+    OSDMap::Incremental inc(prev->get_epoch() + 1);
+    inc.fsid = prev->get_fsid();
+    inc.modified = ceph_clock_now();
+    // a typical epoch under churn: some pg_temp traffic, an up_thru
+    // bump, now and then an upmap change or an osd flapping
+    for (int i = 0; i < 4; ++i) {
+      pg_t pg = random_pg();
+      if (temps.erase(pg)) {
+	inc.new_pg_temp[pg];
+      } else {
+	inc.new_pg_temp[pg] = {random_osd(), random_osd(), random_osd()};
+	temps.insert(pg);
+      }
+    }
+    inc.new_up_thru[random_osd()] = inc.epoch;
+    if (e % 8 == 0) {
+      pg_t pg = random_pg();
+      if (prev->have_pg_upmaps(pg)) {
+	inc.old_pg_upmap_items.insert(pg);
+      } else {
+	inc.new_pg_upmap_items[pg] = {{random_osd(), random_osd()}};
+      }
+    }
+    if (e % 32 == 0) {
+      int osd = random_osd();
+      if (prev->is_up(osd)) {
+	inc.new_state[osd] = CEPH_OSD_UP;
+      } else if (prev->exists(osd)) {
+	inc.new_up_client[osd] = bench_addrs(osd, 6800);
+	inc.new_up_cluster[osd] = bench_addrs(osd, 6801);
+	inc.new_hb_back_up[osd] = bench_addrs(osd, 6802);
+	inc.new_hb_front_up[osd] = bench_addrs(osd, 6803);
+      }
+    }
+
+    auto start = ceph::mono_clock::now();
+    auto next = std::make_shared<OSDMap>();
+    next->deepish_copy_from(*prev);
+    next->apply_incremental(inc);
+    auto applied = ceph::mono_clock::now();
+    bufferlist fbl;
+    next->encode(fbl, features);
+    auto encoded = ceph::mono_clock::now();
+    OSDMap::dedup(prev.get(), next.get());
+    auto deduped = ceph::mono_clock::now();
+    apply_time += applied - start;
+    encode_time += encoded - applied;
+    dedup_time += deduped - encoded;
+
+    maps.push_back(next);
+    while (maps.size() > (size_t)keep) {
+      maps.pop_front();
+    }
+    prev = std::move(next);
+  }
+
+  auto per_epoch = [epochs](ceph::timespan t) {
+    return std::chrono::duration<double, std::micro>(t).count() / epochs;
+  };
+  cout << "applied " << epochs << " epochs, keeping " << maps.size()
+       << " maps" << std::endl;
+  cout << "  apply  " << per_epoch(apply_time) << " us/epoch" << std::endl;
+  cout << "  encode " << per_epoch(encode_time) << " us/epoch" << std::endl;
+  cout << "  dedup  " << per_epoch(dedup_time) << " us/epoch" << std::endl;
+  size_t bytes = mempool::osdmap::allocated_bytes();
+  cout << "  osdmap mempool " << bytes << " bytes, "
+       << (bytes - std::min(bytes, base_bytes)) / std::max<size_t>(1, maps.size() - 1)
+       << " bytes per cached epoch" << std::endl;
+}
+
+/*
+ * Map all the pgs of every pool rounds times, with pg_to_up_acting_osds()
+ * one pg at a time and with pgs_to_up_acting_osds() one pool at a time,
+ * check that both agree and report the time per pg of each.
+ */
+static void bench_mapping(const OSDMap& osdmap, int rounds)
+{
+  ceph::timespan single_time = ceph::timespan::zero();
+  ceph::timespan batch_time = ceph::timespan::zero();
+  uint64_t pgs = 0, mismatches = 0;
+  for (auto& [poolid, pool] : osdmap.get_pools()) {
+    const unsigned pg_num = pool.get_pg_num();
+    std::vector<std::vector<int>> single(pg_num), batch(pg_num);
+    for (int r = 0; r < rounds; ++r) {
+      auto start = ceph::mono_clock::now();
+      for (unsigned ps = 0; ps < pg_num; ++ps) {
+	std::vector<int> up, acting;
+	int up_primary, acting_primary;
+	osdmap.pg_to_up_acting_osds(pg_t(ps, poolid), &up, &up_primary,
+				    &acting, &acting_primary);
+	single[ps] = std::move(acting);
+      }
+      auto mapped = ceph::mono_clock::now();
+      osdmap.pgs_to_up_acting_osds(
+	poolid, 0, pg_num,
+	[&batch](unsigned ps, std::vector<int>&&, int,
+		 std::vector<int>&& acting, int) {
+	  batch[ps] = std::move(acting);
+	});
+      auto batched = ceph::mono_clock::now();
+      single_time += mapped - start;
+      batch_time += batched - mapped;
+      pgs += pg_num;
+    }
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      if (single[ps] != batch[ps]) {
+	cerr << "pg " << pg_t(ps, poolid) << " maps to " << single[ps]
+	     << " one at a time, " << batch[ps] << " batched" << std::endl;
+	++mismatches;
+      }
+    }
+  }
+  auto per_pg = [pgs](ceph::timespan t) {
+    return std::chrono::duration<double, std::micro>(t).count() /
+      std::max<uint64_t>(1, pgs);
+  };
+  cout << "mapped " << pgs << " pgs" << std::endl;
+  cout << "  single  " << per_pg(single_time) << " us/pg" << std::endl;
+  cout << "  batched " << per_pg(batch_time) << " us/pg" << std::endl;
+  if (mismatches) {
+    cerr << mismatches << " pgs mapped differently" << std::endl;
+    exit(1);
+  }
+}
+
 int main(int argc, const char **argv)
 {
   auto args = argv_to_vec(argc, argv);
@@ -181,6 +357,9 @@ int main(int argc, const char **argv)
   bool test_map_pgs_dump_all = false;
   bool save = false;
   bool vstart = false;
+  int bench_epochs = 0;
+  int bench_keep = 50;
+  int bench_rounds = 0;
 
   std::string val;
   std::ostringstream err;
@@ -292,6 +471,9 @@ int main(int argc, const char **argv)
       save = true;
     } else if (ceph_argparse_flag(args, i, "--vstart", (char*)NULL)) {
       vstart = true;
+    } else if (ceph_argparse_witharg(args, i, &bench_epochs, err, "--bench-apply", (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &bench_keep, err, "--bench-keep", (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &bench_rounds, err, "--bench-mapping", (char*)NULL)) {
     } else {
       ++i;
     }
@@ -447,6 +629,14 @@ int main(int argc, const char **argv)
     tmpmap.apply_incremental(pending_inc);
     OSDMap::clean_temps(g_ceph_context, osdmap, tmpmap, &pending_inc);
   }
+  if (bench_epochs > 0) {
+    bench_apply(osdmap, bench_epochs, std::max(1, bench_keep));
+    exit(0);
+  }
+  if (bench_rounds > 0) {
+    bench_mapping(osdmap, bench_rounds);
+    exit(0);
+  }
   int upmap_fd = STDOUT_FILENO;
   if (upmap || upmap_cleanup || read) {
     if (upmap_file != "-") {